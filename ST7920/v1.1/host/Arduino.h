@@ -0,0 +1,165 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Host (Linux) stand-in for the Arduino core, used to build the driver off-target.
+ * Only the functions used by the driver (and the test sketch) are provided.
+ *
+ * Time is simulated: delayMicroseconds()/delay() advance a clock instead of sleeping, and every pin write can be given a cost.
+ * Pin activity is forwarded to attached HostDevice objects (e.g. the ST7920 emulator).
+ */
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define HOST_N_PINS 256u
+#define HOST_MAX_DEVICES 8u
+
+/*Number of digital pins (as on Teensy 4.0)*/
+#define CORE_NUM_DIGITAL 40
+
+extern void pinMode(uint8_t pin, uint8_t mode);
+extern void digitalWrite(uint8_t pin, uint8_t level);
+extern uint8_t digitalRead(uint8_t pin);
+
+extern void hostPinWriteFast(uint8_t pin, uint8_t level);
+extern uint8_t hostPinReadFast(uint8_t pin);
+
+/*
+ * digitalWriteFast() & digitalReadFast()
+ * Teensy core fast pin access. On Teensy, a constant pin number compiles to a single port register access,
+ * anything else falls back to digitalWrite()/digitalRead().
+ * Here, accesses with a constant pin number go through hostPinWriteFast()/hostPinReadFast(): they're counted apart (hostGetPinWriteFastCount())
+ * and cost hostSetPinWriteFastCostNs(). Build with optimization (-O1 or higher), as on Teensy.
+ */
+
+static inline __attribute__((always_inline)) void digitalWriteFast(uint8_t pin, uint8_t level)
+{
+	if(__builtin_constant_p(pin)) hostPinWriteFast(pin, level);
+	else digitalWrite(pin, level);
+}
+
+static inline __attribute__((always_inline)) uint8_t digitalReadFast(uint8_t pin)
+{
+	if(__builtin_constant_p(pin)) return hostPinReadFast(pin);
+
+	return digitalRead(pin);
+}
+
+/*
+ * Cycle counter (ARM_DWT_CYCCNT on Teensy): the simulated clock at F_CPU.
+ */
+
+#define F_CPU 600000000u
+#define ARM_DWT_CYCCNT (hostGetCycleCount())
+
+extern uint32_t hostGetCycleCount(void);
+
+extern void delayMicroseconds(uint32_t us);
+extern void delay(uint32_t ms);
+extern uint32_t micros(void);
+extern uint32_t millis(void);
+
+/*
+ * HostDevice
+ * Something connected to the board pins.
+ */
+
+class HostDevice {
+	public:
+		virtual ~HostDevice(void) {}
+
+		/*
+		 * pinChanged()
+		 * Called after the board changes the level of an output pin.
+		 */
+
+		virtual void pinChanged(uint8_t pin, uint8_t level) { (void) pin; (void) level; }
+
+		/*
+		 * pinRead()
+		 * Called when the board reads a pin.
+		 *
+		 * returns the level driven by the device (0 or 1), or -1 if the device isn't driving that pin.
+		 */
+
+		virtual int32_t pinRead(uint8_t pin) { (void) pin; return -1; }
+
+		/*
+		 * spiTransfer()
+		 * Called for every byte sent on the (host) SPI port.
+		 */
+
+		virtual void spiTransfer(uint8_t byte) { (void) byte; }
+};
+
+/*
+ * hostAttachDevice() & hostDetachDevice()
+ * Connects/disconnects a device to the board pins.
+ *
+ * hostAttachDevice() returns true if successful, false otherwise.
+ */
+
+extern bool hostAttachDevice(HostDevice *device);
+extern void hostDetachDevice(HostDevice *device);
+
+/*
+ * hostGetTimeNs()
+ * Returns the simulated time in nanoseconds.
+ */
+
+extern uint64_t hostGetTimeNs(void);
+
+/*
+ * hostSetPinWriteCostNs()
+ * Sets how much simulated time each digitalWrite()/digitalRead() takes (default 0).
+ */
+
+extern void hostSetPinWriteCostNs(uint32_t ns);
+
+/*
+ * hostSetPinWriteFastCostNs()
+ * Sets how much simulated time each constant pin digitalWriteFast()/digitalReadFast() takes (default 0).
+ */
+
+extern void hostSetPinWriteFastCostNs(uint32_t ns);
+
+/*
+ * hostGetPinWriteCount() & hostGetPinWriteFastCount() & hostGetPinRiseCount() & hostGetDelayUs()
+ * Return the number of pin writes (all of them), the number of constant pin digitalWriteFast() writes, the number of low to high transitions on "pin" (e.g. E strobes)
+ * and the total time spent in delays since the last hostResetCounters().
+ */
+
+extern uint32_t hostGetPinWriteCount(void);
+extern uint32_t hostGetPinWriteFastCount(void);
+extern uint32_t hostGetPinRiseCount(uint8_t pin);
+extern uint64_t hostGetDelayUs(void);
+extern void hostResetCounters(void);
+
+/*
+ * hostSpiTransfer()
+ * Forwards a byte sent on the host SPI port to the attached devices. Used by the SPI stand-in.
+ */
+
+extern void hostSpiTransfer(uint8_t byte);
+
+#endif /*ARDUINO_H*/
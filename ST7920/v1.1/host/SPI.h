@@ -0,0 +1,57 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Host (Linux) stand-in for the Arduino SPI library.
+ * Bytes are forwarded to the attached HostDevice objects (see Arduino.h).
+ */
+
+#ifndef SPI_H
+#define SPI_H
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0c
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+class SPISettings {
+	public:
+		SPISettings(void) {}
+		SPISettings(uint32_t clock_hz, uint8_t bit_order, uint8_t data_mode) { this->clock_hz = clock_hz; (void) bit_order; (void) data_mode; }
+
+		uint32_t clock_hz = 4000000u;
+};
+
+class SPIClass {
+	public:
+		void begin(void) {}
+		void end(void) {}
+
+		void beginTransaction(SPISettings settings);
+		void endTransaction(void);
+
+		uint8_t transfer(uint8_t byte);
+		void transfer(const void *buf, void *retbuf, size_t count);
+		void transfer(void *buf, size_t count);
+
+		/*Host only: transactions begun and bytes transferred so far.*/
+		uint32_t transaction_count = 0u;
+		uint32_t byte_count = 0u;
+
+	private:
+		uint32_t _byte_time_ns = 2000u;
+};
+
+extern SPIClass SPI;
+
+#endif /*SPI_H*/
@@ -0,0 +1,447 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Animation check: sample clips encoded with host/st7920_anim_encoder, played with animationBegin() / bufferAnimationFrame() on
+ * ST7920 (128x64, folded), ST7920_256x32 and ST7920_192x32.
+ *
+ * Clips: boot (progress bar under a logo), spinner (status loop: a spinning line and a blinking dot), ball (bouncing ball over a grid,
+ * a keyframe every 16 frames), runs (random pages from a few values: every kind of run) and noise (random pixels: worst case).
+ * Each clip is played twice (looping). After every frame and bufferPaintDirty(), the emulated screen must show the frame, and the paint
+ * must only send the pages that changed since the previous frame. A clip played without looping must end after its last frame.
+ *
+ * Damaged animations (truncated, random bytes changed) and animations for another panel must be rejected: a damaged frame fails,
+ * leaves the buffer as it was and stops the animation.
+ *
+ * Prints the compression ratio and the bytes sent per frame of each clip, next to bufferPaintAll().
+ * Exit status is 1 if any check fails or the emulator saw a transfer while the display was busy.
+ *
+ * usage: st7920_anim_check
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+#include "st7920_anim_encoder.hpp"
+
+#define CHECK_DB0 2
+#define CHECK_DB1 3
+#define CHECK_DB2 4
+#define CHECK_DB3 5
+#define CHECK_DB4 6
+#define CHECK_DB5 7
+#define CHECK_DB6 8
+#define CHECK_DB7 9
+#define CHECK_RS 10
+#define CHECK_E 11
+
+#define CHECK_MAX_FRAMES 64u
+#define CHECK_IMAGE_SIZE 1024u
+
+static ST7920Emulator emulator(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 0xff, CHECK_E);
+
+static ST7920 panel_128x64(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+static ST7920_256x32 panel_256x32(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+static ST7920_192x32 panel_192x32(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+
+enum CheckClip {
+	CHECK_CLIP_BOOT = 0,
+	CHECK_CLIP_SPINNER = 1,
+	CHECK_CLIP_BALL = 2,
+	CHECK_CLIP_RUNS = 3,
+	CHECK_CLIP_NOISE = 4,
+	CHECK_N_CLIPS = 5
+};
+
+static const char *clip_names[CHECK_N_CLIPS] = {"boot", "spinner", "ball", "runs", "noise"};
+static const uint32_t clip_frames[CHECK_N_CLIPS] = {40u, 12u, 48u, 16u, 8u};
+static const uint32_t clip_keyframe_interval[CHECK_N_CLIPS] = {0u, 0u, 16u, 0u, 0u};
+
+static uint8_t images[CHECK_MAX_FRAMES][CHECK_IMAGE_SIZE];
+static uint8_t anim[CHECK_MAX_FRAMES*(ST7920_ANIM_FRAME_HEADER_SIZE + 1100u) + ST7920_ANIM_HEADER_SIZE];
+static uint8_t damaged[sizeof(anim)];
+static uint8_t shown[CHECK_IMAGE_SIZE];
+
+static uint32_t check_rand_state = 0x2545f491u;
+
+static uint32_t check_random(void)
+{
+	uint32_t x = check_rand_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	check_rand_state = x;
+	return x;
+}
+
+static void image_plot(uint8_t *image, uint32_t width, uint32_t height, int32_t cx, int32_t cy)
+{
+	if((cx < 0) || (cy < 0) || (cx >= ((int32_t) width)) || (cy >= ((int32_t) height))) return;
+
+	image[((uint32_t) cy)*(width/8u) + ((uint32_t) cx)/8u] |= (uint8_t) (0x80 >> (cx % 8));
+	return;
+}
+
+static void image_rect(uint8_t *image, uint32_t width, uint32_t height, int32_t cx, int32_t cy, int32_t w, int32_t h, bool fill)
+{
+	int32_t x = 0;
+	int32_t y = 0;
+
+	for(y = cy; y < (cy + h); y++)
+	{
+		for(x = cx; x < (cx + w); x++)
+		{
+			if(fill || (x == cx) || (y == cy) || (x == (cx + w - 1)) || (y == (cy + h - 1))) image_plot(image, width, height, x, y);
+		}
+	}
+
+	return;
+}
+
+/*Draws frame n_frame of a clip*/
+static void clip_draw(uint32_t clip, uint32_t n_frame, uint32_t width, uint32_t height, uint8_t *image)
+{
+	int32_t x = 0;
+	int32_t y = 0;
+	int32_t cx = 0;
+	int32_t cy = 0;
+	int32_t r = 0;
+	uint32_t n_page = 0u;
+	uint16_t page_value = 0u;
+	static const int8_t spin_x[8] = {0, 4, 6, 4, 0, -4, -6, -4};
+	static const int8_t spin_y[8] = {-6, -4, 0, 4, 6, 4, 0, -4};
+	static const uint16_t run_values[4] = {0x0000, 0xffff, 0x0ff0, 0x8001};
+
+	memset(image, 0, width*height/8u);
+
+	switch(clip)
+	{
+		case CHECK_CLIP_BOOT:
+			image_rect(image, width, height, ((int32_t) width)/2 - 20, 2, 40, 14, false);
+			image_rect(image, width, height, ((int32_t) width)/2 - 16, 6, 32, 6, true);
+			image_rect(image, width, height, 8, ((int32_t) height) - 10, ((int32_t) width) - 16, 7, false);
+			image_rect(image, width, height, 10, ((int32_t) height) - 8, (int32_t) ((width - 20u)*(n_frame + 1u)/clip_frames[clip]), 3, true);
+			break;
+
+		case CHECK_CLIP_SPINNER:
+			/*Static screen, with the status in the top right corner*/
+			for(y = 0; y < ((int32_t) height); y += 4) image_rect(image, width, height, 0, y, ((int32_t) width) - 24, 1, true);
+
+			for(r = 0; r < 6; r++) image_plot(image, width, height, ((int32_t) width) - 12 + spin_x[n_frame % 8u]*r/6, 10 + spin_y[n_frame % 8u]*r/6);
+			if(n_frame & 0x4) image_rect(image, width, height, ((int32_t) width) - 14, 22, 4, 4, true);
+			break;
+
+		case CHECK_CLIP_BALL:
+			for(x = 0; x < ((int32_t) width); x += 16) image_rect(image, width, height, x, 0, 1, (int32_t) height, true);
+			for(y = 0; y < ((int32_t) height); y += 16) image_rect(image, width, height, 0, y, (int32_t) width, 1, true);
+
+			cx = 8 + ((int32_t) (n_frame*5u % (2u*(width - 16u))));
+			if(cx > ((int32_t) (width - 8u))) cx = 2*((int32_t) (width - 8u)) - cx + 8;
+			cy = 6 + ((int32_t) (n_frame*3u % (2u*(height - 12u))));
+			if(cy > ((int32_t) (height - 6u))) cy = 2*((int32_t) (height - 6u)) - cy + 6;
+
+			for(y = -6; y <= 6; y++)
+			{
+				for(x = -6; x <= 6; x++) if((x*x + y*y) <= 36) image_plot(image, width, height, cx + x, cy + y);
+			}
+			break;
+
+		case CHECK_CLIP_RUNS:
+			for(n_page = 0u; n_page < width*height/16u; n_page++)
+			{
+				if(check_random() % 4u) page_value = run_values[check_random() % 4u];
+				else page_value = (uint16_t) check_random();
+
+				image[2u*n_page] = (uint8_t) (page_value >> 8);
+				image[2u*n_page + 1u] = (uint8_t) (page_value & 0xff);
+			}
+			break;
+
+		default:
+			for(n_page = 0u; n_page < width*height/8u; n_page++) image[n_page] = (uint8_t) check_random();
+			break;
+	}
+
+	return;
+}
+
+/*Pages (16 pixels of a row) that differ between two images*/
+static uint32_t count_changed_pages(const uint8_t *image0, const uint8_t *image1, uint32_t width, uint32_t height)
+{
+	uint32_t n_page = 0u;
+	uint32_t n_changed = 0u;
+
+	for(n_page = 0u; n_page < width*height/16u; n_page++)
+	{
+		if((image0[2u*n_page] != image1[2u*n_page]) || (image0[2u*n_page + 1u] != image1[2u*n_page + 1u])) n_changed++;
+	}
+
+	return n_changed;
+}
+
+template<class Panel>
+static bool panel_setup(Panel &panel)
+{
+	emulator.reset();
+	if(!emulator.setPanel(panel.WIDTH, panel.HEIGHT, (panel.HEIGHT > 32u))) return false;
+
+	if(!panel.begin()) return false;
+
+	panel.enableGraphicDisplay(true);
+	panel.clearDisplay();
+	return true;
+}
+
+template<class Panel>
+static void buffer_snapshot(Panel &panel, uint16_t *pages)
+{
+	uint32_t cy = 0u;
+	uint32_t page_index = 0u;
+
+	for(cy = 0u; cy < panel.HEIGHT; cy++)
+	{
+		for(page_index = 0u; page_index < panel.WIDTH_PAGES; page_index++) pages[cy*panel.WIDTH_PAGES + page_index] = (uint16_t) panel.bufferGetPage(page_index, cy);
+	}
+
+	return;
+}
+
+/*Plays a clip twice (looping), checking every frame. Then once without looping.*/
+template<class Panel>
+static uint32_t check_clip(Panel &panel, const char *name, uint32_t clip)
+{
+	uint32_t width = panel.WIDTH;
+	uint32_t height = panel.HEIGHT;
+	uint32_t n_frames = clip_frames[clip];
+	uint32_t n_frame = 0u;
+	uint32_t n_loop = 0u;
+	uint32_t size = 0u;
+	uint32_t n_keyframes = 0u;
+	uint32_t n_changed = 0u;
+	uint32_t sent = 0u;
+	uint32_t sent_total = 0u;
+	uint32_t paint_all = 0u;
+	uint32_t n_fail = 0u;
+	int32_t retval = 0;
+	const uint8_t *prev = NULL;
+
+	/*Frames are consecutive images of width*height/8 bytes*/
+	for(n_frame = 0u; n_frame < n_frames; n_frame++) clip_draw(clip, n_frame, width, height, &images[0][0] + n_frame*width*height/8u);
+
+	size = st7920AnimEncode(&images[0][0], n_frames, width, height, 40u, clip_keyframe_interval[clip], anim, sizeof(anim), &n_keyframes);
+	if(!size || (size > st7920AnimMaxSize(n_frames, width, height)))
+	{
+		printf("%s %s: encoded size %u (at most %u)\n", name, clip_names[clip], size, st7920AnimMaxSize(n_frames, width, height));
+		return 1u;
+	}
+
+	if(!panel_setup(panel)) return 1u;
+
+	panel.resetBusByteCount();
+	panel.bufferPaintAll();
+	paint_all = panel.getBusByteCount();
+
+	if(!panel.animationBegin(anim, size, true))
+	{
+		printf("%s %s: animationBegin() failed\n", name, clip_names[clip]);
+		return 1u;
+	}
+
+	if(panel.getAnimationFramePeriod() != 40)
+	{
+		printf("%s %s: frame period %d, expected 40\n", name, clip_names[clip], panel.getAnimationFramePeriod());
+		n_fail++;
+	}
+
+	for(n_loop = 0u; n_loop < 2u; n_loop++)
+	{
+		for(n_frame = 0u; n_frame < n_frames; n_frame++)
+		{
+			retval = panel.bufferAnimationFrame();
+			if((retval != 1) || (panel.getAnimationFrameIndex() != ((int32_t) n_frame)))
+			{
+				printf("%s %s: loop %u frame %u: bufferAnimationFrame() returned %d (frame index %d)\n", name, clip_names[clip], n_loop, n_frame, retval, panel.getAnimationFrameIndex());
+				return n_fail + 1u;
+			}
+
+			panel.resetBusByteCount();
+			panel.bufferPaintDirty();
+			sent = panel.getBusByteCount();
+			sent_total += sent;
+
+			emulator.render(shown);
+			if(memcmp(shown, &images[0][0] + n_frame*width*height/8u, width*height/8u))
+			{
+				printf("%s %s: loop %u frame %u: screen differs from the frame\n", name, clip_names[clip], n_loop, n_frame);
+				n_fail++;
+			}
+
+			/*Only changed pages are sent: each one 2 data bytes, at most 2 address bytes (and the instruction set once)*/
+			if(n_frame) prev = &images[0][0] + (n_frame - 1u)*width*height/8u;
+			else if(n_loop) prev = &images[0][0] + (n_frames - 1u)*width*height/8u;
+			else prev = NULL;
+
+			if(prev != NULL)
+			{
+				n_changed = count_changed_pages(prev, &images[0][0] + n_frame*width*height/8u, width, height);
+				if(sent > (n_changed ? (1u + 4u*n_changed) : 0u))
+				{
+					printf("%s %s: loop %u frame %u: %u bytes sent for %u changed pages\n", name, clip_names[clip], n_loop, n_frame, sent, n_changed);
+					n_fail++;
+				}
+			}
+		}
+	}
+
+	/*Not looping: over after the last frame*/
+	panel.animationBegin(anim, size, false);
+	for(n_frame = 0u; n_frame < n_frames; n_frame++) panel.bufferAnimationFrame();
+
+	retval = panel.bufferAnimationFrame();
+	if(retval != 0)
+	{
+		printf("%s %s: bufferAnimationFrame() after the last frame returned %d, expected 0\n", name, clip_names[clip], retval);
+		n_fail++;
+	}
+
+	printf("%s %s: %u frames (%u keyframes), %u bytes raw, %u bytes encoded (%.1f:1), %.1f bytes sent per frame (bufferPaintAll(): %u)\n", name, clip_names[clip], n_frames, n_keyframes,
+		n_frames*width*height/8u, size, ((double) (n_frames*width*height/8u))/size, ((double) sent_total)/(2u*n_frames), paint_all);
+
+	return n_fail;
+}
+
+/*Truncated and randomly changed animations: frames either decode fully or fail without touching the buffer*/
+template<class Panel>
+static uint32_t check_damaged(Panel &panel, const char *name)
+{
+	static uint16_t before[512];
+	static uint16_t after[512];
+	uint32_t n_frames = clip_frames[CHECK_CLIP_SPINNER];
+	uint32_t size = 0u;
+	uint32_t damaged_size = 0u;
+	uint32_t n_trial = 0u;
+	uint32_t n_call = 0u;
+	uint32_t n_byte = 0u;
+	uint32_t n_fail = 0u;
+	uint32_t n_rejected = 0u;
+	int32_t retval = 0;
+
+	for(n_call = 0u; n_call < n_frames; n_call++) clip_draw(CHECK_CLIP_SPINNER, n_call, panel.WIDTH, panel.HEIGHT, &images[0][0] + n_call*panel.WIDTH*panel.HEIGHT/8u);
+
+	size = st7920AnimEncode(&images[0][0], n_frames, panel.WIDTH, panel.HEIGHT, 40u, 4u, anim, sizeof(anim), NULL);
+	if(!panel_setup(panel)) return 1u;
+
+	for(n_trial = 0u; n_trial < 600u; n_trial++)
+	{
+		memcpy(damaged, anim, size);
+		damaged_size = size;
+
+		if(n_trial < 200u) damaged_size = check_random() % size;
+		else for(n_byte = 0u; n_byte < (1u + n_trial % 3u); n_byte++) damaged[check_random() % size] ^= (uint8_t) (1u + check_random() % 255u);
+
+		if(!panel.animationBegin(damaged, damaged_size, true))
+		{
+			n_rejected++;
+			continue;
+		}
+
+		for(n_call = 0u; n_call < 3u*n_frames; n_call++)
+		{
+			buffer_snapshot(panel, before);
+			retval = panel.bufferAnimationFrame();
+			if(retval == 1) continue;
+
+			n_rejected++;
+			buffer_snapshot(panel, after);
+			if((retval != -1) || memcmp(before, after, panel.WIDTH_PAGES*panel.HEIGHT*sizeof(uint16_t)))
+			{
+				printf("%s: damaged animation (trial %u): bufferAnimationFrame() returned %d, buffer %s\n", name, n_trial, retval, (memcmp(before, after, panel.WIDTH_PAGES*panel.HEIGHT*sizeof(uint16_t)) ? "changed" : "unchanged"));
+				n_fail++;
+			}
+
+			/*Stopped*/
+			if(panel.bufferAnimationFrame() != -1)
+			{
+				printf("%s: damaged animation (trial %u) didn't stop\n", name, n_trial);
+				n_fail++;
+			}
+
+			break;
+		}
+
+		if(n_fail > 8u) break;
+	}
+
+	printf("%s: %u of %u damaged animations rejected (the others decode to other pictures)\n", name, n_rejected, n_trial);
+	return n_fail;
+}
+
+template<class Panel>
+static uint32_t check_panel(Panel &panel, const char *name)
+{
+	uint32_t n_fail = 0u;
+	uint32_t clip = 0u;
+
+	for(clip = 0u; clip < CHECK_N_CLIPS; clip++) n_fail += check_clip(panel, name, clip);
+
+	n_fail += check_damaged(panel, name);
+
+	printf("%s: %s (%u failures)\n", name, (n_fail ? "FAIL" : "ok"), n_fail);
+	return n_fail;
+}
+
+/*An animation plays on the panel it was made for only*/
+static uint32_t check_other_panel(void)
+{
+	uint32_t size = 0u;
+	uint32_t n_fail = 0u;
+
+	clip_draw(CHECK_CLIP_BOOT, 0u, 256u, 32u, &images[0][0]);
+	size = st7920AnimEncode(&images[0][0], 1u, 256u, 32u, 40u, 0u, anim, sizeof(anim), NULL);
+
+	if(!panel_setup(panel_128x64)) return 1u;
+	if(panel_128x64.animationBegin(anim, size, false) || (panel_128x64.bufferAnimationFrame() != -1))
+	{
+		printf("128x64: 256x32 animation not rejected\n");
+		n_fail++;
+	}
+
+	if(!panel_setup(panel_192x32)) return 1u;
+	if(panel_192x32.animationBegin(anim, size, false))
+	{
+		printf("192x32: 256x32 animation not rejected\n");
+		n_fail++;
+	}
+
+	return n_fail;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t n_fail = 0u;
+
+	(void) argc;
+	(void) argv;
+
+	n_fail += check_panel(panel_128x64, "128x64");
+	n_fail += check_panel(panel_256x32, "256x32");
+	n_fail += check_panel(panel_192x32, "192x32");
+	n_fail += check_other_panel();
+
+	if(emulator.getViolationCount()) n_fail++;
+
+	if(n_fail) return 1;
+
+	return 0;
+}
@@ -0,0 +1,253 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Animation encoder tool: PBM frames (P1 or P4, all the size of the panel) to an animation for ST7920::animationBegin().
+ *
+ * output.h: C header with the animation as a const uint8_t array (name set with -n). Any other output name: raw animation file.
+ * -k: a keyframe at least every keyframe_interval frames (default 0: first frame only). -p: frame period in ms (default 40).
+ *
+ * Prints the number of frames and keyframes, the raw (1 bit per pixel) and encoded sizes, and the compression ratio.
+ *
+ * usage: st7920_anim_encode [-k keyframe_interval] [-p period_ms] [-n name] output frame.pbm [frame.pbm ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "st7920_anim_encoder.hpp"
+
+/*Next PBM header value (skips whitespace and comments). -1 if none.*/
+static int32_t pbm_read_value(FILE *file)
+{
+	int32_t value = -1;
+	int c = 0;
+
+	while((c = fgetc(file)) != EOF)
+	{
+		if(c == '#')
+		{
+			while(((c = fgetc(file)) != EOF) && (c != '\n'));
+			continue;
+		}
+
+		if((c >= '0') && (c <= '9')) break;
+		if((c != ' ') && (c != '\t') && (c != '\r') && (c != '\n')) return -1;
+	}
+
+	if(c == EOF) return -1;
+
+	value = 0;
+	while((c >= '0') && (c <= '9'))
+	{
+		value = 10*value + (c - '0');
+		c = fgetc(file);
+	}
+
+	return value;
+}
+
+/*Reads the pixels of a PBM image of width x height into image (width/8 bytes per row, MSB first). returns true if successful, false otherwise.*/
+static bool pbm_read_pixels(FILE *file, const char *path, uint32_t width, uint32_t height, uint8_t *image)
+{
+	uint32_t cx = 0u;
+	uint32_t cy = 0u;
+	int32_t value = 0;
+	char magic[2];
+
+	if((fread(magic, 1, 2, file) != 2) || (magic[0] != 'P') || ((magic[1] != '1') && (magic[1] != '4')))
+	{
+		fprintf(stderr, "st7920_anim_encode: %s is not a PBM image\n", path);
+		return false;
+	}
+
+	if((pbm_read_value(file) != ((int32_t) width)) || (pbm_read_value(file) != ((int32_t) height)))
+	{
+		fprintf(stderr, "st7920_anim_encode: %s is not %ux%u\n", path, width, height);
+		return false;
+	}
+
+	/*P4: the single whitespace after the height was read with it*/
+	if(magic[1] == '4')
+	{
+		if(fread(image, 1, width*height/8u, file) == width*height/8u) return true;
+
+		fprintf(stderr, "st7920_anim_encode: %s is truncated\n", path);
+		return false;
+	}
+
+	memset(image, 0, width*height/8u);
+
+	for(cy = 0u; cy < height; cy++)
+	{
+		for(cx = 0u; cx < width; cx++)
+		{
+			value = fgetc(file);
+			while((value == ' ') || (value == '\t') || (value == '\r') || (value == '\n')) value = fgetc(file);
+
+			if((value != '0') && (value != '1'))
+			{
+				fprintf(stderr, "st7920_anim_encode: %s is truncated\n", path);
+				return false;
+			}
+
+			if(value == '1') image[cy*(width/8u) + cx/8u] |= (uint8_t) (0x80 >> (cx % 8u));
+		}
+	}
+
+	return true;
+}
+
+static bool pbm_read(const char *path, uint32_t width, uint32_t height, uint8_t *image)
+{
+	FILE *file = NULL;
+	bool retval = false;
+
+	file = fopen(path, "rb");
+	if(file == NULL)
+	{
+		fprintf(stderr, "st7920_anim_encode: can't open %s\n", path);
+		return false;
+	}
+
+	retval = pbm_read_pixels(file, path, width, height, image);
+
+	fclose(file);
+	return retval;
+}
+
+/*PBM header size, without reading the pixels*/
+static bool pbm_size(const char *path, uint32_t *p_width, uint32_t *p_height)
+{
+	FILE *file = NULL;
+	int32_t width = 0;
+	int32_t height = 0;
+	char magic[2];
+
+	file = fopen(path, "rb");
+	if(file == NULL) return false;
+
+	if((fread(magic, 1, 2, file) == 2) && (magic[0] == 'P') && ((magic[1] == '1') || (magic[1] == '4')))
+	{
+		width = pbm_read_value(file);
+		height = pbm_read_value(file);
+	}
+
+	fclose(file);
+
+	if((width <= 0) || (height <= 0)) return false;
+
+	*p_width = (uint32_t) width;
+	*p_height = (uint32_t) height;
+	return true;
+}
+
+static bool write_output(const char *path, const char *name, const uint8_t *anim, uint32_t size)
+{
+	FILE *file = NULL;
+	uint32_t n_byte = 0u;
+	size_t length = strlen(path);
+
+	file = fopen(path, "wb");
+	if(file == NULL) return false;
+
+	if((length > 2u) && !strcmp(&path[length - 2u], ".h"))
+	{
+		fprintf(file, "/*Made by st7920_anim_encode. Play with animationBegin(%s, sizeof(%s), loop).*/\n\n", name, name);
+		fprintf(file, "static const uint8_t %s[%u] = {", name, size);
+
+		for(n_byte = 0u; n_byte < size; n_byte++)
+		{
+			if(n_byte) fprintf(file, ",");
+
+			if(!(n_byte % 16u)) fprintf(file, "\n\t");
+			else fprintf(file, " ");
+
+			fprintf(file, "0x%02x", anim[n_byte]);
+		}
+
+		fprintf(file, "\n};\n");
+	}
+	else fwrite(anim, 1, size, file);
+
+	fclose(file);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	const char *name = "st7920_animation";
+	const char *output = NULL;
+	uint32_t keyframe_interval = 0u;
+	uint32_t period_ms = 40u;
+	uint32_t width = 0u;
+	uint32_t height = 0u;
+	uint32_t image_size = 0u;
+	uint32_t n_frames = 0u;
+	uint32_t n_frame = 0u;
+	uint32_t max_size = 0u;
+	uint32_t size = 0u;
+	uint32_t n_keyframes = 0u;
+	uint8_t *images = NULL;
+	uint8_t *anim = NULL;
+	int n_arg = 1;
+
+	for(; (n_arg + 1) < argc; n_arg += 2)
+	{
+		if(!strcmp(argv[n_arg], "-k")) keyframe_interval = (uint32_t) strtoul(argv[n_arg + 1], NULL, 0);
+		else if(!strcmp(argv[n_arg], "-p")) period_ms = (uint32_t) strtoul(argv[n_arg + 1], NULL, 0);
+		else if(!strcmp(argv[n_arg], "-n")) name = argv[n_arg + 1];
+		else break;
+	}
+
+	if((argc - n_arg) < 2)
+	{
+		fprintf(stderr, "usage: st7920_anim_encode [-k keyframe_interval] [-p period_ms] [-n name] output frame.pbm [frame.pbm ...]\n");
+		return 2;
+	}
+
+	output = argv[n_arg++];
+	n_frames = (uint32_t) (argc - n_arg);
+
+	if(!pbm_size(argv[n_arg], &width, &height) || !st7920AnimPanelIsValid(width, height))
+	{
+		fprintf(stderr, "st7920_anim_encode: %s: frames must be 128x64 or (up to 256)x32 PBM images\n", argv[n_arg]);
+		return 1;
+	}
+
+	image_size = width*height/8u;
+	images = (uint8_t*) malloc(n_frames*image_size);
+
+	for(n_frame = 0u; n_frame < n_frames; n_frame++)
+	{
+		if(pbm_read(argv[n_arg + (int) n_frame], width, height, &images[n_frame*image_size])) continue;
+
+		free(images);
+		return 1;
+	}
+
+	max_size = st7920AnimMaxSize(n_frames, width, height);
+	anim = (uint8_t*) malloc(max_size);
+
+	size = st7920AnimEncode(images, n_frames, width, height, period_ms, keyframe_interval, anim, max_size, &n_keyframes);
+
+	if(!size || !write_output(output, name, anim, size))
+	{
+		fprintf(stderr, "st7920_anim_encode: can't encode %s\n", output);
+		free(images);
+		free(anim);
+		return 1;
+	}
+
+	printf("%s: %ux%u, %u frames (%u keyframes), %u bytes raw, %u bytes encoded, ratio %.1f:1\n", output, width, height, n_frames, n_keyframes, n_frames*image_size, size, ((double) (n_frames*image_size))/size);
+
+	free(images);
+	free(anim);
+	return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "st7920_anim_encoder.hpp"
+
+static void anim_put_u16(uint8_t *bytes, uint32_t value)
+{
+	bytes[0] = (uint8_t) (value & 0xff);
+	bytes[1] = (uint8_t) ((value >> 8) & 0xff);
+	return;
+}
+
+bool st7920AnimPanelIsValid(uint32_t width, uint32_t height)
+{
+	if((width == 128u) && (height == 64u)) return true;
+	if(height != 32u) return false;
+	if(!width || (width > 256u) || (width % 16u)) return false;
+
+	return true;
+}
+
+void st7920AnimPackImage(const uint8_t *image, uint32_t width, uint32_t height, uint16_t *pages)
+{
+	uint32_t width_pages = width/16u;
+	uint32_t row_pages = width_pages;
+	uint32_t cy = 0u;
+	uint32_t n_page = 0u;
+	const uint8_t *row = NULL;
+
+	if(height > 32u) row_pages = 2u*width_pages;
+
+	for(cy = 0u; cy < height; cy++)
+	{
+		row = &image[cy*(width/8u)];
+
+		for(n_page = 0u; n_page < width_pages; n_page++) pages[row_pages*(cy % 32u) + (cy/32u)*width_pages + n_page] = (uint16_t) ((row[2u*n_page] << 8) | row[2u*n_page + 1u]);
+	}
+
+	return;
+}
+
+/*
+ * Zero pages: zero run. 2 or more equal pages: repeat run. Anything else: literal run, up to the next zero page or pair of equal pages.
+ * Worst case: 2 bytes per page, + 1 per 128 pages (literal runs cut), + 1 (a single page literal run costs 3 bytes, but each zero or
+ * repeat run next to it saves at least 1).
+ */
+uint32_t st7920AnimEncodePages(const uint16_t *values, uint32_t n_pages, uint8_t *out)
+{
+	uint32_t n_bytes = 0u;
+	uint32_t index = 0u;
+	uint32_t n_run = 0u;
+	uint32_t n_page = 0u;
+
+	while(n_pages && !values[n_pages - 1u]) n_pages--;
+
+	while(index < n_pages)
+	{
+		n_run = 1u;
+
+		if(!values[index])
+		{
+			while(((index + n_run) < n_pages) && (n_run < ST7920_ANIM_MAX_ZERO_RUN) && !values[index + n_run]) n_run++;
+
+			out[n_bytes++] = (uint8_t) (ST7920_ANIM_ZERO_RUN | (n_run - 1u));
+		}
+		else
+		{
+			while(((index + n_run) < n_pages) && (n_run < ST7920_ANIM_MAX_REPEAT_RUN) && (values[index + n_run] == values[index])) n_run++;
+
+			if(n_run > 1u)
+			{
+				out[n_bytes++] = (uint8_t) (ST7920_ANIM_REPEAT_RUN | (n_run - 1u));
+				anim_put_u16(&out[n_bytes], values[index]);
+				n_bytes += 2u;
+			}
+			else
+			{
+				while(((index + n_run) < n_pages) && (n_run < ST7920_ANIM_MAX_LITERAL_RUN) && values[index + n_run])
+				{
+					if(((index + n_run + 1u) < n_pages) && (values[index + n_run + 1u] == values[index + n_run])) break;
+					n_run++;
+				}
+
+				out[n_bytes++] = (uint8_t) (ST7920_ANIM_LITERAL_RUN | (n_run - 1u));
+
+				for(n_page = 0u; n_page < n_run; n_page++)
+				{
+					anim_put_u16(&out[n_bytes], values[index + n_page]);
+					n_bytes += 2u;
+				}
+			}
+		}
+
+		index += n_run;
+	}
+
+	return n_bytes;
+}
+
+uint32_t st7920AnimMaxPayloadSize(uint32_t n_pages)
+{
+	return (2u*n_pages + (n_pages + ST7920_ANIM_MAX_LITERAL_RUN - 1u)/ST7920_ANIM_MAX_LITERAL_RUN + 1u);
+}
+
+uint32_t st7920AnimMaxSize(uint32_t n_frames, uint32_t width, uint32_t height)
+{
+	return (ST7920_ANIM_HEADER_SIZE + n_frames*(ST7920_ANIM_FRAME_HEADER_SIZE + st7920AnimMaxPayloadSize(width*height/16u)));
+}
+
+uint32_t st7920AnimEncode(const uint8_t *images, uint32_t n_frames, uint32_t width, uint32_t height, uint32_t period_ms, uint32_t keyframe_interval, uint8_t *out, uint32_t out_size, uint32_t *p_n_keyframes)
+{
+	uint32_t n_pages = width*height/16u;
+	uint32_t image_size = width*height/8u;
+	uint32_t n_frame = 0u;
+	uint32_t n_page = 0u;
+	uint32_t n_bytes = 0u;
+	uint32_t n_key_bytes = 0u;
+	uint32_t n_delta_bytes = 0u;
+	uint32_t n_keyframes = 0u;
+	uint16_t *pages = NULL;
+	uint16_t *prev_pages = NULL;
+	uint16_t *delta = NULL;
+	uint8_t *key_payload = NULL;
+	uint8_t *delta_payload = NULL;
+	bool key = false;
+
+	if(!st7920AnimPanelIsValid(width, height)) return 0u;
+	if(!n_frames || (n_frames > 0xffff)) return 0u;
+	if(period_ms > 0xffff) return 0u;
+	if(out_size < st7920AnimMaxSize(n_frames, width, height)) return 0u;
+
+	pages = (uint16_t*) malloc(n_pages*sizeof(uint16_t));
+	prev_pages = (uint16_t*) malloc(n_pages*sizeof(uint16_t));
+	delta = (uint16_t*) malloc(n_pages*sizeof(uint16_t));
+	key_payload = (uint8_t*) malloc(st7920AnimMaxPayloadSize(n_pages));
+	delta_payload = (uint8_t*) malloc(st7920AnimMaxPayloadSize(n_pages));
+
+	out[0] = 'S';
+	out[1] = '7';
+	out[2] = 'A';
+	out[3] = 'N';
+	out[4] = ST7920_ANIM_VERSION;
+	out[5] = 0u;
+	anim_put_u16(&out[6], width);
+	anim_put_u16(&out[8], height);
+	anim_put_u16(&out[10], n_frames);
+	anim_put_u16(&out[12], period_ms);
+	n_bytes = ST7920_ANIM_HEADER_SIZE;
+
+	for(n_frame = 0u; n_frame < n_frames; n_frame++)
+	{
+		st7920AnimPackImage(&images[n_frame*image_size], width, height, pages);
+
+		n_key_bytes = st7920AnimEncodePages(pages, n_pages, key_payload);
+
+		key = true;
+		if(n_frame && (!keyframe_interval || (n_frame % keyframe_interval)))
+		{
+			for(n_page = 0u; n_page < n_pages; n_page++) delta[n_page] = pages[n_page] ^ prev_pages[n_page];
+
+			n_delta_bytes = st7920AnimEncodePages(delta, n_pages, delta_payload);
+			if(n_delta_bytes < n_key_bytes) key = false;
+		}
+
+		if(key)
+		{
+			out[n_bytes] = ST7920_ANIM_KEYFRAME;
+			anim_put_u16(&out[n_bytes + 1u], n_key_bytes);
+			memcpy(&out[n_bytes + ST7920_ANIM_FRAME_HEADER_SIZE], key_payload, n_key_bytes);
+			n_bytes += ST7920_ANIM_FRAME_HEADER_SIZE + n_key_bytes;
+			n_keyframes++;
+		}
+		else
+		{
+			out[n_bytes] = ST7920_ANIM_DELTA;
+			anim_put_u16(&out[n_bytes + 1u], n_delta_bytes);
+			memcpy(&out[n_bytes + ST7920_ANIM_FRAME_HEADER_SIZE], delta_payload, n_delta_bytes);
+			n_bytes += ST7920_ANIM_FRAME_HEADER_SIZE + n_delta_bytes;
+		}
+
+		memcpy(prev_pages, pages, n_pages*sizeof(uint16_t));
+	}
+
+	free(pages);
+	free(prev_pages);
+	free(delta);
+	free(key_payload);
+	free(delta_payload);
+
+	if(p_n_keyframes != NULL) *p_n_keyframes = n_keyframes;
+
+	return n_bytes;
+}
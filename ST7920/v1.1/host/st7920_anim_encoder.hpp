@@ -0,0 +1,62 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Animation encoder (format: see st7920_anim.hpp), for host tools and checks.
+ *
+ * Images are row major, width/8 bytes per row, leftmost pixel in the MSB (as ST7920Emulator::render()).
+ * Panels: width x 32 (width a multiple of 16, up to 256) or 128x64 (folded).
+ */
+
+#ifndef ST7920_ANIM_ENCODER_HPP
+#define ST7920_ANIM_ENCODER_HPP
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <st7920_anim.hpp>
+
+/*
+ * st7920AnimPanelIsValid()
+ * returns true if frames can be made for a width x height panel, false otherwise.
+ */
+
+extern bool st7920AnimPanelIsValid(uint32_t width, uint32_t height);
+
+/*
+ * st7920AnimPackImage()
+ * Converts an image to the buffer page layout of the panel (width*height/16 pages). Folded panel: the lower half of the screen
+ * goes to the right half of the rows.
+ */
+
+extern void st7920AnimPackImage(const uint8_t *image, uint32_t width, uint32_t height, uint16_t *pages);
+
+/*
+ * st7920AnimEncodePages()
+ * Run length encodes n_pages page values into a frame payload. Trailing zero pages are left out.
+ *
+ * returns the payload size (at most st7920AnimMaxPayloadSize(n_pages) bytes).
+ */
+
+extern uint32_t st7920AnimEncodePages(const uint16_t *values, uint32_t n_pages, uint8_t *out);
+extern uint32_t st7920AnimMaxPayloadSize(uint32_t n_pages);
+
+/*
+ * st7920AnimEncode()
+ * Encodes n_frames images (consecutive, width*height/8 bytes each) into an animation.
+ * The first frame is a keyframe, and then every keyframe_interval frames (0: first frame only). Other frames are delta frames,
+ * unless the keyframe is smaller. p_n_keyframes (optional) gets the number of keyframes.
+ *
+ * returns the animation size, 0 if error (panel not valid, no frames or out_size too small: see st7920AnimMaxSize()).
+ */
+
+extern uint32_t st7920AnimEncode(const uint8_t *images, uint32_t n_frames, uint32_t width, uint32_t height, uint32_t period_ms, uint32_t keyframe_interval, uint8_t *out, uint32_t out_size, uint32_t *p_n_keyframes);
+extern uint32_t st7920AnimMaxSize(uint32_t n_frames, uint32_t width, uint32_t height);
+
+#endif /*ST7920_ANIM_ENCODER_HPP*/
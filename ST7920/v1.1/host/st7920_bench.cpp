@@ -0,0 +1,1535 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Benchmark of the public API on the host build (parallel bus, no RW).
+ *
+ * For each operation, prints one CSV line with the per call cost:
+ * bus bytes, commands, E strobes, pin writes (all, and constant pin ones), delay microseconds and simulated microseconds, plus the host CPU time.
+ * The *_fixed_pins operations run the same calls on ST7920Fixed (pins fixed at compile time), for comparison with the runtime pins.
+ * The *_serial operations run them on a display on the serial interface (1MHz SPI): compare their sim_us with the parallel bus.
+ *
+ * Every operation has a budget (bus bytes and delay microseconds per call).
+ * The drawing primitives, batch plotting, bitmap blit and font text are also timed against plotting the same pixels with bufferSetPixel(),
+ * and checked pixel by pixel against a straightforward per pixel reference, also with ends and sizes at the int32_t limits.
+ *
+ * Exit status is 1 if any operation is over budget, a primitive doesn't match its reference,
+ * or the emulator saw a transfer while the display was busy.
+ *
+ * usage: st7920_bench [output.csv]
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <Arduino.h>
+#include <SPI.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define BENCH_DB0 2
+#define BENCH_DB1 3
+#define BENCH_DB2 4
+#define BENCH_DB3 5
+#define BENCH_DB4 6
+#define BENCH_DB5 7
+#define BENCH_DB6 8
+#define BENCH_DB7 9
+#define BENCH_RS 10
+#define BENCH_E 11
+#define BENCH_CS 12
+
+static ST7920Emulator emulator(BENCH_DB0, BENCH_DB1, BENCH_DB2, BENCH_DB3, BENCH_DB4, BENCH_DB5, BENCH_DB6, BENCH_DB7, BENCH_RS, 0xff, BENCH_E);
+static ST7920 st7920(BENCH_DB0, BENCH_DB1, BENCH_DB2, BENCH_DB3, BENCH_DB4, BENCH_DB5, BENCH_DB6, BENCH_DB7, BENCH_RS, BENCH_E);
+
+/*Same pins, fixed at compile time. Only used by the *_fixed_pins operations.*/
+static ST7920Fixed<BENCH_DB0, BENCH_DB1, BENCH_DB2, BENCH_DB3, BENCH_DB4, BENCH_DB5, BENCH_DB6, BENCH_DB7, BENCH_RS, BENCH_E> st7920_fixed;
+
+/*A second display, on the serial interface. Only used by the *_serial operations.*/
+static ST7920Emulator emulator_serial(BENCH_CS);
+static ST7920 st7920_serial(BENCH_CS, SPI);
+
+struct _bench_op {
+	const char *name;
+	void (*prepare)(uint32_t arg); /*Not measured. Called before every run.*/
+	void (*run)(uint32_t arg);
+	uint32_t arg;
+	uint32_t repeat;
+	uint32_t n_items; /*Items (e.g. points) handled per call, for items_per_s. 0 = n/a.*/
+
+	/*Budget per call. 0 = no budget.*/
+	uint32_t max_bytes;
+	uint32_t max_delay_us;
+};
+
+struct _bench_result {
+	double bytes;
+	double commands;
+	double strobes;
+	double pin_writes;
+	double fast_pin_writes;
+	double delay_us;
+	double sim_us;
+	double host_ns;
+};
+
+enum BenchShape {
+	BENCH_SHAPE_HLINE = 0,
+	BENCH_SHAPE_FILL_RECT = 1,
+	BENCH_SHAPE_LINE = 2,
+	BENCH_SHAPE_CIRCLE = 3,
+	BENCH_SHAPE_FILL_CIRCLE = 4
+};
+
+static const uint32_t BENCH_N_CLOUD = 4096u;
+
+static uint16_t bench_cloud_x[BENCH_N_CLOUD];
+static uint16_t bench_cloud_y[BENCH_N_CLOUD];
+static uint16_t bench_cloud_packed[BENCH_N_CLOUD];
+
+/*Blit source: 128x64, (128 + 7)/8 = 16 bytes per row. The 32x32 icon uses rows of 4 bytes.*/
+static uint8_t bench_bitmap[16u*64u];
+static uint8_t bench_icon[4u*32u];
+
+static uint16_t bench_points_x[ST7920::WIDTH*ST7920::HEIGHT];
+static uint16_t bench_points_y[ST7920::WIDTH*ST7920::HEIGHT];
+static uint32_t bench_n_points = 0u;
+
+static void ref_plot(int64_t cx, int64_t cy, int32_t draw_mode);
+
+static uint64_t bench_host_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec)*1000000000ull + ((uint64_t) ts.tv_nsec);
+}
+
+/*
+ * Operations
+ */
+
+static void prep_none(uint32_t arg)
+{
+	(void) arg;
+	return;
+}
+
+static void prep_blank(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.bufferSetAll(false);
+	st7920.bufferPaintAll();
+	return;
+}
+
+static void prep_text_home(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.clearText();
+	st7920.setTextCursorPosition(0u, 0u);
+	return;
+}
+
+/*The text printed by run_print_text() is already on the display*/
+static void prep_text_shown(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.setTextCursorPosition(0u, 0u);
+	st7920.printText("0123456789abcdef");
+	st7920.setTextCursorPosition(0u, 0u);
+	return;
+}
+
+static void prep_text_clear(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.clearText();
+	return;
+}
+
+static void run_pixel_paint(uint32_t arg)
+{
+	st7920.bufferTogglePixel(arg, 45u);
+	st7920.bufferPaintPixel(arg, 45u);
+	return;
+}
+
+static void run_paint_page(uint32_t arg)
+{
+	st7920.bufferTogglePage(arg, 10u, 0x5a5a);
+	st7920.bufferPaintPage(arg, 10u);
+	return;
+}
+
+static void run_paint_all(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.bufferPaintAll();
+	return;
+}
+
+static void run_clear_display(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.clearDisplay();
+	return;
+}
+
+static void run_fill_screen_char(uint32_t arg)
+{
+	st7920.fillScreenChar((char) arg);
+	return;
+}
+
+static void run_print_text(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.printText("0123456789abcdef");
+	return;
+}
+
+static void run_print_text_changed(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.printText("0123456789abcdeF");
+	return;
+}
+
+static void run_text_cursor_char(uint32_t arg)
+{
+	st7920.setTextCursorPosition(arg, 2u);
+	st7920.printChar('#');
+	return;
+}
+
+static void run_shape(uint32_t arg)
+{
+	switch(arg)
+	{
+		case BENCH_SHAPE_HLINE:
+			st7920.bufferDrawHLine(0, 20, 128, st7920.DRAWMODE_SET);
+			break;
+
+		case BENCH_SHAPE_FILL_RECT:
+			st7920.bufferFillRect(4, 12, 120, 40, st7920.DRAWMODE_SET);
+			break;
+
+		case BENCH_SHAPE_LINE:
+			st7920.bufferDrawLine(0, 0, 127, 63, st7920.DRAWMODE_SET);
+			break;
+
+		case BENCH_SHAPE_CIRCLE:
+			st7920.bufferDrawCircle(64, 32, 28u, st7920.DRAWMODE_SET);
+			break;
+
+		case BENCH_SHAPE_FILL_CIRCLE:
+			st7920.bufferFillCircle(64, 32, 28u, st7920.DRAWMODE_SET);
+			break;
+	}
+
+	return;
+}
+
+static void prep_clear(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.bufferSetAll(false);
+	return;
+}
+
+/*Collects the pixels of the shape, so run_points() can plot the same pixels one by one.*/
+static void prep_points(uint32_t arg)
+{
+	uint32_t cx = 0u;
+	uint32_t cy = 0u;
+
+	st7920.bufferSetAll(false);
+	run_shape(arg);
+
+	bench_n_points = 0u;
+
+	for(cy = 0u; cy < st7920.HEIGHT; cy++)
+	{
+		for(cx = 0u; cx < st7920.WIDTH; cx++)
+		{
+			if(st7920.bufferGetPixel(cx, cy) < 1) continue;
+
+			bench_points_x[bench_n_points] = (uint16_t) cx;
+			bench_points_y[bench_n_points] = (uint16_t) cy;
+			bench_n_points++;
+		}
+	}
+
+	st7920.bufferSetAll(false);
+	return;
+}
+
+/*Scope style point cloud: a noisy sine wave*/
+static void prep_cloud(uint32_t arg)
+{
+	uint32_t n_point = 0u;
+	uint32_t noise = 1u;
+
+	(void) arg;
+
+	st7920.bufferSetAll(false);
+
+	if(bench_cloud_packed[BENCH_N_CLOUD - 1u]) return;
+
+	for(n_point = 0u; n_point < BENCH_N_CLOUD; n_point++)
+	{
+		noise = 1103515245u*noise + 12345u;
+
+		bench_cloud_x[n_point] = (uint16_t) (n_point%st7920.WIDTH);
+		bench_cloud_y[n_point] = (uint16_t) (32.0f - 24.0f*sinf(0.049f*bench_cloud_x[n_point]) + (float) ((noise >> 16)%9u) - 4.0f);
+		bench_cloud_packed[n_point] = st7920.packPixel(bench_cloud_x[n_point], bench_cloud_y[n_point]);
+	}
+
+	return;
+}
+
+static void run_cloud_set_pixel(uint32_t arg)
+{
+	uint32_t n_point = 0u;
+
+	(void) arg;
+
+	for(n_point = 0u; n_point < BENCH_N_CLOUD; n_point++) st7920.bufferSetPixel(bench_cloud_x[n_point], bench_cloud_y[n_point], true);
+
+	return;
+}
+
+static void run_cloud_set_pixels(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.bufferSetPixels(bench_cloud_x, bench_cloud_y, BENCH_N_CLOUD, st7920.DRAWMODE_SET);
+	return;
+}
+
+static void run_cloud_set_packed_pixels(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.bufferSetPackedPixels(bench_cloud_packed, BENCH_N_CLOUD, st7920.DRAWMODE_SET);
+	return;
+}
+
+static void run_cloud_unchecked(uint32_t arg)
+{
+	uint32_t n_point = 0u;
+
+	(void) arg;
+
+	for(n_point = 0u; n_point < BENCH_N_CLOUD; n_point++) st7920.bufferSetPixelUnchecked(bench_cloud_x[n_point], bench_cloud_y[n_point], true);
+
+	return;
+}
+
+static void prep_bitmaps(uint32_t arg)
+{
+	uint32_t n_byte = 0u;
+	uint32_t noise = 7u;
+
+	(void) arg;
+
+	st7920.bufferSetAll(false);
+
+	for(n_byte = 0u; n_byte < sizeof(bench_bitmap); n_byte++)
+	{
+		noise = 1103515245u*noise + 12345u;
+		bench_bitmap[n_byte] = (uint8_t) (noise >> 16);
+	}
+
+	for(n_byte = 0u; n_byte < sizeof(bench_icon); n_byte++) bench_icon[n_byte] = bench_bitmap[n_byte];
+
+	return;
+}
+
+/*Per pixel blit (COPY), the baseline*/
+static void ref_blit_pixels(int32_t cx, int32_t cy, uint32_t w, uint32_t h, const uint8_t *bitmap)
+{
+	uint32_t x = 0u;
+	uint32_t y = 0u;
+	uint32_t row_bytes = (w + 7u)/8u;
+
+	for(y = 0u; y < h; y++)
+	{
+		for(x = 0u; x < w; x++)
+		{
+			if((cx + (int32_t) x < 0) || (cy + (int32_t) y < 0)) continue;
+			st7920.bufferSetPixel((cx + x), (cy + y), ((bitmap[y*row_bytes + x/8u] >> (7u - x%8u)) & 0x1));
+		}
+	}
+
+	return;
+}
+
+static void run_icon_pixels(uint32_t arg)
+{
+	ref_blit_pixels((int32_t) arg, 16, 32u, 32u, bench_icon);
+	return;
+}
+
+static void run_icon_blit(uint32_t arg)
+{
+	st7920.bufferBlit((int32_t) arg, 16, 32u, 32u, bench_icon, st7920.RASTEROP_COPY);
+	return;
+}
+
+static void run_screen_pixels(uint32_t arg)
+{
+	ref_blit_pixels((int32_t) arg, 0, 128u, 64u, bench_bitmap);
+	return;
+}
+
+static void run_screen_blit(uint32_t arg)
+{
+	st7920.bufferBlit((int32_t) arg, 0, 128u, 64u, bench_bitmap, st7920.RASTEROP_COPY);
+	return;
+}
+
+static const char bench_text[] = "Vbat 3.71V  I=120mA";
+static const uint32_t BENCH_TEXT_LENGTH = sizeof(bench_text) - 1u;
+
+/*Per pixel text drawing, the baseline and the reference*/
+static int32_t ref_text(int32_t cx, int32_t cy, const char *text, const struct _st7920_font *font, int32_t draw_mode)
+{
+	const uint8_t *column = NULL;
+	uint32_t column_bytes = (font->height + 7u)/8u;
+	uint32_t glyph = 0u;
+	uint32_t width = 0u;
+	uint32_t x = 0u;
+	uint32_t y = 0u;
+	uint8_t c = 0u;
+
+	for(; *text != '\0'; text++)
+	{
+		c = (uint8_t) *text;
+		if((c < font->first_char) || (c > font->last_char)) c = '?';
+
+		glyph = c - font->first_char;
+
+		if(font->width)
+		{
+			width = font->width;
+			column = font->data + glyph*font->width*column_bytes;
+		}
+		else
+		{
+			width = font->widths[glyph];
+			column = font->data + font->offsets[glyph];
+		}
+
+		for(x = 0u; x < width; x++)
+		{
+			for(y = 0u; y < font->height; y++) if((column[x*column_bytes + y/8u] >> (y%8u)) & 0x1) ref_plot((cx + x), (cy + y), draw_mode);
+		}
+
+		cx += width + font->spacing;
+	}
+
+	return cx;
+}
+
+/*16x16 battery icon*/
+static const uint16_t bench_glyph[16] = {
+	0x0000, 0x07e0, 0x0420, 0x3ffc, 0x2004, 0x2ff4, 0x2ff4, 0x2004,
+	0x2ff4, 0x2ff4, 0x2004, 0x2ff4, 0x2ff4, 0x2004, 0x3ffc, 0x0000
+};
+
+static void prep_cgram_glyph_cold(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.clearText();
+	st7920.invalidateCgramGlyphs();
+	return;
+}
+
+static void prep_cgram_glyph_loaded(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.clearText();
+	st7920.loadCgramGlyph(bench_glyph);
+	return;
+}
+
+static void run_cgram_glyph(uint32_t arg)
+{
+	st7920.setWTextCursorPosition(arg, 1u);
+	st7920.printCgramGlyph(bench_glyph);
+	return;
+}
+
+/*The same icon as graphics: drawn, then painted*/
+static void prep_icon_painted(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.bufferSetAll(false);
+	st7920.bufferPaintDirty();
+	return;
+}
+
+static void run_icon_paint(uint32_t arg)
+{
+	uint8_t icon[32];
+	uint32_t n_row = 0u;
+
+	for(n_row = 0u; n_row < 16u; n_row++)
+	{
+		icon[2u*n_row] = (uint8_t) (bench_glyph[n_row] >> 8);
+		icon[2u*n_row + 1u] = (uint8_t) (bench_glyph[n_row] & 0xff);
+	}
+
+	st7920.bufferBlit((int32_t) (16u*arg), 16, 16u, 16u, icon, st7920.RASTEROP_COPY);
+	st7920.bufferPaintDirty();
+	return;
+}
+
+/*Log view: a screen of graphics and text, scrolled up by arg rows*/
+static void prep_scroll(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.bufferSetAll(false);
+	st7920.bufferFillRect(0, 0, 128, 64, st7920.DRAWMODE_SET);
+	st7920.bufferFillRect(4, 4, 120, 56, st7920.DRAWMODE_CLEAR);
+	st7920.bufferPaintDirty();
+	st7920.clearText();
+	st7920.setTextCursorPosition(0u, 0u);
+	st7920.printText("0123456789abcdef0123456789abcdef");
+	return;
+}
+
+static void run_scroll(uint32_t arg)
+{
+	st7920.scrollDisplay((int32_t) arg);
+	return;
+}
+
+/*Status bar: digit arg changed, asked for by overlapping requests (coalesced), sent by one tick*/
+static void prep_refresh_digit(uint32_t arg)
+{
+	uint32_t n_request = 0u;
+
+	st7920.bufferSetAll(false);
+	st7920.bufferPaintAll();
+
+	st7920.bufferFillRect((int32_t) (16u*arg + 4u), 2, 8, 3, st7920.DRAWMODE_SET);
+	for(n_request = 0u; n_request < 4u; n_request++) st7920.refreshRequest(0, 0, 128, 8, 10u, 50000u);
+
+	return;
+}
+
+static void run_refresh_tick(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.refreshTick(20000u);
+	return;
+}
+
+/*Glyph cache for the text operations (set up by prep_glyph_cache_cold())*/
+static const uint32_t BENCH_GLYPH_CACHE_SIZE = 32u;
+static ST7920::GlyphCacheEntry bench_glyph_cache[BENCH_GLYPH_CACHE_SIZE];
+
+static void prep_glyph_cache_off(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.bufferSetAll(false);
+	st7920.setGlyphCache(NULL, 0u);
+	return;
+}
+
+static void prep_glyph_cache_cold(uint32_t arg)
+{
+	(void) arg;
+
+	st7920.bufferSetAll(false);
+	st7920.setGlyphCache(bench_glyph_cache, BENCH_GLYPH_CACHE_SIZE);
+	return;
+}
+
+static void run_text_pixels(uint32_t arg)
+{
+	(void) arg;
+
+	ref_text(3, 20, bench_text, &st7920_font_5x7, st7920.DRAWMODE_SET);
+	return;
+}
+
+static void run_text(uint32_t arg)
+{
+	if(arg) st7920.bufferDrawText(3, 20, bench_text, &st7920_font_5x7p, st7920.DRAWMODE_SET);
+	else st7920.bufferDrawText(3, 20, bench_text, &st7920_font_5x7, st7920.DRAWMODE_SET);
+
+	return;
+}
+
+static void prep_fixed_blank(uint32_t arg)
+{
+	(void) arg;
+
+	st7920_fixed.bufferSetAll(false);
+	st7920_fixed.bufferPaintAll();
+	return;
+}
+
+static void prep_fixed_text_home(uint32_t arg)
+{
+	(void) arg;
+
+	st7920_fixed.clearText();
+	st7920_fixed.setTextCursorPosition(0u, 0u);
+	return;
+}
+
+static void run_fixed_paint_all(uint32_t arg)
+{
+	(void) arg;
+
+	st7920_fixed.bufferPaintAll();
+	return;
+}
+
+static void run_fixed_pixel_paint(uint32_t arg)
+{
+	st7920_fixed.bufferTogglePixel(arg, 45u);
+	st7920_fixed.bufferPaintPixel(arg, 45u);
+	return;
+}
+
+static void run_fixed_print_text(uint32_t arg)
+{
+	(void) arg;
+
+	st7920_fixed.printText("0123456789abcdef");
+	return;
+}
+
+static void prep_serial_blank(uint32_t arg)
+{
+	(void) arg;
+
+	st7920_serial.bufferSetAll(false);
+	st7920_serial.bufferPaintAll();
+	return;
+}
+
+static void prep_serial_text_home(uint32_t arg)
+{
+	(void) arg;
+
+	st7920_serial.clearText();
+	st7920_serial.setTextCursorPosition(0u, 0u);
+	return;
+}
+
+static void run_serial_paint_all(uint32_t arg)
+{
+	(void) arg;
+
+	st7920_serial.bufferPaintAll();
+	return;
+}
+
+static void run_serial_pixel_paint(uint32_t arg)
+{
+	st7920_serial.bufferTogglePixel(arg, 45u);
+	st7920_serial.bufferPaintPixel(arg, 45u);
+	return;
+}
+
+static void run_serial_print_text(uint32_t arg)
+{
+	(void) arg;
+
+	st7920_serial.printText("0123456789abcdef");
+	return;
+}
+
+static void run_points(uint32_t arg)
+{
+	uint32_t n_point = 0u;
+
+	(void) arg;
+
+	for(n_point = 0u; n_point < bench_n_points; n_point++) st7920.bufferSetPixel(bench_points_x[n_point], bench_points_y[n_point], true);
+
+	return;
+}
+
+static const struct _bench_op bench_ops[] = {
+	{"pixel_paint", prep_blank, run_pixel_paint, 37u, 16u, 0u, 4u, 518u},
+	{"paint_page", prep_blank, run_paint_page, 3u, 16u, 0u, 4u, 518u},
+	{"paint_all", prep_none, run_paint_all, 0u, 4u, 0u, 1088u, 140416u},
+	{"clear_display", prep_none, run_clear_display, 0u, 4u, 0u, 1091u, 143878u},
+	{"fill_screen_char", prep_none, run_fill_screen_char, 'A', 4u, 0u, 17u, 2097u},
+	{"print_text_16", prep_text_home, run_print_text, 0u, 16u, 0u, 17u, 2195u},
+	{"print_text_16_unchanged", prep_text_shown, run_print_text, 0u, 16u, 0u, 0u, 0u},
+	{"print_text_16_one_changed", prep_text_shown, run_print_text_changed, 0u, 16u, 0u, 3u, 389u},
+	{"text_cursor_char_col00", prep_text_clear, run_text_cursor_char, 0u, 16u, 0u, 2u, 260u},
+	{"text_cursor_char_col01", prep_text_clear, run_text_cursor_char, 1u, 16u, 0u, 3u, 389u},
+	{"text_cursor_char_col02", prep_text_clear, run_text_cursor_char, 2u, 16u, 0u, 2u, 260u},
+	{"text_cursor_char_col03", prep_text_clear, run_text_cursor_char, 3u, 16u, 0u, 3u, 389u},
+	{"text_cursor_char_col04", prep_text_clear, run_text_cursor_char, 4u, 16u, 0u, 2u, 260u},
+	{"text_cursor_char_col05", prep_text_clear, run_text_cursor_char, 5u, 16u, 0u, 3u, 389u},
+	{"text_cursor_char_col06", prep_text_clear, run_text_cursor_char, 6u, 16u, 0u, 2u, 260u},
+	{"text_cursor_char_col07", prep_text_clear, run_text_cursor_char, 7u, 16u, 0u, 3u, 389u},
+	{"text_cursor_char_col08", prep_text_clear, run_text_cursor_char, 8u, 16u, 0u, 2u, 260u},
+	{"text_cursor_char_col09", prep_text_clear, run_text_cursor_char, 9u, 16u, 0u, 3u, 389u},
+	{"text_cursor_char_col10", prep_text_clear, run_text_cursor_char, 10u, 16u, 0u, 2u, 260u},
+	{"text_cursor_char_col11", prep_text_clear, run_text_cursor_char, 11u, 16u, 0u, 3u, 389u},
+	{"text_cursor_char_col12", prep_text_clear, run_text_cursor_char, 12u, 16u, 0u, 2u, 260u},
+	{"text_cursor_char_col13", prep_text_clear, run_text_cursor_char, 13u, 16u, 0u, 3u, 389u},
+	{"text_cursor_char_col14", prep_text_clear, run_text_cursor_char, 14u, 16u, 0u, 2u, 260u},
+	{"text_cursor_char_col15", prep_text_clear, run_text_cursor_char, 15u, 16u, 0u, 3u, 389u},
+	{"hline_128_pixels", prep_points, run_points, BENCH_SHAPE_HLINE, 64u, 0u, 0u, 0u},
+	{"hline_128", prep_clear, run_shape, BENCH_SHAPE_HLINE, 64u, 0u, 0u, 0u},
+	{"fill_rect_120x40_pixels", prep_points, run_points, BENCH_SHAPE_FILL_RECT, 64u, 0u, 0u, 0u},
+	{"fill_rect_120x40", prep_clear, run_shape, BENCH_SHAPE_FILL_RECT, 64u, 0u, 0u, 0u},
+	{"line_diagonal_pixels", prep_points, run_points, BENCH_SHAPE_LINE, 64u, 0u, 0u, 0u},
+	{"line_diagonal", prep_clear, run_shape, BENCH_SHAPE_LINE, 64u, 0u, 0u, 0u},
+	{"circle_r28_pixels", prep_points, run_points, BENCH_SHAPE_CIRCLE, 64u, 0u, 0u, 0u},
+	{"circle_r28", prep_clear, run_shape, BENCH_SHAPE_CIRCLE, 64u, 0u, 0u, 0u},
+	{"fill_circle_r28_pixels", prep_points, run_points, BENCH_SHAPE_FILL_CIRCLE, 64u, 0u, 0u, 0u},
+	{"fill_circle_r28", prep_clear, run_shape, BENCH_SHAPE_FILL_CIRCLE, 64u, 0u, 0u, 0u},
+	{"cloud_4096_set_pixel", prep_cloud, run_cloud_set_pixel, 0u, 64u, BENCH_N_CLOUD, 0u, 0u},
+	{"cloud_4096_set_pixels", prep_cloud, run_cloud_set_pixels, 0u, 64u, BENCH_N_CLOUD, 0u, 0u},
+	{"cloud_4096_set_packed_pixels", prep_cloud, run_cloud_set_packed_pixels, 0u, 64u, BENCH_N_CLOUD, 0u, 0u},
+	{"cloud_4096_unchecked", prep_cloud, run_cloud_unchecked, 0u, 64u, BENCH_N_CLOUD, 0u, 0u},
+	{"blit_32x32_aligned_pixels", prep_bitmaps, run_icon_pixels, 16u, 64u, 0u, 0u, 0u},
+	{"blit_32x32_aligned", prep_bitmaps, run_icon_blit, 16u, 64u, 0u, 0u, 0u},
+	{"blit_32x32_unaligned_pixels", prep_bitmaps, run_icon_pixels, 13u, 64u, 0u, 0u, 0u},
+	{"blit_32x32_unaligned", prep_bitmaps, run_icon_blit, 13u, 64u, 0u, 0u, 0u},
+	{"blit_128x64_aligned_pixels", prep_bitmaps, run_screen_pixels, 0u, 16u, 0u, 0u, 0u},
+	{"blit_128x64_aligned", prep_bitmaps, run_screen_blit, 0u, 16u, 0u, 0u, 0u},
+	{"blit_128x64_unaligned_pixels", prep_bitmaps, run_screen_pixels, 5u, 16u, 0u, 0u, 0u},
+	{"blit_128x64_unaligned", prep_bitmaps, run_screen_blit, 5u, 16u, 0u, 0u, 0u},
+	{"text_5x7_pixels", prep_clear, run_text_pixels, 0u, 64u, BENCH_TEXT_LENGTH, 0u, 0u},
+	{"text_5x7_no_cache", prep_glyph_cache_off, run_text, 0u, 64u, BENCH_TEXT_LENGTH, 0u, 0u},
+	{"text_5x7_cold_cache", prep_glyph_cache_cold, run_text, 0u, 64u, BENCH_TEXT_LENGTH, 0u, 0u},
+	{"text_5x7", prep_clear, run_text, 0u, 64u, BENCH_TEXT_LENGTH, 0u, 0u},
+	{"text_5x7p", prep_clear, run_text, 1u, 64u, BENCH_TEXT_LENGTH, 0u, 0u},
+	{"icon_16x16_cgram_miss", prep_cgram_glyph_cold, run_cgram_glyph, 3u, 16u, 0u, 36u, 4648u},
+	{"icon_16x16_cgram_hit", prep_cgram_glyph_loaded, run_cgram_glyph, 3u, 16u, 0u, 3u, 389u},
+	{"icon_16x16_graphics", prep_icon_painted, run_icon_paint, 3u, 16u, 0u, 0u, 0u},
+	{"scroll_1_row", prep_scroll, run_scroll, 1u, 16u, 0u, 38u, 5900u},
+	{"scroll_16_rows", prep_scroll, run_scroll, 16u, 16u, 0u, 566u, 75700u},
+	{"refresh_tick_status_digit", prep_refresh_digit, run_refresh_tick, 3u, 16u, 0u, 12u, 1554u},
+	{"pixel_paint_fixed_pins", prep_fixed_blank, run_fixed_pixel_paint, 37u, 16u, 0u, 4u, 518u},
+	{"paint_all_fixed_pins", prep_none, run_fixed_paint_all, 0u, 4u, 0u, 1088u, 140416u},
+	{"print_text_16_fixed_pins", prep_fixed_text_home, run_fixed_print_text, 0u, 16u, 0u, 17u, 2195u},
+	{"pixel_paint_serial", prep_serial_blank, run_serial_pixel_paint, 37u, 16u, 0u, 4u, 518u},
+	{"paint_all_serial", prep_none, run_serial_paint_all, 0u, 4u, 0u, 1088u, 140416u},
+	{"print_text_16_serial", prep_serial_text_home, run_serial_print_text, 0u, 16u, 0u, 17u, 2195u}
+};
+
+static const uint32_t BENCH_N_OPS = sizeof(bench_ops)/sizeof(struct _bench_op);
+
+/*
+ * Drawing primitives reference check
+ */
+
+static uint32_t bench_random_state = 12345u;
+
+static int32_t bench_random(int32_t min, int32_t max)
+{
+	bench_random_state = 1103515245u*bench_random_state + 12345u;
+	return min + (int32_t) ((bench_random_state >> 8)%(((uint32_t) (max - min)) + 1u));
+}
+
+static void ref_plot(int64_t cx, int64_t cy, int32_t draw_mode)
+{
+	if((cx < 0) || (cy < 0) || (cx >= ((int64_t) st7920.WIDTH)) || (cy >= ((int64_t) st7920.HEIGHT))) return;
+
+	if(draw_mode == st7920.DRAWMODE_TOGGLE) st7920.bufferTogglePixel((uint32_t) cx, (uint32_t) cy);
+	else st7920.bufferSetPixel((uint32_t) cx, (uint32_t) cy, (draw_mode == st7920.DRAWMODE_SET));
+
+	return;
+}
+
+/*Walks every step, 64 bit (ends anywhere in the int32_t range, but keep far lines to a few million steps)*/
+static void ref_line(int64_t cx0, int64_t cy0, int64_t cx1, int64_t cy1, int32_t draw_mode)
+{
+	int64_t dx = (cx1 > cx0) ? (cx1 - cx0) : (cx0 - cx1);
+	int64_t dy = -((cy1 > cy0) ? (cy1 - cy0) : (cy0 - cy1));
+	int64_t sx = (cx0 < cx1) ? 1 : -1;
+	int64_t sy = (cy0 < cy1) ? 1 : -1;
+	int64_t err = dx + dy;
+	int64_t e2 = 0;
+
+	while(true)
+	{
+		ref_plot(cx0, cy0, draw_mode);
+		if((cx0 == cx1) && (cy0 == cy1)) break;
+
+		e2 = 2*err;
+		if(e2 >= dy)
+		{
+			err += dy;
+			cx0 += sx;
+		}
+
+		if(e2 <= dx)
+		{
+			err += dx;
+			cy0 += sy;
+		}
+	}
+
+	return;
+}
+
+static bool ref_ellipse_inside(int64_t x, int64_t y, int64_t rx, int64_t ry)
+{
+	int64_t a = (2*rx + 1)*(2*rx + 1);
+	int64_t b = (2*ry + 1)*(2*ry + 1);
+
+	return ((4*x*x*b + 4*y*y*a) <= a*b);
+}
+
+static void ref_ellipse(int32_t cx, int32_t cy, int32_t rx, int32_t ry, bool fill, int32_t draw_mode)
+{
+	int32_t x = 0;
+	int32_t y = 0;
+
+	for(y = -ry; y <= ry; y++)
+	{
+		for(x = -rx; x <= rx; x++)
+		{
+			if(!ref_ellipse_inside(x, y, rx, ry)) continue;
+
+			if(fill || !ref_ellipse_inside((x - 1), y, rx, ry) || !ref_ellipse_inside((x + 1), y, rx, ry) || !ref_ellipse_inside(x, (y - 1), rx, ry) || !ref_ellipse_inside(x, (y + 1), rx, ry)) ref_plot((cx + x), (cy + y), draw_mode);
+		}
+	}
+
+	return;
+}
+
+static void ref_rect(int32_t cx, int32_t cy, int32_t w, int32_t h, bool fill, int32_t draw_mode)
+{
+	int32_t x = 0;
+	int32_t y = 0;
+
+	for(y = 0; y < h; y++)
+	{
+		for(x = 0; x < w; x++)
+		{
+			if(fill || !x || !y || (x == (w - 1)) || (y == (h - 1))) ref_plot((cx + x), (cy + y), draw_mode);
+		}
+	}
+
+	return;
+}
+
+/*Draws shape number "shape" with either the primitive or the reference.*/
+static void ref_check_draw(uint32_t shape, const int32_t *p, int32_t draw_mode, bool reference)
+{
+	switch(shape)
+	{
+		case 0:
+			if(reference) ref_rect(p[0], p[1], p[2], 1, true, draw_mode);
+			else st7920.bufferDrawHLine(p[0], p[1], p[2], draw_mode);
+			break;
+
+		case 1:
+			if(reference) ref_rect(p[0], p[1], 1, p[3], true, draw_mode);
+			else st7920.bufferDrawVLine(p[0], p[1], p[3], draw_mode);
+			break;
+
+		case 2:
+			if(reference) ref_line(p[0], p[1], p[4], p[5], draw_mode);
+			else st7920.bufferDrawLine(p[0], p[1], p[4], p[5], draw_mode);
+			break;
+
+		case 3:
+			if(reference) ref_rect(p[0], p[1], p[2], p[3], false, draw_mode);
+			else st7920.bufferDrawRect(p[0], p[1], p[2], p[3], draw_mode);
+			break;
+
+		case 4:
+			if(reference) ref_rect(p[0], p[1], p[2], p[3], true, draw_mode);
+			else st7920.bufferFillRect(p[0], p[1], p[2], p[3], draw_mode);
+			break;
+
+		case 5:
+			if(reference) ref_ellipse(p[0], p[1], p[6], p[6], false, draw_mode);
+			else st7920.bufferDrawCircle(p[0], p[1], p[6], draw_mode);
+			break;
+
+		case 6:
+			if(reference) ref_ellipse(p[0], p[1], p[6], p[6], true, draw_mode);
+			else st7920.bufferFillCircle(p[0], p[1], p[6], draw_mode);
+			break;
+
+		case 7:
+			if(reference) ref_ellipse(p[0], p[1], p[6], p[7], false, draw_mode);
+			else st7920.bufferDrawEllipse(p[0], p[1], p[6], p[7], draw_mode);
+			break;
+
+		case 8:
+			if(reference) ref_ellipse(p[0], p[1], p[6], p[7], true, draw_mode);
+			else st7920.bufferFillEllipse(p[0], p[1], p[6], p[7], draw_mode);
+			break;
+
+		case 9:
+			/*Full arc*/
+			if(reference) ref_ellipse(p[0], p[1], p[6], p[6], false, draw_mode);
+			else st7920.bufferDrawArc(p[0], p[1], p[6], p[2], (p[2] + 360), draw_mode);
+			break;
+	}
+
+	return;
+}
+
+static const uint32_t REF_CHECK_N_SHAPES = 10u;
+
+static void ref_check_snapshot(uint16_t *pages)
+{
+	uint32_t cy = 0u;
+	uint32_t page_index = 0u;
+
+	for(cy = 0u; cy < st7920.HEIGHT; cy++)
+	{
+		for(page_index = 0u; page_index < st7920.WIDTH_PAGES; page_index++) pages[st7920.WIDTH_PAGES*cy + page_index] = (uint16_t) st7920.bufferGetPage(page_index, cy);
+	}
+
+	return;
+}
+
+static void ref_check_background(uint32_t seed)
+{
+	uint32_t cy = 0u;
+	uint32_t page_index = 0u;
+
+	for(cy = 0u; cy < st7920.HEIGHT; cy++)
+	{
+		for(page_index = 0u; page_index < st7920.WIDTH_PAGES; page_index++)
+		{
+			seed = 1103515245u*seed + 12345u;
+			st7920.bufferSetPage(page_index, cy, (uint16_t) (seed >> 12));
+		}
+	}
+
+	return;
+}
+
+/*returns the number of mismatching shapes*/
+static uint32_t ref_check(uint32_t n_iterations)
+{
+	static uint16_t expected[ST7920::WIDTH_PAGES*ST7920::HEIGHT];
+	static uint16_t actual[ST7920::WIDTH_PAGES*ST7920::HEIGHT];
+	int32_t p[8];
+	uint32_t n_iteration = 0u;
+	uint32_t n_fail = 0u;
+	uint32_t shape = 0u;
+	uint32_t seed = 0u;
+	int32_t draw_mode = 0;
+
+	for(n_iteration = 0u; n_iteration < n_iterations; n_iteration++)
+	{
+		shape = n_iteration%REF_CHECK_N_SHAPES;
+		draw_mode = bench_random(0, 2);
+		seed = (uint32_t) bench_random(0, 0x7fffffff);
+
+		p[0] = bench_random(-40, 170);
+		p[1] = bench_random(-40, 100);
+		p[2] = bench_random(-4, 150);
+		p[3] = bench_random(-4, 80);
+		p[4] = bench_random(-40, 170);
+		p[5] = bench_random(-40, 100);
+		p[6] = bench_random(0, 80);
+		p[7] = bench_random(0, 80);
+
+		ref_check_background(seed);
+		ref_check_draw(shape, p, draw_mode, true);
+		ref_check_snapshot(expected);
+
+		ref_check_background(seed);
+		ref_check_draw(shape, p, draw_mode, false);
+		ref_check_snapshot(actual);
+
+		if(memcmp(expected, actual, sizeof(expected)))
+		{
+			if(n_fail < 8u) fprintf(stderr, "st7920_bench: shape %u (%d, %d, %d, %d, %d, %d, %d, %d) mode %d doesn't match the reference\n", shape, p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], draw_mode);
+			n_fail++;
+		}
+	}
+
+	return n_fail;
+}
+
+/*
+ * Line pixels by definition: one per step along the major axis, the other axis rounded (halves up). 128 bit, any ends, only the
+ * steps on the display are computed.
+ */
+
+static void ref_line_far(int64_t cx0, int64_t cy0, int64_t cx1, int64_t cy1, int32_t draw_mode)
+{
+	int64_t dx = (cx1 > cx0) ? (cx1 - cx0) : (cx0 - cx1);
+	int64_t dy = (cy1 > cy0) ? (cy1 - cy0) : (cy0 - cy1);
+	int64_t sx = (cx0 < cx1) ? 1 : -1;
+	int64_t sy = (cy0 < cy1) ? 1 : -1;
+	int64_t c = 0;
+	int64_t k = 0;
+	__int128 offset = 0;
+
+	if(dx >= dy)
+	{
+		for(c = 0; c < (int64_t) st7920.WIDTH; c++)
+		{
+			k = (c - cx0)*sx;
+			if((k < 0) || (k > dx)) continue;
+
+			offset = (2*((__int128) dy)*k + dx)/(2*((__int128) dx));
+			ref_plot(c, (cy0 + sy*((int64_t) offset)), draw_mode);
+		}
+	}
+	else
+	{
+		for(c = 0; c < (int64_t) st7920.HEIGHT; c++)
+		{
+			k = (c - cy0)*sy;
+			if((k < 0) || (k > dy)) continue;
+
+			offset = (2*((__int128) dx)*k + dy)/(2*((__int128) dy));
+			ref_plot((cx0 + sx*((int64_t) offset)), c, draw_mode);
+		}
+	}
+
+	return;
+}
+
+/*Rectangle with its far edges in 64 bit: edges past the display are moved to just past it, then drawn by ref_rect()*/
+static void ref_rect_far(int64_t cx, int64_t cy, int64_t w, int64_t h, bool fill, int32_t draw_mode)
+{
+	int64_t cx1 = cx + w - 1;
+	int64_t cy1 = cy + h - 1;
+
+	if((w < 1) || (h < 1)) return;
+
+	if(cx < -1) cx = -1;
+	if(cy < -1) cy = -1;
+	if(cx1 > (int64_t) st7920.WIDTH) cx1 = (int64_t) st7920.WIDTH;
+	if(cy1 > (int64_t) st7920.HEIGHT) cy1 = (int64_t) st7920.HEIGHT;
+
+	if((cx > cx1) || (cy > cy1)) return;
+
+	ref_rect((int32_t) cx, (int32_t) cy, (int32_t) (cx1 - cx + 1), (int32_t) (cy1 - cy + 1), fill, draw_mode);
+	return;
+}
+
+struct _far_line {
+	int32_t cx0;
+	int32_t cy0;
+	int32_t cx1;
+	int32_t cy1;
+	bool walk; /*Few enough steps to check against ref_line() too*/
+};
+
+static const struct _far_line far_lines[] = {
+	{-200000000, 0, 200000000, 63, false},
+	{0, 0, INT32_MAX, 1, false},
+	{INT32_MIN, INT32_MIN, INT32_MAX, INT32_MAX, false},
+	{INT32_MAX, INT32_MIN, INT32_MIN, INT32_MAX, false},
+	{INT32_MIN, 31, INT32_MAX, 32, false},
+	{64, INT32_MIN, 65, INT32_MAX, false},
+	{INT32_MIN, -1000, INT32_MAX, 1000, false},
+	{-3000000, -1500000, 3000000, 1500000, true},
+	{2500000, -7, -2500000, 70, true},
+	{-3000, -4000000, 130, 4000000, true},
+	{-1999999, 1000000, 2000001, -999937, true},
+	{1000000, 33, -1000000, 30, true},
+	{-5, 3000000, 100, -3000000, true}
+};
+
+static const uint32_t FAR_N_LINES = sizeof(far_lines)/sizeof(struct _far_line);
+
+struct _far_rect {
+	uint32_t shape; /*0: bufferDrawHLine(), 1: bufferDrawVLine(), 2: bufferDrawRect(), 3: bufferFillRect()*/
+	int32_t cx;
+	int32_t cy;
+	int32_t w;
+	int32_t h;
+};
+
+static const struct _far_rect far_rects[] = {
+	{0u, 100, 5, INT32_MAX, 1},
+	{0u, -5, 63, INT32_MAX, 1},
+	{0u, INT32_MIN, 7, INT32_MAX, 1},
+	{1u, 9, 30, 1, INT32_MAX},
+	{1u, 120, INT32_MIN, 1, INT32_MAX},
+	{2u, 100, 20, INT32_MAX, INT32_MAX},
+	{2u, -7, -3, INT32_MAX, 40},
+	{2u, 40, INT32_MIN, 30, INT32_MAX},
+	{2u, INT32_MIN, INT32_MIN, INT32_MAX, INT32_MAX},
+	{3u, 100, 20, INT32_MAX, INT32_MAX},
+	{3u, INT32_MIN, -4, INT32_MAX, 30},
+	{3u, 3, INT32_MIN + 1, 17, INT32_MAX}
+};
+
+static const uint32_t FAR_N_RECTS = sizeof(far_rects)/sizeof(struct _far_rect);
+
+/*
+ * returns the number of far off shapes (ends or far edges near the int32_t limits, or a million steps off the display) that don't
+ * match the reference, or that take long: a far line must only walk its steps on the display.
+ */
+
+static uint32_t far_check(void)
+{
+	static uint16_t expected[ST7920::WIDTH_PAGES*ST7920::HEIGHT];
+	static uint16_t actual[ST7920::WIDTH_PAGES*ST7920::HEIGHT];
+	const struct _far_line *line = NULL;
+	const struct _far_rect *rect = NULL;
+	struct timespec start;
+	struct timespec stop;
+	uint32_t n_item = 0u;
+	uint32_t n_call = 0u;
+	uint32_t n_fail = 0u;
+	double host_ns = 0.0;
+
+	for(n_item = 0u; n_item < FAR_N_LINES; n_item++)
+	{
+		line = &far_lines[n_item];
+
+		ref_check_background(n_item);
+		ref_line_far(line->cx0, line->cy0, line->cx1, line->cy1, st7920.DRAWMODE_TOGGLE);
+		ref_check_snapshot(expected);
+
+		ref_check_background(n_item);
+		st7920.bufferDrawLine(line->cx0, line->cy0, line->cx1, line->cy1, st7920.DRAWMODE_TOGGLE);
+		ref_check_snapshot(actual);
+
+		if(memcmp(expected, actual, sizeof(expected)))
+		{
+			fprintf(stderr, "st7920_bench: far line (%d, %d) - (%d, %d) doesn't match the reference\n", line->cx0, line->cy0, line->cx1, line->cy1);
+			n_fail++;
+		}
+
+		if(!line->walk) continue;
+
+		ref_check_background(n_item);
+		ref_line(line->cx0, line->cy0, line->cx1, line->cy1, st7920.DRAWMODE_TOGGLE);
+		ref_check_snapshot(expected);
+
+		if(memcmp(expected, actual, sizeof(expected)))
+		{
+			fprintf(stderr, "st7920_bench: far line (%d, %d) - (%d, %d) doesn't match walking every step\n", line->cx0, line->cy0, line->cx1, line->cy1);
+			n_fail++;
+		}
+	}
+
+	/*Walking the whole line took ~0.5s per call*/
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for(n_call = 0u; n_call < 1000u; n_call++) st7920.bufferDrawLine(-200000000, 0, 200000000, 63, st7920.DRAWMODE_TOGGLE);
+
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+	host_ns = 1.0e9*(stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec);
+
+	if(host_ns > 100.0e6)
+	{
+		fprintf(stderr, "st7920_bench: far line takes %.0f ns per call\n", host_ns/1000.0);
+		n_fail++;
+	}
+
+	for(n_item = 0u; n_item < FAR_N_RECTS; n_item++)
+	{
+		rect = &far_rects[n_item];
+
+		ref_check_background(n_item);
+		ref_rect_far(rect->cx, rect->cy, rect->w, rect->h, (rect->shape != 2u), st7920.DRAWMODE_TOGGLE);
+		ref_check_snapshot(expected);
+
+		ref_check_background(n_item);
+
+		switch(rect->shape)
+		{
+			case 0u: st7920.bufferDrawHLine(rect->cx, rect->cy, rect->w, st7920.DRAWMODE_TOGGLE); break;
+			case 1u: st7920.bufferDrawVLine(rect->cx, rect->cy, rect->h, st7920.DRAWMODE_TOGGLE); break;
+			case 2u: st7920.bufferDrawRect(rect->cx, rect->cy, rect->w, rect->h, st7920.DRAWMODE_TOGGLE); break;
+			case 3u: st7920.bufferFillRect(rect->cx, rect->cy, rect->w, rect->h, st7920.DRAWMODE_TOGGLE); break;
+		}
+
+		ref_check_snapshot(actual);
+
+		if(memcmp(expected, actual, sizeof(expected)))
+		{
+			fprintf(stderr, "st7920_bench: far shape %u (%d, %d, %d, %d) doesn't match the reference\n", rect->shape, rect->cx, rect->cy, rect->w, rect->h);
+			n_fail++;
+		}
+	}
+
+	/*Blits as wide or tall as allowed, against the same rows and columns blitted at their visible size*/
+	ref_check_background(1u);
+	st7920.bufferBlit(100, 9, (st7920.WIDTH - 100u), 1u, bench_bitmap, st7920.RASTEROP_XOR);
+	ref_check_snapshot(expected);
+
+	ref_check_background(1u);
+	st7920.bufferBlit(100, 9, 0x7fffffffu, 1u, bench_bitmap, st7920.RASTEROP_XOR);
+	ref_check_snapshot(actual);
+
+	if(memcmp(expected, actual, sizeof(expected)))
+	{
+		fprintf(stderr, "st7920_bench: blit 0x7fffffff wide doesn't match the reference\n");
+		n_fail++;
+	}
+
+	ref_check_background(2u);
+	st7920.bufferBlit(50, 10, 8u, (st7920.HEIGHT - 10u), bench_bitmap, st7920.RASTEROP_COPY);
+	ref_check_snapshot(expected);
+
+	ref_check_background(2u);
+	st7920.bufferBlit(50, 10, 8u, 0x7fffffffu, bench_bitmap, st7920.RASTEROP_COPY);
+	ref_check_snapshot(actual);
+
+	if(memcmp(expected, actual, sizeof(expected)))
+	{
+		fprintf(stderr, "st7920_bench: blit 0x7fffffff tall doesn't match the reference\n");
+		n_fail++;
+	}
+
+	return n_fail;
+}
+
+/*returns the number of batch plotting calls that don't match plotting the same points one by one*/
+static uint32_t batch_check(void)
+{
+	static uint16_t expected[ST7920::WIDTH_PAGES*ST7920::HEIGHT];
+	static uint16_t actual[ST7920::WIDTH_PAGES*ST7920::HEIGHT];
+	uint32_t n_point = 0u;
+	uint32_t n_fail = 0u;
+	int32_t draw_mode = 0;
+
+	prep_cloud(0u);
+
+	/*A few points out of range, to be skipped*/
+	bench_cloud_x[7] = st7920.WIDTH;
+	bench_cloud_y[9] = st7920.HEIGHT;
+	bench_cloud_packed[7] = st7920.packPixel(st7920.WIDTH, 3u);
+	bench_cloud_packed[9] = st7920.packPixel(3u, st7920.HEIGHT);
+
+	for(draw_mode = st7920.DRAWMODE_CLEAR; draw_mode <= st7920.DRAWMODE_TOGGLE; draw_mode++)
+	{
+		ref_check_background((uint32_t) draw_mode);
+		for(n_point = 0u; n_point < BENCH_N_CLOUD; n_point++) ref_plot(bench_cloud_x[n_point], bench_cloud_y[n_point], draw_mode);
+		ref_check_snapshot(expected);
+
+		ref_check_background((uint32_t) draw_mode);
+		st7920.bufferSetPixels(bench_cloud_x, bench_cloud_y, BENCH_N_CLOUD, draw_mode);
+		ref_check_snapshot(actual);
+		if(memcmp(expected, actual, sizeof(expected))) n_fail++;
+
+		ref_check_background((uint32_t) draw_mode);
+		for(n_point = 0u; n_point < BENCH_N_CLOUD; n_point++) ref_plot((bench_cloud_packed[n_point] & 0xff), (bench_cloud_packed[n_point] >> 8), draw_mode);
+		ref_check_snapshot(expected);
+
+		ref_check_background((uint32_t) draw_mode);
+		st7920.bufferSetPackedPixels(bench_cloud_packed, BENCH_N_CLOUD, draw_mode);
+		ref_check_snapshot(actual);
+		if(memcmp(expected, actual, sizeof(expected))) n_fail++;
+	}
+
+	/*Restore the cloud*/
+	bench_cloud_packed[BENCH_N_CLOUD - 1u] = 0u;
+	prep_cloud(0u);
+
+	return n_fail;
+}
+
+/*returns the number of random blits that don't match a per pixel reference*/
+static uint32_t blit_check(uint32_t n_iterations)
+{
+	static uint16_t expected[ST7920::WIDTH_PAGES*ST7920::HEIGHT];
+	static uint16_t actual[ST7920::WIDTH_PAGES*ST7920::HEIGHT];
+	uint32_t n_iteration = 0u;
+	uint32_t n_fail = 0u;
+	uint32_t seed = 0u;
+	uint32_t w = 0u;
+	uint32_t h = 0u;
+	uint32_t x = 0u;
+	uint32_t y = 0u;
+	int32_t cx = 0;
+	int32_t cy = 0;
+	int32_t raster_op = 0;
+	int32_t level = 0;
+	int32_t source = 0;
+
+	prep_bitmaps(0u);
+
+	for(n_iteration = 0u; n_iteration < n_iterations; n_iteration++)
+	{
+		raster_op = bench_random(st7920.RASTEROP_COPY, st7920.RASTEROP_NOT);
+		seed = (uint32_t) bench_random(0, 0x7fffffff);
+		cx = bench_random(-70, 140);
+		cy = bench_random(-40, 80);
+		w = (uint32_t) bench_random(0, 120);
+		h = (uint32_t) bench_random(0, 64);
+
+		if((w + 7u)/8u*h > sizeof(bench_bitmap)) h = sizeof(bench_bitmap)/((w + 7u)/8u);
+
+		ref_check_background(seed);
+
+		for(y = 0u; y < h; y++)
+		{
+			for(x = 0u; x < w; x++)
+			{
+				if((cx + (int32_t) x < 0) || (cy + (int32_t) y < 0)) continue;
+
+				level = st7920.bufferGetPixel((cx + x), (cy + y));
+				if(level < 0) continue;
+
+				source = (bench_bitmap[y*((w + 7u)/8u) + x/8u] >> (7u - x%8u)) & 0x1;
+
+				switch(raster_op)
+				{
+					case st7920.RASTEROP_COPY: level = source; break;
+					case st7920.RASTEROP_OR: level |= source; break;
+					case st7920.RASTEROP_AND: level &= source; break;
+					case st7920.RASTEROP_XOR: level ^= source; break;
+					case st7920.RASTEROP_NOT: level = !source; break;
+				}
+
+				st7920.bufferSetPixel((cx + x), (cy + y), (level != 0));
+			}
+		}
+
+		ref_check_snapshot(expected);
+
+		ref_check_background(seed);
+		st7920.bufferBlit(cx, cy, w, h, bench_bitmap, raster_op);
+		ref_check_snapshot(actual);
+
+		if(memcmp(expected, actual, sizeof(expected)))
+		{
+			if(n_fail < 8u) fprintf(stderr, "st7920_bench: blit (%d, %d, %u, %u) rop %d doesn't match the reference\n", cx, cy, w, h, raster_op);
+			n_fail++;
+		}
+	}
+
+	return n_fail;
+}
+
+/*returns the number of random strings that don't match the per pixel reference*/
+static uint32_t text_check(uint32_t n_iterations)
+{
+	static uint16_t expected[ST7920::WIDTH_PAGES*ST7920::HEIGHT];
+	static uint16_t actual[ST7920::WIDTH_PAGES*ST7920::HEIGHT];
+	const struct _st7920_font *font = NULL;
+	char text[24];
+	uint32_t n_iteration = 0u;
+	uint32_t n_char = 0u;
+	uint32_t length = 0u;
+	uint32_t n_fail = 0u;
+	uint32_t seed = 0u;
+	int32_t cx = 0;
+	int32_t cy = 0;
+	int32_t draw_mode = 0;
+	int32_t end_cx = 0;
+
+	for(n_iteration = 0u; n_iteration < n_iterations; n_iteration++)
+	{
+		if(n_iteration & 0x1) font = &st7920_font_5x7p;
+		else font = &st7920_font_5x7;
+
+		draw_mode = bench_random(0, 2);
+		seed = (uint32_t) bench_random(0, 0x7fffffff);
+		cx = bench_random(-40, 140);
+		cy = bench_random(-10, 70);
+		length = (uint32_t) bench_random(0, 23);
+
+		/*Printable characters, plus a few missing from the font*/
+		for(n_char = 0u; n_char < length; n_char++) text[n_char] = (char) bench_random(0x1e, 0x80);
+		text[length] = '\0';
+
+		ref_check_background(seed);
+		end_cx = ref_text(cx, cy, text, font, draw_mode);
+		ref_check_snapshot(expected);
+
+		ref_check_background(seed);
+		st7920.bufferDrawText(cx, cy, text, font, draw_mode);
+		ref_check_snapshot(actual);
+
+		if(memcmp(expected, actual, sizeof(expected)) || (length && (st7920.measureText(text, font) != (end_cx - cx - (int32_t) font->spacing))))
+		{
+			if(n_fail < 8u) fprintf(stderr, "st7920_bench: text \"%s\" at (%d, %d) mode %d doesn't match the reference\n", text, cx, cy, draw_mode);
+			n_fail++;
+		}
+	}
+
+	return n_fail;
+}
+
+static void bench_run(const struct _bench_op *op, struct _bench_result *result)
+{
+	uint32_t n_rep = 0u;
+	uint64_t sim_ns = 0u;
+	uint64_t host_ns = 0u;
+	uint64_t t0 = 0u;
+
+	memset(result, 0, sizeof(struct _bench_result));
+
+	for(n_rep = 0u; n_rep < op->repeat; n_rep++)
+	{
+		op->prepare(op->arg);
+
+		st7920.resetBusByteCount();
+		st7920_fixed.resetBusByteCount();
+		st7920_serial.resetBusByteCount();
+		hostResetCounters();
+		sim_ns = hostGetTimeNs();
+		t0 = bench_host_time_ns();
+
+		op->run(op->arg);
+
+		host_ns = bench_host_time_ns() - t0;
+		sim_ns = hostGetTimeNs() - sim_ns;
+
+		/*Only one of them is in use by the operation*/
+		result->bytes += st7920.getBusByteCount() + st7920_fixed.getBusByteCount() + st7920_serial.getBusByteCount();
+		result->commands += st7920.getBusCommandCount() + st7920_fixed.getBusCommandCount() + st7920_serial.getBusCommandCount();
+		result->strobes += hostGetPinRiseCount(BENCH_E);
+		result->pin_writes += hostGetPinWriteCount();
+		result->fast_pin_writes += hostGetPinWriteFastCount();
+		result->delay_us += (double) hostGetDelayUs();
+		result->sim_us += sim_ns/1000.0;
+		result->host_ns += (double) host_ns;
+	}
+
+	result->bytes /= op->repeat;
+	result->commands /= op->repeat;
+	result->strobes /= op->repeat;
+	result->pin_writes /= op->repeat;
+	result->fast_pin_writes /= op->repeat;
+	result->delay_us /= op->repeat;
+	result->sim_us /= op->repeat;
+	result->host_ns /= op->repeat;
+
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	FILE *output = stdout;
+	struct _bench_result result;
+	uint32_t n_op = 0u;
+	uint32_t n_fail = 0u;
+	double items_per_s = 0.0;
+	bool over = false;
+
+	if(argc > 1)
+	{
+		output = fopen(argv[1], "w");
+		if(output == NULL)
+		{
+			fprintf(stderr, "st7920_bench: can't open %s\n", argv[1]);
+			return 2;
+		}
+	}
+
+	if(!st7920.begin()) return 2;
+	if(!st7920_fixed.begin()) return 2;
+	if(!st7920_serial.begin()) return 2;
+
+	/*Cursor not shown: text cursor moves are only sent with the next text*/
+	st7920.setDisplayMode(st7920.DISPLAYMODE_DISPLAY_ON_CURSOR_OFF);
+	st7920_fixed.setDisplayMode(st7920_fixed.DISPLAYMODE_DISPLAY_ON_CURSOR_OFF);
+	st7920_serial.setDisplayMode(st7920_serial.DISPLAYMODE_DISPLAY_ON_CURSOR_OFF);
+
+	st7920.clearDisplay();
+	st7920.enableGraphicDisplay(true);
+	emulator.resetCounters();
+
+	fprintf(output, "op,calls,bus_bytes,commands,e_strobes,pin_writes,fast_pin_writes,delay_us,sim_us,host_ns,items_per_s,budget_bytes,budget_delay_us,status\n");
+
+	for(n_op = 0u; n_op < BENCH_N_OPS; n_op++)
+	{
+		bench_run(&bench_ops[n_op], &result);
+
+		over = false;
+		if(bench_ops[n_op].max_bytes && (result.bytes > bench_ops[n_op].max_bytes)) over = true;
+		if(bench_ops[n_op].max_delay_us && (result.delay_us > bench_ops[n_op].max_delay_us)) over = true;
+
+		if(over) n_fail++;
+
+		items_per_s = 0.0;
+		if(bench_ops[n_op].n_items && (result.host_ns > 0.0)) items_per_s = 1.0e9*bench_ops[n_op].n_items/result.host_ns;
+
+		fprintf(output, "%s,%u,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.0f,%.0f,%u,%u,%s\n", bench_ops[n_op].name, bench_ops[n_op].repeat, result.bytes, result.commands, result.strobes, result.pin_writes, result.fast_pin_writes, result.delay_us, result.sim_us, result.host_ns, items_per_s, bench_ops[n_op].max_bytes, bench_ops[n_op].max_delay_us, (over ? "OVER" : "ok"));
+	}
+
+	if(output != stdout) fclose(output);
+
+	if(ref_check(4000u))
+	{
+		fprintf(stderr, "st7920_bench: drawing primitives don't match the reference\n");
+		return 1;
+	}
+
+	if(far_check())
+	{
+		fprintf(stderr, "st7920_bench: far off shapes don't match the reference\n");
+		return 1;
+	}
+
+	if(blit_check(4000u))
+	{
+		fprintf(stderr, "st7920_bench: bufferBlit() doesn't match the reference\n");
+		return 1;
+	}
+
+	/*With the glyph cache (left on by the text operations), then without*/
+	if(text_check(4000u))
+	{
+		fprintf(stderr, "st7920_bench: bufferDrawText() doesn't match the reference\n");
+		return 1;
+	}
+
+	st7920.setGlyphCache(NULL, 0u);
+
+	if(text_check(4000u))
+	{
+		fprintf(stderr, "st7920_bench: bufferDrawText() without a glyph cache doesn't match the reference\n");
+		return 1;
+	}
+
+	if(batch_check())
+	{
+		fprintf(stderr, "st7920_bench: batch pixel plotting doesn't match bufferSetPixel()\n");
+		return 1;
+	}
+
+	if(emulator.getViolationCount() || emulator_serial.getViolationCount())
+	{
+		fprintf(stderr, "st7920_bench: %u transfers sent while the display was busy\n", (emulator.getViolationCount() + emulator_serial.getViolationCount()));
+		return 1;
+	}
+
+	if(n_fail)
+	{
+		fprintf(stderr, "st7920_bench: %u operations over budget\n", n_fail);
+		return 1;
+	}
+
+	return 0;
+}
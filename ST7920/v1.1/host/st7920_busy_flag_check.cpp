@@ -0,0 +1,237 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Busy flag polling check, on an emulated 128x64 display with the simulated clock.
+ *
+ * The same graphics and text are sent with RW connected (busy flag polling) and without (fixed delays), with the display executing
+ * instructions in 10us up to 160us (setExecTime()). With the busy flag, the time taken follows the display and nothing is sent
+ * while it's busy, whatever its speed. The fixed delays don't: they take the same time on a fast display, and a display slower than
+ * they allow gets transfers while busy (counted, expected).
+ * Then the busy flag is stuck (reads busy all the time, from after begin()): the bus must give up polling after one timeout and
+ * go on with fixed delays (_CMD_LONG_DELAY_US for that transfer), showing the same content. Same for ST7920Fixed with RW.
+ *
+ * Exit status is 1 if any check fails.
+ *
+ * usage: st7920_busy_flag_check
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define CHECK_DB0 2
+#define CHECK_DB1 3
+#define CHECK_DB2 4
+#define CHECK_DB3 5
+#define CHECK_DB4 6
+#define CHECK_DB5 7
+#define CHECK_DB6 8
+#define CHECK_DB7 9
+#define CHECK_RS 10
+#define CHECK_E 11
+#define CHECK_RW 12
+
+#define CHECK_PIN_COST_NS 40u
+
+/*Busy flag timeout and fallback delay of the bus (see ST7920ParallelBus)*/
+#define CHECK_BUSY_TIMEOUT_US 2048u
+#define CHECK_LONG_DELAY_US 1024u
+
+static ST7920Emulator emulator(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_RW, CHECK_E);
+
+static ST7920 fixed_delays(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+static ST7920 busy_flag(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_RW, CHECK_E);
+static ST7920Fixed<CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E, CHECK_RW> busy_flag_fixed_pins;
+
+struct _check_run {
+	uint64_t time_ns; /*Graphics and text, after begin()*/
+	uint32_t violations;
+	bool shown; /*The display holds the buffer and the text*/
+	bool busy_flag; /*busyFlagIsEnabled() at the end*/
+};
+
+static uint32_t n_fail = 0u;
+
+static void check(bool ok, const char *what)
+{
+	if(ok) return;
+
+	printf("FAIL: %s\n", what);
+	n_fail++;
+	return;
+}
+
+/*Text line n (16 characters)*/
+static void check_line(uint32_t n_line, uint32_t exec_us, char *line)
+{
+	snprintf(line, 17, "Line %u, exec %3u", n_line, exec_us);
+	return;
+}
+
+/*
+ * emulator.reset(), begin(), then graphics and text (timed). exec_us: display execution time (clear: 22 times longer, ~1.6ms at 72us).
+ * stuck: the busy flag reads busy from after begin().
+ */
+
+template<class Panel>
+static void check_run(Panel &panel, uint32_t exec_us, bool stuck, struct _check_run *p_run)
+{
+	uint32_t rand_state = 0x5bd1e995u;
+	uint32_t n_pixel = 0u;
+	uint32_t n_line = 0u;
+	uint32_t cy = 0u;
+	uint32_t page = 0u;
+	uint64_t start_ns = 0u;
+	char line[40];
+	char text[40];
+
+	memset(p_run, 0, sizeof(struct _check_run));
+
+	emulator.setBusyFlagStuck(false);
+	emulator.reset();
+	emulator.setExecTime(exec_us, 22u*exec_us);
+
+	if(!panel.begin()) return;
+
+	emulator.setBusyFlagStuck(stuck);
+	emulator.resetCounters();
+
+	start_ns = hostGetTimeNs();
+
+	panel.clearText();
+	panel.enableGraphicDisplay(true);
+	panel.bufferSetAll(false);
+
+	for(n_pixel = 0u; n_pixel < 800u; n_pixel++)
+	{
+		rand_state ^= rand_state << 13;
+		rand_state ^= rand_state >> 17;
+		rand_state ^= rand_state << 5;
+
+		panel.bufferSetPixel((rand_state % panel.WIDTH), ((rand_state >> 16) % panel.HEIGHT), true);
+	}
+
+	panel.bufferDrawCircle(64, 32, 24u, panel.DRAWMODE_TOGGLE);
+	panel.bufferPaintAll();
+
+	for(n_line = 0u; n_line < panel.N_LINES; n_line++)
+	{
+		check_line(n_line, exec_us, line);
+		panel.setTextCursorPosition(0u, n_line);
+		panel.printText(line);
+	}
+
+	p_run->time_ns = hostGetTimeNs() - start_ns;
+	p_run->violations = emulator.getViolationCount();
+	p_run->busy_flag = (panel.busyFlagIsEnabled() == 1);
+
+	/*Let the last instruction finish before reading back*/
+	delayMicroseconds(22u*exec_us);
+
+	p_run->shown = true;
+
+	for(cy = 0u; cy < panel.HEIGHT; cy++)
+	{
+		for(page = 0u; page < panel.WIDTH_PAGES; page++)
+		{
+			if(emulator.getGdramWord((cy % 32u), ((cy/32u)*panel.WIDTH_PAGES + page)) != (uint16_t) panel.bufferGetPage(page, cy)) p_run->shown = false;
+		}
+	}
+
+	for(n_line = 0u; n_line < panel.N_LINES; n_line++)
+	{
+		check_line(n_line, exec_us, line);
+		emulator.getTextLine(n_line, text);
+
+		if(memcmp(text, line, 16u)) p_run->shown = false;
+	}
+
+	return;
+}
+
+/*Execution times: faster and slower than the fixed delays (_CMD_SHORT_DELAY_US = 128us)*/
+static const uint32_t check_exec_us[] = {10u, 36u, 72u, 128u, 160u};
+
+static void check_exec_times(void)
+{
+	struct _check_run fixed_run;
+	struct _check_run busy_run;
+	uint64_t last_busy_ns = 0u;
+	uint32_t n_exec = 0u;
+	uint32_t exec_us = 0u;
+
+	for(n_exec = 0u; n_exec < (sizeof(check_exec_us)/sizeof(uint32_t)); n_exec++)
+	{
+		exec_us = check_exec_us[n_exec];
+
+		check_run(fixed_delays, exec_us, false, &fixed_run);
+		check_run(busy_flag, exec_us, false, &busy_run);
+
+		printf("exec %3uus: fixed delays %7.2f ms (%u sent while busy), busy flag %7.2f ms (%u sent while busy), %.2fx\n", exec_us, (((double) fixed_run.time_ns)/1e6), fixed_run.violations, (((double) busy_run.time_ns)/1e6), busy_run.violations, (((double) fixed_run.time_ns)/((double) busy_run.time_ns)));
+
+		check(busy_run.shown, "busy flag: display shows the buffer and the text");
+		check(!busy_run.violations, "busy flag: nothing sent while busy");
+		check(busy_run.busy_flag, "busy flag: still polling");
+
+		/*The busy flag time follows the display*/
+		check((busy_run.time_ns > last_busy_ns), "busy flag: slower display, longer time");
+		last_busy_ns = busy_run.time_ns;
+
+		if(exec_us <= 72u) check((10u*busy_run.time_ns < 8u*fixed_run.time_ns), "busy flag: faster than fixed delays (by 25% or more) on a display faster than them");
+
+		if(exec_us <= 128u)
+		{
+			check(fixed_run.shown, "fixed delays: display shows the buffer and the text");
+			check(!fixed_run.violations, "fixed delays: nothing sent while busy");
+		}
+		else check((fixed_run.violations > 0u), "fixed delays: a display slower than them gets transfers while busy");
+	}
+
+	return;
+}
+
+template<class Panel>
+static void check_stuck(Panel &panel, const char *name)
+{
+	struct _check_run fixed_run;
+	struct _check_run stuck_run;
+	uint64_t max_ns = 0u;
+
+	check_run(fixed_delays, 72u, false, &fixed_run);
+	check_run(panel, 72u, true, &stuck_run);
+
+	/*One timeout, one long delay instead of that transfer's delay, the rest as with fixed delays*/
+	max_ns = fixed_run.time_ns + 1000u*((uint64_t) (CHECK_BUSY_TIMEOUT_US + CHECK_LONG_DELAY_US + 100u));
+
+	printf("%s, busy flag stuck: %.2f ms (fixed delays %.2f ms), %u sent while busy\n", name, (((double) stuck_run.time_ns)/1e6), (((double) fixed_run.time_ns)/1e6), stuck_run.violations);
+
+	check(!stuck_run.busy_flag, "busy flag stuck: polling given up");
+	check((stuck_run.time_ns <= max_ns), "busy flag stuck: one timeout, then fixed delays");
+	check(stuck_run.shown, "busy flag stuck: display shows the buffer and the text");
+	check(!stuck_run.violations, "busy flag stuck: nothing sent while busy");
+	return;
+}
+
+int main(void)
+{
+	hostSetPinWriteCostNs(CHECK_PIN_COST_NS);
+
+	check_exec_times();
+	check_stuck(busy_flag, "ST7920");
+	check_stuck(busy_flag_fixed_pins, "ST7920Fixed");
+
+	printf("busy flag: %s (%u failures)\n", (n_fail ? "FAIL" : "ok"), n_fail);
+
+	if(n_fail) return 1;
+
+	return 0;
+}
@@ -0,0 +1,366 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * CGRAM glyph check: loadCgramGlyph() / printCgramGlyph() against a model of the 4 CGRAM slots.
+ *
+ * LRU: random loads of more glyphs than there are slots, nothing on screen. Every load must pick the slot the model picks
+ * (an empty one, otherwise the least recently used), upload only on a miss (nothing at all is sent on a hit), count hits and misses,
+ * and leave the glyph in CGRAM.
+ *
+ * On screen: random glyphs printed at random places, mixed with text written over them. A glyph showing on screen must never be replaced:
+ * every DDRAM word the model says shows a glyph must hold that glyph's code, with that glyph in CGRAM. A print must fail exactly when
+ * the glyph isn't loaded and all 4 slots show on screen.
+ *
+ * Exit status is 1 if any check fails or the emulator saw a transfer while the display was busy.
+ *
+ * usage: st7920_cgram_check [n_calls]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define CHECK_DB0 2
+#define CHECK_DB1 3
+#define CHECK_DB2 4
+#define CHECK_DB3 5
+#define CHECK_DB4 6
+#define CHECK_DB5 7
+#define CHECK_DB6 8
+#define CHECK_DB7 9
+#define CHECK_RS 10
+#define CHECK_E 11
+
+#define CHECK_N_GLYPHS 7u
+#define CHECK_N_SLOTS 4u
+#define CHECK_N_WORDS 32u
+
+static ST7920Emulator emulator(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 0xff, CHECK_E);
+static ST7920 st7920(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+
+static uint16_t glyphs[CHECK_N_GLYPHS][16];
+
+/*Slot model: glyph index in each slot (-1: empty) and last use. Screen model: glyph shown by each DDRAM word (-1: text).*/
+static int32_t model_slot[CHECK_N_SLOTS];
+static uint32_t model_last_use[CHECK_N_SLOTS];
+static uint32_t model_use_count = 0u;
+static uint32_t model_hits = 0u;
+static uint32_t model_misses = 0u;
+static int32_t model_word[CHECK_N_WORDS];
+
+static uint32_t n_calls_total = 20000u;
+static uint32_t check_rand_state = 0x2545f491u;
+
+static uint32_t check_random(void)
+{
+	uint32_t x = check_rand_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	check_rand_state = x;
+	return x;
+}
+
+static void model_reset(void)
+{
+	uint32_t n = 0u;
+
+	for(n = 0u; n < CHECK_N_SLOTS; n++) model_slot[n] = -1;
+	for(n = 0u; n < CHECK_N_WORDS; n++) model_word[n] = -1;
+
+	return;
+}
+
+static bool model_slot_shown(uint32_t slot)
+{
+	uint32_t n_word = 0u;
+
+	for(n_word = 0u; n_word < CHECK_N_WORDS; n_word++) if(model_word[n_word] == model_slot[slot]) return true;
+
+	return false;
+}
+
+/*returns the slot the glyph ends up in, -1 if none can take it*/
+static int32_t model_load(uint32_t glyph)
+{
+	uint32_t slot = 0u;
+	int32_t pick = -1;
+
+	model_use_count++;
+
+	for(slot = 0u; slot < CHECK_N_SLOTS; slot++)
+	{
+		if(model_slot[slot] != ((int32_t) glyph)) continue;
+
+		model_last_use[slot] = model_use_count;
+		model_hits++;
+		return (int32_t) slot;
+	}
+
+	for(slot = 0u; slot < CHECK_N_SLOTS; slot++)
+	{
+		if(model_slot[slot] < 0)
+		{
+			pick = (int32_t) slot;
+			break;
+		}
+
+		if(model_slot_shown(slot)) continue;
+		if((pick < 0) || (model_last_use[slot] < model_last_use[pick])) pick = (int32_t) slot;
+	}
+
+	if(pick < 0) return -1;
+
+	model_slot[pick] = (int32_t) glyph;
+	model_last_use[pick] = model_use_count;
+	model_misses++;
+
+	return pick;
+}
+
+/*CGRAM holds each modeled glyph, and each DDRAM word showing a glyph has its slot code*/
+static uint32_t check_display(uint32_t n_call, const char *call)
+{
+	uint32_t slot = 0u;
+	uint32_t n_row = 0u;
+	uint32_t n_word = 0u;
+	int32_t glyph_slot = -1;
+
+	for(slot = 0u; slot < CHECK_N_SLOTS; slot++)
+	{
+		if(model_slot[slot] < 0) continue;
+
+		for(n_row = 0u; n_row < 16u; n_row++)
+		{
+			if(emulator.getCgramWord(16u*slot + n_row) == glyphs[model_slot[slot]][n_row]) continue;
+
+			printf("call %u (%s): CGRAM slot %u row %u is 0x%04x, expected 0x%04x (glyph %d)\n", n_call, call, slot, n_row, emulator.getCgramWord(16u*slot + n_row), glyphs[model_slot[slot]][n_row], model_slot[slot]);
+			return 1u;
+		}
+	}
+
+	for(n_word = 0u; n_word < CHECK_N_WORDS; n_word++)
+	{
+		if(model_word[n_word] < 0) continue;
+
+		glyph_slot = -1;
+		for(slot = 0u; slot < CHECK_N_SLOTS; slot++) if(model_slot[slot] == model_word[n_word]) glyph_slot = (int32_t) slot;
+
+		if((glyph_slot >= 0) && !emulator.getDdramByte(2u*n_word) && (emulator.getDdramByte(2u*n_word + 1u) == (uint8_t) (2*glyph_slot))) continue;
+
+		printf("call %u (%s): DDRAM word %u is 0x%02x%02x, expected glyph %d (slot %d)\n", n_call, call, n_word, emulator.getDdramByte(2u*n_word), emulator.getDdramByte(2u*n_word + 1u), model_word[n_word], glyph_slot);
+		return 1u;
+	}
+
+	return 0u;
+}
+
+static uint32_t check_lru(void)
+{
+	uint32_t n_call = 0u;
+	uint32_t n_fail = 0u;
+	uint32_t glyph = 0u;
+	uint32_t sent = 0u;
+	uint32_t hits = 0u;
+	int32_t slot = 0;
+	int32_t code = 0;
+
+	st7920.clearDisplay();
+	st7920.invalidateCgramGlyphs();
+	st7920.resetCgramGlyphCounters();
+
+	model_reset();
+	model_hits = 0u;
+	model_misses = 0u;
+
+	for(n_call = 0u; (n_call < n_calls_total) && (n_fail < 8u); n_call++)
+	{
+		/*Skewed: a few glyphs are used most of the time*/
+		glyph = check_random() % CHECK_N_GLYPHS;
+		if(check_random() & 0x1) glyph %= 3u;
+
+		hits = model_hits;
+		slot = model_load(glyph);
+
+		st7920.resetBusByteCount();
+		code = st7920.loadCgramGlyph(glyphs[glyph]);
+		sent = st7920.getBusByteCount();
+
+		if(code != 2*slot)
+		{
+			printf("lru: call %u: glyph %u loaded as 0x%04x, expected slot %d\n", n_call, glyph, code, slot);
+			n_fail++;
+		}
+
+		/*Hit: nothing to send. Miss: CGRAM address and 32 bytes (plus an instruction set switch).*/
+		if((model_hits > hits) && sent)
+		{
+			printf("lru: call %u: %u bytes sent on a hit\n", n_call, sent);
+			n_fail++;
+		}
+
+		if(sent > 34u + 1u)
+		{
+			printf("lru: call %u: %u bytes sent to load a glyph\n", n_call, sent);
+			n_fail++;
+		}
+
+		n_fail += check_display(n_call, "loadCgramGlyph");
+	}
+
+	if((st7920.getCgramGlyphHitCount() != model_hits) || (st7920.getCgramGlyphMissCount() != model_misses))
+	{
+		printf("lru: %u hits, %u misses, expected %u hits, %u misses\n", st7920.getCgramGlyphHitCount(), st7920.getCgramGlyphMissCount(), model_hits, model_misses);
+		n_fail++;
+	}
+
+	printf("lru: %u loads, %u hits, %u misses, %s\n", n_call, model_hits, model_misses, (n_fail ? "FAIL" : "ok"));
+	return n_fail;
+}
+
+static uint32_t check_on_screen(void)
+{
+	uint32_t n_call = 0u;
+	uint32_t n_fail = 0u;
+	uint32_t n_failed_prints = 0u;
+	uint32_t glyph = 0u;
+	uint32_t cx = 0u;
+	uint32_t cy = 0u;
+	uint32_t n_word = 0u;
+	uint32_t n_char = 0u;
+	uint32_t n_len = 0u;
+	int32_t slot = 0;
+	bool printed = false;
+	char text[8];
+
+	st7920.clearDisplay();
+	st7920.invalidateCgramGlyphs();
+	model_reset();
+
+	for(n_call = 0u; (n_call < n_calls_total) && (n_fail < 8u); n_call++)
+	{
+		cx = check_random() % st7920.N_WCHARS;
+		cy = check_random() % st7920.N_LINES;
+
+		/*DDRAM word of that wide character (lines 2 - 3: right half of DDRAM lines 0 - 1)*/
+		n_word = 16u*(cy % 2u) + (cy/2u)*st7920.N_WCHARS + cx;
+
+		st7920.setWTextCursorPosition(cx, cy);
+
+		if(check_random() % 3u)
+		{
+			glyph = check_random() % CHECK_N_GLYPHS;
+
+			slot = model_load(glyph);
+			printed = st7920.printCgramGlyph(glyphs[glyph]);
+
+			if(printed != (slot >= 0))
+			{
+				printf("on screen: call %u: printCgramGlyph() returned %d, expected %d\n", n_call, printed, (slot >= 0));
+				n_fail++;
+			}
+
+			if(slot >= 0) model_word[n_word] = (int32_t) glyph;
+			else n_failed_prints++;
+
+			n_fail += check_display(n_call, "printCgramGlyph");
+		}
+		else
+		{
+			/*1 to 4 wide characters of text*/
+			n_len = 2u*(1u + check_random() % 4u);
+			if((cx + n_len/2u) > st7920.N_WCHARS) n_len = 2u*(st7920.N_WCHARS - cx);
+
+			for(n_char = 0u; n_char < n_len; n_char++) text[n_char] = (char) ('a' + check_random() % 26u);
+
+			st7920.printText(text, n_len);
+			for(n_char = 0u; n_char < n_len/2u; n_char++) model_word[n_word + n_char] = -1;
+
+			n_fail += check_display(n_call, "printText");
+		}
+	}
+
+	printf("on screen: %u calls, %u prints refused (all slots on screen), %s\n", n_call, n_failed_prints, (n_fail ? "FAIL" : "ok"));
+	return n_fail;
+}
+
+/*Cost of one 16x16 icon: in CGRAM (first time, then again), and drawn as graphics*/
+static void report_cost(void)
+{
+	uint32_t upload = 0u;
+	uint32_t hit = 0u;
+	uint32_t graphics = 0u;
+	uint8_t icon[32];
+
+	st7920.clearDisplay();
+	st7920.invalidateCgramGlyphs();
+
+	st7920.setWTextCursorPosition(2u, 1u);
+	st7920.resetBusByteCount();
+	st7920.printCgramGlyph(glyphs[0]);
+	upload = st7920.getBusByteCount();
+
+	st7920.setWTextCursorPosition(5u, 1u);
+	st7920.resetBusByteCount();
+	st7920.printCgramGlyph(glyphs[0]);
+	hit = st7920.getBusByteCount();
+
+	memcpy(icon, glyphs[0], sizeof(icon));
+
+	st7920.bufferPaintDirty();
+	st7920.resetBusByteCount();
+	st7920.bufferBlit(80, 16, 16u, 16u, icon, st7920.RASTEROP_XOR);
+	st7920.bufferPaintDirty();
+	graphics = st7920.getBusByteCount();
+
+	printf("16x16 icon: %u bytes (upload + print), then %u bytes per print; %u bytes as graphics\n", upload, hit, graphics);
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t n_fail = 0u;
+	uint32_t glyph = 0u;
+	uint32_t n_row = 0u;
+
+	if(argc > 1) n_calls_total = (uint32_t) strtoul(argv[1], NULL, 0);
+
+	if(!n_calls_total)
+	{
+		fprintf(stderr, "st7920_cgram_check: invalid number of calls\n");
+		return 2;
+	}
+
+	for(glyph = 0u; glyph < CHECK_N_GLYPHS; glyph++)
+	{
+		for(n_row = 0u; n_row < 16u; n_row++) glyphs[glyph][n_row] = (uint16_t) check_random();
+	}
+
+	if(!st7920.begin()) return 1;
+
+	st7920.setDisplayMode(st7920.DISPLAYMODE_DISPLAY_ON_CURSOR_OFF);
+	st7920.enableGraphicDisplay(true);
+
+	n_fail += check_lru();
+	n_fail += check_on_screen();
+
+	report_cost();
+
+	if(emulator.getViolationCount()) n_fail++;
+
+	if(n_fail) return 1;
+
+	return 0;
+}
@@ -0,0 +1,644 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "st7920_emulator.hpp"
+
+/*Pin slots in _pins / _levels*/
+#define PIN_SLOT_RS 8u
+#define PIN_SLOT_RW 9u
+#define PIN_SLOT_E 10u
+#define PIN_SLOT_CS PIN_SLOT_RS
+
+ST7920Emulator::ST7920Emulator(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t rw, uint8_t e)
+{
+	this->_serial = false;
+
+	this->_pins[0] = db0;
+	this->_pins[1] = db1;
+	this->_pins[2] = db2;
+	this->_pins[3] = db3;
+	this->_pins[4] = db4;
+	this->_pins[5] = db5;
+	this->_pins[6] = db6;
+	this->_pins[7] = db7;
+	this->_pins[PIN_SLOT_RS] = rs;
+	this->_pins[PIN_SLOT_RW] = rw;
+	this->_pins[PIN_SLOT_E] = e;
+
+	memset(this->_levels, 0, sizeof(this->_levels));
+
+	this->reset();
+	hostAttachDevice(this);
+}
+
+ST7920Emulator::ST7920Emulator(uint8_t cs)
+{
+	this->_serial = true;
+
+	memset(this->_pins, 0xff, sizeof(this->_pins));
+	this->_pins[PIN_SLOT_CS] = cs;
+
+	memset(this->_levels, 0, sizeof(this->_levels));
+
+	this->reset();
+	hostAttachDevice(this);
+}
+
+ST7920Emulator::~ST7920Emulator(void)
+{
+	hostDetachDevice(this);
+}
+
+void ST7920Emulator::reset(void)
+{
+	memset(this->_ddram, ' ', sizeof(this->_ddram));
+	memset(this->_cgram, 0, sizeof(this->_cgram));
+	memset(this->_gdram, 0, sizeof(this->_gdram));
+
+	this->_ext = false;
+	this->_graphics = false;
+	this->_display_on = true;
+	this->_cursor_on = false;
+	this->_blink_on = false;
+	this->_increment = true;
+	this->_scroll_select = false;
+	this->_scroll = 0u;
+
+	this->_target = this->_TARGET_DDRAM;
+	this->_ac = 0u;
+	this->_ac_half = 0u;
+	this->_gdram_v = 0u;
+	this->_gdram_h = 0u;
+	this->_gdram_expect_h = false;
+
+	this->_serial_rs = -1;
+	this->_serial_high_nibble = -1;
+
+	this->_busy_until_ns = 0u;
+
+	this->resetCounters();
+	return;
+}
+
+void ST7920Emulator::setExecTime(uint32_t exec_us, uint32_t clear_us)
+{
+	this->_exec_us = exec_us;
+	this->_clear_us = clear_us;
+	return;
+}
+
+void ST7920Emulator::setBusyFlagStuck(bool stuck)
+{
+	this->_busy_stuck = stuck;
+	return;
+}
+
+bool ST7920Emulator::setPanel(uint32_t width, uint32_t height, bool folded)
+{
+	uint32_t gdram_width = width;
+
+	if(folded) gdram_width *= 2u;
+
+	if(!width || (width % 16u) || (gdram_width > 16u*this->_GDRAM_H_SIZE)) return false;
+	if(!height || (height % 16u) || ((width*height/8u) > this->IMAGE_SIZE_BYTES)) return false;
+	if(folded && (height % 32u)) return false;
+
+	this->_width = width;
+	this->_height = height;
+	this->_folded = folded;
+
+	return true;
+}
+
+uint32_t ST7920Emulator::getWidth(void)
+{
+	return this->_width;
+}
+
+uint32_t ST7920Emulator::getHeight(void)
+{
+	return this->_height;
+}
+
+void ST7920Emulator::render(uint8_t *image)
+{
+	uint32_t cx = 0u;
+	uint32_t cy = 0u;
+
+	if(image == NULL) return;
+
+	memset(image, 0, this->IMAGE_SIZE_BYTES);
+
+	for(cy = 0u; cy < this->_height; cy++)
+	{
+		for(cx = 0u; cx < this->_width; cx++)
+		{
+			if(this->getPixel(cx, cy) > 0) image[(cy*this->_width + cx)/8u] |= (0x80 >> (cx%8u));
+		}
+	}
+
+	return;
+}
+
+int32_t ST7920Emulator::getPixel(uint32_t cx, uint32_t cy)
+{
+	uint32_t v_addr = 0u;
+	uint32_t h_addr = 0u;
+
+	if((cx >= this->_width) || (cy >= this->_height)) return -1;
+
+	if(!this->_display_on) return 0;
+
+	if(this->_text_pixel(cx, cy)) return 1;
+
+	if(!this->_graphics) return 0;
+
+	/*Folded panel (128x64): lower half of the screen is the right half of the GDRAM rows*/
+	v_addr = this->_ram_row(cy);
+	h_addr = cx/16u;
+
+	if(this->_folded && (cy >= this->_height/2u)) h_addr += this->_width/16u;
+
+	if(this->_gdram[v_addr][h_addr] & (0x8000 >> (cx%16u))) return 1;
+
+	return 0;
+}
+
+uint16_t ST7920Emulator::getGdramWord(uint32_t v_addr, uint32_t h_addr)
+{
+	if((v_addr >= this->_GDRAM_V_SIZE) || (h_addr >= this->_GDRAM_H_SIZE)) return 0u;
+
+	return this->_gdram[v_addr][h_addr];
+}
+
+uint8_t ST7920Emulator::getDdramByte(uint32_t byte_addr)
+{
+	if(byte_addr >= this->_DDRAM_SIZE_BYTES) return 0u;
+
+	return this->_ddram[byte_addr];
+}
+
+uint32_t ST7920Emulator::getScrollPosition(void)
+{
+	return this->_scroll;
+}
+
+int32_t ST7920Emulator::getCursorAddress(void)
+{
+	if(this->_target != this->_TARGET_DDRAM) return -1;
+
+	return (int32_t) ((2u*this->_ac + this->_ac_half) % this->_DDRAM_SIZE_BYTES);
+}
+
+uint16_t ST7920Emulator::getCgramWord(uint32_t addr)
+{
+	if(addr >= this->_CGRAM_SIZE_WORDS) return 0u;
+
+	return this->_cgram[addr];
+}
+
+void ST7920Emulator::getTextLine(uint32_t line, char *text)
+{
+	uint32_t n_char = 0u;
+	uint8_t c = 0u;
+
+	if(text == NULL) return;
+
+	text[0] = '\0';
+	if(line >= this->_height/16u) return;
+
+	for(n_char = 0u; n_char < this->_width/8u; n_char++)
+	{
+		c = this->_ddram[(2u*this->_text_word(0u, 16u*line) + n_char) % this->_DDRAM_SIZE_BYTES];
+
+		if((c < 0x20) || (c > 0x7e)) c = '?';
+		text[n_char] = (char) c;
+	}
+
+	text[n_char] = '\0';
+	return;
+}
+
+void ST7920Emulator::printImage(FILE *file)
+{
+	uint32_t cx = 0u;
+	uint32_t cy = 0u;
+
+	for(cy = 0u; cy < this->_height; cy++)
+	{
+		for(cx = 0u; cx < this->_width; cx++)
+		{
+			if(this->getPixel(cx, cy) > 0) fputc('#', file);
+			else fputc('.', file);
+		}
+
+		fputc('\n', file);
+	}
+
+	return;
+}
+
+bool ST7920Emulator::isExtendedMode(void)
+{
+	return this->_ext;
+}
+
+bool ST7920Emulator::isGraphicDisplayEnabled(void)
+{
+	return this->_graphics;
+}
+
+bool ST7920Emulator::isDisplayOn(void)
+{
+	return this->_display_on;
+}
+
+uint32_t ST7920Emulator::getInstructionCount(void)
+{
+	return this->_instruction_count;
+}
+
+uint32_t ST7920Emulator::getDataByteCount(void)
+{
+	return this->_data_byte_count;
+}
+
+uint32_t ST7920Emulator::getViolationCount(void)
+{
+	return this->_violation_count;
+}
+
+uint32_t ST7920Emulator::getModeSwitchCount(void)
+{
+	return this->_mode_switch_count;
+}
+
+void ST7920Emulator::resetCounters(void)
+{
+	this->_instruction_count = 0u;
+	this->_data_byte_count = 0u;
+	this->_violation_count = 0u;
+	this->_mode_switch_count = 0u;
+	return;
+}
+
+void ST7920Emulator::pinChanged(uint8_t pin, uint8_t level)
+{
+	int32_t slot = 0;
+
+	slot = this->_pin_index(pin);
+	if(slot < 0) return;
+
+	this->_levels[slot] = level;
+
+	if(this->_serial)
+	{
+		/*Chip select resets the serial decoder*/
+		if(level)
+		{
+			this->_serial_rs = -1;
+			this->_serial_high_nibble = -1;
+		}
+
+		return;
+	}
+
+	/*Writes are latched on the E falling edge*/
+	if((slot != PIN_SLOT_E) || level) return;
+	if((this->_pins[PIN_SLOT_RW] != 0xff) && this->_levels[PIN_SLOT_RW]) return;
+
+	this->_receive((this->_levels[PIN_SLOT_RS] != 0), this->_read_dataline());
+	return;
+}
+
+int32_t ST7920Emulator::pinRead(uint8_t pin)
+{
+	int32_t slot = 0;
+	uint8_t value = 0u;
+
+	if(this->_serial) return -1;
+
+	slot = this->_pin_index(pin);
+	if((slot < 0) || (slot >= 8)) return -1;
+
+	/*The display drives the data lines only while reading (RW high, E high)*/
+	if(this->_pins[PIN_SLOT_RW] == 0xff) return -1;
+	if(!this->_levels[PIN_SLOT_RW] || !this->_levels[PIN_SLOT_E]) return -1;
+	if(this->_levels[PIN_SLOT_RS]) return -1;
+
+	/*Busy flag + address counter*/
+	value = (uint8_t) (this->_ac & 0x7f);
+	if(this->_busy() || this->_busy_stuck) value |= 0x80;
+
+	return ((value >> slot) & 0x1);
+}
+
+void ST7920Emulator::spiTransfer(uint8_t byte)
+{
+	if(!this->_serial) return;
+	if(!this->_levels[PIN_SLOT_CS]) return;
+
+	/*Sync: 11111 RW RS 0*/
+	if((byte & 0xf9) == 0xf8)
+	{
+		this->_serial_rw = ((byte & 0x04) != 0);
+		this->_serial_rs = ((byte & 0x02) != 0);
+		this->_serial_high_nibble = -1;
+		return;
+	}
+
+	if((this->_serial_rs < 0) || this->_serial_rw) return;
+
+	if(this->_serial_high_nibble < 0)
+	{
+		this->_serial_high_nibble = byte & 0xf0;
+		return;
+	}
+
+	this->_receive((this->_serial_rs != 0), (uint8_t) (this->_serial_high_nibble | (byte >> 4)));
+	this->_serial_high_nibble = -1;
+
+	return;
+}
+
+bool ST7920Emulator::_busy(void)
+{
+	return (hostGetTimeNs() < this->_busy_until_ns);
+}
+
+void ST7920Emulator::_receive(bool rs, uint8_t byte)
+{
+	uint32_t exec_us = this->_exec_us;
+
+	if(this->_busy()) this->_violation_count++;
+
+	if(rs)
+	{
+		this->_data_byte_count++;
+		this->_data(byte);
+	}
+	else
+	{
+		this->_instruction_count++;
+		if(!this->_ext && (byte == 0x01)) exec_us = this->_clear_us;
+		this->_instruction(byte);
+	}
+
+	this->_busy_until_ns = hostGetTimeNs() + 1000u*((uint64_t) exec_us);
+	return;
+}
+
+void ST7920Emulator::_instruction(uint8_t byte)
+{
+	/*Set DDRAM address (basic) / Set GDRAM address (extended)*/
+	if(byte & 0x80)
+	{
+		if(this->_ext)
+		{
+			if(!this->_gdram_expect_h)
+			{
+				this->_gdram_v = byte & 0x3f;
+				this->_gdram_expect_h = true;
+			}
+			else
+			{
+				this->_gdram_h = byte & 0x0f;
+				this->_gdram_expect_h = false;
+			}
+
+			this->_target = this->_TARGET_GDRAM;
+		}
+		else
+		{
+			this->_ac = byte & 0x3f;
+			this->_target = this->_TARGET_DDRAM;
+		}
+
+		this->_ac_half = 0u;
+		return;
+	}
+
+	/*Set CGRAM address (basic, SR = 0) / Set scroll address (extended, SR = 1)*/
+	if(byte & 0x40)
+	{
+		if(this->_ext)
+		{
+			if(this->_scroll_select) this->_scroll = byte & 0x3f;
+		}
+		else if(!this->_scroll_select)
+		{
+			this->_ac = byte & 0x3f;
+			this->_target = this->_TARGET_CGRAM;
+			this->_ac_half = 0u;
+		}
+
+		return;
+	}
+
+	/*Function set (both): DL, RE, G (G only when RE = 1)*/
+	if(byte & 0x20)
+	{
+		if(this->_ext != ((byte & 0x04) != 0)) this->_mode_switch_count++;
+
+		this->_ext = ((byte & 0x04) != 0);
+		if(this->_ext) this->_graphics = ((byte & 0x02) != 0);
+
+		this->_gdram_expect_h = false;
+		return;
+	}
+
+	if(this->_ext)
+	{
+		/*Scroll/RAM select. Reverse and standby are accepted but not modeled.*/
+		if((byte & 0xfe) == 0x02) this->_scroll_select = ((byte & 0x01) != 0);
+
+		return;
+	}
+
+	/*Cursor/display shift*/
+	if(byte & 0x10)
+	{
+		if(!(byte & 0x08))
+		{
+			if(byte & 0x04) this->_ac = (this->_ac + 1u) & 0x3f;
+			else this->_ac = (this->_ac - 1u) & 0x3f;
+
+			this->_ac_half = 0u;
+		}
+
+		return;
+	}
+
+	/*Display control*/
+	if(byte & 0x08)
+	{
+		this->_display_on = ((byte & 0x04) != 0);
+		this->_cursor_on = ((byte & 0x02) != 0);
+		this->_blink_on = ((byte & 0x01) != 0);
+		return;
+	}
+
+	/*Entry mode*/
+	if(byte & 0x04)
+	{
+		this->_increment = ((byte & 0x02) != 0);
+		return;
+	}
+
+	/*Home*/
+	if(byte & 0x02)
+	{
+		this->_ac = 0u;
+		this->_ac_half = 0u;
+		this->_target = this->_TARGET_DDRAM;
+		return;
+	}
+
+	/*Clear*/
+	if(byte & 0x01)
+	{
+		memset(this->_ddram, ' ', sizeof(this->_ddram));
+		this->_ac = 0u;
+		this->_ac_half = 0u;
+		this->_target = this->_TARGET_DDRAM;
+		this->_increment = true;
+		return;
+	}
+
+	return;
+}
+
+void ST7920Emulator::_data(uint8_t byte)
+{
+	uint16_t *p_word = NULL;
+
+	switch(this->_target)
+	{
+		case this->_TARGET_DDRAM:
+			this->_ddram[(2u*this->_ac + this->_ac_half) % this->_DDRAM_SIZE_BYTES] = byte;
+			break;
+
+		case this->_TARGET_CGRAM:
+			p_word = &this->_cgram[this->_ac % this->_CGRAM_SIZE_WORDS];
+			break;
+
+		case this->_TARGET_GDRAM:
+			p_word = &this->_gdram[this->_gdram_v % this->_GDRAM_V_SIZE][this->_gdram_h % this->_GDRAM_H_SIZE];
+			break;
+	}
+
+	/*16 bit RAM: high byte first*/
+	if(p_word != NULL)
+	{
+		if(this->_ac_half) *p_word = (*p_word & 0xff00) | byte;
+		else *p_word = (*p_word & 0x00ff) | (((uint16_t) byte) << 8);
+	}
+
+	this->_ac_half++;
+	if(this->_ac_half < 2u) return;
+
+	this->_ac_half = 0u;
+
+	switch(this->_target)
+	{
+		case this->_TARGET_DDRAM:
+			if(this->_increment) this->_ac = (this->_ac + 1u) & 0x3f;
+			else this->_ac = (this->_ac - 1u) & 0x3f;
+			break;
+
+		case this->_TARGET_CGRAM:
+			this->_ac = (this->_ac + 1u) & 0x3f;
+			break;
+
+		case this->_TARGET_GDRAM:
+			this->_gdram_h = (this->_gdram_h + 1u) & 0x0f;
+			break;
+	}
+
+	return;
+}
+
+uint8_t ST7920Emulator::_read_dataline(void)
+{
+	uint32_t n_line = 0u;
+	uint8_t byte = 0u;
+
+	for(n_line = 0u; n_line < 8u; n_line++) if(this->_levels[n_line]) byte |= (1u << n_line);
+
+	return byte;
+}
+
+int32_t ST7920Emulator::_pin_index(uint8_t pin)
+{
+	uint32_t slot = 0u;
+
+	for(slot = 0u; slot < 11u; slot++) if((this->_pins[slot] == pin) && (pin != 0xff)) return (int32_t) slot;
+
+	return -1;
+}
+
+bool ST7920Emulator::_text_pixel(uint32_t cx, uint32_t cy)
+{
+	uint32_t word = 0u;
+	uint32_t row = 0u;
+	uint32_t col = 0u;
+	uint8_t high = 0u;
+	uint8_t low = 0u;
+	uint8_t c = 0u;
+
+	word = this->_text_word(cx, cy);
+	row = this->_ram_row(cy)%16u;
+	col = cx%16u;
+
+	high = this->_ddram[2u*word];
+	low = this->_ddram[2u*word + 1u];
+
+	/*CGRAM characters: 0x0000, 0x0002, 0x0004, 0x0006*/
+	if(!high && !(low & 0xf9))
+	{
+		if(this->_cgram[16u*(low >> 1) + row] & (0x8000 >> col)) return true;
+		return false;
+	}
+
+	/*16x16 ROM character (not modeled: box)*/
+	if(high >= 0xa1)
+	{
+		if((row == 0u) || (row == 15u) || (col == 0u) || (col == 15u)) return true;
+		return false;
+	}
+
+	/*8x16 ROM character (not modeled: box)*/
+	if(col < 8u) c = high;
+	else c = low;
+
+	if(c <= 0x20) return false;
+
+	col %= 8u;
+	if((row == 1u) || (row == 14u) || (col == 0u) || (col == 6u))
+	{
+		if((row >= 1u) && (row <= 14u) && (col <= 6u)) return true;
+	}
+
+	return false;
+}
+
+uint32_t ST7920Emulator::_text_word(uint32_t cx, uint32_t cy)
+{
+	/*DDRAM rows are 16 words (0x00, 0x10, 0x20, 0x30), 16 pixels tall. Folded panel: lines 2 and 3 are the right half of the rows.*/
+	if(this->_folded && (cy >= this->_height/2u)) return (0x10*(this->_ram_row(cy)/16u) + this->_width/16u + cx/16u) % (this->_DDRAM_SIZE_BYTES/2u);
+
+	return (0x10*(this->_ram_row(cy)/16u) + cx/16u) % (this->_DDRAM_SIZE_BYTES/2u);
+}
+
+/*GDRAM row shown on screen row cy (DDRAM: pixel row, 16 per DDRAM row)*/
+uint32_t ST7920Emulator::_ram_row(uint32_t cy)
+{
+	if(this->_folded) cy %= this->_height/2u;
+
+	return ((cy + this->_scroll) % this->_GDRAM_V_SIZE);
+}
@@ -0,0 +1,214 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Software model of an ST7920 display (128x64 by default, see setPanel()), for host builds.
+ * Connects to the host pins (see host/Arduino.h), decodes the bytes strobed on E (parallel) or sent on SPI with CS high (serial),
+ * and keeps DDRAM, CGRAM, GDRAM and the basic/extended instruction set state.
+ *
+ * Each instruction keeps the controller busy for its execution time. Transfers that arrive while busy are counted as violations.
+ * The busy flag can be read through RW.
+ *
+ * The character generator ROMs are not modeled: ROM characters are rendered as outlined boxes (spaces are blank).
+ * CGRAM characters and graphics are rendered exactly. Text and graphics are OR'ed together.
+ * Vertical scroll: screen row y (of the 32 the controller drives) shows GDRAM row (y + scroll position) % 64, and the DDRAM (4 rows of
+ * 16 pixels) in the same way.
+ *
+ * The display starts on (the driver never sends display control unless setDisplayMode() is called).
+ */
+
+#ifndef ST7920_EMULATOR_HPP
+#define ST7920_EMULATOR_HPP
+
+#include <stdio.h>
+#include <Arduino.h>
+
+class ST7920Emulator : public HostDevice {
+	public:
+		ST7920Emulator(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t rw, uint8_t e);
+		ST7920Emulator(uint8_t cs);
+		~ST7920Emulator(void);
+
+		/*
+		 * reset()
+		 * Puts the controller back to its power on state.
+		 */
+
+		void reset(void);
+
+		/*
+		 * setExecTime()
+		 * Sets the execution time of regular instructions/data writes (default 72us) and of clear (default 1600us).
+		 */
+
+		void setExecTime(uint32_t exec_us, uint32_t clear_us);
+
+		/*
+		 * setBusyFlagStuck()
+		 * stuck = true: the busy flag always reads busy (a wiring fault: DB7 or RW), to check the driver falls back to fixed delays.
+		 * Kept across reset().
+		 */
+
+		void setBusyFlagStuck(bool stuck);
+
+		/*
+		 * setPanel()
+		 * Sets the panel the controller drives: width x height pixels. folded: the lower half of the screen is the right half
+		 * of the GDRAM/DDRAM rows (128x64 panels). Otherwise GDRAM/DDRAM rows map straight to the screen (256x32, 192x32 panels).
+		 *
+		 * returns true if successful, false otherwise.
+		 */
+
+		bool setPanel(uint32_t width, uint32_t height, bool folded);
+
+		uint32_t getWidth(void);
+		uint32_t getHeight(void);
+
+		/*
+		 * render()
+		 * Renders the visible image into "image" (up to IMAGE_SIZE_BYTES, row major, getWidth()/8 bytes per row, MSB first).
+		 */
+
+		void render(uint8_t *image);
+
+		/*
+		 * getPixel()
+		 * returns 1 if the visible pixel (cx , cy) is on, 0 if it's off, -1 if out of range.
+		 */
+
+		int32_t getPixel(uint32_t cx, uint32_t cy);
+
+		/*
+		 * getGdramWord() & getDdramByte() & getCgramWord()
+		 * Raw access to the display RAM.
+		 */
+
+		uint16_t getGdramWord(uint32_t v_addr, uint32_t h_addr);
+		uint8_t getDdramByte(uint32_t byte_addr);
+		uint16_t getCgramWord(uint32_t addr);
+
+		/*
+		 * getScrollPosition()
+		 * returns the vertical scroll position (0 - 63).
+		 */
+
+		uint32_t getScrollPosition(void);
+
+		/*
+		 * getCursorAddress()
+		 * returns the DDRAM byte address the next data byte goes to (where the cursor is shown), or -1 if the address counter isn't in DDRAM.
+		 */
+
+		int32_t getCursorAddress(void);
+
+		/*
+		 * getTextLine()
+		 * Copies the getWidth()/8 characters shown on text line "line" (0 - getHeight()/16 - 1) into "text" (null terminated).
+		 * Wide characters are shown as two bytes, non printable bytes as '?'. Scrolled: the DDRAM row shown on the first pixel row of the line.
+		 */
+
+		void getTextLine(uint32_t line, char *text);
+
+		/*
+		 * printImage()
+		 * Prints the visible image as text (one character per pixel).
+		 */
+
+		void printImage(FILE *file);
+
+		bool isExtendedMode(void);
+		bool isGraphicDisplayEnabled(void);
+		bool isDisplayOn(void);
+
+		/*
+		 * Counters (since the last reset()/resetCounters())
+		 * instructions: instruction bytes received. data_bytes: data bytes received. violations: transfers received while busy.
+		 * mode switches: function sets that change the instruction set (basic <-> extended).
+		 */
+
+		uint32_t getInstructionCount(void);
+		uint32_t getDataByteCount(void);
+		uint32_t getViolationCount(void);
+		uint32_t getModeSwitchCount(void);
+		void resetCounters(void);
+
+		void pinChanged(uint8_t pin, uint8_t level);
+		int32_t pinRead(uint8_t pin);
+		void spiTransfer(uint8_t byte);
+
+		/*Largest image (all panels are 8192 pixels or less)*/
+		static const uint32_t IMAGE_SIZE_BYTES = 1024u;
+
+	private:
+		static const uint32_t _GDRAM_V_SIZE = 64u;
+		static const uint32_t _GDRAM_H_SIZE = 16u;
+		static const uint32_t _DDRAM_SIZE_BYTES = 128u;
+		static const uint32_t _CGRAM_SIZE_WORDS = 64u;
+
+		enum AddressTarget {
+			_TARGET_DDRAM = 0,
+			_TARGET_CGRAM = 1,
+			_TARGET_GDRAM = 2
+		};
+
+		uint32_t _width = 128u;
+		uint32_t _height = 64u;
+		bool _folded = true;
+
+		bool _serial = false;
+		uint8_t _pins[11];
+		uint8_t _levels[11]; /*Last level seen on each pin*/
+
+		/*Serial decoder state*/
+		int32_t _serial_rs = -1;
+		bool _serial_rw = false;
+		int32_t _serial_high_nibble = -1;
+
+		uint8_t _ddram[_DDRAM_SIZE_BYTES];
+		uint16_t _cgram[_CGRAM_SIZE_WORDS];
+		uint16_t _gdram[_GDRAM_V_SIZE][_GDRAM_H_SIZE];
+
+		bool _ext = false;
+		bool _graphics = false;
+		bool _display_on = true;
+		bool _cursor_on = false;
+		bool _blink_on = false;
+		bool _increment = true;
+		bool _scroll_select = false;
+		uint8_t _scroll = 0u;
+
+		int32_t _target = this->_TARGET_DDRAM;
+		uint32_t _ac = 0u;
+		uint32_t _ac_half = 0u; /*Byte within the current 16 bit word*/
+		uint32_t _gdram_v = 0u;
+		uint32_t _gdram_h = 0u;
+		bool _gdram_expect_h = false;
+
+		uint32_t _exec_us = 72u;
+		uint32_t _clear_us = 1600u;
+		uint64_t _busy_until_ns = 0u;
+		bool _busy_stuck = false;
+
+		uint32_t _instruction_count = 0u;
+		uint32_t _data_byte_count = 0u;
+		uint32_t _violation_count = 0u;
+		uint32_t _mode_switch_count = 0u;
+
+		bool _busy(void);
+		void _receive(bool rs, uint8_t byte);
+		void _instruction(uint8_t byte);
+		void _data(uint8_t byte);
+		uint8_t _read_dataline(void);
+		int32_t _pin_index(uint8_t pin);
+
+		bool _text_pixel(uint32_t cx, uint32_t cy);
+		uint32_t _text_word(uint32_t cx, uint32_t cy);
+		uint32_t _ram_row(uint32_t cy);
+};
+
+#endif /*ST7920_EMULATOR_HPP*/
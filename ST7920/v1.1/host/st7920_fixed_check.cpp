@@ -0,0 +1,256 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Compile time pins check: ST7920Fixed (ST7920FixedBus) against ST7920 (ST7920ParallelBus) on the same pins.
+ *
+ * The same calls are made on both, without and with RW (busy flag polling). For each, every pin level change is recorded.
+ * ST7920Fixed must produce exactly the same pin sequence and the same display content, with every pin write being a
+ * constant pin digitalWriteFast() (no runtime pin number left). The object sizes are checked at compile time: ST7920Fixed holds
+ * no pin table (no ST7920ParallelBus / ST7920SerialBus), only its ST7920FixedBus. Runtime pins that aren't digital pins of the board
+ * (CORE_NUM_DIGITAL) must make begin() fail, as they fail to compile with ST7920Fixed.
+ *
+ * Exit status is 1 if any check fails or the emulator saw a transfer while the display was busy.
+ * Build with optimization (-O1 or higher): constant pins are detected as on Teensy (see digitalWriteFast() in Arduino.h).
+ *
+ * usage: st7920_fixed_check
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define CHECK_DB0 2
+#define CHECK_DB1 3
+#define CHECK_DB2 4
+#define CHECK_DB3 5
+#define CHECK_DB4 6
+#define CHECK_DB5 7
+#define CHECK_DB6 8
+#define CHECK_DB7 9
+#define CHECK_RS 10
+#define CHECK_E 11
+#define CHECK_RW 12
+
+#define CHECK_TRACE_SIZE 1048576u
+
+/*
+ * Records every pin level change as (pin << 1) | level.
+ */
+
+class CheckTrace : public HostDevice {
+	public:
+		void pinChanged(uint8_t pin, uint8_t level)
+		{
+			if(this->n_changes < CHECK_TRACE_SIZE) this->changes[this->n_changes] = (uint16_t) ((pin << 1) | (level & 0x1));
+			this->n_changes++;
+
+			return;
+		}
+
+		uint16_t changes[CHECK_TRACE_SIZE];
+		uint32_t n_changes = 0u;
+};
+
+struct _check_result {
+	uint32_t n_writes;
+	uint32_t n_fast_writes;
+	uint8_t image[ST7920Emulator::IMAGE_SIZE_BYTES];
+	char text[2][40];
+};
+
+static ST7920Emulator emulator(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_RW, CHECK_E);
+
+static ST7920 runtime_pins(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+static ST7920 runtime_pins_rw(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_RW, CHECK_E);
+
+static ST7920Fixed<CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E> fixed_pins;
+static ST7920Fixed<CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E, CHECK_RW> fixed_pins_rw;
+
+typedef ST7920Fixed<CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E> CheckFixed;
+typedef ST7920FixedBus<CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E> CheckFixedBus;
+
+/*No pin table: the fixed pin display is the panel and its ST7920FixedBus, nothing else (the runtime pin buses aren't in it)*/
+static_assert(sizeof(CheckFixed) <= (sizeof(ST7920Panel<ST7920Geometry128x64>) + sizeof(CheckFixedBus) + alignof(CheckFixed)), "ST7920Fixed holds more than its fixed bus");
+static_assert((sizeof(ST7920) - sizeof(CheckFixed)) >= sizeof(ST7920ParallelBus), "ST7920Fixed not smaller than ST7920 by a pin table");
+
+static CheckTrace reference_trace;
+static CheckTrace fixed_trace;
+
+/*Makes the same calls on any panel: commands, graphics and text*/
+template<class Panel>
+static bool check_script(Panel &panel)
+{
+	uint32_t rand_state = 0x2545f491u;
+	uint32_t n_pixel = 0u;
+
+	if(!panel.begin()) return false;
+
+	panel.clearDisplay();
+	panel.enableGraphicDisplay(true);
+
+	for(n_pixel = 0u; n_pixel < 600u; n_pixel++)
+	{
+		rand_state ^= rand_state << 13;
+		rand_state ^= rand_state >> 17;
+		rand_state ^= rand_state << 5;
+
+		panel.bufferSetPixel((rand_state % panel.WIDTH), ((rand_state >> 16) % panel.HEIGHT), true);
+	}
+
+	panel.bufferPaintDirty();
+	panel.bufferDrawCircle(64, 32, 20u, panel.DRAWMODE_TOGGLE);
+	panel.bufferPaintDirty();
+
+	panel.setTextCursorPosition(3u, 1u);
+	panel.printText("Fixed pins");
+	panel.setWTextCursorPosition(0u, 0u);
+	panel.printWChar(('<' << 8) | '>');
+
+	return true;
+}
+
+template<class Panel>
+static bool check_run(Panel &panel, CheckTrace *p_trace, struct _check_result *p_result)
+{
+	bool retval = false;
+	uint8_t pin = 0u;
+
+	/*Both runs start from the same pin levels*/
+	for(pin = CHECK_DB0; pin <= CHECK_RW; pin++) digitalWrite(pin, 0);
+
+	emulator.reset();
+	hostResetCounters();
+
+	p_trace->n_changes = 0u;
+	hostAttachDevice(p_trace);
+
+	retval = check_script(panel);
+
+	hostDetachDevice(p_trace);
+
+	p_result->n_writes = hostGetPinWriteCount();
+	p_result->n_fast_writes = hostGetPinWriteFastCount();
+
+	emulator.render(p_result->image);
+	emulator.getTextLine(0u, p_result->text[0]);
+	emulator.getTextLine(1u, p_result->text[1]);
+
+	return retval;
+}
+
+template<class Reference, class Fixed>
+static uint32_t check_pins(Reference &reference, Fixed &fixed, const char *name)
+{
+	static struct _check_result reference_result;
+	static struct _check_result fixed_result;
+	uint32_t n_change = 0u;
+	uint32_t n_fail = 0u;
+
+	if(!check_run(reference, &reference_trace, &reference_result)) return 1u;
+	if(!check_run(fixed, &fixed_trace, &fixed_result)) return 1u;
+
+	if(reference_trace.n_changes > CHECK_TRACE_SIZE)
+	{
+		printf("%s: trace too long (%u pin changes)\n", name, reference_trace.n_changes);
+		return 1u;
+	}
+
+	if(fixed_trace.n_changes != reference_trace.n_changes)
+	{
+		printf("%s: %u pin changes with fixed pins, %u with runtime pins\n", name, fixed_trace.n_changes, reference_trace.n_changes);
+		n_fail++;
+	}
+
+	for(n_change = 0u; (n_change < reference_trace.n_changes) && (n_change < fixed_trace.n_changes); n_change++)
+	{
+		if(fixed_trace.changes[n_change] == reference_trace.changes[n_change]) continue;
+
+		printf("%s: pin change %u is pin %u -> %u, expected pin %u -> %u\n", name, n_change, (fixed_trace.changes[n_change] >> 1), (fixed_trace.changes[n_change] & 0x1), (reference_trace.changes[n_change] >> 1), (reference_trace.changes[n_change] & 0x1));
+		n_fail++;
+		break;
+	}
+
+	if(fixed_result.n_writes != reference_result.n_writes)
+	{
+		printf("%s: %u pin writes with fixed pins, %u with runtime pins\n", name, fixed_result.n_writes, reference_result.n_writes);
+		n_fail++;
+	}
+
+	if(fixed_result.n_fast_writes != fixed_result.n_writes)
+	{
+		printf("%s: %u of %u pin writes with fixed pins aren't constant pin writes\n", name, (fixed_result.n_writes - fixed_result.n_fast_writes), fixed_result.n_writes);
+		n_fail++;
+	}
+
+	if(memcmp(fixed_result.image, reference_result.image, sizeof(fixed_result.image)) || memcmp(fixed_result.text, reference_result.text, sizeof(fixed_result.text)))
+	{
+		printf("%s: display content differs\n", name);
+		n_fail++;
+	}
+
+	if(emulator.getViolationCount()) n_fail++;
+
+	printf("%s: %u pin changes, %u pin writes (runtime pins: %u constant), %s\n", name, fixed_trace.n_changes, fixed_result.n_writes, reference_result.n_fast_writes, (n_fail ? "FAIL" : "ok"));
+	return n_fail;
+}
+
+/*
+ * Runtime pins past the board's digital pins (CORE_NUM_DIGITAL): begin() must fail, as ST7920FixedBus fails to compile.
+ * returns the number of pin layouts accepted or rejected wrongly.
+ */
+
+static uint32_t check_pin_range(void)
+{
+	static ST7920 panel(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+	const uint8_t last = CORE_NUM_DIGITAL - 1;
+	uint32_t n_fail = 0u;
+
+	panel.resetPinout(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, last, CHECK_RS, CHECK_E);
+	if(!panel.begin()) n_fail++;
+
+	panel.resetPinout(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CORE_NUM_DIGITAL, CHECK_RS, CHECK_E);
+	if(panel.begin()) n_fail++;
+
+	panel.resetPinout(60, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+	if(panel.begin()) n_fail++;
+
+	panel.resetPinout(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, 100, CHECK_E);
+	if(panel.begin()) n_fail++;
+
+	panel.resetPinout(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 100);
+	if(panel.begin()) n_fail++;
+
+	panel.resetPinout(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CORE_NUM_DIGITAL, CHECK_E);
+	if(panel.begin()) n_fail++;
+
+	panel.resetPinout(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, last, CHECK_E);
+	if(!panel.begin()) n_fail++;
+
+	printf("pins past CORE_NUM_DIGITAL (%u): %s\n", (uint32_t) CORE_NUM_DIGITAL, (n_fail ? "FAIL" : "ok"));
+	return n_fail;
+}
+
+int main(void)
+{
+	uint32_t n_fail = 0u;
+
+	n_fail += check_pins(runtime_pins, fixed_pins, "no RW");
+	n_fail += check_pins(runtime_pins_rw, fixed_pins_rw, "RW (busy flag)");
+	n_fail += check_pin_range();
+
+	printf("bus object size: ST7920ParallelBus %u bytes, ST7920FixedBus %u bytes\n", (uint32_t) sizeof(ST7920ParallelBus), (uint32_t) sizeof(CheckFixedBus));
+	printf("display object size: ST7920 %u bytes, ST7920Fixed %u bytes\n", (uint32_t) sizeof(ST7920), (uint32_t) sizeof(CheckFixed));
+
+	if(n_fail) return 1;
+
+	return 0;
+}
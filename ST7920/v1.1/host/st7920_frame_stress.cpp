@@ -0,0 +1,296 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Frame buffering stress test (setFrameBuffers(), bufferPublish(), bufferPaintFrame()).
+ *
+ * A producer thread draws frames (random pages, plus a frame number stamped in the top left page) and publishes them.
+ * A consumer thread paints frames to the emulator as fast as it can and checks that the image on the display is exactly one of
+ * the published frames (no torn frame), and that frame numbers never go backwards.
+ * The consumer yields to the producer in the middle of painting (every few E strobes), so drawing and painting interleave even on a single CPU.
+ * Runs double buffering, then triple buffering.
+ *
+ * Exit status is 1 if any frame was torn or out of order, the last frame was never painted, or the emulator saw a transfer while the display was busy.
+ *
+ * usage: st7920_frame_stress [n_frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define STRESS_DB0 2
+#define STRESS_DB1 3
+#define STRESS_DB2 4
+#define STRESS_DB3 5
+#define STRESS_DB4 6
+#define STRESS_DB5 7
+#define STRESS_DB6 8
+#define STRESS_DB7 9
+#define STRESS_RS 10
+#define STRESS_E 11
+
+/*Published frames kept for the consumer checks. The producer stays less than half the ring ahead of the consumer.*/
+#define STRESS_RING_SIZE 64u
+#define STRESS_MAX_WAITS 1000000u
+
+static ST7920Emulator emulator(STRESS_DB0, STRESS_DB1, STRESS_DB2, STRESS_DB3, STRESS_DB4, STRESS_DB5, STRESS_DB6, STRESS_DB7, STRESS_RS, 0xff, STRESS_E);
+static ST7920 st7920(STRESS_DB0, STRESS_DB1, STRESS_DB2, STRESS_DB3, STRESS_DB4, STRESS_DB5, STRESS_DB6, STRESS_DB7, STRESS_RS, STRESS_E);
+
+/*
+ * Yields the CPU from within the bus transfers of bufferPaintFrame() (consumer thread only).
+ */
+
+class StressPreempt : public HostDevice {
+	public:
+		void pinChanged(uint8_t pin, uint8_t level)
+		{
+			if((pin != STRESS_E) || level) return;
+
+			this->_n_strobes++;
+			if((this->_n_strobes % 61u) == 0u) sched_yield();
+
+			return;
+		}
+
+	private:
+		uint32_t _n_strobes = 0u;
+};
+
+static StressPreempt preempt;
+
+static ST7920::Frame frames[2];
+
+static uint8_t ring[STRESS_RING_SIZE][ST7920Emulator::IMAGE_SIZE_BYTES];
+
+static uint32_t n_frames_total = 20000u;
+static volatile uint32_t last_published = 0u; /*Latest frame number that may have been published*/
+static volatile uint32_t last_painted = 0u;
+static volatile bool producer_done = false;
+
+/*Consumer results*/
+static uint32_t n_painted = 0u;
+static uint32_t n_skipped = 0u;
+static uint32_t n_torn = 0u;
+static uint32_t n_backwards = 0u;
+static uint32_t n_lost = 0u; /*Last frame never painted*/
+
+/*Producer results*/
+static uint32_t n_published = 0u;
+static uint32_t n_publish_failed = 0u;
+
+static uint32_t stress_random(uint32_t *p_state)
+{
+	uint32_t x = *p_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	*p_state = x;
+	return x;
+}
+
+static void stress_set_page(uint8_t *image, uint32_t page_index, uint32_t cy, uint16_t page_value)
+{
+	st7920.bufferSetPage(page_index, cy, page_value);
+
+	/*Image rows are 16 bytes, leftmost pixel in the MSB. Same as the page layout.*/
+	image[16u*cy + 2u*page_index] = (uint8_t) (page_value >> 8);
+	image[16u*cy + 2u*page_index + 1u] = (uint8_t) (page_value & 0xff);
+	return;
+}
+
+static void *stress_producer(void *arg)
+{
+	uint8_t image[ST7920Emulator::IMAGE_SIZE_BYTES];
+	uint32_t rand_state = 0x2545f491u;
+	uint32_t n_frame = 1u;
+	uint32_t n_pages = 0u;
+	uint32_t n_page = 0u;
+	uint32_t value = 0u;
+	uint32_t n_waits = 0u;
+
+	(void) arg;
+
+	memset(image, 0x00, sizeof(image));
+
+	while(n_frame <= n_frames_total)
+	{
+		/*Don't overwrite frames the consumer might still have to check. Give up if it stops painting (frames lost).*/
+		n_waits = 0u;
+		while(((n_frame - __atomic_load_n(&last_painted, __ATOMIC_ACQUIRE)) >= (STRESS_RING_SIZE/2u)) && (n_waits < STRESS_MAX_WAITS))
+		{
+			sched_yield();
+			n_waits++;
+		}
+
+		if(n_waits >= STRESS_MAX_WAITS) break;
+
+		n_pages = stress_random(&rand_state) % 48u;
+		for(n_page = 0u; n_page < n_pages; n_page++)
+		{
+			value = stress_random(&rand_state);
+			stress_set_page(image, ((value >> 16) & 0x7), ((value >> 19) & 0x3f), (uint16_t) value);
+
+			if((value & 0x3f) == 0u) sched_yield();
+		}
+
+		stress_set_page(image, 0u, 0u, (uint16_t) n_frame);
+
+		memcpy(ring[n_frame % STRESS_RING_SIZE], image, sizeof(image));
+
+		/*Before publishing: the consumer decodes stamps relative to it*/
+		__atomic_store_n(&last_published, n_frame, __ATOMIC_RELEASE);
+
+		if(!st7920.bufferPublish())
+		{
+			/*Double buffering, previous frame still being painted: keep drawing this frame*/
+			n_publish_failed++;
+			continue;
+		}
+
+		n_published++;
+		n_frame++;
+	}
+
+	__atomic_store_n(&producer_done, true, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void *stress_consumer(void *arg)
+{
+	uint8_t image[ST7920Emulator::IMAGE_SIZE_BYTES];
+	uint32_t n_frame = 0u;
+	uint32_t previous = 0u;
+	int32_t painted = 0;
+	bool done = false;
+
+	(void) arg;
+
+	while(true)
+	{
+		/*Read before painting: once the producer is done, its last frame must be painted by now or by this call*/
+		done = __atomic_load_n(&producer_done, __ATOMIC_ACQUIRE);
+
+		painted = st7920.bufferPaintFrame();
+
+		if(painted < 1)
+		{
+			if(done)
+			{
+				if(previous != n_frames_total) n_lost++;
+				break;
+			}
+
+			sched_yield();
+			continue;
+		}
+
+		n_painted++;
+
+		emulator.render(image);
+
+		/*Frame number from the stamp: the most recent published frame with matching low bits*/
+		n_frame = __atomic_load_n(&last_published, __ATOMIC_ACQUIRE);
+		n_frame -= (uint16_t) (n_frame - ((((uint32_t) image[0]) << 8) | image[1]));
+
+		if(n_frame <= previous)
+		{
+			n_backwards++;
+			continue;
+		}
+
+		if(memcmp(image, ring[n_frame % STRESS_RING_SIZE], sizeof(image))) n_torn++;
+
+		n_skipped += n_frame - previous - 1u;
+		previous = n_frame;
+
+		__atomic_store_n(&last_painted, n_frame, __ATOMIC_RELEASE);
+	}
+
+	return NULL;
+}
+
+static bool stress_run(uint32_t n_buffers)
+{
+	pthread_t producer;
+	pthread_t consumer;
+	bool retval = true;
+
+	n_painted = 0u;
+	n_skipped = 0u;
+	n_torn = 0u;
+	n_backwards = 0u;
+	n_lost = 0u;
+	n_published = 0u;
+	n_publish_failed = 0u;
+	last_published = 0u;
+	last_painted = 0u;
+	producer_done = false;
+
+	memset(ring, 0x00, sizeof(ring));
+
+	if(!st7920.begin()) return false;
+
+	st7920.clearDisplay();
+	st7920.enableGraphicDisplay(true);
+	st7920.bufferSetAll(false);
+	st7920.bufferPaintAll();
+
+	if(!st7920.setFrameBuffers(frames, n_buffers)) return false;
+
+	emulator.resetCounters();
+
+	pthread_create(&consumer, NULL, stress_consumer, NULL);
+	pthread_create(&producer, NULL, stress_producer, NULL);
+
+	pthread_join(producer, NULL);
+	pthread_join(consumer, NULL);
+
+	st7920.setFrameBuffers(NULL, 0u);
+
+	printf("%s buffering: %u frames published, %u painted, %u skipped, %u publish retries, %u torn, %u out of order, %u lost, %u violations\n", ((n_buffers == 1u) ? "double" : "triple"), n_published, n_painted, n_skipped, n_publish_failed, n_torn, n_backwards, n_lost, emulator.getViolationCount());
+
+	if(n_torn || n_backwards || n_lost || emulator.getViolationCount()) retval = false;
+
+	return retval;
+}
+
+int main(int argc, char **argv)
+{
+	bool pass = true;
+
+	if(argc > 1) n_frames_total = (uint32_t) strtoul(argv[1], NULL, 0);
+
+	if((n_frames_total == 0u) || (n_frames_total > 0xffff0000u))
+	{
+		fprintf(stderr, "st7920_frame_stress: invalid number of frames\n");
+		return 2;
+	}
+
+	hostAttachDevice(&preempt);
+
+	if(!stress_run(1u)) pass = false;
+	if(!stress_run(2u)) pass = false;
+
+	if(!pass)
+	{
+		printf("FAIL\n");
+		return 1;
+	}
+
+	printf("ok\n");
+	return 0;
+}
@@ -0,0 +1,250 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+
+static uint8_t host_pin_level[HOST_N_PINS] = {0u};
+static uint8_t host_pin_mode[HOST_N_PINS] = {0u};
+
+static HostDevice *host_devices[HOST_MAX_DEVICES] = {NULL};
+
+static uint64_t host_time_ns = 0u;
+static uint32_t host_pin_cost_ns = 0u;
+static uint32_t host_pin_fast_cost_ns = 0u;
+
+static uint32_t host_pin_write_count = 0u;
+static uint32_t host_pin_write_fast_count = 0u;
+static uint32_t host_pin_rise_count[HOST_N_PINS] = {0u};
+static uint64_t host_delay_us = 0u;
+
+SPIClass SPI;
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	host_pin_mode[pin] = mode;
+	return;
+}
+
+static void host_pin_write(uint8_t pin, uint8_t level)
+{
+	uint32_t n_device = 0u;
+
+	if(level) level = HIGH;
+
+	host_pin_write_count++;
+
+	if(host_pin_level[pin] == level) return;
+
+	host_pin_level[pin] = level;
+	if(level) host_pin_rise_count[pin]++;
+
+	if(host_pin_mode[pin] != OUTPUT) return;
+
+	for(n_device = 0u; n_device < HOST_MAX_DEVICES; n_device++) if(host_devices[n_device] != NULL) host_devices[n_device]->pinChanged(pin, level);
+
+	return;
+}
+
+static uint8_t host_pin_read(uint8_t pin)
+{
+	uint32_t n_device = 0u;
+	int32_t level = -1;
+
+	for(n_device = 0u; n_device < HOST_MAX_DEVICES; n_device++)
+	{
+		if(host_devices[n_device] == NULL) continue;
+
+		level = host_devices[n_device]->pinRead(pin);
+		if(level >= 0) return (uint8_t) level;
+	}
+
+	return host_pin_level[pin];
+}
+
+void digitalWrite(uint8_t pin, uint8_t level)
+{
+	host_time_ns += host_pin_cost_ns;
+	host_pin_write(pin, level);
+	return;
+}
+
+uint8_t digitalRead(uint8_t pin)
+{
+	host_time_ns += host_pin_cost_ns;
+	return host_pin_read(pin);
+}
+
+void hostPinWriteFast(uint8_t pin, uint8_t level)
+{
+	host_time_ns += host_pin_fast_cost_ns;
+	host_pin_write_fast_count++;
+	host_pin_write(pin, level);
+	return;
+}
+
+uint8_t hostPinReadFast(uint8_t pin)
+{
+	host_time_ns += host_pin_fast_cost_ns;
+	return host_pin_read(pin);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+	host_time_ns += 1000u*((uint64_t) us);
+	host_delay_us += us;
+	return;
+}
+
+void delay(uint32_t ms)
+{
+	delayMicroseconds(1000u*ms);
+	return;
+}
+
+uint32_t micros(void)
+{
+	return (uint32_t) (host_time_ns/1000u);
+}
+
+uint32_t millis(void)
+{
+	return (uint32_t) (host_time_ns/1000000u);
+}
+
+uint32_t hostGetCycleCount(void)
+{
+	return (uint32_t) (host_time_ns*(F_CPU/1000000u)/1000u);
+}
+
+bool hostAttachDevice(HostDevice *device)
+{
+	uint32_t n_device = 0u;
+
+	if(device == NULL) return false;
+
+	for(n_device = 0u; n_device < HOST_MAX_DEVICES; n_device++)
+	{
+		if(host_devices[n_device] == NULL)
+		{
+			host_devices[n_device] = device;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void hostDetachDevice(HostDevice *device)
+{
+	uint32_t n_device = 0u;
+
+	for(n_device = 0u; n_device < HOST_MAX_DEVICES; n_device++) if(host_devices[n_device] == device) host_devices[n_device] = NULL;
+
+	return;
+}
+
+uint64_t hostGetTimeNs(void)
+{
+	return host_time_ns;
+}
+
+void hostSetPinWriteCostNs(uint32_t ns)
+{
+	host_pin_cost_ns = ns;
+	return;
+}
+
+void hostSetPinWriteFastCostNs(uint32_t ns)
+{
+	host_pin_fast_cost_ns = ns;
+	return;
+}
+
+uint32_t hostGetPinWriteCount(void)
+{
+	return host_pin_write_count;
+}
+
+uint32_t hostGetPinWriteFastCount(void)
+{
+	return host_pin_write_fast_count;
+}
+
+uint32_t hostGetPinRiseCount(uint8_t pin)
+{
+	return host_pin_rise_count[pin];
+}
+
+uint64_t hostGetDelayUs(void)
+{
+	return host_delay_us;
+}
+
+void hostResetCounters(void)
+{
+	host_pin_write_count = 0u;
+	host_pin_write_fast_count = 0u;
+	memset(host_pin_rise_count, 0, sizeof(host_pin_rise_count));
+	host_delay_us = 0u;
+	return;
+}
+
+void hostSpiTransfer(uint8_t byte)
+{
+	uint32_t n_device = 0u;
+
+	for(n_device = 0u; n_device < HOST_MAX_DEVICES; n_device++) if(host_devices[n_device] != NULL) host_devices[n_device]->spiTransfer(byte);
+
+	return;
+}
+
+/*
+ * SPIClass
+ */
+
+void SPIClass::beginTransaction(SPISettings settings)
+{
+	if(settings.clock_hz) this->_byte_time_ns = (uint32_t) (8000000000ull/settings.clock_hz);
+
+	this->transaction_count++;
+	return;
+}
+
+void SPIClass::endTransaction(void)
+{
+	return;
+}
+
+uint8_t SPIClass::transfer(uint8_t byte)
+{
+	host_time_ns += this->_byte_time_ns;
+	this->byte_count++;
+
+	hostSpiTransfer(byte);
+	return 0u;
+}
+
+void SPIClass::transfer(const void *buf, void *retbuf, size_t count)
+{
+	size_t n_byte = 0u;
+
+	for(n_byte = 0u; n_byte < count; n_byte++)
+	{
+		this->transfer(((const uint8_t*) buf)[n_byte]);
+		if(retbuf != NULL) ((uint8_t*) retbuf)[n_byte] = 0u;
+	}
+
+	return;
+}
+
+void SPIClass::transfer(void *buf, size_t count)
+{
+	this->transfer(buf, buf, count);
+	return;
+}
@@ -0,0 +1,127 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Runs the test sketch headless against the emulator.
+ * Prints the image after each draw procedure, plus the simulated time and bus activity of each call.
+ * Optionally writes the bus trace of the whole run (ST7920Tracer): decoded, without timestamps (to diff two driver versions), and as a VCD.
+ */
+
+#include <stdio.h>
+#include <Arduino.h>
+
+#include "st7920_emulator.hpp"
+
+/*Same pins as the sketch, RW not connected*/
+static ST7920Emulator emulator(2, 3, 4, 5, 6, 7, 8, 9, 10, 0xff, 11);
+
+#include "../Test_ST7920/Test_ST7920.ino"
+
+static uint64_t run_start_ns = 0u;
+static uint32_t run_violations = 0u;
+
+/*Enough for the whole run*/
+static struct _st7920_trace_entry run_trace_entries[1u << 18];
+static ST7920Tracer run_tracer(run_trace_entries, (sizeof(run_trace_entries)/sizeof(struct _st7920_trace_entry)));
+
+static void run_trace_output(void *context, const char *text)
+{
+	fputs(text, (FILE*) context);
+	return;
+}
+
+static bool run_trace_write(const char *path, bool vcd)
+{
+	FILE *file = fopen(path, "w");
+
+	if(file == NULL)
+	{
+		fprintf(stderr, "cannot write %s\n", path);
+		return false;
+	}
+
+	if(vcd) run_tracer.exportVcd(run_trace_output, file);
+	else run_tracer.exportText(run_trace_output, file, false);
+
+	fclose(file);
+	return true;
+}
+
+static void run_begin(void)
+{
+	hostResetCounters();
+	emulator.resetCounters();
+	run_start_ns = hostGetTimeNs();
+	return;
+}
+
+static void run_end(const char *name, bool print_image)
+{
+	char text[17];
+	uint32_t n_line = 0u;
+
+	printf("%s: %.1f us, %u instructions, %u data bytes, %u pin writes, %llu us in delays, %u violations\n", name, (hostGetTimeNs() - run_start_ns)/1000.0, emulator.getInstructionCount(), emulator.getDataByteCount(), hostGetPinWriteCount(), (unsigned long long) hostGetDelayUs(), emulator.getViolationCount());
+
+	run_violations += emulator.getViolationCount();
+
+	if(!print_image) return;
+
+	for(n_line = 0u; n_line < 4u; n_line++)
+	{
+		emulator.getTextLine(n_line, text);
+		printf("text %u: \"%s\"\n", n_line, text);
+	}
+
+	emulator.printImage(stdout);
+	printf("\n");
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	if(argc > 1) st7920.setTracer(&run_tracer);
+
+	run_begin();
+	setup();
+	run_end("setup", false);
+
+	run_begin();
+	st7920.bufferSetAll(false);
+	draw_proc1();
+	run_end("draw_proc1", true);
+
+	run_begin();
+	st7920.bufferSetAll(false);
+	draw_proc2();
+	run_end("draw_proc2", true);
+
+	run_begin();
+	st7920.enableGraphicDisplay(false);
+	draw_proc3();
+	run_end("draw_proc3", true);
+
+	run_begin();
+	st7920.clearText();
+	draw_proc4();
+	run_end("draw_proc4", true);
+
+	if(argc > 1)
+	{
+		st7920.setTracer(NULL);
+
+		if(run_tracer.getLostCount()) fprintf(stderr, "trace: %u transfers lost\n", run_tracer.getLostCount());
+		if(!run_trace_write(argv[1], false)) return 1;
+		if((argc > 2) && !run_trace_write(argv[2], true)) return 1;
+
+		printf("trace: %u transfers\n", run_tracer.getCount());
+	}
+
+	if(run_violations) return 1;
+
+	return 0;
+}
@@ -0,0 +1,324 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Incremental paint check (bufferPaintBegin(), bufferPaintStep()), on an emulated 128x64 display with the simulated clock.
+ *
+ * Random drawing is latched (all pages or the modified ones), then painted with random budgets, with text printed between the steps
+ * (the display goes back to the basic instruction set). Each step must stay within its budget, or paint exactly one page when the budget
+ * is shorter than that (one page, plus the instruction set switch if needed). Once complete, the display RAM must hold the latched frame,
+ * bit for bit. Pages drawn during the paint must stay modified for the next paint.
+ *
+ * Exit status is 1 if any check fails.
+ *
+ * usage: st7920_paint_step_check [n_paints]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define CHECK_DB0 2
+#define CHECK_DB1 3
+#define CHECK_DB2 4
+#define CHECK_DB3 5
+#define CHECK_DB4 6
+#define CHECK_DB5 7
+#define CHECK_DB6 8
+#define CHECK_DB7 9
+#define CHECK_RS 10
+#define CHECK_E 11
+
+#define CHECK_PIN_COST_NS 40u
+
+#define CHECK_N_PAINTS 300u
+
+/*Worst case transfer times (see ST7920Panel): a page alone is an address set and 2 data bytes*/
+#define CHECK_SHORT_TRANSFER_US 136u
+#define CHECK_LONG_TRANSFER_US 1032u
+#define CHECK_ONE_PAGE_US (4u*CHECK_SHORT_TRANSFER_US)
+
+static ST7920Emulator emulator(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 0xff, CHECK_E);
+static ST7920 panel(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+
+/*Latched frame: page p of screen row cy*/
+static uint16_t frame[ST7920::HEIGHT][ST7920::WIDTH_PAGES];
+
+static uint32_t check_rand_state = 0x6c1e93a5u;
+static uint32_t n_fail = 0u;
+
+static uint32_t n_steps = 0u;
+static uint32_t n_over_budget = 0u;
+static uint32_t n_no_progress = 0u;
+static uint32_t n_small_budget = 0u;
+static bool paint_pending = false;
+
+static void check(bool ok, const char *what)
+{
+	if(ok) return;
+
+	printf("FAIL: %s\n", what);
+	n_fail++;
+	return;
+}
+
+static uint32_t check_random(void)
+{
+	uint32_t x = check_rand_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	check_rand_state = x;
+	return x;
+}
+
+static void frame_latch(void)
+{
+	uint32_t cy = 0u;
+	uint32_t page = 0u;
+
+	for(cy = 0u; cy < ST7920::HEIGHT; cy++)
+	{
+		for(page = 0u; page < ST7920::WIDTH_PAGES; page++) frame[cy][page] = (uint16_t) panel.bufferGetPage(page, cy);
+	}
+
+	return;
+}
+
+/*returns the number of pages the display RAM holds differently from the latched frame (not scrolled: row cy is GDRAM row cy % 32)*/
+static uint32_t frame_diff(void)
+{
+	uint32_t cy = 0u;
+	uint32_t page = 0u;
+	uint32_t n_diff = 0u;
+
+	for(cy = 0u; cy < ST7920::HEIGHT; cy++)
+	{
+		for(page = 0u; page < ST7920::WIDTH_PAGES; page++)
+		{
+			if(emulator.getGdramWord((cy % 32u), ((cy/32u)*ST7920::WIDTH_PAGES + page)) != frame[cy][page]) n_diff++;
+		}
+	}
+
+	return n_diff;
+}
+
+static void draw_random(uint32_t n_shapes)
+{
+	int32_t cx = 0;
+	int32_t cy = 0;
+
+	for(; n_shapes > 0u; n_shapes--)
+	{
+		cx = (int32_t) (check_random() % 136u) - 4;
+		cy = (int32_t) (check_random() % 68u) - 2;
+
+		if(check_random() & 1u) panel.bufferFillRect(cx, cy, (int32_t) (check_random() % 40u) + 1, (int32_t) (check_random() % 12u) + 1, panel.DRAWMODE_TOGGLE);
+		else panel.bufferDrawLine(cx, cy, (int32_t) (check_random() % 128u), (int32_t) (check_random() % 64u), panel.DRAWMODE_TOGGLE);
+	}
+
+	return;
+}
+
+/*
+ * bufferPaintStep(), timed on the simulated clock. A budget shorter than one page (plus the instruction set switch, if the display isn't
+ * in the extended set) may be overrun by exactly one page.
+ */
+
+static int32_t step(uint32_t budget_us)
+{
+	uint64_t start_ns = 0u;
+	uint64_t spent_ns = 0u;
+	uint32_t data_bytes = emulator.getDataByteCount();
+	uint32_t min_us = CHECK_ONE_PAGE_US;
+	int32_t retval = 0;
+
+	if(!emulator.isExtendedMode()) min_us += CHECK_LONG_TRANSFER_US;
+
+	start_ns = hostGetTimeNs();
+	retval = panel.bufferPaintStep(budget_us);
+	spent_ns = hostGetTimeNs() - start_ns;
+
+	n_steps++;
+
+	/*Latched pages left (the last step returned 0): the step must paint some*/
+	if(paint_pending && (emulator.getDataByteCount() == data_bytes)) n_no_progress++;
+	paint_pending = (retval == 0);
+
+	if(budget_us >= min_us)
+	{
+		if(spent_ns > 1000u*((uint64_t) budget_us)) n_over_budget++;
+	}
+	else
+	{
+		n_small_budget++;
+		if((spent_ns > 1000u*((uint64_t) min_us)) || ((emulator.getDataByteCount() - data_bytes) > 2u)) n_over_budget++;
+	}
+
+	return retval;
+}
+
+static void check_errors(void)
+{
+	check((panel.bufferPaintStep(10000u) == -1), "bufferPaintStep() before begin()");
+	check(!panel.bufferPaintBegin(true), "bufferPaintBegin() before begin()");
+
+	check(panel.begin(), "begin()");
+	panel.enableGraphicDisplay(true);
+	panel.bufferSetAll(false);
+	panel.bufferPaintAll();
+
+	check((panel.bufferPaintStep(0u) == 1), "nothing latched: complete");
+
+	panel.bufferPaintBegin(false);
+	check((panel.bufferPaintStep(0u) == 1), "nothing modified: complete");
+	return;
+}
+
+/*Extended instruction set already on: budgets below an instruction set switch still paint within budget*/
+static void check_extended_set(void)
+{
+	uint32_t n_step = 0u;
+	int32_t retval = 0;
+
+	panel.bufferSetAll(false);
+	panel.bufferPaintAll();
+
+	draw_random(20u);
+	frame_latch();
+	panel.bufferPaintBegin(false);
+
+	n_steps = 0u;
+	n_over_budget = 0u;
+	n_no_progress = 0u;
+
+	for(n_step = 0u; n_step < 1000u; n_step++)
+	{
+		retval = step(1000u);
+		if(retval) break;
+	}
+
+	check((retval == 1), "1000us steps, extended set on: paint complete");
+	check(!n_over_budget, "1000us steps: within budget");
+	check(!n_no_progress, "1000us steps: each step paints");
+	check(!frame_diff(), "1000us steps: display holds the latched frame");
+
+	printf("paint step 1000us: %u steps\n", n_steps);
+	return;
+}
+
+/*Random budgets, with text printed between the steps (basic instruction set), and drawing during the paint*/
+static void check_random_paints(uint32_t n_paints)
+{
+	uint32_t n_paint = 0u;
+	uint32_t n_step = 0u;
+	uint32_t budget_us = 0u;
+	uint32_t n_diff = 0u;
+	uint32_t n_incomplete = 0u;
+	uint32_t n_lost = 0u;
+	uint32_t n_text = 0u;
+	bool draw_during = false;
+	int32_t retval = 0;
+	char text[4];
+
+	n_steps = 0u;
+	n_over_budget = 0u;
+	n_no_progress = 0u;
+	n_small_budget = 0u;
+
+	for(n_paint = 0u; n_paint < n_paints; n_paint++)
+	{
+		draw_random(check_random() % 24u);
+		frame_latch();
+
+		panel.bufferPaintBegin(!(check_random() % 8u));
+		draw_during = !(check_random() % 4u);
+
+		for(n_step = 0u; n_step < 2000u; n_step++)
+		{
+			switch(check_random() % 4u)
+			{
+				case 0u: budget_us = check_random() % CHECK_ONE_PAGE_US; break;
+				case 1u: budget_us = check_random() % (CHECK_LONG_TRANSFER_US + CHECK_ONE_PAGE_US); break;
+				default: budget_us = check_random() % 12000u; break;
+			}
+
+			retval = step(budget_us);
+			if(retval) break;
+
+			if(!(check_random() % 3u))
+			{
+				text[0] = (char) ('A' + check_random() % 26u);
+				text[1] = (char) ('a' + check_random() % 26u);
+				text[2] = '\0';
+
+				panel.setTextCursorPosition(check_random() % ST7920::N_CHARS, check_random() % ST7920::N_LINES);
+				panel.printText(text);
+				n_text++;
+			}
+
+			if(draw_during) draw_random(1u);
+
+			delayMicroseconds(check_random() % 2000u);
+		}
+
+		if(retval != 1)
+		{
+			n_incomplete++;
+			continue;
+		}
+
+		if(draw_during)
+		{
+			/*What was drawn during the paint goes with the next one*/
+			frame_latch();
+			panel.bufferPaintDirty();
+			if(frame_diff()) n_lost++;
+			continue;
+		}
+
+		if(frame_diff()) n_diff++;
+	}
+
+	check(!n_incomplete, "random budgets: every paint completes");
+	check(!n_over_budget, "random budgets: every step within budget (or one page)");
+	check(!n_no_progress, "random budgets: every step paints");
+	check(!n_diff, "random budgets: display holds the latched frame");
+	check(!n_lost, "drawing during the paint: painted by the next paint");
+	check((n_small_budget > 0u) && (n_text > 0u), "small budgets and instruction set switches exercised");
+
+	printf("paint step random: %u paints, %u steps (%u below one page), %u text writes between steps\n", n_paints, n_steps, n_small_budget, n_text);
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t n_paints = CHECK_N_PAINTS;
+
+	if(argc > 1) n_paints = (uint32_t) strtoul(argv[1], NULL, 0);
+
+	hostSetPinWriteCostNs(CHECK_PIN_COST_NS);
+
+	check_errors();
+	check_extended_set();
+	check_random_paints(n_paints);
+
+	check(!emulator.getViolationCount(), "no transfer while busy");
+
+	printf("paint step: %s (%u failures)\n", (n_fail ? "FAIL" : "ok"), n_fail);
+
+	if(n_fail) return 1;
+
+	return 0;
+}
@@ -0,0 +1,281 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Panel geometry check: ST7920 (128x64, folded), ST7920_256x32 and ST7920_192x32 against the emulator set up for the same panel.
+ *
+ * For each panel: random pixels, pages and batch plotted points, a whole screen bitmap, shapes and text drawn across the whole screen must show up on the emulated screen
+ * exactly where they were drawn. Text written on each line (and at the last character cell) must show up on that line.
+ * Coordinates just outside the panel must be rejected.
+ *
+ * Exit status is 1 if any check fails or the emulator saw a transfer while the display was busy.
+ *
+ * usage: st7920_panel_check
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define CHECK_DB0 2
+#define CHECK_DB1 3
+#define CHECK_DB2 4
+#define CHECK_DB3 5
+#define CHECK_DB4 6
+#define CHECK_DB5 7
+#define CHECK_DB6 8
+#define CHECK_DB7 9
+#define CHECK_RS 10
+#define CHECK_E 11
+
+static ST7920Emulator emulator(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 0xff, CHECK_E);
+
+static ST7920 panel_128x64(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+static ST7920_256x32 panel_256x32(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+static ST7920_192x32 panel_192x32(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+
+/*Reference image, one byte per pixel (largest panel: 8192 pixels)*/
+static uint8_t reference[8192];
+
+static uint32_t check_rand_state = 0x9e3779b9u;
+
+static uint32_t check_random(void)
+{
+	uint32_t x = check_rand_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	check_rand_state = x;
+	return x;
+}
+
+/*
+ * Compares the emulated screen with the reference image and with the panel buffer.
+ * returns the number of mismatching pixels (the first few are printed).
+ */
+
+template<class Panel>
+static uint32_t check_screen(Panel &panel, const char *name, const char *step)
+{
+	uint32_t cx = 0u;
+	uint32_t cy = 0u;
+	uint32_t n_bad = 0u;
+	int32_t shown = 0;
+
+	for(cy = 0u; cy < panel.HEIGHT; cy++)
+	{
+		for(cx = 0u; cx < panel.WIDTH; cx++)
+		{
+			shown = emulator.getPixel(cx, cy);
+
+			if((shown == ((int32_t) reference[cy*panel.WIDTH + cx])) && (panel.bufferGetPixel(cx, cy) == shown)) continue;
+
+			if(n_bad < 4u) printf("%s %s: pixel (%u , %u) is %d on screen, %d in buffer, expected %u\n", name, step, cx, cy, shown, panel.bufferGetPixel(cx, cy), reference[cy*panel.WIDTH + cx]);
+			n_bad++;
+		}
+	}
+
+	return n_bad;
+}
+
+template<class Panel>
+static uint32_t check_text_line(Panel &panel, const char *name, uint32_t line, const char *expected)
+{
+	char text[40];
+
+	emulator.getTextLine(line, text);
+
+	if((strlen(text) == panel.N_CHARS) && !strcmp(text, expected)) return 0u;
+
+	printf("%s: text line %u is \"%s\", expected \"%s\"\n", name, line, text, expected);
+	return 1u;
+}
+
+template<class Panel>
+static uint32_t check_panel(Panel &panel, const char *name, bool folded)
+{
+	static uint16_t points[2048];
+	static uint8_t bitmap[1024];
+	char text[40];
+	uint32_t n_fail = 0u;
+	uint32_t n_pixel = 0u;
+	uint32_t n_char = 0u;
+	uint32_t line = 0u;
+	uint32_t cx = 0u;
+	uint32_t cy = 0u;
+	uint32_t page_index = 0u;
+	uint32_t value = 0u;
+	uint32_t bit = 0u;
+
+	emulator.reset();
+	if(!emulator.setPanel(panel.WIDTH, panel.HEIGHT, folded)) return 1u;
+
+	if(!panel.begin()) return 1u;
+
+	panel.clearDisplay();
+	panel.enableGraphicDisplay(true);
+
+	/*Random pixels*/
+	memset(reference, 0, sizeof(reference));
+
+	for(n_pixel = 0u; n_pixel < (panel.WIDTH*panel.HEIGHT/3u); n_pixel++)
+	{
+		value = check_random();
+		cx = value % panel.WIDTH;
+		cy = (value >> 16) % panel.HEIGHT;
+
+		if(!panel.bufferSetPixel(cx, cy, true)) n_fail++;
+		reference[cy*panel.WIDTH + cx] = 1u;
+	}
+
+	panel.bufferPaintDirty();
+	n_fail += check_screen(panel, name, "pixels");
+
+	/*Random pages*/
+	for(n_pixel = 0u; n_pixel < 64u; n_pixel++)
+	{
+		value = check_random();
+		page_index = value % panel.WIDTH_PAGES;
+		cy = (value >> 8) % panel.HEIGHT;
+
+		panel.bufferSetPage(page_index, cy, (uint16_t) (value >> 16));
+		if(panel.bufferGetPage(page_index, cy) != ((int32_t) (value >> 16))) n_fail++;
+
+		for(bit = 0u; bit < 16u; bit++) reference[cy*panel.WIDTH + 16u*page_index + bit] = (uint8_t) (((value >> 16) >> (15u - bit)) & 0x1);
+	}
+
+	panel.bufferPaintDirty();
+	n_fail += check_screen(panel, name, "pages");
+
+	/*Batch plotting*/
+	panel.bufferSetAll(false);
+	memset(reference, 0, sizeof(reference));
+
+	for(n_pixel = 0u; n_pixel < (sizeof(points)/sizeof(uint16_t)); n_pixel++)
+	{
+		value = check_random();
+		cx = value % panel.WIDTH;
+		cy = (value >> 16) % panel.HEIGHT;
+
+		points[n_pixel] = panel.packPixel(cx, cy);
+		reference[cy*panel.WIDTH + cx] ^= 1u;
+	}
+
+	panel.bufferSetPackedPixels(points, (sizeof(points)/sizeof(uint16_t)), panel.DRAWMODE_TOGGLE);
+	panel.bufferPaintDirty();
+	n_fail += check_screen(panel, name, "batch");
+
+	/*Whole screen bitmap, off by 3 pixels (clipped)*/
+	for(n_pixel = 0u; n_pixel < (panel.WIDTH*panel.HEIGHT/8u); n_pixel++) bitmap[n_pixel] = (uint8_t) check_random();
+
+	panel.bufferBlit(3, -3, panel.WIDTH, panel.HEIGHT, bitmap, panel.RASTEROP_COPY);
+
+	for(cy = 0u; cy < (panel.HEIGHT - 3u); cy++)
+	{
+		for(cx = 3u; cx < panel.WIDTH; cx++) reference[cy*panel.WIDTH + cx] = (uint8_t) ((bitmap[((cy + 3u)*panel.WIDTH + cx - 3u)/8u] >> (7u - (cx - 3u)%8u)) & 0x1);
+	}
+
+	panel.bufferPaintDirty();
+	n_fail += check_screen(panel, name, "blit");
+
+	/*Shapes across the whole screen: filled rectangle (rows), column lines (top to bottom), corner pixels*/
+	panel.bufferSetAll(false);
+	memset(reference, 0, sizeof(reference));
+
+	panel.bufferFillRect(3, 5, (panel.WIDTH - 6u), (panel.HEIGHT - 10u), panel.DRAWMODE_SET);
+	panel.bufferDrawVLine(1, -4, (panel.HEIGHT + 8u), panel.DRAWMODE_SET);
+	panel.bufferDrawVLine((panel.WIDTH - 2u), 0, panel.HEIGHT, panel.DRAWMODE_SET);
+	panel.bufferDrawHLine(-10, (panel.HEIGHT/2u), (panel.WIDTH + 20u), panel.DRAWMODE_TOGGLE);
+
+	for(cy = 0u; cy < panel.HEIGHT; cy++)
+	{
+		for(cx = 0u; cx < panel.WIDTH; cx++)
+		{
+			value = 0u;
+			if((cx >= 3u) && (cx < (panel.WIDTH - 3u)) && (cy >= 5u) && (cy < (panel.HEIGHT - 5u))) value = 1u;
+			if((cx == 1u) || (cx == (panel.WIDTH - 2u))) value = 1u;
+			if(cy == (panel.HEIGHT/2u)) value ^= 1u;
+
+			reference[cy*panel.WIDTH + cx] = (uint8_t) value;
+		}
+	}
+
+	panel.bufferSetPixel(0u, 0u, true);
+	panel.bufferSetPixel((panel.WIDTH - 1u), (panel.HEIGHT - 1u), true);
+	reference[0] = 1u;
+	reference[panel.WIDTH*panel.HEIGHT - 1u] = 1u;
+
+	panel.bufferPaintDirty();
+	n_fail += check_screen(panel, name, "shapes");
+
+	/*Out of range*/
+	if(panel.bufferSetPixel(panel.WIDTH, 0u, true)) n_fail++;
+	if(panel.bufferSetPixel(0u, panel.HEIGHT, true)) n_fail++;
+	if(panel.bufferGetPage(panel.WIDTH_PAGES, 0u) >= 0) n_fail++;
+	if(panel.setTextCursorPosition(panel.N_CHARS, 0u)) n_fail++;
+	if(panel.setTextCursorPosition(0u, panel.N_LINES)) n_fail++;
+	if(panel.setWTextCursorPosition(panel.N_WCHARS, 0u)) n_fail++;
+
+	/*Text: each line, then the last character cell*/
+	panel.enableGraphicDisplay(false);
+	panel.clearText();
+
+	for(line = 0u; line < panel.N_LINES; line++)
+	{
+		for(n_char = 0u; n_char < panel.N_CHARS; n_char++) text[n_char] = (char) ('A' + (line*7u + n_char) % 26u);
+		text[n_char] = '\0';
+
+		panel.setTextCursorPosition(0u, line);
+		panel.printText(text);
+	}
+
+	for(line = 0u; line < panel.N_LINES; line++)
+	{
+		for(n_char = 0u; n_char < panel.N_CHARS; n_char++) text[n_char] = (char) ('A' + (line*7u + n_char) % 26u);
+		text[n_char] = '\0';
+
+		n_fail += check_text_line(panel, name, line, text);
+	}
+
+	panel.setTextCursorPosition((panel.N_CHARS - 1u), (panel.N_LINES - 1u));
+	panel.printChar('#');
+
+	/*Odd column: the character on its left stays*/
+	text[panel.N_CHARS - 1u] = '#';
+	n_fail += check_text_line(panel, name, (panel.N_LINES - 1u), text);
+
+	panel.setWTextCursorPosition(0u, (panel.N_LINES - 1u));
+	panel.printWChar(('*' << 8) | '*');
+
+	text[0] = '*';
+	text[1] = '*';
+	n_fail += check_text_line(panel, name, (panel.N_LINES - 1u), text);
+
+	if(emulator.getViolationCount()) n_fail++;
+
+	printf("%s: %s (%u failures)\n", name, (n_fail ? "FAIL" : "ok"), n_fail);
+	return n_fail;
+}
+
+int main(void)
+{
+	uint32_t n_fail = 0u;
+
+	n_fail += check_panel(panel_128x64, "128x64", true);
+	n_fail += check_panel(panel_256x32, "256x32", false);
+	n_fail += check_panel(panel_192x32, "192x32", false);
+
+	if(n_fail) return 1;
+
+	return 0;
+}
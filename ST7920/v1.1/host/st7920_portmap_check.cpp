@@ -0,0 +1,210 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Data line to port mapping check (st7920_portmap_build(), st7920_portmap_encode()), against fake port tables.
+ *
+ * Each table gives the port and bit of every data line (DB0 - DB7): one port with consecutive bits (single shift path), one port with
+ * scattered bits, two ports, and one port per data line. The map is built from the table, then every byte is written to fake port
+ * output registers the way ST7920ParallelBus does (one set and one clear write per port), starting from random register contents.
+ * The data lines must end up exactly as eight per pin writes (digitalWrite() of each bit) would leave them, and no other port bit may
+ * change. Tables that can't be mapped (no bit, more than one bit, two lines on the same bit) must be rejected.
+ *
+ * Exit status is 1 if any check fails.
+ *
+ * usage: st7920_portmap_check
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <st7920_portmap.hpp>
+
+/*Fake ports: identifiers are the addresses of the output registers*/
+#define CHECK_N_PORTS 8u
+
+struct _check_table {
+	const char *name;
+	uint8_t line_port[8]; /*Fake port of each data line (DB0 - DB7)*/
+	uint8_t line_bit[8]; /*Bit of each data line within its port*/
+	uint32_t n_ports; /*Expected*/
+	bool shift; /*Expected: single shift path*/
+};
+
+static const struct _check_table check_tables[] = {
+	{"one port, consecutive bits", {3, 3, 3, 3, 3, 3, 3, 3}, {16, 17, 18, 19, 20, 21, 22, 23}, 1u, true},
+	{"one port, consecutive bits at 24", {0, 0, 0, 0, 0, 0, 0, 0}, {24, 25, 26, 27, 28, 29, 30, 31}, 1u, true},
+	{"one port, descending bits", {1, 1, 1, 1, 1, 1, 1, 1}, {7, 6, 5, 4, 3, 2, 1, 0}, 1u, false},
+	{"one port, scattered bits", {2, 2, 2, 2, 2, 2, 2, 2}, {3, 2, 18, 19, 23, 22, 17, 16}, 1u, false},
+	{"two ports", {6, 6, 6, 6, 7, 7, 7, 7}, {4, 5, 6, 8, 10, 17, 16, 11}, 2u, false},
+	{"one port per data line", {0, 1, 2, 3, 4, 5, 6, 7}, {0, 31, 5, 5, 12, 1, 30, 9}, 8u, false}
+};
+
+static const uint32_t CHECK_N_TABLES = sizeof(check_tables)/sizeof(struct _check_table);
+
+static uint32_t check_ports[CHECK_N_PORTS];
+
+static uint32_t n_fail = 0u;
+static uint32_t check_rand_state = 0x2f6b9d13u;
+
+static void check(bool ok, const char *what)
+{
+	if(ok) return;
+
+	printf("FAIL: %s\n", what);
+	n_fail++;
+	return;
+}
+
+static uint32_t check_random(void)
+{
+	uint32_t x = check_rand_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	check_rand_state = x;
+	return x;
+}
+
+static void check_table_lines(const struct _check_table *table, uintptr_t *line_port, uint32_t *line_mask)
+{
+	uint32_t n_line = 0u;
+
+	for(n_line = 0u; n_line < 8u; n_line++)
+	{
+		line_port[n_line] = (uintptr_t) &check_ports[table->line_port[n_line]];
+		line_mask[n_line] = 1u << table->line_bit[n_line];
+	}
+
+	return;
+}
+
+/*returns the number of bytes written wrong*/
+static uint32_t check_table(const struct _check_table *table)
+{
+	struct _st7920_portmap map;
+	uintptr_t line_port[8];
+	uint32_t line_mask[8];
+	uint32_t pin_ports[CHECK_N_PORTS];
+	uint32_t set_mask[8];
+	uint32_t clear_mask[8];
+	uint32_t n_byte = 0u;
+	uint32_t n_line = 0u;
+	uint32_t n_port = 0u;
+	uint32_t n_wrong = 0u;
+	uint32_t port_writes = 0u;
+	uint32_t *p_reg = NULL;
+
+	check_table_lines(table, line_port, line_mask);
+
+	if(!st7920_portmap_build(line_port, line_mask, &map))
+	{
+		printf("FAIL: %s: not mapped\n", table->name);
+		n_fail++;
+		return 1u;
+	}
+
+	if((map.n_ports != table->n_ports) || ((map.shift >= 0) != table->shift))
+	{
+		printf("FAIL: %s: %u ports, shift %d\n", table->name, map.n_ports, map.shift);
+		n_fail++;
+	}
+
+	for(n_byte = 0u; n_byte < 256u; n_byte++)
+	{
+		/*Random port contents (other pins, previous byte)*/
+		for(n_port = 0u; n_port < CHECK_N_PORTS; n_port++) check_ports[n_port] = check_random();
+		memcpy(pin_ports, check_ports, sizeof(check_ports));
+
+		/*Per pin: each data line written on its own*/
+		for(n_line = 0u; n_line < 8u; n_line++)
+		{
+			p_reg = &pin_ports[table->line_port[n_line]];
+
+			if(n_byte & (1u << n_line)) *p_reg |= line_mask[n_line];
+			else *p_reg &= ~line_mask[n_line];
+		}
+
+		/*Port writes: set then clear, as the bus does*/
+		st7920_portmap_encode(&map, (uint8_t) n_byte, set_mask, clear_mask);
+
+		port_writes = 0u;
+		for(n_port = 0u; n_port < map.n_ports; n_port++)
+		{
+			p_reg = (uint32_t*) map.port[n_port];
+
+			*p_reg |= set_mask[n_port];
+			*p_reg &= ~clear_mask[n_port];
+			port_writes += 2u;
+
+			/*Only data line bits, and never set and cleared at once*/
+			if((set_mask[n_port] | clear_mask[n_port]) & ~map.port_mask[n_port]) n_wrong++;
+			if(set_mask[n_port] & clear_mask[n_port]) n_wrong++;
+		}
+
+		if(memcmp(check_ports, pin_ports, sizeof(check_ports))) n_wrong++;
+		if(port_writes != 2u*table->n_ports) n_wrong++;
+	}
+
+	printf("%s: %u port(s)%s, %u port writes per byte (8 pin writes)\n", table->name, map.n_ports, ((map.shift >= 0) ? " (shift)" : ""), 2u*map.n_ports);
+
+	if(n_wrong)
+	{
+		printf("FAIL: %s: %u bytes not written as per pin\n", table->name, n_wrong);
+		n_fail++;
+	}
+
+	return n_wrong;
+}
+
+static void check_rejected(void)
+{
+	struct _st7920_portmap map;
+	uintptr_t line_port[8];
+	uint32_t line_mask[8];
+
+	check_table_lines(&check_tables[4], line_port, line_mask);
+	check(st7920_portmap_build(line_port, line_mask, &map), "valid table mapped");
+
+	line_mask[3] = 0u;
+	check(!st7920_portmap_build(line_port, line_mask, &map), "data line with no bit rejected");
+
+	check_table_lines(&check_tables[4], line_port, line_mask);
+	line_mask[5] |= 1u << 3;
+	check(!st7920_portmap_build(line_port, line_mask, &map), "data line with two bits rejected");
+
+	/*DB7 on DB4's port bit*/
+	check_table_lines(&check_tables[4], line_port, line_mask);
+	line_mask[7] = line_mask[4];
+	check(!st7920_portmap_build(line_port, line_mask, &map), "two data lines on the same port bit rejected");
+
+	/*Same bit number on another port is fine*/
+	check_table_lines(&check_tables[4], line_port, line_mask);
+	line_mask[7] = line_mask[0];
+	check(st7920_portmap_build(line_port, line_mask, &map), "same bit on two ports mapped");
+
+	check(!st7920_portmap_build(NULL, line_mask, &map) && !st7920_portmap_build(line_port, NULL, &map) && !st7920_portmap_build(line_port, line_mask, NULL), "NULL arguments rejected");
+	return;
+}
+
+int main(void)
+{
+	uint32_t n_table = 0u;
+
+	for(n_table = 0u; n_table < CHECK_N_TABLES; n_table++) check_table(&check_tables[n_table]);
+
+	check_rejected();
+
+	printf("portmap: %s (%u failures)\n", (n_fail ? "FAIL" : "ok"), n_fail);
+
+	if(n_fail) return 1;
+
+	return 0;
+}
@@ -0,0 +1,675 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Command queue stress test (ST7920CommandQueue, ST7920QueuedBus), a producer thread against a consumer thread.
+ *
+ * Queue: the producer pushes numbered transfers in random batches, the consumer pops them. Every transfer must come out once, in order.
+ * Queued bus (drop on full): random writes (some larger than the queue). A write is either dropped whole (counted, the write returns false)
+ * or sent whole: the consumer (service(), on a recording bus) must receive exactly the writes that weren't dropped, each transfer held for
+ * its delay.
+ * Queued bus (wait when full): writes larger than the queue are sent in chunks, nothing is dropped.
+ * Display: text calls on an emulated display through the queue, the consumer servicing it as a timer interrupt would. Calls are made when
+ * getFree() has room, and now and then in bursts without checking: a call that had a write dropped must return false, and the text is
+ * then printed again. The display must end up with the text, with no transfer sent while busy.
+ * Display, dropped writes (no consumer thread): a paint / refresh tick / print that doesn't fit the queue returns false and leaves the
+ * pages not sent modified. Painting the modified pages as the queue drains must show the buffer, each page sent once (skipped with a
+ * queue too small for a paint call), printing again must show the text.
+ * The threads yield now and then, so they interleave even on a single CPU.
+ *
+ * Exit status is 1 if any check fails.
+ *
+ * usage: st7920_queue_stress [n_transfers]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define STRESS_DB0 2
+#define STRESS_DB1 3
+#define STRESS_DB2 4
+#define STRESS_DB3 5
+#define STRESS_DB4 6
+#define STRESS_DB5 7
+#define STRESS_DB6 8
+#define STRESS_DB7 9
+#define STRESS_RS 10
+#define STRESS_E 11
+
+#define STRESS_TICK_US 10u
+#define STRESS_MAX_WRITE 600u
+#define STRESS_MAX_RECORD 4000000u
+#define STRESS_N_TEXT_CALLS 4000u
+
+/*Room a text call needs in the queue (a few writes of up to MAX_WRITE_BYTES; a small queue must be empty)*/
+#define STRESS_CALL_ROOM ((ST7920CommandQueue::SIZE < 192u) ? ST7920CommandQueue::SIZE : 192u)
+
+/*Room the dropped paint check needs, the queue only serviced between calls: text cleared in one call (2 DDRAM rows and addresses)*/
+#define STRESS_PAINT_ROOM 128u
+
+/*
+ * Transfer n: byte n & 0xff, RS bit 12 of n, delay 0 - 3 ticks. Records what the queued bus sends, and the service() call it was sent on.
+ */
+
+static uint8_t transfer_byte(uint32_t n) { return (uint8_t) (n & 0xff); }
+static bool transfer_reg(uint32_t n) { return ((n >> 12) & 1u); }
+static uint32_t transfer_delay_us(uint32_t n) { return ((n*7u) % 4u)*STRESS_TICK_US; }
+
+class StressRecordBus : public ST7920Bus {
+	public:
+		bool begin(void) { return true; }
+
+		bool writeCommands(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us) { this->_record(false, bytes, n_bytes, cmddelay_us); return true; }
+		bool writeData(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us) { this->_record(true, bytes, n_bytes, cmddelay_us); return true; }
+
+		uint8_t *bytes = NULL;
+		uint8_t *regs = NULL;
+		uint32_t *calls = NULL;
+		uint32_t n_recorded = 0u;
+		uint32_t n_bad_writes = 0u; /*More than a byte per write, or a delay left to the wrapped bus*/
+		uint32_t n_call = 0u; /*Set by the consumer*/
+
+	private:
+		void _record(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+		{
+			if((n_bytes != 1u) || cmddelay_us) this->n_bad_writes++;
+			if(this->n_recorded >= STRESS_MAX_RECORD) return;
+
+			this->bytes[this->n_recorded] = bytes[0];
+			this->regs[this->n_recorded] = (uint8_t) reg;
+			this->calls[this->n_recorded] = this->n_call;
+			this->n_recorded++;
+			return;
+		}
+};
+
+static uint32_t n_fail = 0u;
+static uint32_t n_transfers = 200000u;
+
+static ST7920CommandQueue queue;
+static StressRecordBus record_bus;
+
+static bool producer_done = false;
+
+/*Accepted writes of the queued bus runs: first transfer number and length*/
+static uint32_t *accepted_first = NULL;
+static uint32_t *accepted_length = NULL;
+static uint32_t n_accepted = 0u;
+static uint32_t n_dropped = 0u;
+static uint32_t n_unreported = 0u; /*Drops the write (display call) didn't return false for, or false returns without a drop*/
+
+static ST7920Emulator emulator(STRESS_DB0, STRESS_DB1, STRESS_DB2, STRESS_DB3, STRESS_DB4, STRESS_DB5, STRESS_DB6, STRESS_DB7, STRESS_RS, 0xff, STRESS_E);
+static ST7920ParallelBus display_bus(STRESS_DB0, STRESS_DB1, STRESS_DB2, STRESS_DB3, STRESS_DB4, STRESS_DB5, STRESS_DB6, STRESS_DB7, STRESS_RS, ST7920Bus::PIN_NONE, STRESS_E);
+static ST7920QueuedBus display_queued(display_bus, STRESS_TICK_US);
+static ST7920 st7920(display_queued);
+
+static void check(bool ok, const char *what)
+{
+	if(ok) return;
+
+	printf("FAIL: %s\n", what);
+	n_fail++;
+	return;
+}
+
+static uint32_t stress_random(uint32_t *p_state)
+{
+	uint32_t x = *p_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	*p_state = x;
+	return x;
+}
+
+/*
+ * Queue alone
+ */
+
+static void *queue_producer(void *arg)
+{
+	uint32_t rand_state = 0x1b873593u;
+	uint32_t n_next = 0u;
+	uint32_t n_batch = 0u;
+	uint32_t n_byte = 0u;
+	uint8_t bytes[64];
+
+	(void) arg;
+
+	while(n_next < n_transfers)
+	{
+		/*Same RS and delay for a whole batch*/
+		n_batch = stress_random(&rand_state) % ((queue.SIZE < 64u) ? queue.SIZE : 64u) + 1u;
+		if((n_next + n_batch) > n_transfers) n_batch = n_transfers - n_next;
+		if(((n_next & 0xfff) + n_batch) > 4096u) n_batch = 4096u - (n_next & 0xfff);
+
+		for(n_byte = 0u; n_byte < n_batch; n_byte++) bytes[n_byte] = transfer_byte(n_next + n_byte);
+
+		while(!queue.push(transfer_reg(n_next), bytes, n_batch, (n_next % 1000u))) sched_yield();
+
+		n_next += n_batch;
+		if(!(stress_random(&rand_state) % 16u)) sched_yield();
+	}
+
+	__atomic_store_n(&producer_done, true, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void *queue_consumer(void *arg)
+{
+	uint32_t *p_bad = (uint32_t*) arg;
+	uint32_t n_next = 0u;
+	struct _st7920_transfer transfer;
+
+	while(n_next < n_transfers)
+	{
+		if(!queue.pop(&transfer))
+		{
+			if(__atomic_load_n(&producer_done, __ATOMIC_ACQUIRE) && queue.isEmpty() && (n_next < n_transfers)) break;
+
+			sched_yield();
+			continue;
+		}
+
+		if((transfer.byte != transfer_byte(n_next)) || (((bool) transfer.reg) != transfer_reg(n_next))) (*p_bad)++;
+
+		n_next++;
+	}
+
+	if(n_next != n_transfers) (*p_bad)++;
+
+	return NULL;
+}
+
+static void check_queue(void)
+{
+	pthread_t producer;
+	pthread_t consumer;
+	uint32_t n_bad = 0u;
+
+	producer_done = false;
+
+	pthread_create(&consumer, NULL, queue_consumer, &n_bad);
+	pthread_create(&producer, NULL, queue_producer, NULL);
+
+	pthread_join(producer, NULL);
+	pthread_join(consumer, NULL);
+
+	check(!n_bad, "queue: every transfer out once, in order");
+	check(queue.isEmpty() && (queue.getFree() == queue.SIZE), "queue: empty at the end");
+
+	printf("queue: %u transfers through a %u slot queue\n", n_transfers, queue.SIZE);
+	return;
+}
+
+/*
+ * Queued bus: writes n_next, n_next + 1... (one RS per write), some larger than the queue
+ */
+
+static void *bus_producer(void *arg)
+{
+	ST7920QueuedBus *p_queued = (ST7920QueuedBus*) arg;
+	uint32_t rand_state = 0x85ebca6bu;
+	uint32_t n_next = 0u;
+	uint32_t n_write = 0u;
+	uint32_t n_byte = 0u;
+	uint32_t drop_count = 0u;
+	bool queued = false;
+	uint8_t bytes[STRESS_MAX_WRITE];
+
+	n_accepted = 0u;
+	n_dropped = 0u;
+	n_unreported = 0u;
+
+	while(n_next < n_transfers)
+	{
+		n_write = stress_random(&rand_state) % 40u + 1u;
+		if(!(stress_random(&rand_state) % 64u)) n_write = stress_random(&rand_state) % STRESS_MAX_WRITE + 1u;
+
+		if((n_next + n_write) > n_transfers) n_write = n_transfers - n_next;
+		if(((n_next & 0xfff) + n_write) > 4096u) n_write = 4096u - (n_next & 0xfff);
+
+		for(n_byte = 0u; n_byte < n_write; n_byte++) bytes[n_byte] = transfer_byte(n_next + n_byte);
+
+		drop_count = p_queued->getDropCount();
+
+		if(transfer_reg(n_next)) queued = p_queued->writeData(bytes, n_write, transfer_delay_us(n_next));
+		else queued = p_queued->writeCommands(bytes, n_write, transfer_delay_us(n_next));
+
+		if(queued == (p_queued->getDropCount() != drop_count)) n_unreported++;
+
+		if(p_queued->getDropCount() != drop_count)
+		{
+			n_dropped++;
+			sched_yield();
+		}
+		else
+		{
+			accepted_first[n_accepted] = n_next;
+			accepted_length[n_accepted] = n_write;
+			n_accepted++;
+		}
+
+		/*Numbers of dropped writes are skipped too: what's received tells which writes went*/
+		n_next += n_write;
+		if(!(stress_random(&rand_state) % 8u)) sched_yield();
+	}
+
+	__atomic_store_n(&producer_done, true, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void *bus_consumer(void *arg)
+{
+	ST7920QueuedBus *p_queued = (ST7920QueuedBus*) arg;
+
+	while(!__atomic_load_n(&producer_done, __ATOMIC_ACQUIRE) || !p_queued->idle())
+	{
+		p_queued->service();
+		record_bus.n_call++;
+
+		if(!(record_bus.n_call % 32u)) sched_yield();
+	}
+
+	return NULL;
+}
+
+/*returns the number of transfers received wrong: not the accepted writes in order, or sent before the previous one's delay was over*/
+static uint32_t check_received(void)
+{
+	uint32_t n_write = 0u;
+	uint32_t n_byte = 0u;
+	uint32_t n_received = 0u;
+	uint32_t n_transfer = 0u;
+	uint32_t n_bad = 0u;
+	uint32_t hold_calls = 0u;
+
+	for(n_write = 0u; n_write < n_accepted; n_write++)
+	{
+		for(n_byte = 0u; n_byte < accepted_length[n_write]; n_byte++)
+		{
+			n_transfer = accepted_first[n_write] + n_byte;
+
+			if(n_received >= record_bus.n_recorded) return (n_bad + 1u);
+
+			if((record_bus.bytes[n_received] != transfer_byte(n_transfer)) || (((bool) record_bus.regs[n_received]) != transfer_reg(n_transfer))) n_bad++;
+			if(n_received && ((record_bus.calls[n_received] - record_bus.calls[n_received - 1u]) < hold_calls)) n_bad++;
+
+			/*The delay is held over the following service() calls*/
+			hold_calls = transfer_delay_us(accepted_first[n_write])/STRESS_TICK_US;
+			if(!hold_calls) hold_calls = 1u;
+
+			n_received++;
+		}
+	}
+
+	if(n_received != record_bus.n_recorded) n_bad++;
+
+	return n_bad;
+}
+
+static void run_bus(ST7920QueuedBus *p_queued)
+{
+	pthread_t producer;
+	pthread_t consumer;
+
+	producer_done = false;
+	record_bus.n_recorded = 0u;
+	record_bus.n_bad_writes = 0u;
+	record_bus.n_call = 0u;
+
+	pthread_create(&consumer, NULL, bus_consumer, p_queued);
+	pthread_create(&producer, NULL, bus_producer, p_queued);
+
+	pthread_join(producer, NULL);
+	pthread_join(consumer, NULL);
+	return;
+}
+
+static void check_bus(void)
+{
+	ST7920QueuedBus queued(record_bus, STRESS_TICK_US);
+	uint32_t n_bad = 0u;
+
+	check(queued.begin(), "queued bus: begin()");
+
+	/*Drop on full*/
+	run_bus(&queued);
+	n_bad = check_received();
+
+	check(!n_bad, "drop on full: the writes not dropped received whole, in order, each held for its delay");
+	check((n_dropped > 0u) && (queued.getDropCount() == n_dropped) && (queued.getFullCount() == n_dropped), "drop on full: drops counted");
+	check(!n_unreported, "drop on full: the write returns false if (and only if) it was dropped");
+	check(!record_bus.n_bad_writes, "drop on full: one byte per write, no delay on the wrapped bus");
+	check(queued.idle(), "drop on full: idle at the end");
+
+	printf("queued bus, drop on full: %u writes sent, %u dropped, %u transfers\n", n_accepted, n_dropped, record_bus.n_recorded);
+
+	/*Wait when full*/
+	queued.resetFullCount();
+	queued.setWaitWhenFull(true);
+
+	run_bus(&queued);
+	n_bad = check_received();
+
+	check(!n_bad && !n_dropped && !n_unreported && !queued.getDropCount(), "wait when full: every write received whole, in order");
+	check((queued.getFullCount() > 0u), "wait when full: the queue filled up");
+	check(!record_bus.n_bad_writes, "wait when full: one byte per write, no delay on the wrapped bus");
+
+	printf("queued bus, wait when full: %u writes, %u found the queue full, %u transfers\n", n_accepted, queued.getFullCount(), record_bus.n_recorded);
+	return;
+}
+
+/*
+ * Display through the queue: text calls (producer), service() every STRESS_TICK_US (consumer)
+ */
+
+static char text_model[4][17];
+
+static void *display_producer(void *arg)
+{
+	uint32_t rand_state = 0xc2b2ae35u;
+	uint32_t n_call = 0u;
+	uint32_t cx = 0u;
+	uint32_t cy = 0u;
+	uint32_t n_char = 0u;
+	uint32_t length = 0u;
+	uint32_t drop_count = 0u;
+	uint32_t n_burst = 0u;
+	uint32_t *p_recovered = (uint32_t*) arg;
+	bool sent = true;
+	char text[17];
+
+	n_unreported = 0u;
+
+	for(n_call = 0u; n_call < STRESS_N_TEXT_CALLS; n_call++)
+	{
+		/*Backpressure: most calls wait for room, some come in bursts regardless*/
+		n_burst = 1u;
+		if(stress_random(&rand_state) % 8u)
+		{
+			while(display_queued.getFree() < STRESS_CALL_ROOM) sched_yield();
+		}
+		else n_burst = 16u;
+
+		drop_count = display_queued.getDropCount();
+		sent = true;
+
+		for(; n_burst > 0u; n_burst--)
+		{
+			switch(stress_random(&rand_state) % 8u)
+			{
+				case 0u:
+					if(!st7920.setDisplayMode((int32_t) (stress_random(&rand_state) % 2u) + st7920.DISPLAYMODE_DISPLAY_ON_CURSOR_OFF)) sent = false;
+					break;
+
+				case 1u:
+					if(!st7920.cursorHome()) sent = false;
+					break;
+
+				default:
+					cx = stress_random(&rand_state) % 16u;
+					cy = stress_random(&rand_state) % 4u;
+					length = stress_random(&rand_state) % (16u - cx) + 1u;
+
+					for(n_char = 0u; n_char < length; n_char++) text[n_char] = (char) ('a' + stress_random(&rand_state) % 26u);
+
+					if(!st7920.setTextCursorPosition(cx, cy)) sent = false;
+					if(!st7920.printText(text, length)) sent = false;
+
+					memcpy(&text_model[cy][cx], text, length);
+					break;
+			}
+		}
+
+		if(sent == (display_queued.getDropCount() != drop_count)) n_unreported++;
+
+		if(sent) continue;
+
+		/*Dropped: the display missed part of it (the driver knows). Let the queue drain, then print the text again.*/
+		while(!display_queued.idle()) sched_yield();
+
+		for(cy = 0u; cy < 4u; cy++)
+		{
+			while(display_queued.getFree() < STRESS_CALL_ROOM) sched_yield();
+
+			if(!st7920.setTextCursorPosition(0u, cy) || !st7920.printText(text_model[cy], 16u)) n_unreported++;
+		}
+
+		(*p_recovered)++;
+	}
+
+	__atomic_store_n(&producer_done, true, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void *display_consumer(void *arg)
+{
+	uint32_t n_call = 0u;
+
+	(void) arg;
+
+	while(!__atomic_load_n(&producer_done, __ATOMIC_ACQUIRE) || !display_queued.idle())
+	{
+		display_queued.service();
+		delayMicroseconds(STRESS_TICK_US);
+
+		n_call++;
+		if(!(n_call % 16u)) sched_yield();
+	}
+
+	return NULL;
+}
+
+static void display_drain(void)
+{
+	while(!display_queued.idle())
+	{
+		display_queued.service();
+		delayMicroseconds(STRESS_TICK_US);
+	}
+
+	return;
+}
+
+static void check_display(void)
+{
+	pthread_t producer;
+	pthread_t consumer;
+	uint32_t n_recovered = 0u;
+	uint32_t n_line = 0u;
+	uint32_t n_wrong = 0u;
+	char line[40];
+
+	check(st7920.begin(), "display: begin()");
+	display_queued.flush();
+
+	memset(text_model, ' ', sizeof(text_model));
+	for(n_line = 0u; n_line < 4u; n_line++) text_model[n_line][16] = '\0';
+
+	st7920.clearText();
+	display_drain();
+
+	producer_done = false;
+
+	pthread_create(&consumer, NULL, display_consumer, NULL);
+	pthread_create(&producer, NULL, display_producer, &n_recovered);
+
+	pthread_join(producer, NULL);
+	pthread_join(consumer, NULL);
+
+	/*Text lines 0 - 3 of the model against the emulator (ROM characters aren't rendered, DDRAM bytes are read back)*/
+	for(n_line = 0u; n_line < 4u; n_line++)
+	{
+		emulator.getTextLine(n_line, line);
+		if(memcmp(line, text_model[n_line], 16u)) n_wrong++;
+	}
+
+	check(!n_wrong, "display: text shown as printed");
+	check((display_queued.getDropCount() > 0u) && (n_recovered > 0u), "display: drops seen and recovered from");
+	check(!n_unreported, "display: a call returns false if (and only if) a write was dropped");
+	check(!emulator.getViolationCount(), "display: no transfer while busy");
+
+	printf("display through the queue: %u text calls, %u drops recovered, %u instructions, %u data bytes\n", STRESS_N_TEXT_CALLS, n_recovered, emulator.getInstructionCount(), emulator.getDataByteCount());
+	return;
+}
+
+/*
+ * Display, dropped writes: the queue is only serviced between calls
+ */
+
+/*returns the number of pixels the display shows differently from the buffer*/
+static uint32_t display_mismatch(void)
+{
+	uint32_t cx = 0u;
+	uint32_t cy = 0u;
+	uint32_t n_wrong = 0u;
+
+	for(cy = 0u; cy < st7920.HEIGHT; cy++)
+	{
+		for(cx = 0u; cx < st7920.WIDTH; cx++) if(emulator.getPixel(cx, cy) != st7920.bufferGetPixel(cx, cy)) n_wrong++;
+	}
+
+	return n_wrong;
+}
+
+static void check_display_drop_paint(void)
+{
+	uint32_t page_index = 0u;
+	uint32_t cy = 0u;
+	uint32_t n_call = 0u;
+	uint32_t n_paint_calls = 0u;
+	uint32_t drop_count = 0u;
+	int32_t n_pending = 0;
+
+	/*Text off the screen: only the graphics are compared*/
+	display_drain();
+	check(st7920.clearText() && st7920.enableGraphicDisplay(true), "dropped paint: text cleared, graphic display on");
+	display_drain();
+
+	for(cy = 0u; cy < st7920.HEIGHT; cy++)
+	{
+		for(page_index = 0u; page_index < st7920.WIDTH_PAGES; page_index++) st7920.bufferSetPage(page_index, cy, (uint16_t) (0x9249u*(cy + 1u) ^ (0x1111u*page_index)));
+	}
+
+	/*Paint all: more than the queue holds*/
+	drop_count = display_queued.getDropCount();
+	emulator.resetCounters();
+
+	check(!st7920.bufferPaintAll(), "dropped paint: bufferPaintAll() returns false");
+	check((display_queued.getDropCount() != drop_count) && (st7920.bufferIsDirty() == 1), "dropped paint: the pages not sent stay modified");
+
+	for(n_call = 0u; (n_call < 1000u) && (st7920.bufferIsDirty() == 1); n_call++)
+	{
+		display_drain();
+		st7920.bufferPaintDirty();
+	}
+
+	display_drain();
+	n_paint_calls = n_call;
+
+	check(!st7920.bufferIsDirty() && !display_mismatch(), "dropped paint: the display shows the buffer once the modified pages are painted");
+	check((emulator.getDataByteCount() == (st7920.WIDTH*st7920.HEIGHT/8u)), "dropped paint: each page sent once");
+
+	/*Refresh tick: the region stays pending*/
+	st7920.bufferToggleAll();
+	emulator.resetCounters();
+
+	check(st7920.refreshRequest(0, 0, (int32_t) st7920.WIDTH, (int32_t) st7920.HEIGHT, 0u, (micros() + 100000u)), "dropped refresh: refreshRequest()");
+	check((st7920.refreshTick(100000u) == -1), "dropped refresh: refreshTick() returns -1");
+	check((st7920.getRefreshPendingCount() == 1u) && (st7920.bufferIsDirty() == 1), "dropped refresh: the region stays pending, its pages not sent modified");
+
+	n_pending = 1;
+	for(n_call = 0u; (n_call < 1000u) && n_pending; n_call++)
+	{
+		display_drain();
+		n_pending = st7920.refreshTick(100000u);
+	}
+
+	display_drain();
+
+	check(!n_pending && !st7920.bufferIsDirty() && !display_mismatch(), "dropped refresh: the display shows the buffer once the region is done");
+	check((emulator.getDataByteCount() == (st7920.WIDTH*st7920.HEIGHT/8u)), "dropped refresh: each page sent once");
+
+	printf("display, dropped paint: painted in %u calls, refreshed in %u ticks\n", n_paint_calls, n_call);
+	return;
+}
+
+static void check_display_drop_text(void)
+{
+	uint32_t n_call = 0u;
+	char line[40];
+
+	/*Text printed while the queue is full: filled with display mode changes (single byte writes) until one is dropped*/
+	for(n_call = 0u; n_call < 1000u; n_call++)
+	{
+		if(!st7920.setDisplayMode((n_call & 1u) ? st7920.DISPLAYMODE_DISPLAY_ON_CURSOR_ON : st7920.DISPLAYMODE_DISPLAY_ON_CURSOR_OFF)) break;
+	}
+
+	check((n_call < 1000u) && !display_queued.getFree(), "dropped text: a display mode change returns false once the queue is full");
+	check(!st7920.setTextCursorPosition(0u, 1u) && !st7920.printText("dropped text", 12u), "dropped text: calls return false");
+
+	display_drain();
+	check(st7920.setTextCursorPosition(0u, 1u) && st7920.printText("dropped text", 12u), "dropped text: printed again once there's room");
+	check(st7920.setDisplayMode(st7920.DISPLAYMODE_DISPLAY_ON_CURSOR_OFF), "dropped text: display mode set again");
+	display_drain();
+
+	emulator.getTextLine(1u, line);
+	check(!memcmp(line, "dropped text", 12u) && emulator.isDisplayOn() && !emulator.getViolationCount(), "dropped text: shown once printed again, no transfer while busy");
+
+	printf("display, dropped text: printed again after %u display mode changes filled the queue\n", n_call);
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	if(argc > 1) n_transfers = (uint32_t) strtoul(argv[1], NULL, 0);
+	if(n_transfers > STRESS_MAX_RECORD) n_transfers = STRESS_MAX_RECORD;
+
+	record_bus.bytes = (uint8_t*) malloc(STRESS_MAX_RECORD);
+	record_bus.regs = (uint8_t*) malloc(STRESS_MAX_RECORD);
+	record_bus.calls = (uint32_t*) malloc(STRESS_MAX_RECORD*sizeof(uint32_t));
+	accepted_first = (uint32_t*) malloc(n_transfers*sizeof(uint32_t));
+	accepted_length = (uint32_t*) malloc(n_transfers*sizeof(uint32_t));
+
+	if((record_bus.bytes == NULL) || (record_bus.regs == NULL) || (record_bus.calls == NULL) || (accepted_first == NULL) || (accepted_length == NULL))
+	{
+		printf("out of memory\n");
+		return 1;
+	}
+
+	check_queue();
+	check_bus();
+	check_display();
+
+	if(ST7920CommandQueue::SIZE >= STRESS_PAINT_ROOM) check_display_drop_paint();
+	else printf("display, dropped paint: skipped (queue smaller than %u transfers)\n", STRESS_PAINT_ROOM);
+
+	check_display_drop_text();
+
+	printf("queue stress: %s (%u failures)\n", (n_fail ? "FAIL" : "ok"), n_fail);
+
+	free(record_bus.bytes);
+	free(record_bus.regs);
+	free(record_bus.calls);
+	free(accepted_first);
+	free(accepted_length);
+
+	if(n_fail) return 1;
+
+	return 0;
+}
@@ -0,0 +1,527 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Refresh scheduler check (refreshRequest(), refreshTick()), on an emulated 128x64 display with the simulated clock.
+ *
+ * Coalescing: overlapping requests merge into one region, disjoint ones don't, a full table merges, and a page asked for many times is
+ * sent once. Order: higher priority first, then earlier deadline. Only the modified pages of the regions are sent.
+ * Budget: small budgets (below an instruction set switch) still send while the display is in the extended set, and a budget below one
+ * page still sends one page a tick. Random drawing, requests and budgets; no tick may take longer than its budget (a budget below one
+ * page, plus the switch if needed, by exactly one page), every tick with a region pending makes progress, and once drained every
+ * requested area shows.
+ * Deadlines: a 20Hz status bar and a 2Hz graph ticked every 10ms. With enough budget nothing is missed, and each shows in time; with too
+ * little, the graph misses (reported) while the status bar still shows in time.
+ *
+ * Exit status is 1 if any check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define CHECK_DB0 2
+#define CHECK_DB1 3
+#define CHECK_DB2 4
+#define CHECK_DB3 5
+#define CHECK_DB4 6
+#define CHECK_DB5 7
+#define CHECK_DB6 8
+#define CHECK_DB7 9
+#define CHECK_RS 10
+#define CHECK_E 11
+
+#define CHECK_PIN_COST_NS 40u
+
+/*Worst case transfer times the driver plans with: one page is an address set and a page (4 short transfers)*/
+#define CHECK_SHORT_TRANSFER_US 136u
+#define CHECK_LONG_TRANSFER_US 1032u
+#define CHECK_ONE_PAGE_US (4u*CHECK_SHORT_TRANSFER_US)
+
+#define CHECK_N_RANDOM_TICKS 3000u
+
+/*Status bar / graph scenario*/
+#define CHECK_TICK_PERIOD_US 10000u
+#define CHECK_STATUS_PERIOD_US 50000u
+#define CHECK_GRAPH_PERIOD_US 500000u
+#define CHECK_SCENARIO_US 3000000u
+#define CHECK_BUDGET_US 5000u
+#define CHECK_LOW_BUDGET_US 2500u
+
+static ST7920Emulator emulator(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 0xff, CHECK_E);
+static ST7920 panel(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+
+static struct _st7920_refresh_stats stats;
+
+static uint32_t check_rand_state = 0x2f6b81c3u;
+static uint32_t n_fail = 0u;
+static uint32_t n_over_budget = 0u;
+static uint32_t n_no_progress = 0u;
+static uint32_t n_small_budget = 0u;
+
+static void check(bool ok, const char *what)
+{
+	if(ok) return;
+
+	printf("FAIL: %s\n", what);
+	n_fail++;
+	return;
+}
+
+static uint32_t check_random(void)
+{
+	uint32_t x = check_rand_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	check_rand_state = x;
+	return x;
+}
+
+/*returns true if the display shows the buffer within the rectangle*/
+static bool area_shown(int32_t cx, int32_t cy, int32_t w, int32_t h)
+{
+	int32_t x = 0;
+	int32_t y = 0;
+
+	for(y = cy; y < (cy + h); y++)
+	{
+		for(x = cx; x < (cx + w); x++)
+		{
+			if(emulator.getPixel((uint32_t) x, (uint32_t) y) != panel.bufferGetPixel((uint32_t) x, (uint32_t) y)) return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * refreshTick(), timed on the simulated clock. A budget shorter than one page (plus the instruction set switch, if the display isn't
+ * in the extended set) may be overrun by exactly one page.
+ */
+
+static int32_t tick(uint32_t budget_us)
+{
+	uint64_t start_ns = 0u;
+	uint64_t spent_ns = 0u;
+	uint32_t data_bytes = emulator.getDataByteCount();
+	uint32_t min_us = CHECK_ONE_PAGE_US;
+	int32_t n_pending_before = (int32_t) panel.getRefreshPendingCount();
+	int32_t n_pending = 0;
+
+	if(!emulator.isExtendedMode()) min_us += CHECK_LONG_TRANSFER_US;
+
+	start_ns = hostGetTimeNs();
+	n_pending = panel.refreshTick(budget_us);
+	spent_ns = hostGetTimeNs() - start_ns;
+
+	/*A region pending: the tick must send a page or finish a region*/
+	if(n_pending_before && (n_pending == n_pending_before) && (emulator.getDataByteCount() == data_bytes)) n_no_progress++;
+
+	if(budget_us >= min_us)
+	{
+		if(spent_ns > 1000u*((uint64_t) budget_us)) n_over_budget++;
+	}
+	else
+	{
+		n_small_budget++;
+		if((spent_ns > 1000u*((uint64_t) min_us)) || ((emulator.getDataByteCount() - data_bytes) > 2u)) n_over_budget++;
+	}
+
+	return n_pending;
+}
+
+static void drain(void)
+{
+	uint32_t n_ticks = 0u;
+
+	while((tick(20000u) > 0) && (n_ticks < 1000u)) n_ticks++;
+	return;
+}
+
+static void check_errors(void)
+{
+	check(!panel.refreshRequest(0, 0, 16, 16, 1u, 1000u), "refreshRequest() before begin()");
+	check((panel.refreshTick(10000u) == -1), "refreshTick() before begin()");
+
+	check(panel.begin(), "begin()");
+	panel.enableGraphicDisplay(true);
+	panel.bufferSetAll(false);
+	panel.bufferPaintAll();
+
+	check(!panel.refreshRequest(0, 0, 0, 16, 1u, 1000u), "empty rectangle");
+	check(!panel.refreshRequest(128, 0, 16, 16, 1u, 1000u), "rectangle off the screen (right)");
+	check(!panel.refreshRequest(-20, -20, 20, 20, 1u, 1000u), "rectangle off the screen (top left)");
+	check(!panel.getRefreshPendingCount(), "nothing pending after bad requests");
+
+	panel.bufferFillRect(0, 0, 16, 8, panel.DRAWMODE_TOGGLE);
+	check(panel.refreshRequest(-8, -8, 24, 16, 1u, 1000u), "rectangle partly on the screen");
+	check((panel.getRefreshPendingCount() == 1u), "clipped request pending");
+	check((tick(0u) == 1), "no budget: still pending");
+
+	panel.refreshCancel();
+	check(!panel.getRefreshPendingCount(), "refreshCancel()");
+
+	/*Far edges past the int32_t range: clipped to the bottom right corner*/
+	panel.bufferFillRect(96, 56, 32, 8, panel.DRAWMODE_TOGGLE);
+	check(panel.refreshRequest(100, 60, INT32_MAX, INT32_MAX, 1u, 100000u), "rectangle to the int32_t limits");
+	check(!panel.refreshRequest(INT32_MIN, INT32_MIN, INT32_MAX, INT32_MAX, 1u, 1000u), "rectangle from the int32_t limits, off the screen");
+	drain();
+	check(area_shown(96, 60, 32, 4) && !area_shown(96, 56, 32, 4), "rectangle to the int32_t limits: only the corner sent");
+
+	/*Nothing modified: done without sending anything*/
+	panel.bufferPaintDirty();
+	panel.resetBusByteCount();
+	panel.refreshRequest(0, 0, 128, 64, 1u, 1000u);
+	check((tick(0u) == 0) && !panel.getBusByteCount(), "region with nothing modified done at once");
+
+	panel.bufferSetAll(false);
+	panel.bufferPaintAll();
+	return;
+}
+
+static void check_coalescing(void)
+{
+	uint32_t n_request = 0u;
+	uint32_t bytes = 0u;
+
+	panel.refreshCancel();
+	panel.resetRefreshStats();
+
+	/*A and B overlap, C doesn't*/
+	panel.refreshRequest(0, 0, 32, 8, 1u, 100000u);
+	panel.refreshRequest(16, 4, 32, 8, 1u, 100000u);
+	check((panel.getRefreshPendingCount() == 1u), "overlapping requests merged");
+
+	panel.refreshRequest(96, 40, 16, 8, 1u, 100000u);
+	check((panel.getRefreshPendingCount() == 2u), "disjoint request kept apart");
+
+	/*D bridges both*/
+	panel.refreshRequest(24, 10, 80, 40, 1u, 100000u);
+	check((panel.getRefreshPendingCount() == 1u), "bridging request merges everything");
+
+	/*Same page column, rows apart*/
+	panel.refreshRequest(0, 60, 16, 2, 1u, 100000u);
+	panel.refreshRequest(0, 62, 16, 2, 1u, 100000u);
+	check((panel.getRefreshPendingCount() == 3u), "rows apart kept apart");
+
+	panel.getRefreshStats(&stats);
+	check((stats.requests == 6u) && (stats.coalesced == 2u), "request and coalesce counts");
+
+	panel.refreshCancel();
+
+	/*A page asked for many times is sent once: 3 x 12 modified pages*/
+	panel.bufferFillRect(0, 0, 48, 12, panel.DRAWMODE_SET);
+	for(n_request = 0u; n_request < 10u; n_request++) panel.refreshRequest((int32_t) (4u*n_request), (int32_t) n_request, 8, 3, (uint8_t) n_request, 100000u);
+	panel.refreshRequest(0, 0, 48, 12, 1u, 100000u);
+
+	panel.resetRefreshStats();
+	panel.resetBusByteCount();
+	drain();
+	panel.getRefreshStats(&stats);
+
+	check((stats.pages == 36u), "each modified page sent once");
+	check(((panel.getBusByteCount() - 2u*stats.pages) <= 2u*12u + 2u), "one address set per row run");
+	check(area_shown(0, 0, 48, 12), "coalesced area shown");
+	check((stats.completed == 1u) && !stats.missed, "one region completed in time");
+
+	/*Full table: merged with the region that grows the least*/
+	panel.refreshCancel();
+	panel.resetRefreshStats();
+
+	for(n_request = 0u; n_request < (ST7920_REFRESH_SLOTS + 4u); n_request++)
+	{
+		panel.bufferFillRect((int32_t) ((n_request % 8u)*16u), (int32_t) ((n_request/8u)*20u), 16, 4, panel.DRAWMODE_TOGGLE);
+		panel.refreshRequest((int32_t) ((n_request % 8u)*16u), (int32_t) ((n_request/8u)*20u), 16, 4, 1u, 100000u);
+	}
+
+	panel.getRefreshStats(&stats);
+	check((panel.getRefreshPendingCount() == ST7920_REFRESH_SLOTS) && (stats.coalesced == 4u), "full table merges");
+
+	drain();
+	check(area_shown(0, 0, 128, 64), "full table: every area shown");
+
+	/*Modified pages outside the regions aren't sent*/
+	panel.bufferFillRect(64, 32, 16, 8, panel.DRAWMODE_TOGGLE);
+	panel.bufferFillRect(0, 32, 16, 8, panel.DRAWMODE_TOGGLE);
+	panel.refreshRequest(0, 32, 16, 8, 1u, 100000u);
+
+	bytes = panel.getBusByteCount();
+	drain();
+
+	check(area_shown(0, 32, 16, 8), "requested area shown");
+	check(!area_shown(64, 32, 16, 8), "area not requested not sent");
+	check(((panel.getBusByteCount() - bytes) <= (8u*(2u + 2u) + 1u)), "only the requested pages sent");
+
+	panel.bufferPaintDirty();
+	return;
+}
+
+static void check_order(void)
+{
+	/*Budget for about 8 rows of 8 pages (plus the instruction set)*/
+	static const uint32_t budget_us = 1040u + 8u*18u*136u + 500u;
+
+	panel.refreshCancel();
+	panel.resetRefreshStats();
+
+	/*Low priority asked first, with the earlier deadline*/
+	panel.bufferFillRect(0, 32, 128, 32, panel.DRAWMODE_TOGGLE);
+	panel.refreshRequest(0, 32, 128, 32, 1u, 1000u);
+
+	panel.bufferFillRect(0, 0, 128, 8, panel.DRAWMODE_TOGGLE);
+	panel.refreshRequest(0, 0, 128, 8, 9u, 100000u);
+
+	check((tick(budget_us) == 1), "low priority region left");
+	check(area_shown(0, 0, 128, 8), "high priority region sent first");
+	check(!area_shown(0, 32, 128, 32), "low priority region waits");
+
+	drain();
+	check(area_shown(0, 32, 128, 32), "low priority region sent");
+
+	panel.getRefreshStats(&stats);
+	check((stats.missed == 1u) && (stats.max_late_us > 0u), "low priority region missed its deadline");
+
+	/*Equal priority: earlier deadline first*/
+	panel.bufferFillRect(0, 32, 128, 8, panel.DRAWMODE_TOGGLE);
+	panel.refreshRequest(0, 32, 128, 8, 5u, 90000u);
+
+	panel.bufferFillRect(0, 8, 128, 8, panel.DRAWMODE_TOGGLE);
+	panel.refreshRequest(0, 8, 128, 8, 5u, 30000u);
+
+	check((tick(budget_us) == 1), "later deadline left");
+	check(area_shown(0, 8, 128, 8), "earlier deadline sent first");
+	check(!area_shown(0, 32, 128, 8), "later deadline waits");
+
+	drain();
+
+	/*A region cut short goes on from there, and a missed deadline is counted once*/
+	panel.resetRefreshStats();
+	panel.bufferFillRect(0, 0, 128, 64, panel.DRAWMODE_TOGGLE);
+	panel.refreshRequest(0, 0, 128, 64, 1u, 20000u);
+
+	while(tick(budget_us) > 0) delayMicroseconds(10000u);
+
+	panel.getRefreshStats(&stats);
+	check(area_shown(0, 0, 128, 64), "large region sent over several ticks");
+	check((stats.pages == 512u) && (stats.missed == 1u) && (stats.completed == 1u), "large region: each page once, missed once");
+	check((stats.ticks >= 6u), "large region needs several ticks");
+	return;
+}
+
+static void check_budget(void)
+{
+	uint32_t n_tick = 0u;
+	uint32_t n_request = 0u;
+	uint32_t budget_us = 0u;
+	uint32_t max_budget_us = 0u;
+	int32_t cx = 0;
+	int32_t cy = 0;
+	int32_t w = 0;
+	int32_t h = 0;
+	static bool requested[64][128];
+
+	panel.refreshCancel();
+	panel.resetRefreshStats();
+	n_over_budget = 0u;
+	n_no_progress = 0u;
+	n_small_budget = 0u;
+
+	/*
+	 * Small budgets: below an instruction set switch (1032us) + one page, pages still go while the display is in the extended set.
+	 * After text (basic set), the first page of a tick still goes, with the switch. Below one page, one page a tick.
+	 */
+	panel.bufferPaintAll();
+	panel.bufferFillRect(0, 0, 16, 8, panel.DRAWMODE_TOGGLE);
+	panel.refreshRequest(0, 0, 16, 8, 1u, 50000u);
+
+	for(n_tick = 0u; (n_tick < 200u) && (tick(1200u) > 0); n_tick++) delayMicroseconds(10000u);
+
+	panel.getRefreshStats(&stats);
+	check(area_shown(0, 0, 16, 8) && (stats.pages == 8u), "1200us ticks, extended set on: region sent");
+	check((n_tick <= 4u) && !stats.missed, "1200us ticks, extended set on: 2 rows a tick, in time");
+
+	panel.bufferFillRect(0, 8, 16, 1, panel.DRAWMODE_TOGGLE);
+	panel.refreshRequest(0, 8, 16, 1, 1u, 50000u);
+	panel.setTextCursorPosition(0u, 3u);
+	panel.printText("ok");
+
+	check((tick(1200u) == 0) && area_shown(0, 8, 16, 1), "1200us tick, basic set on: the switch and one page go anyway");
+
+	panel.bufferFillRect(0, 16, 16, 4, panel.DRAWMODE_TOGGLE);
+	panel.refreshRequest(0, 16, 16, 4, 1u, 50000u);
+
+	for(n_tick = 0u; (n_tick < 10u) && (tick(300u) > 0); n_tick++);
+	check(area_shown(0, 16, 16, 4) && (n_tick == 3u), "300us ticks: one page a tick");
+
+	panel.setTextCursorPosition(0u, 3u);
+	panel.printText("ok");
+	panel.bufferFillRect(0, 24, 16, 2, panel.DRAWMODE_TOGGLE);
+	panel.refreshRequest(0, 24, 16, 2, 1u, 50000u);
+
+	check((tick(0u) == 1) && (tick(0u) == 0) && area_shown(0, 24, 16, 2), "0us ticks, basic set on: the switch and one page, then one page");
+
+	panel.clearText();
+	check(!n_over_budget, "small budgets: no tick over its budget (or one page)");
+	check(!n_no_progress, "small budgets: every tick makes progress");
+
+	panel.resetRefreshStats();
+	memset(requested, 0, sizeof(requested));
+	n_small_budget = 0u;
+
+	for(n_tick = 0u; n_tick < CHECK_N_RANDOM_TICKS; n_tick++)
+	{
+		for(n_request = check_random() % 3u; n_request > 0u; n_request--)
+		{
+			cx = (int32_t) (check_random() % 140u) - 8;
+			cy = (int32_t) (check_random() % 70u) - 4;
+			w = (int32_t) (check_random() % 48u) + 1;
+			h = (int32_t) (check_random() % 24u) + 1;
+
+			panel.bufferFillRect(cx, cy, w, h, panel.DRAWMODE_TOGGLE);
+
+			if(!panel.refreshRequest(cx, cy, w, h, (uint8_t) (check_random() % 4u), (check_random() % 200000u))) continue;
+
+			/*Pages are sent whole: the request covers its 16 pixel columns*/
+			for(int32_t y = ((cy < 0) ? 0 : cy); (y < (cy + h)) && (y < 64); y++)
+			{
+				for(int32_t x = (((cx < 0) ? 0 : cx) & ~15); (x < (cx + w)) && (x < 128); x++) requested[y][x] = true;
+			}
+		}
+
+		/*A quarter of the ticks below an instruction set switch + one page*/
+		if(check_random() % 4u) budget_us = check_random() % 12000u;
+		else budget_us = check_random() % 1600u;
+		if(budget_us > max_budget_us) max_budget_us = budget_us;
+
+		tick(budget_us);
+		delayMicroseconds(check_random() % 5000u);
+	}
+
+	panel.getRefreshStats(&stats);
+	check(!n_over_budget, "no tick over its budget (or one page)");
+	check(!n_no_progress, "every tick with a region pending makes progress");
+	check((n_small_budget > 0u), "budgets below one page exercised");
+	check((stats.max_tick_us <= max_budget_us), "longest tick within the largest budget");
+
+	drain();
+
+	for(cy = 0; cy < 64; cy++)
+	{
+		for(cx = 0; cx < 128; cx++)
+		{
+			if(requested[cy][cx] && (emulator.getPixel((uint32_t) cx, (uint32_t) cy) != panel.bufferGetPixel((uint32_t) cx, (uint32_t) cy))) n_request++;
+		}
+	}
+
+	check(!n_request, "every requested area shown once drained");
+	check(!n_over_budget, "no drain tick over its budget");
+
+	printf("refresh random: %u ticks, %u requests (%u coalesced), %u pages, %u missed, longest tick %u us\n", stats.ticks, stats.requests, stats.coalesced, stats.pages, stats.missed, stats.max_tick_us);
+
+	panel.bufferPaintDirty();
+	return;
+}
+
+/*
+ * Status bar: 4 "digits" (8x3 pixels, 3 pages each) of a counter, redrawn every 50ms, due within 50ms.
+ * Graph: rows 16 - 63, redrawn every 500ms, due within 500ms.
+ * returns the number of times a region wasn't shown by the time it's redrawn (its deadline).
+ */
+
+static uint32_t run_scenario(uint32_t budget_us, uint32_t *p_late_status, uint32_t *p_late_graph)
+{
+	uint32_t time_us = 0u;
+	uint32_t counter = 0u;
+	uint32_t n_digit = 0u;
+	uint32_t n_line = 0u;
+
+	panel.refreshCancel();
+	panel.resetRefreshStats();
+	*p_late_status = 0u;
+	*p_late_graph = 0u;
+	n_over_budget = 0u;
+
+	for(time_us = 0u; time_us < CHECK_SCENARIO_US; time_us += CHECK_TICK_PERIOD_US)
+	{
+		if(!(time_us % CHECK_STATUS_PERIOD_US))
+		{
+			if(time_us && !area_shown(0, 0, 128, 8)) (*p_late_status)++;
+
+			counter++;
+			for(n_digit = 0u; n_digit < 4u; n_digit++) panel.bufferFillRect((int32_t) (32u*n_digit + 4u), 2, 8, 3, ((counter >> n_digit) & 1u) ? panel.DRAWMODE_SET : panel.DRAWMODE_CLEAR);
+
+			panel.refreshRequest(0, 0, 128, 8, 10u, CHECK_STATUS_PERIOD_US);
+		}
+
+		if(!(time_us % CHECK_GRAPH_PERIOD_US))
+		{
+			if(time_us && !area_shown(0, 16, 128, 48)) (*p_late_graph)++;
+
+			/*Every page of the graph changes*/
+			panel.bufferFillRect(0, 16, 128, 48, panel.DRAWMODE_TOGGLE);
+			for(n_line = 0u; n_line < 24u; n_line++) panel.bufferDrawLine((int32_t) (check_random() % 128u), (int32_t) (16u + check_random() % 48u), (int32_t) (check_random() % 128u), (int32_t) (16u + check_random() % 48u), panel.DRAWMODE_TOGGLE);
+
+			panel.refreshRequest(0, 16, 128, 48, 1u, CHECK_GRAPH_PERIOD_US);
+		}
+
+		tick(budget_us);
+		delayMicroseconds(CHECK_TICK_PERIOD_US);
+	}
+
+	panel.getRefreshStats(&stats);
+	return stats.missed;
+}
+
+static void check_deadlines(void)
+{
+	uint32_t late_status = 0u;
+	uint32_t late_graph = 0u;
+	uint32_t missed = 0u;
+
+	missed = run_scenario(CHECK_BUDGET_US, &late_status, &late_graph);
+	printf("refresh %uus/tick: %u pages, %u completed, %u missed, status late %u, graph late %u, longest tick %u us\n", CHECK_BUDGET_US, stats.pages, stats.completed, missed, late_status, late_graph, stats.max_tick_us);
+
+	check(!missed, "enough budget: no deadline missed");
+	check(!late_status && !late_graph, "enough budget: everything shown in time");
+	check(!n_over_budget, "enough budget: no tick over budget");
+
+	missed = run_scenario(CHECK_LOW_BUDGET_US, &late_status, &late_graph);
+	printf("refresh %uus/tick: %u pages, %u completed, %u missed, status late %u, graph late %u, longest tick %u us\n", CHECK_LOW_BUDGET_US, stats.pages, stats.completed, missed, late_status, late_graph, stats.max_tick_us);
+
+	check((missed > 0u) && (late_graph > 0u), "low budget: graph deadlines missed and reported");
+	check(!late_status, "low budget: status bar still shown in time");
+	check((missed <= late_graph + 1u) && (missed + 1u >= late_graph), "low budget: each graph deadline missed reported");
+	check(!n_over_budget, "low budget: no tick over budget");
+	return;
+}
+
+int main(void)
+{
+	hostSetPinWriteCostNs(CHECK_PIN_COST_NS);
+
+	check_errors();
+	check_coalescing();
+	check_order();
+	check_budget();
+	check_deadlines();
+
+	check(!emulator.getViolationCount(), "no transfer while busy");
+
+	printf("refresh: %s (%u failures)\n", (n_fail ? "FAIL" : "ok"), n_fail);
+
+	if(n_fail) return 1;
+
+	return 0;
+}
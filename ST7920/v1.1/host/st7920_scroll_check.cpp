@@ -0,0 +1,421 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Vertical scroll check: scrollDisplay() on ST7920 (128x64, folded), ST7920_256x32 and ST7920_192x32, against a model of the screen.
+ *
+ * Random calls: rectangles toggled on the buffer, text lines printed (while the scroll position is a multiple of 16), scrolls up and down
+ * by random amounts (some by a screen or more), CGRAM glyph loads, and paints (bufferPaintDirty(), bufferPaintAll(), bufferPaintBegin()/Step()).
+ * The model moves the graphics and the text along with each scroll, blank rows coming in. A text line stays as long as any of its rows is on screen.
+ *
+ * After every paint, the emulated screen must show the model: every pixel not covered by a model text line, and (scroll position a multiple of 16)
+ * every text line. A scroll must send at most one scroll command (with its instruction set and scroll select), the rows the display can't move
+ * (scrolled into view, or from one half of the screen to the other) and the text lines that move between DDRAM rows.
+ * A glyph loaded after a scroll must land in CGRAM.
+ *
+ * Exit status is 1 if any check fails or the emulator saw a transfer while the display was busy.
+ *
+ * usage: st7920_scroll_check [n_calls]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define CHECK_DB0 2
+#define CHECK_DB1 3
+#define CHECK_DB2 4
+#define CHECK_DB3 5
+#define CHECK_DB4 6
+#define CHECK_DB5 7
+#define CHECK_DB6 8
+#define CHECK_DB7 9
+#define CHECK_RS 10
+#define CHECK_E 11
+
+#define CHECK_MAX_LINES 8u
+
+static ST7920Emulator emulator(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 0xff, CHECK_E);
+
+static ST7920 panel_128x64(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+static ST7920_256x32 panel_256x32(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+static ST7920_192x32 panel_192x32(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+
+/*Graphics model, one byte per pixel (largest panel: 8192 pixels)*/
+static uint8_t model_image[8192];
+
+/*Text model: lines with the screen row of their top (text printed at line L: 16*L)*/
+struct _model_line {
+	bool used;
+	int32_t top;
+	char text[33];
+};
+
+static struct _model_line model_lines[CHECK_MAX_LINES];
+
+static const uint16_t check_glyph[16] = {
+	0x0000, 0x7ffe, 0x4002, 0x4ff2, 0x4812, 0x4bd2, 0x4a52, 0x4a52,
+	0x4a52, 0x4a52, 0x4bd2, 0x4812, 0x4ff2, 0x4002, 0x7ffe, 0x0000
+};
+
+static uint32_t n_calls_total = 5000u;
+static uint32_t check_rand_state = 0x68e31da4u;
+
+/*Totals*/
+static uint32_t n_scrolls = 0u;
+static uint32_t n_scroll_bytes = 0u;
+
+static uint32_t check_random(void)
+{
+	uint32_t x = check_rand_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	check_rand_state = x;
+	return x;
+}
+
+template<class Panel>
+static void model_scroll(Panel &panel, int32_t n_rows)
+{
+	int32_t cy = 0;
+	int32_t src_cy = 0;
+	uint32_t n_line = 0u;
+
+	if(n_rows > 0)
+	{
+		for(cy = 0; cy < ((int32_t) panel.HEIGHT); cy++)
+		{
+			src_cy = cy + n_rows;
+			if(src_cy < ((int32_t) panel.HEIGHT)) memcpy(&model_image[panel.WIDTH*cy], &model_image[panel.WIDTH*src_cy], panel.WIDTH);
+			else memset(&model_image[panel.WIDTH*cy], 0, panel.WIDTH);
+		}
+	}
+	else
+	{
+		for(cy = ((int32_t) panel.HEIGHT) - 1; cy >= 0; cy--)
+		{
+			src_cy = cy + n_rows;
+			if(src_cy >= 0) memcpy(&model_image[panel.WIDTH*cy], &model_image[panel.WIDTH*src_cy], panel.WIDTH);
+			else memset(&model_image[panel.WIDTH*cy], 0, panel.WIDTH);
+		}
+	}
+
+	for(n_line = 0u; n_line < CHECK_MAX_LINES; n_line++)
+	{
+		if(!model_lines[n_line].used) continue;
+
+		model_lines[n_line].top -= n_rows;
+		if((model_lines[n_line].top <= -16) || (model_lines[n_line].top >= ((int32_t) panel.HEIGHT))) model_lines[n_line].used = false;
+	}
+
+	return;
+}
+
+static void model_print(int32_t top, const char *text)
+{
+	uint32_t n_line = 0u;
+	int32_t slot = -1;
+
+	for(n_line = 0u; n_line < CHECK_MAX_LINES; n_line++)
+	{
+		if(model_lines[n_line].used && (model_lines[n_line].top == top)) model_lines[n_line].used = false;
+		if(!model_lines[n_line].used && (slot < 0)) slot = (int32_t) n_line;
+	}
+
+	model_lines[slot].used = true;
+	model_lines[slot].top = top;
+	strcpy(model_lines[slot].text, text);
+
+	return;
+}
+
+/*true if screen row cy is covered by a model text line (other than spaces)*/
+static bool model_text_row(int32_t cy)
+{
+	uint32_t n_line = 0u;
+
+	for(n_line = 0u; n_line < CHECK_MAX_LINES; n_line++)
+	{
+		if(!model_lines[n_line].used) continue;
+		if((cy >= model_lines[n_line].top) && (cy < (model_lines[n_line].top + 16))) return true;
+	}
+
+	return false;
+}
+
+template<class Panel>
+static uint32_t check_screen(Panel &panel, const char *name, uint32_t n_call, const char *call)
+{
+	char shown[40];
+	char expected[40];
+	uint32_t cx = 0u;
+	uint32_t cy = 0u;
+	uint32_t line = 0u;
+	uint32_t n_line = 0u;
+
+	for(cy = 0u; cy < panel.HEIGHT; cy++)
+	{
+		if(model_text_row((int32_t) cy)) continue;
+
+		for(cx = 0u; cx < panel.WIDTH; cx++)
+		{
+			if(emulator.getPixel(cx, cy) == ((int32_t) model_image[panel.WIDTH*cy + cx])) continue;
+
+			printf("%s: call %u (%s): pixel (%u , %u) is %d, expected %u (scroll position %d)\n", name, n_call, call, cx, cy, emulator.getPixel(cx, cy), model_image[panel.WIDTH*cy + cx], panel.getScrollPosition());
+			return 1u;
+		}
+	}
+
+	if(panel.getScrollPosition() % 16) return 0u;
+
+	for(line = 0u; line < panel.N_LINES; line++)
+	{
+		memset(expected, ' ', panel.N_CHARS);
+		expected[panel.N_CHARS] = '\0';
+
+		for(n_line = 0u; n_line < CHECK_MAX_LINES; n_line++)
+		{
+			if(model_lines[n_line].used && (model_lines[n_line].top == ((int32_t) (16u*line)))) strcpy(expected, model_lines[n_line].text);
+		}
+
+		emulator.getTextLine(line, shown);
+		if(!strcmp(shown, expected)) continue;
+
+		printf("%s: call %u (%s): text line %u is \"%s\", expected \"%s\" (scroll position %d)\n", name, n_call, call, line, shown, expected, panel.getScrollPosition());
+		return 1u;
+	}
+
+	return 0u;
+}
+
+template<class Panel>
+static uint32_t check_scroll(Panel &panel, const char *name)
+{
+	static const char alphabet[] = "AB  ab01";
+	char text[40];
+	uint32_t n_call = 0u;
+	uint32_t n_fail = 0u;
+	uint32_t op = 0u;
+	uint32_t n_char = 0u;
+	uint32_t line = 0u;
+	uint32_t n_row = 0u;
+	uint32_t sent = 0u;
+	uint32_t bound = 0u;
+	uint32_t n_halves = 1u;
+	int32_t cx = 0;
+	int32_t cy = 0;
+	int32_t w = 0;
+	int32_t h = 0;
+	int32_t n_rows = 0;
+	int32_t code = 0;
+	bool painted = false;
+	const char *call = NULL;
+
+	emulator.reset();
+	if(!emulator.setPanel(panel.WIDTH, panel.HEIGHT, (panel.HEIGHT > 32u))) return 1u;
+
+	if(!panel.begin()) return 1u;
+
+	panel.setDisplayMode(panel.DISPLAYMODE_DISPLAY_ON_CURSOR_OFF);
+	panel.enableGraphicDisplay(true);
+	panel.clearDisplay();
+
+	memset(model_image, 0, sizeof(model_image));
+	memset(model_lines, 0, sizeof(model_lines));
+
+	if(panel.HEIGHT > 32u) n_halves = 2u;
+
+	for(n_call = 0u; n_call < n_calls_total; n_call++)
+	{
+		op = check_random() % 32u;
+		painted = false;
+
+		if(op < 8u)
+		{
+			cx = ((int32_t) (check_random() % (panel.WIDTH + 16u))) - 8;
+			cy = ((int32_t) (check_random() % (panel.HEIGHT + 16u))) - 8;
+			w = (int32_t) (1u + check_random() % 40u);
+			h = (int32_t) (1u + check_random() % 24u);
+
+			panel.bufferFillRect(cx, cy, w, h, panel.DRAWMODE_TOGGLE);
+
+			for(n_row = 0u; n_row < panel.HEIGHT; n_row++)
+			{
+				if((((int32_t) n_row) < cy) || (((int32_t) n_row) >= (cy + h))) continue;
+
+				for(n_char = 0u; n_char < panel.WIDTH; n_char++)
+				{
+					if((((int32_t) n_char) >= cx) && (((int32_t) n_char) < (cx + w))) model_image[panel.WIDTH*n_row + n_char] ^= 1u;
+				}
+			}
+
+			call = "bufferFillRect";
+		}
+		else if(op < 12u)
+		{
+			/*Text lines are in place only at multiples of 16*/
+			if(panel.getScrollPosition() % 16) continue;
+
+			line = check_random() % panel.N_LINES;
+			for(n_char = 0u; n_char < panel.N_CHARS; n_char++) text[n_char] = alphabet[check_random() % (sizeof(alphabet) - 1u)];
+			text[panel.N_CHARS] = '\0';
+
+			panel.setTextCursorPosition(0u, line);
+			panel.printText(text);
+			model_print((int32_t) (16u*line), text);
+
+			call = "printText";
+		}
+		else if(op < 22u)
+		{
+			/*Small steps, whole text lines, and now and then a screen or more*/
+			n_rows = (int32_t) (1u + check_random() % 20u);
+			if(op < 15u) n_rows = 16;
+			if(op == 21u) n_rows = (int32_t) (panel.HEIGHT + check_random() % 8u);
+			if(check_random() & 0x1) n_rows = -n_rows;
+
+			panel.resetBusByteCount();
+			panel.scrollDisplay(n_rows);
+			sent = panel.getBusByteCount();
+			model_scroll(panel, n_rows);
+
+			/*Scroll command: instruction set, scroll select, scroll address (and back to basic for text). Moved rows. Text lines.*/
+			n_row = (uint32_t) ((n_rows < 0) ? -n_rows : n_rows);
+			if(n_row > panel.HEIGHT) n_row = panel.HEIGHT;
+
+			bound = 4u + n_halves*n_row*(2u + 2u*panel.WIDTH_PAGES) + 3u*n_halves*(2u + panel.N_CHARS);
+			if(n_row >= panel.HEIGHT) bound = 4u + n_halves*(panel.HEIGHT/n_halves)*(2u + 2u*panel.WIDTH_PAGES) + 3u*n_halves*(2u + panel.N_CHARS);
+
+			if(sent > bound)
+			{
+				printf("%s: call %u: scrollDisplay(%d) sent %u bytes, at most %u expected\n", name, n_call, n_rows, sent, bound);
+				n_fail++;
+			}
+
+			n_scrolls++;
+			n_scroll_bytes += sent;
+
+			call = "scrollDisplay";
+		}
+		else if(op < 23u)
+		{
+			code = panel.loadCgramGlyph(check_glyph);
+			panel.invalidateCgramGlyphs();
+
+			for(n_row = 0u; (code >= 0) && (n_row < 16u); n_row++)
+			{
+				if(emulator.getCgramWord(8u*((uint32_t) code) + n_row) == check_glyph[n_row]) continue;
+
+				printf("%s: call %u: glyph row %u not in CGRAM (code 0x%04x, scroll position %d)\n", name, n_call, n_row, code, panel.getScrollPosition());
+				n_fail++;
+				break;
+			}
+
+			call = "loadCgramGlyph";
+		}
+		else if(op < 29u)
+		{
+			panel.bufferPaintDirty();
+			painted = true;
+			call = "bufferPaintDirty";
+		}
+		else if(op < 30u)
+		{
+			panel.bufferPaintAll();
+			painted = true;
+			call = "bufferPaintAll";
+		}
+		else
+		{
+			panel.bufferPaintBegin(false);
+			while(!panel.bufferPaintStep(3000u));
+
+			painted = true;
+			call = "bufferPaintStep";
+		}
+
+		if(painted) n_fail += check_screen(panel, name, n_call, call);
+		if(n_fail > 8u) break;
+	}
+
+	if(emulator.getViolationCount()) n_fail++;
+
+	printf("%s: %s (%u failures)\n", name, (n_fail ? "FAIL" : "ok"), n_fail);
+	return n_fail;
+}
+
+/*Log view: a line of text and 16 rows of graphics scrolled in, by scrolling vs. by redrawing the whole screen*/
+static void report_cost(void)
+{
+	uint32_t scrolled = 0u;
+	uint32_t redrawn = 0u;
+
+	emulator.reset();
+	emulator.setPanel(panel_256x32.WIDTH, panel_256x32.HEIGHT, false);
+
+	panel_256x32.begin();
+	panel_256x32.enableGraphicDisplay(true);
+	panel_256x32.clearDisplay();
+
+	panel_256x32.bufferFillRect(0, 0, 256, 8, panel_256x32.DRAWMODE_SET);
+	panel_256x32.setTextCursorPosition(0u, 1u);
+	panel_256x32.printText("0123456789abcdef");
+	panel_256x32.bufferPaintDirty();
+
+	panel_256x32.resetBusByteCount();
+	panel_256x32.scrollDisplay(16);
+	panel_256x32.bufferFillRect(0, 16, 256, 8, panel_256x32.DRAWMODE_SET);
+	panel_256x32.setTextCursorPosition(0u, 1u);
+	panel_256x32.printText("0123456789abcdef");
+	panel_256x32.bufferPaintDirty();
+	scrolled = panel_256x32.getBusByteCount();
+
+	panel_256x32.resetBusByteCount();
+	panel_256x32.bufferPaintAll();
+	panel_256x32.fillScreenChar(' ');
+	panel_256x32.setTextCursorPosition(0u, 0u);
+	panel_256x32.printText("0123456789abcdef");
+	panel_256x32.setTextCursorPosition(0u, 1u);
+	panel_256x32.printText("0123456789abcdef");
+	redrawn = panel_256x32.getBusByteCount();
+
+	printf("256x32 log view, scrolled by a text line: %u bytes (whole screen redrawn: %u bytes); %u scrolls checked, %u bytes\n", scrolled, redrawn, n_scrolls, n_scroll_bytes);
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t n_fail = 0u;
+
+	if(argc > 1) n_calls_total = (uint32_t) strtoul(argv[1], NULL, 0);
+
+	if(!n_calls_total)
+	{
+		fprintf(stderr, "st7920_scroll_check: invalid number of calls\n");
+		return 2;
+	}
+
+	n_fail += check_scroll(panel_128x64, "128x64");
+	n_fail += check_scroll(panel_256x32, "256x32");
+	n_fail += check_scroll(panel_192x32, "192x32");
+
+	report_cost();
+
+	if(emulator.getViolationCount()) n_fail++;
+
+	if(n_fail) return 1;
+
+	return 0;
+}
@@ -0,0 +1,320 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Serial interface check (ST7920SerialBus), on emulated 128x64 displays with the simulated clock.
+ *
+ * The same graphics and text are sent to a display on the serial interface and to one on the parallel bus: both must show the same
+ * image and text, and hold the buffer. Every SPI byte is decoded on the way: each chip select window must start with a sync byte,
+ * and a sync byte is only sent when RS changes (never twice for the same RS in a window). Text lines printed without and within a
+ * transaction (and nested transactions) must take the expected number of sync bytes and chip select windows.
+ *
+ * Exit status is 1 if any check fails.
+ *
+ * usage: st7920_serial_check
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <Arduino.h>
+#include <SPI.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define CHECK_DB0 2
+#define CHECK_DB1 3
+#define CHECK_DB2 4
+#define CHECK_DB3 5
+#define CHECK_DB4 6
+#define CHECK_DB5 7
+#define CHECK_DB6 8
+#define CHECK_DB7 9
+#define CHECK_RS 10
+#define CHECK_E 11
+#define CHECK_CS 12
+
+#define CHECK_PIN_COST_NS 40u
+
+/*
+ * Decodes the SPI bytes sent with CS high: sync bytes (11111 RW RS 0) and data frames (a nibble in the high bits, low bits 0).
+ */
+
+class CheckSyncCounter : public HostDevice {
+	public:
+		void pinChanged(uint8_t pin, uint8_t level)
+		{
+			if(pin != CHECK_CS) return;
+
+			this->_selected = (level != 0u);
+			if(!this->_selected)
+			{
+				this->n_releases++;
+				return;
+			}
+
+			this->n_windows++;
+			this->_rs = -1;
+			return;
+		}
+
+		void spiTransfer(uint8_t byte)
+		{
+			if(!this->_selected) return;
+
+			if((byte & 0xf9) == 0xf8)
+			{
+				this->n_syncs++;
+
+				/*Same RS as the last sync in this window: not needed*/
+				if(((int32_t) ((byte >> 1) & 0x1)) == this->_rs) this->n_redundant++;
+
+				this->_rs = (int32_t) ((byte >> 1) & 0x1);
+				return;
+			}
+
+			this->n_frames++;
+			if(this->_rs < 0) this->n_unsynced++;
+
+			return;
+		}
+
+		void reset(void)
+		{
+			this->n_windows = 0u;
+			this->n_releases = 0u;
+			this->n_syncs = 0u;
+			this->n_frames = 0u;
+			this->n_redundant = 0u;
+			this->n_unsynced = 0u;
+			return;
+		}
+
+		uint32_t n_windows = 0u;
+		uint32_t n_releases = 0u;
+		uint32_t n_syncs = 0u;
+		uint32_t n_frames = 0u;
+		uint32_t n_redundant = 0u; /*Sync bytes repeating the RS already set in the window*/
+		uint32_t n_unsynced = 0u; /*Frames sent before any sync byte in the window*/
+
+	private:
+		bool _selected = false;
+		int32_t _rs = -1;
+};
+
+static ST7920Emulator parallel_emulator(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 0xff, CHECK_E);
+static ST7920Emulator serial_emulator(CHECK_CS);
+
+static ST7920 parallel_panel(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+static ST7920 serial_panel(CHECK_CS, SPI);
+
+static CheckSyncCounter sync_counter;
+
+static uint32_t n_fail = 0u;
+
+static void check(bool ok, const char *what)
+{
+	if(ok) return;
+
+	printf("FAIL: %s\n", what);
+	n_fail++;
+	return;
+}
+
+/*Makes the same calls on either panel: graphics, text, wide characters. returns the simulated time taken (ns).*/
+static uint64_t check_script(ST7920 &panel)
+{
+	uint32_t rand_state = 0x68e31da4u;
+	uint32_t n_pixel = 0u;
+	uint64_t start_ns = hostGetTimeNs();
+
+	panel.clearDisplay();
+	panel.enableGraphicDisplay(true);
+
+	for(n_pixel = 0u; n_pixel < 600u; n_pixel++)
+	{
+		rand_state ^= rand_state << 13;
+		rand_state ^= rand_state >> 17;
+		rand_state ^= rand_state << 5;
+
+		panel.bufferSetPixel((rand_state % panel.WIDTH), ((rand_state >> 16) % panel.HEIGHT), true);
+	}
+
+	panel.bufferPaintDirty();
+	panel.bufferDrawCircle(64, 32, 20u, panel.DRAWMODE_TOGGLE);
+	panel.bufferFillRect(90, 40, 30, 20, panel.DRAWMODE_TOGGLE);
+	panel.bufferPaintDirty();
+
+	panel.setTextCursorPosition(2u, 0u);
+	panel.printText("Serial bus");
+	panel.setTextCursorPosition(0u, 3u);
+	panel.printText("0123456789abcdef");
+	panel.setWTextCursorPosition(3u, 1u);
+	panel.printWChar(('[' << 8) | ']');
+
+	return (hostGetTimeNs() - start_ns);
+}
+
+/*returns true if the display RAM holds the panel buffer (not scrolled)*/
+static bool check_buffer_shown(ST7920 &panel, ST7920Emulator &emulator)
+{
+	uint32_t cy = 0u;
+	uint32_t page = 0u;
+
+	for(cy = 0u; cy < panel.HEIGHT; cy++)
+	{
+		for(page = 0u; page < panel.WIDTH_PAGES; page++)
+		{
+			if(emulator.getGdramWord((cy % 32u), ((cy/32u)*panel.WIDTH_PAGES + page)) != (uint16_t) panel.bufferGetPage(page, cy)) return false;
+		}
+	}
+
+	return true;
+}
+
+static void check_image(void)
+{
+	static uint8_t parallel_image[ST7920Emulator::IMAGE_SIZE_BYTES];
+	static uint8_t serial_image[ST7920Emulator::IMAGE_SIZE_BYTES];
+	uint64_t parallel_ns = 0u;
+	uint64_t serial_ns = 0u;
+	uint32_t n_line = 0u;
+	char parallel_line[40];
+	char serial_line[40];
+	bool same_text = true;
+
+	check(parallel_panel.begin(), "parallel: begin()");
+	check(serial_panel.begin(), "serial: begin()");
+
+	parallel_emulator.resetCounters();
+	serial_emulator.resetCounters();
+	sync_counter.reset();
+
+	parallel_ns = check_script(parallel_panel);
+	serial_ns = check_script(serial_panel);
+
+	parallel_emulator.render(parallel_image);
+	serial_emulator.render(serial_image);
+
+	for(n_line = 0u; n_line < 4u; n_line++)
+	{
+		parallel_emulator.getTextLine(n_line, parallel_line);
+		serial_emulator.getTextLine(n_line, serial_line);
+
+		if(strcmp(parallel_line, serial_line)) same_text = false;
+	}
+
+	check(!memcmp(parallel_image, serial_image, sizeof(parallel_image)), "serial: same image as on the parallel bus");
+	check(same_text, "serial: same text as on the parallel bus");
+	check(check_buffer_shown(serial_panel, serial_emulator), "serial: display holds the buffer");
+	check(check_buffer_shown(parallel_panel, parallel_emulator), "parallel: display holds the buffer");
+
+	/*Same instructions and data on both, each byte as two frames on the serial interface*/
+	check((serial_emulator.getInstructionCount() == parallel_emulator.getInstructionCount()) && (serial_emulator.getDataByteCount() == parallel_emulator.getDataByteCount()), "serial: same instructions and data bytes as parallel");
+	check((sync_counter.n_frames == 2u*(serial_emulator.getInstructionCount() + serial_emulator.getDataByteCount())), "serial: two frames per byte");
+	check(!sync_counter.n_unsynced, "serial: every chip select window starts with a sync byte");
+	check(!sync_counter.n_redundant, "serial: a sync byte only when RS changes");
+
+	printf("script: parallel %.2f ms, serial %.2f ms, %u bytes in %u windows with %u sync bytes\n", (((double) parallel_ns)/1e6), (((double) serial_ns)/1e6), (sync_counter.n_frames/2u), sync_counter.n_windows, sync_counter.n_syncs);
+	return;
+}
+
+/*4 lines, each an address set (instruction) then 16 characters (data): 8 RS changes*/
+static void check_lines(bool transaction, const char *text)
+{
+	uint32_t n_line = 0u;
+
+	if(transaction) serial_panel.beginTransaction();
+
+	for(n_line = 0u; n_line < 4u; n_line++)
+	{
+		serial_panel.setTextCursorPosition(0u, n_line);
+		serial_panel.printText(text);
+	}
+
+	if(transaction) serial_panel.endTransaction();
+
+	return;
+}
+
+static void check_sync_counts(void)
+{
+	uint32_t instructions = 0u;
+
+	/*Cursor not shown (cursor moves go with the next text), text shown: each line is exactly one address set and its 16 characters*/
+	serial_panel.setDisplayMode(serial_panel.DISPLAYMODE_DISPLAY_ON_CURSOR_OFF);
+	serial_panel.clearText();
+	check_lines(false, "----------------");
+
+	/*Without a transaction: one window per bus write, one sync byte each*/
+	sync_counter.reset();
+	serial_emulator.resetCounters();
+	check_lines(false, "abcdefghijklmnop");
+	instructions = serial_emulator.getInstructionCount();
+
+	check((instructions == 4u) && (serial_emulator.getDataByteCount() == 64u), "4 lines: 4 address sets, 64 characters");
+	check((sync_counter.n_windows == 8u) && (sync_counter.n_syncs == 8u), "4 lines, no transaction: 8 windows, 8 sync bytes");
+
+	printf("4 lines, no transaction: %u windows, %u sync bytes\n", sync_counter.n_windows, sync_counter.n_syncs);
+
+	/*Within one transaction: one window, a sync byte per RS change*/
+	sync_counter.reset();
+	serial_emulator.resetCounters();
+	check_lines(true, "ABCDEFGHIJKLMNOP");
+
+	check((serial_emulator.getInstructionCount() == instructions) && (serial_emulator.getDataByteCount() == 64u), "4 lines, transaction: same instructions and data");
+	check((sync_counter.n_windows == 1u) && (sync_counter.n_syncs == 8u), "4 lines, transaction: 1 window, 8 sync bytes");
+
+	printf("4 lines, transaction: %u windows, %u sync bytes\n", sync_counter.n_windows, sync_counter.n_syncs);
+
+	/*Two prints in a row: the second goes on from where the first stopped, data only, no sync byte*/
+	sync_counter.reset();
+	serial_emulator.resetCounters();
+	serial_panel.beginTransaction();
+	serial_panel.setTextCursorPosition(0u, 0u);
+	serial_panel.printText("01234567");
+	serial_panel.printText("89abcdef");
+	serial_panel.endTransaction();
+
+	check((serial_emulator.getInstructionCount() == 1u) && (serial_emulator.getDataByteCount() == 16u), "two prints in a row: 1 address set, 16 characters");
+	check((sync_counter.n_windows == 1u) && (sync_counter.n_syncs == 2u), "two prints in a row, transaction: 1 window, 2 sync bytes");
+
+	/*Nested: chip select held until the outermost endTransaction()*/
+	sync_counter.reset();
+	serial_panel.beginTransaction();
+	serial_panel.beginTransaction();
+	check_lines(false, "abcdefghijklmnop");
+	serial_panel.endTransaction();
+
+	check((sync_counter.n_windows == 1u) && !sync_counter.n_releases, "nested transaction: chip select held by the outer one");
+
+	check_lines(false, "ABCDEFGHIJKLMNOP");
+	serial_panel.endTransaction();
+
+	check((sync_counter.n_windows == 1u) && (sync_counter.n_releases == 1u) && (sync_counter.n_syncs == 16u), "nested transaction: 1 window, 16 sync bytes");
+
+	check(!sync_counter.n_redundant && !sync_counter.n_unsynced, "sync bytes: one per RS change, every window synced");
+	return;
+}
+
+int main(void)
+{
+	hostSetPinWriteCostNs(CHECK_PIN_COST_NS);
+	hostAttachDevice(&sync_counter);
+
+	check_image();
+	check_sync_counts();
+
+	check(!parallel_emulator.getViolationCount() && !serial_emulator.getViolationCount(), "no transfer while busy");
+
+	printf("serial: %s (%u failures)\n", (n_fail ? "FAIL" : "ok"), n_fail);
+
+	if(n_fail) return 1;
+
+	return 0;
+}
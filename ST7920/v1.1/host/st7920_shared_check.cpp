@@ -0,0 +1,415 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Shared bus check: three displays (128x64, 256x32, 192x32) on one ST7920SharedBus, DB0 - DB7 and RS common, one E pin each.
+ *
+ * Workloads: full paints (queued in slices, round robin, with bufferPaintBegin()/bufferPaintStep()), status bar updates (bufferPaintDirty())
+ * and text pages (clearText(), printText()). Each one runs on every display alone, then on all three at once.
+ * Every display must show its own buffer and text, with no transfer sent while it was busy. All three at once must take no more than
+ * CHECK_MAX_OVERLAP_PCT percent of the slowest display alone (sequential: the sum of the three).
+ * Also checks that E pins used twice (or shared with the data lines) are rejected, and compares one display alone with the plain
+ * parallel bus.
+ *
+ * Prints the simulated time of each workload: each display alone, their sum, and all three at once.
+ * Exit status is 1 if any check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define CHECK_DB0 2
+#define CHECK_DB1 3
+#define CHECK_DB2 4
+#define CHECK_DB3 5
+#define CHECK_DB4 6
+#define CHECK_DB5 7
+#define CHECK_DB6 8
+#define CHECK_DB7 9
+#define CHECK_RS 10
+#define CHECK_E_A 11
+#define CHECK_E_B 12
+#define CHECK_E_C 13
+
+#define CHECK_N_DISPLAYS 3u
+#define CHECK_ALL_DISPLAYS 0x7u
+
+/*bufferPaintStep() budget: ~13 pages per display per step*/
+#define CHECK_STEP_BUDGET_US 4000u
+
+#define CHECK_STATUS_ROUNDS 20u
+
+/*All displays at once, in percent of the slowest display alone*/
+#define CHECK_MAX_OVERLAP_PCT 120u
+
+/*One display alone on the shared bus, in percent of the same work on the plain parallel bus*/
+#define CHECK_MAX_ALONE_PCT 110u
+
+static ST7920Emulator emulator_a(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 0xff, CHECK_E_A);
+static ST7920Emulator emulator_b(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 0xff, CHECK_E_B);
+static ST7920Emulator emulator_c(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 0xff, CHECK_E_C);
+
+static ST7920SharedBus shared_bus(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS);
+static ST7920SharedBusDisplay bus_a(shared_bus, CHECK_E_A);
+static ST7920SharedBusDisplay bus_b(shared_bus, CHECK_E_B);
+static ST7920SharedBusDisplay bus_c(shared_bus, CHECK_E_C);
+
+static ST7920 panel_a(bus_a);
+static ST7920_256x32 panel_b(bus_b);
+static ST7920_192x32 panel_c(bus_c);
+
+static ST7920Emulator *emulators[CHECK_N_DISPLAYS] = {&emulator_a, &emulator_b, &emulator_c};
+static const char *panel_names[CHECK_N_DISPLAYS] = {"128x64", "256x32", "192x32"};
+
+static uint32_t check_rand_state = 0x3c6ef372u;
+
+static uint32_t check_random(void)
+{
+	uint32_t x = check_rand_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	check_rand_state = x;
+	return x;
+}
+
+template<class Panel>
+static void draw_random(Panel &panel)
+{
+	uint32_t cy = 0u;
+	uint32_t page_index = 0u;
+
+	for(cy = 0u; cy < panel.HEIGHT; cy++)
+	{
+		for(page_index = 0u; page_index < panel.WIDTH_PAGES; page_index++) panel.bufferSetPage(page_index, cy, (uint16_t) (check_random() | 1u));
+	}
+
+	return;
+}
+
+template<class Panel>
+static void draw_status(Panel &panel, uint32_t round)
+{
+	panel.bufferFillRect(0, 0, panel.WIDTH, 8, panel.DRAWMODE_CLEAR);
+	panel.bufferFillRect((int32_t) ((round*12u) % (panel.WIDTH - 24u)), 1, 24, 6, panel.DRAWMODE_SET);
+	return;
+}
+
+template<class Panel>
+static void print_text_page(Panel &panel, uint32_t display)
+{
+	char text[33];
+	uint32_t line = 0u;
+	uint32_t n_char = 0u;
+
+	panel.clearText();
+
+	for(line = 0u; line < panel.N_LINES; line++)
+	{
+		for(n_char = 0u; n_char < panel.N_CHARS; n_char++) text[n_char] = (char) ('A' + (display*5u + line*7u + n_char) % 26u);
+		text[n_char] = '\0';
+
+		panel.setTextCursorPosition(0u, line);
+		panel.printText(text);
+	}
+
+	return;
+}
+
+template<class Panel>
+static uint32_t check_screen(Panel &panel, uint32_t display, const char *workload)
+{
+	ST7920Emulator *emulator = emulators[display];
+	uint32_t cx = 0u;
+	uint32_t cy = 0u;
+	uint32_t n_wrong = 0u;
+
+	for(cy = 0u; cy < panel.HEIGHT; cy++)
+	{
+		for(cx = 0u; cx < panel.WIDTH; cx++) if(emulator->getPixel(cx, cy) != panel.bufferGetPixel(cx, cy)) n_wrong++;
+	}
+
+	if(!n_wrong) return 0u;
+
+	printf("%s: %s: %u pixels wrong\n", panel_names[display], workload, n_wrong);
+	return 1u;
+}
+
+template<class Panel>
+static uint32_t check_text(Panel &panel, uint32_t display)
+{
+	char text[33];
+	char shown[33];
+	uint32_t line = 0u;
+	uint32_t n_char = 0u;
+	uint32_t n_fail = 0u;
+
+	for(line = 0u; line < panel.N_LINES; line++)
+	{
+		for(n_char = 0u; n_char < panel.N_CHARS; n_char++) text[n_char] = (char) ('A' + (display*5u + line*7u + n_char) % 26u);
+		text[n_char] = '\0';
+
+		emulators[display]->getTextLine(line, shown);
+		if(strcmp(shown, text))
+		{
+			printf("%s: text line %u: \"%s\", expected \"%s\"\n", panel_names[display], line, shown, text);
+			n_fail++;
+		}
+	}
+
+	return n_fail;
+}
+
+/*Full paint of the displays in mask, queued round robin in bufferPaintStep() slices. returns the simulated time (ns).*/
+static uint64_t run_full(uint32_t mask)
+{
+	uint64_t start_ns = 0u;
+	bool done = false;
+
+	if(mask & 0x1u) draw_random(panel_a);
+	if(mask & 0x2u) draw_random(panel_b);
+	if(mask & 0x4u) draw_random(panel_c);
+
+	start_ns = hostGetTimeNs();
+
+	if(mask & 0x1u) panel_a.bufferPaintBegin(true);
+	if(mask & 0x2u) panel_b.bufferPaintBegin(true);
+	if(mask & 0x4u) panel_c.bufferPaintBegin(true);
+
+	while(!done)
+	{
+		done = true;
+		if((mask & 0x1u) && (panel_a.bufferPaintStep(CHECK_STEP_BUDGET_US) != 1)) done = false;
+		if((mask & 0x2u) && (panel_b.bufferPaintStep(CHECK_STEP_BUDGET_US) != 1)) done = false;
+		if((mask & 0x4u) && (panel_c.bufferPaintStep(CHECK_STEP_BUDGET_US) != 1)) done = false;
+	}
+
+	shared_bus.flush();
+
+	return hostGetTimeNs() - start_ns;
+}
+
+/*Status bar updates of the displays in mask, one bufferPaintDirty() per display per round. returns the simulated time (ns).*/
+static uint64_t run_status(uint32_t mask)
+{
+	uint64_t start_ns = hostGetTimeNs();
+	uint32_t round = 0u;
+
+	for(round = 0u; round < CHECK_STATUS_ROUNDS; round++)
+	{
+		if(mask & 0x1u)
+		{
+			draw_status(panel_a, round);
+			panel_a.bufferPaintDirty();
+		}
+
+		if(mask & 0x2u)
+		{
+			draw_status(panel_b, round);
+			panel_b.bufferPaintDirty();
+		}
+
+		if(mask & 0x4u)
+		{
+			draw_status(panel_c, round);
+			panel_c.bufferPaintDirty();
+		}
+
+		shared_bus.flush();
+	}
+
+	return hostGetTimeNs() - start_ns;
+}
+
+/*Text page (clear + every line) on the displays in mask. returns the simulated time (ns).*/
+static uint64_t run_text(uint32_t mask)
+{
+	uint64_t start_ns = hostGetTimeNs();
+
+	if(mask & 0x1u) print_text_page(panel_a, 0u);
+	if(mask & 0x2u) print_text_page(panel_b, 1u);
+	if(mask & 0x4u) print_text_page(panel_c, 2u);
+
+	shared_bus.flush();
+
+	return hostGetTimeNs() - start_ns;
+}
+
+static uint64_t run_workload(uint32_t workload, uint32_t mask)
+{
+	if(workload == 0u) return run_full(mask);
+	if(workload == 1u) return run_status(mask);
+
+	return run_text(mask);
+}
+
+static uint32_t check_displays(uint32_t workload, const char *name)
+{
+	uint32_t n_fail = 0u;
+
+	if(workload == 2u)
+	{
+		n_fail += check_text(panel_a, 0u);
+		n_fail += check_text(panel_b, 1u);
+		n_fail += check_text(panel_c, 2u);
+		return n_fail;
+	}
+
+	n_fail += check_screen(panel_a, 0u, name);
+	n_fail += check_screen(panel_b, 1u, name);
+	n_fail += check_screen(panel_c, 2u, name);
+
+	return n_fail;
+}
+
+static uint32_t check_workload(uint32_t workload, const char *name)
+{
+	uint64_t alone_ns[CHECK_N_DISPLAYS];
+	uint64_t sum_ns = 0u;
+	uint64_t max_ns = 0u;
+	uint64_t all_ns = 0u;
+	uint32_t display = 0u;
+	uint32_t n_fail = 0u;
+
+	for(display = 0u; display < CHECK_N_DISPLAYS; display++)
+	{
+		alone_ns[display] = run_workload(workload, (1u << display));
+
+		sum_ns += alone_ns[display];
+		if(alone_ns[display] > max_ns) max_ns = alone_ns[display];
+	}
+
+	n_fail += check_displays(workload, name);
+
+	all_ns = run_workload(workload, CHECK_ALL_DISPLAYS);
+
+	n_fail += check_displays(workload, name);
+
+	printf("%s: alone %.2f / %.2f / %.2f ms, sequential %.2f ms, shared %.2f ms (%.0f%% of the slowest alone, %.2fx faster than sequential)\n", name,
+		alone_ns[0]/1e6, alone_ns[1]/1e6, alone_ns[2]/1e6, sum_ns/1e6, all_ns/1e6, (100.0*all_ns)/max_ns, ((double) sum_ns)/all_ns);
+
+	if((100u*all_ns) > (CHECK_MAX_OVERLAP_PCT*max_ns))
+	{
+		printf("%s: all displays at once take more than %u%% of the slowest alone\n", name, CHECK_MAX_OVERLAP_PCT);
+		n_fail++;
+	}
+
+	return n_fail;
+}
+
+/*Bad E pins: already used by another display on the bus, or one of the shared lines*/
+static uint32_t check_pins(void)
+{
+	ST7920SharedBusDisplay bus_dup(shared_bus, CHECK_E_B);
+	ST7920SharedBusDisplay bus_data(shared_bus, CHECK_DB3);
+	ST7920SharedBusDisplay bus_rs(shared_bus, CHECK_RS);
+	uint32_t n_fail = 0u;
+
+	if(bus_dup.begin()) n_fail++;
+	if(bus_data.begin()) n_fail++;
+	if(bus_rs.begin()) n_fail++;
+
+	/*begin() again on a display already on the bus*/
+	if(!bus_a.begin()) n_fail++;
+
+	if(shared_bus.getDisplayCount() != CHECK_N_DISPLAYS) n_fail++;
+
+	if(n_fail) printf("pins: %u failures\n", n_fail);
+	return n_fail;
+}
+
+/*One display alone: shared bus against the plain parallel bus (same panel, same work)*/
+static uint32_t check_alone(void)
+{
+	ST7920 direct(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E_A);
+	uint64_t shared_ns = 0u;
+	uint64_t direct_ns = 0u;
+	uint64_t start_ns = 0u;
+	uint32_t n_fail = 0u;
+
+	shared_ns = run_full(0x1u);
+
+	/*The text page workload left text on screen*/
+	direct.begin();
+	direct.clearText();
+	direct.enableGraphicDisplay(true);
+	direct.bufferPaintAll();
+
+	draw_random(direct);
+
+	start_ns = hostGetTimeNs();
+	direct.bufferPaintAll();
+	direct_ns = hostGetTimeNs() - start_ns;
+
+	n_fail += check_screen(direct, 0u, "direct");
+
+	printf("128x64 full paint alone: shared bus %.2f ms, parallel bus %.2f ms\n", shared_ns/1e6, direct_ns/1e6);
+
+	if((100u*shared_ns) > (CHECK_MAX_ALONE_PCT*direct_ns))
+	{
+		printf("one display alone takes more than %u%% of the parallel bus time\n", CHECK_MAX_ALONE_PCT);
+		n_fail++;
+	}
+
+	return n_fail;
+}
+
+int main(void)
+{
+	uint32_t display = 0u;
+	uint32_t n_fail = 0u;
+
+	/*Pin writes aren't free: the interleaved transfers have to fit in the command delays*/
+	hostSetPinWriteCostNs(50u);
+
+	emulator_b.setPanel(256u, 32u, false);
+	emulator_c.setPanel(192u, 32u, false);
+
+	if(!panel_a.begin() || !panel_b.begin() || !panel_c.begin())
+	{
+		printf("begin() failed\n");
+		return 1;
+	}
+
+	panel_a.enableGraphicDisplay(true);
+	panel_b.enableGraphicDisplay(true);
+	panel_c.enableGraphicDisplay(true);
+	shared_bus.flush();
+
+	n_fail += check_pins();
+
+	n_fail += check_workload(0u, "full paint");
+	n_fail += check_workload(1u, "status bar");
+	n_fail += check_workload(2u, "text page");
+
+	for(display = 0u; display < CHECK_N_DISPLAYS; display++)
+	{
+		if(!emulators[display]->getViolationCount()) continue;
+
+		printf("%s: %u transfers sent while busy\n", panel_names[display], emulators[display]->getViolationCount());
+		n_fail++;
+	}
+
+	/*Last: the plain bus leaves the shared bus display state cache stale*/
+	n_fail += check_alone();
+
+	if(emulator_a.getViolationCount()) n_fail++;
+
+	printf("shared bus: %s (%u failures)\n", (n_fail ? "FAIL" : "ok"), n_fail);
+
+	if(n_fail) return 1;
+
+	return 0;
+}
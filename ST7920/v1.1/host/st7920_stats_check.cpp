@@ -0,0 +1,308 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Performance counter check (build with -DST7920_STATS).
+ *
+ * ST7920Stats alone: histogram buckets, call counting and nesting, transfers inside and outside calls, delay/pin time split, reset,
+ * method names.
+ * On the driver (emulated 128x64 display, simulated clock: 600 cycles per microsecond): each counted call must report the bytes and
+ * commands it sent (as getBusByteCount()/getBusCommandCount()), the time the bus spent in delays (as the host clock), the rest as pin time,
+ * its instruction set switches, and its duration in the right histogram bucket. Public methods calling each other are counted once.
+ *
+ * Exit status is 1 if any check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#ifndef ST7920_STATS
+#error "st7920_stats_check: build with -DST7920_STATS"
+#endif
+
+#define CHECK_DB0 2
+#define CHECK_DB1 3
+#define CHECK_DB2 4
+#define CHECK_DB3 5
+#define CHECK_DB4 6
+#define CHECK_DB5 7
+#define CHECK_DB6 8
+#define CHECK_DB7 9
+#define CHECK_RS 10
+#define CHECK_E 11
+
+#define CHECK_PIN_COST_NS 40u
+
+static ST7920Emulator emulator(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 0xff, CHECK_E);
+static ST7920 panel(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+
+static struct _st7920_stats stats;
+
+static uint32_t n_fail = 0u;
+
+static void check(bool ok, const char *what)
+{
+	if(ok) return;
+
+	printf("FAIL: %s\n", what);
+	n_fail++;
+	return;
+}
+
+static void check_stats_alone(void)
+{
+	ST7920Stats counters;
+	struct _st7920_method_stats *p_method = NULL;
+	uint32_t n_method = 0u;
+	uint32_t other = 0u;
+	bool names_ok = true;
+
+	/*Buckets: 2^(n - 1) <= cycles < 2^n*/
+	check((ST7920Stats::getHistogramBucket(0u) == 0u), "bucket of 0 cycles");
+	check((ST7920Stats::getHistogramBucket(1u) == 1u), "bucket of 1 cycle");
+	check((ST7920Stats::getHistogramBucket(2u) == 2u), "bucket of 2 cycles");
+	check((ST7920Stats::getHistogramBucket(3u) == 2u), "bucket of 3 cycles");
+	check((ST7920Stats::getHistogramBucket(1023u) == 10u), "bucket of 1023 cycles");
+	check((ST7920Stats::getHistogramBucket(1024u) == 11u), "bucket of 1024 cycles");
+	check((ST7920Stats::getHistogramBucket(0x20000000u) == 30u), "bucket of 2^29 cycles");
+	check((ST7920Stats::getHistogramBucket(0xffffffffu) == (ST7920_STATS_HISTOGRAM_SIZE - 1u)), "last bucket");
+
+	check((ST7920Stats::getCyclesPerUs() == 600u), "cycles per us");
+
+	/*One call: 10us -> 6000 cycles (bucket 13)*/
+	counters.enter(ST7920_STATS_BUFFER_PAINT_ALL);
+	delayMicroseconds(10u);
+	counters.leave();
+
+	counters.getSnapshot(&stats);
+	p_method = &stats.methods[ST7920_STATS_BUFFER_PAINT_ALL];
+
+	check((stats.cycles_per_us == 600u), "snapshot cycles per us");
+	check((p_method->calls == 1u), "call count");
+	check((p_method->total_cycles == 6000u) && (p_method->max_cycles == 6000u), "call cycles");
+	check((p_method->histogram[13] == 1u), "call histogram");
+
+	/*Nested: counted as the outer call only, transfers included*/
+	counters.enter(ST7920_STATS_PRINT_TEXT);
+	counters.enter(ST7920_STATS_PRINT_CHAR);
+	counters.countTransfer(true, 4u, 0u, 600u);
+	counters.countModeSwitch();
+	counters.leave();
+	counters.countTransfer(false, 2u, 200u, 150000u);
+	counters.leave();
+
+	/*Transfer outside any call*/
+	counters.countTransfer(false, 3u, 0u, 0u);
+
+	/*Extra leave() is ignored*/
+	counters.leave();
+
+	counters.getSnapshot(&stats);
+	p_method = &stats.methods[ST7920_STATS_PRINT_TEXT];
+
+	check((p_method->calls == 1u), "nested: outer call count");
+	check((stats.methods[ST7920_STATS_PRINT_CHAR].calls == 0u) && (stats.methods[ST7920_STATS_PRINT_CHAR].bytes == 0u), "nested: inner call not counted");
+	check((p_method->bytes == 6u) && (p_method->commands == 2u), "nested: bytes and commands");
+	check((p_method->mode_switches == 1u), "nested: mode switches");
+	check((p_method->delay_us == 200u), "delay time");
+	check((p_method->pin_us == 51u), "pin time (251us of bus, 200us delays)");
+	check((stats.methods[ST7920_STATS_OTHER].bytes == 3u) && (stats.methods[ST7920_STATS_OTHER].commands == 3u), "transfer outside calls");
+	check((stats.methods[ST7920_STATS_OTHER].calls == 0u), "no call for transfers outside calls");
+
+	/*Out of range method*/
+	counters.enter(ST7920_STATS_N_METHODS + 5u);
+	counters.leave();
+	counters.getSnapshot(&stats);
+	check((stats.methods[ST7920_STATS_OTHER].calls == 1u), "out of range method counted as other");
+
+	counters.reset();
+	counters.getSnapshot(&stats);
+
+	for(n_method = 0u; n_method < ST7920_STATS_N_METHODS; n_method++) other |= stats.methods[n_method].calls | stats.methods[n_method].bytes;
+	check(!other && (stats.cycles_per_us == 600u), "reset");
+
+	for(n_method = 0u; n_method < ST7920_STATS_N_METHODS; n_method++)
+	{
+		if(!strlen(ST7920Stats::getMethodName(n_method))) names_ok = false;
+
+		for(other = 0u; other < n_method; other++) if(!strcmp(ST7920Stats::getMethodName(n_method), ST7920Stats::getMethodName(other))) names_ok = false;
+	}
+
+	check(names_ok, "method names");
+	check(!strcmp(ST7920Stats::getMethodName(ST7920_STATS_BUFFER_PAINT_ALL), "bufferPaintAll"), "method name");
+	check(!strcmp(ST7920Stats::getMethodName(ST7920_STATS_SCROLL_DISPLAY), "scrollDisplay"), "method name");
+	check(!strcmp(ST7920Stats::getMethodName(ST7920_STATS_N_METHODS), ""), "invalid method name");
+
+	return;
+}
+
+/*
+ * Bus activity of a single call, measured around it.
+ */
+
+struct _call_measure {
+	uint64_t start_ns;
+	uint64_t start_delay_us;
+	uint32_t start_bytes;
+	uint32_t start_commands;
+	uint32_t start_mode_switches;
+};
+
+static void measure_begin(struct _call_measure *p_measure)
+{
+	p_measure->start_ns = hostGetTimeNs();
+	p_measure->start_delay_us = hostGetDelayUs();
+	p_measure->start_bytes = panel.getBusByteCount();
+	p_measure->start_commands = panel.getBusCommandCount();
+	p_measure->start_mode_switches = emulator.getModeSwitchCount();
+	return;
+}
+
+/*The counters of method must show exactly one call, matching the measure*/
+static void measure_check(const struct _call_measure *p_measure, uint32_t method, const char *name)
+{
+	struct _st7920_method_stats *p_method = NULL;
+	uint64_t time_ns = hostGetTimeNs() - p_measure->start_ns;
+	uint64_t delay_us = hostGetDelayUs() - p_measure->start_delay_us;
+	uint64_t pin_us = (time_ns - 1000u*delay_us)/1000u;
+	uint32_t cycles = (uint32_t) (time_ns*600u/1000u);
+	uint32_t mode_switches = emulator.getModeSwitchCount() - p_measure->start_mode_switches;
+	char what[96];
+
+	panel.getStats(&stats);
+	p_method = &stats.methods[method];
+
+	snprintf(what, sizeof(what), "%s: call count", name);
+	check((p_method->calls == 1u), what);
+
+	snprintf(what, sizeof(what), "%s: bytes (%u, sent %u)", name, p_method->bytes, (panel.getBusByteCount() - p_measure->start_bytes));
+	check((p_method->bytes == (panel.getBusByteCount() - p_measure->start_bytes)), what);
+
+	snprintf(what, sizeof(what), "%s: commands (%u, sent %u)", name, p_method->commands, (panel.getBusCommandCount() - p_measure->start_commands));
+	check((p_method->commands == (panel.getBusCommandCount() - p_measure->start_commands)), what);
+
+	snprintf(what, sizeof(what), "%s: delay time (%u us, clock %u us)", name, (uint32_t) p_method->delay_us, (uint32_t) delay_us);
+	check((p_method->delay_us == delay_us), what);
+
+	/*Pin time is summed per transfer in cycles: at most 1us short*/
+	snprintf(what, sizeof(what), "%s: pin time (%u us, clock %u us)", name, (uint32_t) p_method->pin_us, (uint32_t) pin_us);
+	check(((p_method->pin_us <= pin_us) && ((p_method->pin_us + 1u) >= pin_us)), what);
+
+	snprintf(what, sizeof(what), "%s: mode switches (%u, expected %u)", name, p_method->mode_switches, mode_switches);
+	check((p_method->mode_switches == mode_switches), what);
+
+	snprintf(what, sizeof(what), "%s: duration (%u cycles, clock %u cycles)", name, p_method->max_cycles, cycles);
+	check((p_method->max_cycles == cycles) && (p_method->total_cycles == cycles), what);
+
+	snprintf(what, sizeof(what), "%s: histogram", name);
+	check((p_method->histogram[ST7920Stats::getHistogramBucket(cycles)] == 1u), what);
+
+	return;
+}
+
+static void check_driver(void)
+{
+	struct _call_measure measure;
+	uint32_t n_method = 0u;
+	uint32_t n_bytes = 0u;
+	uint32_t n_calls = 0u;
+
+	hostSetPinWriteCostNs(CHECK_PIN_COST_NS);
+
+	check(panel.begin(), "begin()");
+	panel.enableGraphicDisplay(true);
+
+	panel.getStats(&stats);
+	check((stats.methods[ST7920_STATS_BEGIN].calls == 1u) && (stats.methods[ST7920_STATS_ENABLE_GRAPHIC_DISPLAY].calls == 1u), "begin() and enableGraphicDisplay() counted");
+
+	/*Full paint: extended instruction set already selected by enableGraphicDisplay()*/
+	panel.resetStats();
+	panel.bufferFillRect(10, 10, 50, 30, panel.DRAWMODE_SET);
+
+	measure_begin(&measure);
+	panel.bufferPaintAll();
+	measure_check(&measure, ST7920_STATS_BUFFER_PAINT_ALL, "bufferPaintAll()");
+
+	check((stats.methods[ST7920_STATS_BUFFER_FILL_RECT].calls == 1u) && !stats.methods[ST7920_STATS_BUFFER_FILL_RECT].bytes, "bufferFillRect(): buffer only");
+
+	/*Text: back to the basic instruction set*/
+	panel.resetStats();
+	measure_begin(&measure);
+	panel.printText("PERF");
+	measure_check(&measure, ST7920_STATS_PRINT_TEXT, "printText()");
+
+	/*Still basic: no switch. printText(text) calls printText(text, length): one call.*/
+	panel.resetStats();
+	measure_begin(&measure);
+	panel.setTextCursorPosition(0u, 1u);
+	panel.printText("COUNTERS");
+	panel.getStats(&stats);
+	check((stats.methods[ST7920_STATS_PRINT_TEXT].calls == 1u) && !stats.methods[ST7920_STATS_PRINT_TEXT].mode_switches, "printText(): no switch while basic");
+
+	/*Dirty paint after text: back to extended*/
+	panel.resetStats();
+	panel.bufferDrawLine(0, 0, 127, 63, panel.DRAWMODE_TOGGLE);
+
+	measure_begin(&measure);
+	panel.bufferPaintDirty();
+	measure_check(&measure, ST7920_STATS_BUFFER_PAINT_DIRTY, "bufferPaintDirty()");
+
+	/*Display clear (1.6ms delay) and scroll*/
+	panel.resetStats();
+	measure_begin(&measure);
+	panel.clearText();
+	measure_check(&measure, ST7920_STATS_CLEAR_TEXT, "clearText()");
+
+	panel.resetStats();
+	measure_begin(&measure);
+	panel.scrollDisplay(5);
+	measure_check(&measure, ST7920_STATS_SCROLL_DISPLAY, "scrollDisplay()");
+
+	/*Everything sent is counted somewhere*/
+	panel.resetStats();
+	panel.resetBusByteCount();
+
+	panel.bufferSetAll(true);
+	panel.bufferPaintBegin(true);
+	while(panel.bufferPaintStep(5000u) == 0);
+	panel.printText("ABC");
+	panel.scrollDisplay(-5);
+	panel.bufferToggleAll();
+	panel.bufferPaintDirty();
+
+	panel.getStats(&stats);
+	for(n_method = 0u; n_method < ST7920_STATS_N_METHODS; n_method++)
+	{
+		n_bytes += stats.methods[n_method].bytes;
+		n_calls += stats.methods[n_method].calls;
+	}
+
+	check((n_bytes == panel.getBusByteCount()), "every byte sent is counted");
+	check((stats.methods[ST7920_STATS_BUFFER_PAINT_STEP].calls >= 2u), "bufferPaintStep() calls");
+	check((n_calls == (stats.methods[ST7920_STATS_BUFFER_PAINT_STEP].calls + 6u)), "call total");
+
+	check(!emulator.getViolationCount(), "no transfer while busy");
+	return;
+}
+
+int main(void)
+{
+	check_stats_alone();
+	check_driver();
+
+	printf("stats: %s (%u failures)\n", (n_fail ? "FAIL" : "ok"), n_fail);
+
+	if(n_fail) return 1;
+
+	return 0;
+}
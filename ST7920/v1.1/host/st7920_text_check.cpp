@@ -0,0 +1,383 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Text mode check: DDRAM shadow, direct cursor addressing and diff based text writes.
+ *
+ * Random text calls (cursor moves, text, characters, wide characters, screen fills, clears), mixed with graphics painting and
+ * cursor on/off, are made on ST7920 (128x64) and ST7920_192x32. A model of the display DDRAM is kept alongside.
+ * After every call, the emulated DDRAM must match the model. After every text call, with the cursor shown, the emulated cursor must be
+ * at the text cursor (painting graphics moves the address counter to GDRAM: the cursor comes back with the next text call).
+ *
+ * Every text write must be minimal: nothing at all is sent when the text is already on the display (cursor not shown), and otherwise
+ * at most 2 bytes per word (2 characters) that changes, plus one DDRAM address per run of changed words (plus one instruction set
+ * switch, plus up to 5 bytes for the cursor, when shown).
+ *
+ * Exit status is 1 if any check fails or the emulator saw a transfer while the display was busy.
+ *
+ * usage: st7920_text_check [n_calls]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define CHECK_DB0 2
+#define CHECK_DB1 3
+#define CHECK_DB2 4
+#define CHECK_DB3 5
+#define CHECK_DB4 6
+#define CHECK_DB5 7
+#define CHECK_DB6 8
+#define CHECK_DB7 9
+#define CHECK_RS 10
+#define CHECK_E 11
+
+#define CHECK_DDRAM_SIZE 64u
+#define CHECK_ROW_BYTES 32u
+
+static ST7920Emulator emulator(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 0xff, CHECK_E);
+
+static ST7920 panel_128x64(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+static ST7920_192x32 panel_192x32(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+
+/*DDRAM model: content and text cursor (byte address)*/
+static uint8_t model_ddram[CHECK_DDRAM_SIZE];
+static uint32_t model_cursor = 0u;
+static bool model_cursor_shown = false;
+
+static uint32_t n_calls_total = 20000u;
+static uint32_t check_rand_state = 0x9e3779b9u;
+
+/*Totals*/
+static uint32_t n_bytes_sent = 0u;
+static uint32_t n_bytes_shift = 0u; /*Estimate for cursor shifts and full re-sends (previous driver)*/
+static uint32_t n_writes_unchanged = 0u;
+
+static uint32_t check_random(void)
+{
+	uint32_t x = check_rand_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	check_rand_state = x;
+	return x;
+}
+
+/*DDRAM byte address of character cx on text line cy. Folded panels: lines 2 and 3 are the right halves of lines 0 and 1.*/
+template<class Panel>
+static uint32_t model_address(Panel &panel, uint32_t cx, uint32_t cy)
+{
+	return CHECK_ROW_BYTES*(cy % 2u) + (cy/2u)*panel.N_CHARS + cx;
+}
+
+static void model_write(const uint8_t *bytes, uint32_t n_bytes)
+{
+	uint32_t n_byte = 0u;
+
+	for(n_byte = 0u; n_byte < n_bytes; n_byte++)
+	{
+		model_ddram[model_cursor] = bytes[n_byte];
+		model_cursor = (model_cursor + 1u) % CHECK_DDRAM_SIZE;
+	}
+
+	return;
+}
+
+/*
+ * Largest number of bytes allowed to write "bytes" at the model cursor (before model_write()).
+ * *p_changed: number of words that change.
+ */
+
+static uint32_t model_write_bound(const uint8_t *bytes, uint32_t n_bytes, uint32_t *p_changed)
+{
+	uint32_t address = model_cursor;
+	uint32_t n_byte = 0u;
+	uint32_t n_changed = 0u;
+	uint32_t n_runs = 0u;
+	bool in_run = false;
+	bool changed = false;
+
+	while(n_byte < n_bytes)
+	{
+		changed = false;
+
+		if((address & 0x1) || ((n_byte + 1u) == n_bytes))
+		{
+			if(model_ddram[address] != bytes[n_byte]) changed = true;
+
+			n_byte++;
+			address = (address + 1u) % CHECK_DDRAM_SIZE;
+		}
+		else
+		{
+			if((model_ddram[address] != bytes[n_byte]) || (model_ddram[address + 1u] != bytes[n_byte + 1u])) changed = true;
+
+			n_byte += 2u;
+			address = (address + 2u) % CHECK_DDRAM_SIZE;
+		}
+
+		if(changed)
+		{
+			n_changed++;
+			if(!in_run) n_runs++;
+		}
+
+		in_run = changed;
+
+		/*A run doesn't go past the end of a DDRAM row*/
+		if(!(address % CHECK_ROW_BYTES)) in_run = false;
+	}
+
+	*p_changed = n_changed;
+
+	if(!n_changed) return 0u;
+
+	return 1u + n_runs + 2u*n_changed;
+}
+
+template<class Panel>
+static uint32_t check_ddram(Panel &panel, const char *name, uint32_t n_call, const char *call, bool text_call)
+{
+	uint32_t address = 0u;
+
+	(void) panel;
+
+	for(address = 0u; address < CHECK_DDRAM_SIZE; address++)
+	{
+		if(emulator.getDdramByte(address) == model_ddram[address]) continue;
+
+		printf("%s: call %u (%s): DDRAM byte %u is 0x%02x, expected 0x%02x\n", name, n_call, call, address, emulator.getDdramByte(address), model_ddram[address]);
+		return 1u;
+	}
+
+	if(text_call && model_cursor_shown && (emulator.getCursorAddress() != ((int32_t) model_cursor)))
+	{
+		printf("%s: call %u (%s): cursor shown at %d, expected %u\n", name, n_call, call, emulator.getCursorAddress(), model_cursor);
+		return 1u;
+	}
+
+	return 0u;
+}
+
+template<class Panel>
+static uint32_t check_text(Panel &panel, const char *name)
+{
+	static const char alphabet[] = "AB  ab01";
+	uint8_t bytes[48];
+	uint32_t n_call = 0u;
+	uint32_t n_fail = 0u;
+	uint32_t n_bytes = 0u;
+	uint32_t n_byte = 0u;
+	uint32_t op = 0u;
+	uint32_t cx = 0u;
+	uint32_t cy = 0u;
+	uint32_t bound = 0u;
+	uint32_t n_changed = 0u;
+	uint32_t sent = 0u;
+	bool write = false;
+	bool text_call = false;
+	bool text_bytes = false;
+	const char *call = NULL;
+
+	emulator.reset();
+	if(!emulator.setPanel(panel.WIDTH, panel.HEIGHT, (panel.HEIGHT > 32u))) return 1u;
+
+	if(!panel.begin()) return 1u;
+
+	panel.setDisplayMode(panel.DISPLAYMODE_DISPLAY_ON_CURSOR_OFF);
+	panel.enableGraphicDisplay(false);
+	panel.clearDisplay();
+
+	memset(model_ddram, ' ', sizeof(model_ddram));
+	model_cursor = 0u;
+	model_cursor_shown = false;
+
+	for(n_call = 0u; n_call < n_calls_total; n_call++)
+	{
+		op = check_random() % 64u;
+		write = false;
+		text_call = true;
+		text_bytes = true;
+		bound = 0u;
+
+		panel.resetBusByteCount();
+
+		if(op < 30u)
+		{
+			/*Cursor, then text. Half of the time, the text already on the display there.*/
+			cx = check_random() % panel.N_CHARS;
+			cy = check_random() % panel.N_LINES;
+
+			panel.setTextCursorPosition(cx, cy);
+			model_cursor = model_address(panel, cx, cy);
+			n_bytes_shift += 1u + cx/2u + (cx & 0x1) + ((cy >= 2u) ? (panel.N_CHARS/2u) : 0u);
+
+			n_bytes = check_random() % 40u;
+			for(n_byte = 0u; n_byte < n_bytes; n_byte++)
+			{
+				if(op & 0x1) bytes[n_byte] = model_ddram[(model_cursor + n_byte) % CHECK_DDRAM_SIZE];
+				else bytes[n_byte] = (uint8_t) alphabet[check_random() % (sizeof(alphabet) - 1u)];
+			}
+
+			bound = model_write_bound(bytes, n_bytes, &n_changed);
+			panel.printText((const char*) bytes, n_bytes);
+			n_bytes_shift += n_bytes;
+
+			write = true;
+			call = "printText";
+		}
+		else if(op < 38u)
+		{
+			cx = check_random() % panel.N_WCHARS;
+			cy = check_random() % panel.N_LINES;
+
+			panel.setWTextCursorPosition(cx, cy);
+			model_cursor = model_address(panel, 2u*cx, cy);
+			n_bytes_shift += 1u + cx + ((cy >= 2u) ? (panel.N_CHARS/2u) : 0u);
+
+			bytes[0] = (uint8_t) alphabet[check_random() % (sizeof(alphabet) - 1u)];
+			bytes[1] = (uint8_t) alphabet[check_random() % (sizeof(alphabet) - 1u)];
+			n_bytes = 2u;
+
+			bound = model_write_bound(bytes, n_bytes, &n_changed);
+			panel.printWChar((uint16_t) ((bytes[0] << 8) | bytes[1]));
+			n_bytes_shift += 2u;
+
+			write = true;
+			call = "printWChar";
+		}
+		else if(op < 46u)
+		{
+			/*At the current text cursor (odd or even)*/
+			bytes[0] = (uint8_t) alphabet[check_random() % (sizeof(alphabet) - 1u)];
+			n_bytes = 1u;
+
+			bound = model_write_bound(bytes, n_bytes, &n_changed);
+			panel.printChar((char) bytes[0]);
+			n_bytes_shift += 1u;
+
+			write = true;
+			call = "printChar";
+		}
+		else if(op < 48u)
+		{
+			bytes[0] = (uint8_t) alphabet[check_random() % (sizeof(alphabet) - 1u)];
+
+			panel.fillScreenChar((char) bytes[0]);
+			n_bytes_shift += 2u + panel.N_CHARS*panel.N_LINES;
+
+			/*Both DDRAM rows, as far as the panel shows*/
+			for(n_byte = 0u; n_byte < (panel.N_CHARS*panel.N_LINES/2u); n_byte++)
+			{
+				model_ddram[n_byte] = bytes[0];
+				model_ddram[CHECK_ROW_BYTES + n_byte] = bytes[0];
+			}
+
+			model_cursor = (CHECK_ROW_BYTES + panel.N_CHARS*panel.N_LINES/2u) % CHECK_DDRAM_SIZE;
+			call = "fillScreenChar";
+		}
+		else if(op < 49u)
+		{
+			panel.clearDisplay();
+			memset(model_ddram, ' ', sizeof(model_ddram));
+			model_cursor = 0u;
+
+			/*Clears graphics too*/
+			text_bytes = false;
+			call = "clearDisplay";
+		}
+		else if(op < 56u)
+		{
+			/*Graphics: the address counter goes to GDRAM*/
+			panel.bufferTogglePixel((check_random() % panel.WIDTH), (check_random() % panel.HEIGHT));
+			panel.bufferPaintDirty();
+			text_call = false;
+			text_bytes = false;
+			call = "bufferPaintDirty";
+		}
+		else if(op < 60u)
+		{
+			model_cursor_shown = ((op & 0x3) != 0u);
+
+			if(model_cursor_shown) panel.setDisplayMode(panel.DISPLAYMODE_DISPLAY_ON_CURSOR_BLINK);
+			else panel.setDisplayMode(panel.DISPLAYMODE_DISPLAY_ON_CURSOR_OFF);
+
+			call = "setDisplayMode";
+		}
+		else
+		{
+			panel.cursorHome();
+			model_cursor = 0u;
+			n_bytes_shift += 1u;
+			call = "cursorHome";
+		}
+
+		sent = panel.getBusByteCount();
+
+		if(write)
+		{
+			model_write(bytes, n_bytes);
+
+			/*Cursor shown: moved to the start of the text, then to its end*/
+			if(model_cursor_shown) bound += 5u;
+
+			if(!n_changed && !model_cursor_shown && sent)
+			{
+				printf("%s: call %u (%s): %u bytes sent, text already on the display\n", name, n_call, call, sent);
+				n_fail++;
+			}
+
+			if(sent > bound)
+			{
+				printf("%s: call %u (%s): %u bytes sent, %u words changed, at most %u bytes expected\n", name, n_call, call, sent, n_changed, bound);
+				n_fail++;
+			}
+
+			if(!n_changed) n_writes_unchanged++;
+		}
+
+		if(text_bytes) n_bytes_sent += sent;
+
+		n_fail += check_ddram(panel, name, n_call, call, text_call);
+		if(n_fail > 8u) break;
+	}
+
+	if(emulator.getViolationCount()) n_fail++;
+
+	printf("%s: %s (%u failures)\n", name, (n_fail ? "FAIL" : "ok"), n_fail);
+	return n_fail;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t n_fail = 0u;
+
+	if(argc > 1) n_calls_total = (uint32_t) strtoul(argv[1], NULL, 0);
+
+	if(!n_calls_total)
+	{
+		fprintf(stderr, "st7920_text_check: invalid number of calls\n");
+		return 2;
+	}
+
+	n_fail += check_text(panel_128x64, "128x64");
+	n_fail += check_text(panel_192x32, "192x32");
+
+	printf("%u bus bytes for text calls (cursor shifts and full re-sends: about %u), %u text writes with nothing to change\n", n_bytes_sent, n_bytes_shift, n_writes_unchanged);
+
+	if(n_fail) return 1;
+
+	return 0;
+}
@@ -0,0 +1,484 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Bus trace check.
+ *
+ * ST7920Tracer alone: storage validation, ring order and overwrite, per byte time interpolation, and the exact decoded text of a hand
+ * made trace covering the basic and extended instruction sets.
+ * On the driver (emulated 128x64 display, simulated clock): the trace must hold exactly the E strobes seen on the pins (RS, byte, order),
+ * each close to its strobe time and followed by at least its command delay; a small ring must keep the last strobes; the VCD export,
+ * parsed back, must give the same strobes, with time only moving forward.
+ *
+ * Usage: st7920_trace_check [output.vcd] (also writes the VCD of the driver trace, e.g. to open in GTKWave)
+ * Exit status is 1 if any check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define CHECK_DB0 2
+#define CHECK_DB1 3
+#define CHECK_DB2 4
+#define CHECK_DB3 5
+#define CHECK_DB4 6
+#define CHECK_DB5 7
+#define CHECK_DB6 8
+#define CHECK_DB7 9
+#define CHECK_RS 10
+#define CHECK_E 11
+
+#define CHECK_PIN_COST_NS 40u
+
+/*Trace time vs strobe time: within one transfer (pins + command delay) of each other*/
+#define CHECK_TIME_SLACK_NS 2000u
+
+#define CHECK_MAX_STROBES 16384u
+
+static ST7920Emulator emulator(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 0xff, CHECK_E);
+static ST7920 panel(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+
+struct _strobe {
+	uint64_t time_ns;
+	uint8_t reg;
+	uint8_t byte;
+};
+
+/*
+ * Logs every E strobe (latched on the falling edge, as the display does).
+ */
+
+class StrobeLogger : public HostDevice {
+	public:
+		struct _strobe strobes[CHECK_MAX_STROBES];
+		uint32_t n_strobes = 0u;
+		uint32_t n_lost = 0u;
+
+		void pinChanged(uint8_t pin, uint8_t level)
+		{
+			static const uint8_t db_pins[8] = {CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7};
+			uint32_t n_bit = 0u;
+
+			for(n_bit = 0u; n_bit < 8u; n_bit++)
+			{
+				if(pin != db_pins[n_bit]) continue;
+
+				if(level) this->_byte |= (1u << n_bit);
+				else this->_byte &= ~(1u << n_bit);
+			}
+
+			if(pin == CHECK_RS) this->_reg = level;
+
+			if(pin != CHECK_E) return;
+
+			if(level)
+			{
+				this->_rise_ns = hostGetTimeNs();
+				return;
+			}
+
+			if(this->n_strobes >= CHECK_MAX_STROBES)
+			{
+				this->n_lost++;
+				return;
+			}
+
+			this->strobes[this->n_strobes].time_ns = this->_rise_ns;
+			this->strobes[this->n_strobes].reg = this->_reg;
+			this->strobes[this->n_strobes].byte = this->_byte;
+			this->n_strobes++;
+			return;
+		}
+
+		void reset(void)
+		{
+			this->n_strobes = 0u;
+			this->n_lost = 0u;
+			return;
+		}
+
+	private:
+		uint8_t _byte = 0u;
+		uint8_t _reg = 0u;
+		uint64_t _rise_ns = 0u;
+};
+
+static StrobeLogger logger;
+
+/*Export output, kept in memory*/
+struct _text {
+	char *data;
+	size_t length;
+	size_t size;
+};
+
+static uint32_t n_fail = 0u;
+
+static void check(bool ok, const char *what)
+{
+	if(ok) return;
+
+	printf("FAIL: %s\n", what);
+	n_fail++;
+	return;
+}
+
+static void text_output(void *context, const char *text)
+{
+	struct _text *p_text = (struct _text*) context;
+	size_t length = strlen(text);
+
+	if((p_text->length + length + 1u) > p_text->size)
+	{
+		p_text->size = 2u*(p_text->length + length + 1u);
+		p_text->data = (char*) realloc(p_text->data, p_text->size);
+		if(p_text->data == NULL) exit(2);
+	}
+
+	memcpy(p_text->data + p_text->length, text, (length + 1u));
+	p_text->length += length;
+	return;
+}
+
+static void text_clear(struct _text *p_text)
+{
+	free(p_text->data);
+	p_text->data = NULL;
+	p_text->length = 0u;
+	p_text->size = 0u;
+	return;
+}
+
+static void check_tracer_alone(void)
+{
+	static const uint8_t init[] = {0x30, 0x0c, 0x01, 0x06, 0x80};
+	static const uint8_t ext[] = {0x34, 0x36, 0x36, 0x80, 0x88};
+	static const uint8_t scroll[] = {0x03, 0x45, 0x02, 0x44, 0x04, 0x30, 0x40, 0x18, 0x00};
+	static const char *expected =
+		"# ST7920 bus trace: 21 transfers\n"
+		"C 30 FUNCTION_SET 8BIT BASIC\n"
+		"C 0C DISPLAY_CONTROL D=1 C=0 B=0\n"
+		"C 01 CLEAR\n"
+		"C 06 ENTRY_MODE INC\n"
+		"C 80 SET_DDRAM_ADDR 00\n"
+		"D 48 DATA DDRAM 'H'\n"
+		"D 69 DATA DDRAM 'i'\n"
+		"C 34 FUNCTION_SET 8BIT EXTENDED GRAPHICS_OFF\n"
+		"C 36 FUNCTION_SET 8BIT EXTENDED GRAPHICS_ON\n"
+		"C 36 FUNCTION_SET 8BIT EXTENDED GRAPHICS_ON (redundant)\n"
+		"C 80 SET_GDRAM_Y 0\n"
+		"C 88 SET_GDRAM_X 8\n"
+		"D FF DATA GDRAM\n"
+		"C 03 SCROLL_SELECT SCROLL\n"
+		"C 45 SET_SCROLL_ADDR 5\n"
+		"C 02 SCROLL_SELECT IRAM\n"
+		"C 44 SET_IRAM_ADDR 04\n"
+		"C 04 REVERSE 0\n"
+		"C 30 FUNCTION_SET 8BIT BASIC\n"
+		"C 40 SET_CGRAM_ADDR 00\n"
+		"C 18 CURSOR_SHIFT DISPLAY LEFT\n"
+		"# 18 commands (1 redundant function sets), 3 data\n";
+	static const uint8_t data_text[] = {0x48, 0x69};
+	static const uint8_t data_gdram[] = {0xff};
+
+	struct _st7920_trace_entry entries[32];
+	struct _st7920_trace_entry entry;
+	struct _text text = {NULL, 0u, 0u};
+	uint32_t n_entry = 0u;
+	bool ok = true;
+
+	/*Storage*/
+	ST7920Tracer no_storage(NULL, 16u);
+	ST7920Tracer no_entries(entries, 0u);
+	ST7920Tracer odd_size(entries, 24u);
+	ST7920Tracer tracer(entries, 32u);
+
+	check(!no_storage.isValid() && !no_entries.isValid() && !odd_size.isValid(), "storage not valid rejected");
+	check(tracer.isValid(), "storage valid");
+	check(!panel.setTracer(&odd_size), "setTracer() with storage not valid");
+	check(panel.setTracer(NULL), "setTracer(NULL)");
+
+	odd_size.record(false, init, 1u, 0u, 0u, 0u);
+	check(!odd_size.getCount() && !odd_size.getLostCount(), "nothing recorded without storage");
+
+	/*Times spread over the write*/
+	tracer.record(true, init, 4u, 72u, 1000u, 1400u);
+	check((tracer.getCount() == 4u) && !tracer.getLostCount(), "4 entries");
+
+	for(n_entry = 0u; n_entry < 4u; n_entry++)
+	{
+		if(!tracer.getEntry(n_entry, &entry)) ok = false;
+		else if((entry.cycles != (1000u + 100u*n_entry)) || (entry.byte != init[n_entry]) || !entry.reg || (entry.delay_us != 72u)) ok = false;
+	}
+
+	check(ok, "entries in order, times interpolated");
+	check(!tracer.getEntry(4u, &entry), "getEntry() out of range");
+
+	/*Times wrap with the cycle counter*/
+	tracer.clear();
+	tracer.record(false, init, 2u, 100000u, 0xfffffff0u, 0x10u);
+	check(tracer.getEntry(1u, &entry) && (entry.cycles == 0u) && (entry.delay_us == 0xffffu), "time wrap and delay clamp");
+
+	/*Overwrite: the last 32 held*/
+	tracer.clear();
+	for(n_entry = 0u; n_entry < 40u; n_entry++) tracer.record(true, &init[n_entry % 5u], 1u, 0u, n_entry, n_entry);
+
+	check((tracer.getCount() == 32u) && (tracer.getLostCount() == 8u), "ring overwrite counts");
+	check(tracer.getEntry(0u, &entry) && (entry.cycles == 8u) && tracer.getEntry(31u, &entry) && (entry.cycles == 39u), "ring keeps the last entries");
+
+	/*Decoder*/
+	tracer.clear();
+	tracer.record(false, init, sizeof(init), 72u, 0u, 0u);
+	tracer.record(true, data_text, sizeof(data_text), 72u, 0u, 0u);
+	tracer.record(false, ext, sizeof(ext), 72u, 0u, 0u);
+	tracer.record(true, data_gdram, sizeof(data_gdram), 72u, 0u, 0u);
+	tracer.record(false, scroll, (sizeof(scroll) - 1u), 72u, 0u, 0u);
+
+	tracer.exportText(text_output, &text, false);
+	check(((text.data != NULL) && !strcmp(text.data, expected)), "decoded text");
+	if((text.data != NULL) && strcmp(text.data, expected)) printf("%s", text.data);
+
+	text_clear(&text);
+
+	/*Timestamps: microseconds since the first entry (600 cycles/us here), then the command delay*/
+	tracer.clear();
+	tracer.record(false, init, 1u, 1024u, 5000u, 5000u);
+	tracer.record(false, &scroll[8], 1u, 72u, (5000u + 600u*12u + 300u), (5000u + 600u*12u + 300u));
+
+	tracer.exportText(text_output, &text, true);
+	check(((text.data != NULL) && (strstr(text.data, "\n         0.000 C 30 FUNCTION_SET 8BIT BASIC +1024us\n") != NULL)), "first timestamp");
+	check(((text.data != NULL) && (strstr(text.data, "\n        12.500 C 00 UNKNOWN +72us\n") != NULL)), "second timestamp");
+
+	text_clear(&text);
+
+	/*Lost entries are reported*/
+	tracer.clear();
+	for(n_entry = 0u; n_entry < 33u; n_entry++) tracer.record(true, init, 1u, 0u, 0u, 0u);
+
+	tracer.exportText(text_output, &text, false);
+	check(((text.data != NULL) && (strstr(text.data, "# 1 earlier transfers lost") != NULL)), "lost entries reported");
+
+	text_clear(&text);
+	return;
+}
+
+static void check_trace_against_strobes(ST7920Tracer *p_tracer, const char *what)
+{
+	struct _st7920_trace_entry entry;
+	struct _st7920_trace_entry first_entry;
+	uint32_t n_entries = p_tracer->getCount();
+	uint32_t first_strobe = 0u;
+	uint32_t n_entry = 0u;
+	uint32_t n_bad_bytes = 0u;
+	uint32_t n_bad_times = 0u;
+	uint32_t n_bad_delays = 0u;
+	uint64_t trace_ns = 0u;
+	uint64_t strobe_ns = 0u;
+	uint64_t slack_ns = 0u;
+	char message[128];
+
+	snprintf(message, sizeof(message), "%s: %u entries, %u strobes", what, n_entries, logger.n_strobes);
+	check((n_entries <= logger.n_strobes) && !logger.n_lost, message);
+	if((n_entries > logger.n_strobes) || !n_entries) return;
+
+	/*The trace holds the last strobes*/
+	first_strobe = logger.n_strobes - n_entries;
+	p_tracer->getEntry(0u, &first_entry);
+
+	for(n_entry = 0u; n_entry < n_entries; n_entry++)
+	{
+		p_tracer->getEntry(n_entry, &entry);
+
+		if((entry.reg != logger.strobes[first_strobe + n_entry].reg) || (entry.byte != logger.strobes[first_strobe + n_entry].byte)) n_bad_bytes++;
+
+		/*Relative to the first entry: both clocks are the simulated one*/
+		trace_ns = ((uint64_t) (uint32_t) (entry.cycles - first_entry.cycles))*1000u/ST7920Stats::getCyclesPerUs();
+		strobe_ns = logger.strobes[first_strobe + n_entry].time_ns - logger.strobes[first_strobe].time_ns;
+		slack_ns = CHECK_TIME_SLACK_NS + 1000u*entry.delay_us;
+
+		if((trace_ns > (strobe_ns + slack_ns)) || (strobe_ns > (trace_ns + slack_ns))) n_bad_times++;
+
+		/*The bus waits the command delay before the next strobe*/
+		if(((first_strobe + n_entry + 1u) < logger.n_strobes) && ((logger.strobes[first_strobe + n_entry + 1u].time_ns - logger.strobes[first_strobe + n_entry].time_ns) < 1000u*entry.delay_us)) n_bad_delays++;
+	}
+
+	snprintf(message, sizeof(message), "%s: %u entries not matching the strobe", what, n_bad_bytes);
+	check(!n_bad_bytes, message);
+	snprintf(message, sizeof(message), "%s: %u entries off the strobe time", what, n_bad_times);
+	check(!n_bad_times, message);
+	snprintf(message, sizeof(message), "%s: %u strobes sooner than the traced delay", what, n_bad_delays);
+	check(!n_bad_delays, message);
+	return;
+}
+
+/*Parses the VCD back into strobes (RS and DB at each E rise), compares them to the trace*/
+static void check_vcd(ST7920Tracer *p_tracer, const char *vcd)
+{
+	struct _st7920_trace_entry entry;
+	const char *line = vcd;
+	const char *end = NULL;
+	uint32_t n_rises = 0u;
+	uint32_t n_bad = 0u;
+	uint32_t n_bit = 0u;
+	uint64_t time_ns = 0u;
+	uint64_t new_time_ns = 0u;
+	uint8_t rs = 0u;
+	uint8_t db = 0u;
+	bool hold = false;
+	bool timed = false;
+	bool definitions = false;
+	bool time_ok = true;
+	bool hold_ok = true;
+	char message[96];
+
+	check((strstr(vcd, "$timescale 1ns $end") != NULL), "VCD timescale");
+	check((strstr(vcd, "$var wire 8 # db [7:0] $end") != NULL), "VCD db variable");
+
+	while((line != NULL) && *line)
+	{
+		end = strchr(line, '\n');
+
+		if(!definitions)
+		{
+			if(!strncmp(line, "$enddefinitions", 15)) definitions = true;
+		}
+		else if(line[0] == '#')
+		{
+			new_time_ns = strtoull(line + 1, NULL, 10);
+			if(timed && (new_time_ns <= time_ns)) time_ok = false;
+			time_ns = new_time_ns;
+			timed = true;
+		}
+		else if(line[0] == 'b')
+		{
+			db = 0u;
+			for(n_bit = 1u; (line[n_bit] == '0') || (line[n_bit] == '1'); n_bit++) db = (uint8_t) ((db << 1) | (line[n_bit] - '0'));
+		}
+		else if(!strncmp(line, "0!", 2) || !strncmp(line, "1!", 2)) rs = (uint8_t) (line[0] - '0');
+		else if(!strncmp(line, "0$", 2) || !strncmp(line, "1$", 2)) hold = (line[0] == '1');
+		else if(!strncmp(line, "1\"", 2))
+		{
+			if(hold) hold_ok = false;
+
+			if(!p_tracer->getEntry(n_rises, &entry) || (entry.reg != rs) || (entry.byte != db)) n_bad++;
+			n_rises++;
+		}
+
+		line = (end != NULL) ? (end + 1) : NULL;
+	}
+
+	check(definitions, "VCD definitions");
+	check(time_ok, "VCD time only moves forward");
+	check(hold_ok, "VCD hold over before the next strobe");
+
+	snprintf(message, sizeof(message), "VCD: %u E rises for %u entries, %u not matching", n_rises, p_tracer->getCount(), n_bad);
+	check(((n_rises == p_tracer->getCount()) && !n_bad), message);
+	return;
+}
+
+static void check_driver(const char *vcd_path)
+{
+	static struct _st7920_trace_entry entries[CHECK_MAX_STROBES];
+	static struct _st7920_trace_entry small_entries[64];
+
+	ST7920Tracer tracer(entries, CHECK_MAX_STROBES);
+	ST7920Tracer small_tracer(small_entries, 64u);
+	struct _text text = {NULL, 0u, 0u};
+	uint32_t n_bytes = 0u;
+	uint32_t cx = 0u;
+	FILE *file = NULL;
+
+	hostAttachDevice(&logger);
+	hostSetPinWriteCostNs(CHECK_PIN_COST_NS);
+
+	check(panel.setTracer(&tracer), "setTracer()");
+	panel.resetBusByteCount();
+
+	check(panel.begin(), "begin()");
+	panel.enableGraphicDisplay(true);
+
+	/*Graphics, text, scroll*/
+	for(cx = 0u; cx < panel.WIDTH; cx += 3u) panel.bufferDrawLine(cx, 0u, (panel.WIDTH - cx - 1u), (panel.HEIGHT - 1u), true);
+	panel.bufferPaintAll();
+
+	panel.setTextCursorPosition(0u, 0u);
+	panel.printText("Trace check");
+	panel.setTextCursorPosition(0u, 1u);
+	panel.printText("VCD export");
+	panel.scrollDisplay(8u);
+	panel.bufferFillRect(10u, 10u, 20u, 20u, false);
+	panel.bufferPaintDirty();
+	panel.scrollDisplay(0u);
+	panel.clearText();
+
+	n_bytes = panel.getBusByteCount();
+
+	check((tracer.getCount() == n_bytes) && !tracer.getLostCount(), "every byte sent is traced");
+	check((tracer.getCount() == logger.n_strobes), "one entry per strobe");
+	check_trace_against_strobes(&tracer, "driver");
+
+	/*Nothing recorded once detached*/
+	check(panel.setTracer(NULL), "setTracer(NULL)");
+	panel.printText("untraced");
+	check((tracer.getCount() == n_bytes), "nothing recorded after setTracer(NULL)");
+
+	tracer.exportVcd(text_output, &text);
+	check_vcd(&tracer, text.data);
+
+	if(vcd_path != NULL)
+	{
+		file = fopen(vcd_path, "w");
+		if(file != NULL)
+		{
+			fputs(text.data, file);
+			fclose(file);
+		}
+		else check(false, "VCD file written");
+	}
+
+	text_clear(&text);
+
+	tracer.exportText(text_output, &text, false);
+	check((strstr(text.data, "FUNCTION_SET 8BIT EXTENDED GRAPHICS_ON") != NULL), "driver trace decoded: graphics on");
+	check((strstr(text.data, "DATA DDRAM 'T'") != NULL), "driver trace decoded: text");
+	check((strstr(text.data, "SET_SCROLL_ADDR 8") != NULL), "driver trace decoded: scroll");
+	text_clear(&text);
+
+	/*A small ring keeps the last strobes*/
+	logger.reset();
+	check(panel.setTracer(&small_tracer), "setTracer() small ring");
+
+	panel.bufferSetAll(true);
+	panel.bufferPaintAll();
+	panel.setTracer(NULL);
+
+	check((small_tracer.getCount() == 64u) && (small_tracer.getLostCount() == (logger.n_strobes - 64u)), "small ring counts");
+	check_trace_against_strobes(&small_tracer, "small ring");
+
+	printf("trace: %u transfers traced, %u in the small ring (%u lost)\n", tracer.getCount(), small_tracer.getCount(), small_tracer.getLostCount());
+
+	check(!emulator.getViolationCount(), "no transfer while busy");
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	check_tracer_alone();
+	check_driver((argc > 1) ? argv[1] : NULL);
+
+	printf("trace: %s (%u failures)\n", (n_fail ? "FAIL" : "ok"), n_fail);
+
+	if(n_fail) return 1;
+
+	return 0;
+}
@@ -0,0 +1,307 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Transaction check (beginTransaction(), endTransaction()), on an emulated 128x64 display on the parallel bus.
+ *
+ * Each call sequence is run without a transaction, within one, and within nested ones, from the same display state. The commands
+ * and data sent must be exactly the expected counts (getBusCommandCount(), getBusByteCount(), emulator and E strobes), and the same in
+ * all three runs: on the parallel bus a transaction holds nothing, so the pin sequence and its timing must be the same too.
+ * Nesting: only the outermost endTransaction() ends the transaction, an endTransaction() without a matching begin fails.
+ *
+ * Exit status is 1 if any check fails.
+ *
+ * usage: st7920_transaction_check
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <Arduino.h>
+
+#include <st7920.hpp>
+#include "st7920_emulator.hpp"
+
+#define CHECK_DB0 2
+#define CHECK_DB1 3
+#define CHECK_DB2 4
+#define CHECK_DB3 5
+#define CHECK_DB4 6
+#define CHECK_DB5 7
+#define CHECK_DB6 8
+#define CHECK_DB7 9
+#define CHECK_RS 10
+#define CHECK_E 11
+
+#define CHECK_PIN_COST_NS 40u
+
+/*
+ * Hashes every pin level change (FNV-1a), with the simulated time it happened at.
+ */
+
+class CheckPinHash : public HostDevice {
+	public:
+		void pinChanged(uint8_t pin, uint8_t level)
+		{
+			this->_add((uint64_t) ((pin << 1) | (level & 0x1)));
+			this->_add(hostGetTimeNs() - this->_start_ns);
+
+			this->n_changes++;
+			return;
+		}
+
+		void reset(void)
+		{
+			this->hash = 0xcbf29ce484222325ull;
+			this->n_changes = 0u;
+			this->_start_ns = hostGetTimeNs();
+			return;
+		}
+
+		uint64_t hash = 0xcbf29ce484222325ull;
+		uint32_t n_changes = 0u;
+
+	private:
+		uint64_t _start_ns = 0u;
+
+		void _add(uint64_t value)
+		{
+			this->hash ^= value;
+			this->hash *= 0x100000001b3ull;
+			return;
+		}
+};
+
+struct _check_counts {
+	uint32_t bus_commands;
+	uint32_t bus_bytes;
+	uint32_t instructions;
+	uint32_t data_bytes;
+	uint32_t strobes;
+	uint32_t n_changes;
+	uint64_t hash;
+};
+
+struct _check_sequence {
+	const char *name;
+	void (*prepare)(void); /*Sets up the same display state before each run*/
+	void (*run)(void);
+
+	/*Expected per run*/
+	uint32_t bus_commands;
+	uint32_t bus_bytes;
+};
+
+static ST7920Emulator emulator(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, 0xff, CHECK_E);
+static ST7920 panel(CHECK_DB0, CHECK_DB1, CHECK_DB2, CHECK_DB3, CHECK_DB4, CHECK_DB5, CHECK_DB6, CHECK_DB7, CHECK_RS, CHECK_E);
+
+static CheckPinHash pin_hash;
+
+static uint32_t n_fail = 0u;
+
+static void check(bool ok, const char *what)
+{
+	if(ok) return;
+
+	printf("FAIL: %s\n", what);
+	n_fail++;
+	return;
+}
+
+/*
+ * Sequences
+ */
+
+static void prepare_text_cleared(void)
+{
+	panel.clearText();
+	panel.setTextCursorPosition(0u, 0u);
+	return;
+}
+
+static void prepare_text_shown(void)
+{
+	uint32_t n_line = 0u;
+
+	panel.clearText();
+
+	for(n_line = 0u; n_line < 4u; n_line++)
+	{
+		panel.setTextCursorPosition(0u, n_line);
+		panel.printText("0123456789abcdef");
+	}
+
+	return;
+}
+
+static void prepare_blank(void)
+{
+	panel.bufferSetAll(false);
+	panel.bufferPaintAll();
+
+	panel.clearText();
+	return;
+}
+
+/*4 setTextCursorPosition() + printText() pairs: an address set and 16 characters each*/
+static void run_four_lines(void)
+{
+	uint32_t n_line = 0u;
+
+	for(n_line = 0u; n_line < 4u; n_line++)
+	{
+		panel.setTextCursorPosition(0u, n_line);
+		panel.printText("0123456789abcdef");
+	}
+
+	return;
+}
+
+/*4 pairs, 2 characters each at column 6 (one word): an address set and 2 characters each*/
+static void run_four_words(void)
+{
+	uint32_t n_line = 0u;
+
+	for(n_line = 0u; n_line < 4u; n_line++)
+	{
+		panel.setTextCursorPosition(6u, n_line);
+		panel.printText("AB");
+	}
+
+	return;
+}
+
+/*Graphics then text: instruction set switch (extended), address set, page, switch back (basic), address set, characters*/
+static void run_pixel_then_text(void)
+{
+	panel.bufferSetPixel(37u, 45u, true);
+	panel.bufferPaintPixel(37u, 45u);
+
+	panel.setTextCursorPosition(0u, 0u);
+	panel.printText("Hi");
+	return;
+}
+
+static const struct _check_sequence check_sequences[] = {
+	{"4 lines, text cleared", prepare_text_cleared, run_four_lines, 4u, 68u},
+	{"4 lines, text unchanged", prepare_text_shown, run_four_lines, 0u, 0u},
+	{"4 words, text shown", prepare_text_shown, run_four_words, 4u, 12u},
+	{"pixel then text", prepare_blank, run_pixel_then_text, 5u, 9u}
+};
+
+static const uint32_t CHECK_N_SEQUENCES = sizeof(check_sequences)/sizeof(struct _check_sequence);
+
+/*Runs the sequence within "depth" nested transactions (0: none)*/
+static void check_run(const struct _check_sequence *sequence, uint32_t depth, struct _check_counts *p_counts)
+{
+	uint32_t n_depth = 0u;
+	bool ok = true;
+
+	sequence->prepare();
+
+	panel.resetBusByteCount();
+	emulator.resetCounters();
+	hostResetCounters();
+	pin_hash.reset();
+
+	for(n_depth = 0u; n_depth < depth; n_depth++) ok &= panel.beginTransaction();
+
+	sequence->run();
+
+	for(n_depth = 0u; n_depth < depth; n_depth++) ok &= panel.endTransaction();
+
+	check(ok, "beginTransaction() / endTransaction() succeed");
+
+	p_counts->bus_commands = panel.getBusCommandCount();
+	p_counts->bus_bytes = panel.getBusByteCount();
+	p_counts->instructions = emulator.getInstructionCount();
+	p_counts->data_bytes = emulator.getDataByteCount();
+	p_counts->strobes = hostGetPinRiseCount(CHECK_E);
+	p_counts->n_changes = pin_hash.n_changes;
+	p_counts->hash = pin_hash.hash;
+	return;
+}
+
+static void check_sequences_counts(void)
+{
+	const struct _check_sequence *sequence = NULL;
+	struct _check_counts plain;
+	struct _check_counts single;
+	struct _check_counts nested;
+	uint32_t n_sequence = 0u;
+
+	for(n_sequence = 0u; n_sequence < CHECK_N_SEQUENCES; n_sequence++)
+	{
+		sequence = &check_sequences[n_sequence];
+
+		check_run(sequence, 0u, &plain);
+		check_run(sequence, 1u, &single);
+		check_run(sequence, 3u, &nested);
+
+		printf("%s: %u commands, %u bytes (transaction: %u, %u; nested: %u, %u)\n", sequence->name, plain.bus_commands, plain.bus_bytes, single.bus_commands, single.bus_bytes, nested.bus_commands, nested.bus_bytes);
+
+		if((plain.bus_commands != sequence->bus_commands) || (plain.bus_bytes != sequence->bus_bytes))
+		{
+			printf("FAIL: %s: expected %u commands, %u bytes\n", sequence->name, sequence->bus_commands, sequence->bus_bytes);
+			n_fail++;
+		}
+
+		/*What the display received and what was strobed*/
+		check((plain.instructions == plain.bus_commands) && (plain.data_bytes == (plain.bus_bytes - plain.bus_commands)) && (plain.strobes == plain.bus_bytes), "counts: display received what was counted");
+
+		check(!memcmp(&single, &plain, sizeof(struct _check_counts)), "transaction: same commands, data, pins and timing as without");
+		check(!memcmp(&nested, &plain, sizeof(struct _check_counts)), "nested transactions: same commands, data, pins and timing as without");
+	}
+
+	return;
+}
+
+static void check_nesting(void)
+{
+	check(!panel.endTransaction(), "endTransaction() without beginTransaction() fails");
+
+	check(panel.beginTransaction() && panel.beginTransaction(), "nested beginTransaction()");
+	check(panel.endTransaction(), "inner endTransaction()");
+
+	/*Still in the outer transaction: calls go on as usual*/
+	panel.resetBusByteCount();
+	prepare_text_cleared();
+	run_four_lines();
+	check((panel.getBusByteCount() > 0u), "calls between the inner and the outer endTransaction() are sent");
+
+	check(panel.endTransaction(), "outer endTransaction()");
+	check(!panel.endTransaction(), "endTransaction() after the outermost fails");
+	return;
+}
+
+int main(void)
+{
+	hostSetPinWriteCostNs(CHECK_PIN_COST_NS);
+
+	check(!panel.beginTransaction() && !panel.endTransaction(), "transactions before begin() fail");
+
+	check(panel.begin(), "begin()");
+
+	/*Cursor not shown: text cursor moves are only sent with the next text*/
+	panel.setDisplayMode(panel.DISPLAYMODE_DISPLAY_ON_CURSOR_OFF);
+	panel.enableGraphicDisplay(true);
+
+	hostAttachDevice(&pin_hash);
+
+	check_sequences_counts();
+	check_nesting();
+
+	hostDetachDevice(&pin_hash);
+
+	check(!emulator.getViolationCount(), "no transfer while busy");
+
+	printf("transactions: %s (%u failures)\n", (n_fail ? "FAIL" : "ok"), n_fail);
+
+	if(n_fail) return 1;
+
+	return 0;
+}
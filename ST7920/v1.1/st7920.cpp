@@ -1,5 +1,5 @@
 /*
- * ST7920 Driver for Teensy boards (Arduino IDE) (Standard 128x64 ST7920 Displays Only!)
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
  * Version 1.1
  *
  * Author: Rafael Sabe
@@ -11,71 +11,127 @@
 #include <stdlib.h>
 #include <string.h>
 
-ST7920::ST7920(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t e)
+template<class Geometry>
+ST7920Panel<Geometry>::ST7920Panel(ST7920Bus &bus)
 {
-	this->resetPinout(db0, db1, db2, db3, db4, db5, db6, db7, rs, e);
+	this->resetBus(bus);
 }
 
-ST7920::~ST7920(void)
+template<class Geometry>
+ST7920Panel<Geometry>::~ST7920Panel(void)
 {
 }
 
-bool ST7920::begin(void)
+template<class Geometry>
+bool ST7920Panel<Geometry>::begin(void)
 {
-	if(!this->_validate_pins())
+	ST7920_STATS_SCOPE(ST7920_STATS_BEGIN);
+
+	if(this->_bus == NULL)
+	{
+		this->_status = this->_STATUS_ERROR;
+		return false;
+	}
+
+	if(!this->_bus->begin())
 	{
 		this->_status = this->_STATUS_ERROR;
 		return false;
 	}
 
-	pinMode(this->pins.e, OUTPUT);
-	digitalWrite(this->pins.e, 0);
+	this->_status = this->_STATUS_UNINITIALIZED;
+
+	/*Display content and state are unknown at this point. First bufferPaintDirty() paints everything.*/
+	this->_dirty_map_set_all(true);
+	this->invalidateStateCache();
+	this->invalidateGlyphCache();
+	this->_transaction_depth = 0u;
 
-	pinMode(this->pins.rs, OUTPUT);
+	this->_bus_call_depth = 0u;
+	this->_bus_dropped = false;
+	this->_bus_resync = false;
 
-	this->_set_dataline_mode(true);
+	/*Power on state: not scrolled, CGRAM address selected (SR = 0)*/
+	this->_scroll_position = 0u;
+	this->_scroll_select = (int32_t) this->_SCROLL_SELECT_BYTE;
 
 	this->_status = this->_STATUS_INITIALIZED;
 	return true;
 }
 
-void ST7920::resetPinout(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t e)
+template<class Geometry>
+void ST7920Panel<Geometry>::resetBus(ST7920Bus &bus)
 {
-	memset(&this->pins, 0xff, sizeof(struct _st7920_pinout));
-
 	this->_status = this->_STATUS_UNINITIALIZED;
+	this->_bus = &bus;
+	return;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::beginTransaction(void)
+{
+	if(this->_status < 1) return false;
+
+	if(!this->_transaction_depth) this->_bus->beginTransaction();
+	this->_transaction_depth++;
 
-	this->pins.db0 = db0;
-	this->pins.db1 = db1;
-	this->pins.db2 = db2;
-	this->pins.db3 = db3;
-	this->pins.db4 = db4;
-	this->pins.db5 = db5;
-	this->pins.db6 = db6;
-	this->pins.db7 = db7;
-	this->pins.rs = rs;
-	this->pins.e = e;
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::endTransaction(void)
+{
+	if(this->_status < 1) return false;
+	if(!this->_transaction_depth) return false;
+
+	this->_transaction_depth--;
+	if(!this->_transaction_depth) this->_bus->endTransaction();
+
+	return true;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::invalidateStateCache(void)
+{
+	this->_forget_state();
+	this->_text_cursor = -1;
+
+	/*Sent right now*/
+	this->_bus_resync = false;
+
+	if(this->_status < 1) return;
+
+	this->_bus_call_begin();
+	this->_send_scroll_position();
+	this->_bus_call_end();
 
 	return;
 }
 
-int32_t ST7920::getStatus(void)
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::getStatus(void)
 {
 	return this->_status;
 }
 
-bool ST7920::enableGraphicDisplay(bool enable)
+template<class Geometry>
+bool ST7920Panel<Geometry>::enableGraphicDisplay(bool enable)
 {
+	ST7920_STATS_SCOPE(ST7920_STATS_ENABLE_GRAPHIC_DISPLAY);
+
 	if(this->_status < 1) return false;
 
+	this->_bus_call_begin();
+
 	this->_set_instruction_mode(true);
 	this->_graphic_display_enabled = enable;
 	this->_set_instruction_mode(true);
 
-	return true;
+	return this->_bus_call_end();
 }
 
-int32_t ST7920::graphicDisplayIsEnabled(void)
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::graphicDisplayIsEnabled(void)
 {
 	if(this->_status < 1) return -1;
 
@@ -84,7 +140,18 @@ int32_t ST7920::graphicDisplayIsEnabled(void)
 	return 0;
 }
 
-bool ST7920::bufferSetPixel(uint32_t cx, uint32_t cy, bool lit)
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::busyFlagIsEnabled(void)
+{
+	if(this->_status < 1) return -1;
+
+	if(this->_bus->busyFlagIsEnabled()) return 1;
+
+	return 0;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferSetPixel(uint32_t cx, uint32_t cy, bool lit)
 {
 	uint32_t buffer_index = 0u;
 	uint32_t pixel_offset = 0u;
@@ -93,13 +160,14 @@ bool ST7920::bufferSetPixel(uint32_t cx, uint32_t cy, bool lit)
 
 	if(!this->_phys_cx_cy_to_virt_bufindex_pageindex_cy_offset(cx, cy, &buffer_index, NULL, NULL, &pixel_offset)) return false;
 
-	if(lit) this->_page_buffer[buffer_index] |= (1 << pixel_offset);
-	else this->_page_buffer[buffer_index] &= ~(1 << pixel_offset);
+	if(lit) this->_buffer_write_page(buffer_index, (this->_page_buffer[buffer_index] | (1 << pixel_offset)));
+	else this->_buffer_write_page(buffer_index, (this->_page_buffer[buffer_index] & ~(1 << pixel_offset)));
 
 	return true;
 }
 
-int32_t ST7920::bufferGetPixel(uint32_t cx, uint32_t cy)
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::bufferGetPixel(uint32_t cx, uint32_t cy)
 {
 	uint32_t buffer_index = 0u;
 	uint32_t pixel_offset = 0u;
@@ -113,7 +181,8 @@ int32_t ST7920::bufferGetPixel(uint32_t cx, uint32_t cy)
 	return 0;
 }
 
-bool ST7920::bufferTogglePixel(uint32_t cx, uint32_t cy)
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferTogglePixel(uint32_t cx, uint32_t cy)
 {
 	uint32_t buffer_index = 0u;
 	uint32_t pixel_offset = 0u;
@@ -122,12 +191,13 @@ bool ST7920::bufferTogglePixel(uint32_t cx, uint32_t cy)
 
 	if(!this->_phys_cx_cy_to_virt_bufindex_pageindex_cy_offset(cx, cy, &buffer_index, NULL, NULL, &pixel_offset)) return false;
 
-	this->_page_buffer[buffer_index] ^= (1 << pixel_offset);
+	this->_buffer_write_page(buffer_index, (this->_page_buffer[buffer_index] ^ (1 << pixel_offset)));
 
 	return true;
 }
 
-bool ST7920::bufferSetPage(uint32_t page_index, uint32_t cy, uint16_t page_value)
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferSetPage(uint32_t page_index, uint32_t cy, uint16_t page_value)
 {
 	uint32_t buffer_index = 0u;
 
@@ -135,11 +205,12 @@ bool ST7920::bufferSetPage(uint32_t page_index, uint32_t cy, uint16_t page_value
 
 	if(!this->_phys_pageindex_cy_to_virt_bufindex_pageindex_cy(page_index, cy, &buffer_index, NULL, NULL)) return false;
 
-	this->_page_buffer[buffer_index] = page_value;
+	this->_buffer_write_page(buffer_index, page_value);
 	return true;
 }
 
-int32_t ST7920::bufferGetPage(uint32_t page_index, uint32_t cy)
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::bufferGetPage(uint32_t page_index, uint32_t cy)
 {
 	uint32_t buffer_index = 0u;
 
@@ -150,7 +221,8 @@ int32_t ST7920::bufferGetPage(uint32_t page_index, uint32_t cy)
 	return (int32_t) this->_page_buffer[buffer_index];
 }
 
-bool ST7920::bufferTogglePage(uint32_t page_index, uint32_t cy, uint16_t toggle_value)
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferTogglePage(uint32_t page_index, uint32_t cy, uint16_t toggle_value)
 {
 	uint32_t buffer_index = 0u;
 
@@ -160,33 +232,48 @@ bool ST7920::bufferTogglePage(uint32_t page_index, uint32_t cy, uint16_t toggle_
 
 	if(!toggle_value) return true;
 
-	this->_page_buffer[buffer_index] ^= toggle_value;
+	this->_buffer_write_page(buffer_index, (this->_page_buffer[buffer_index] ^ toggle_value));
 	return true;
 }
 
-bool ST7920::bufferSetAll(bool lit)
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferSetAll(bool lit)
 {
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_SET_ALL);
+
+	uint32_t buffer_index = 0u;
+	uint16_t page_value = 0u;
+
 	if(this->_status < 1) return false;
 
-	if(lit) memset(this->_page_buffer, 0xff, this->_BUFFER_SIZE_BYTES);
-	else memset(this->_page_buffer, 0x00, this->_BUFFER_SIZE_BYTES);
+	if(lit) page_value = 0xffff;
+	else page_value = 0x0000;
+
+	for(buffer_index = 0u; buffer_index < this->_BUFFER_SIZE_PAGES; buffer_index++) this->_buffer_write_page(buffer_index, page_value);
 
 	return true;
 }
 
-bool ST7920::bufferToggleAll(void)
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferToggleAll(void)
 {
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_TOGGLE_ALL);
+
 	uint32_t buffer_index = 0u;
 
 	if(this->_status < 1) return false;
 
 	for(buffer_index = 0u; buffer_index < this->_BUFFER_SIZE_PAGES; buffer_index++) this->_page_buffer[buffer_index] = ~(this->_page_buffer[buffer_index]);
 
+	this->_dirty_map_set_all(true);
 	return true;
 }
 
-bool ST7920::bufferPaintPixel(uint32_t cx, uint32_t cy)
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferPaintPixel(uint32_t cx, uint32_t cy)
 {
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_PAINT_PIXEL);
+
 	uint32_t page_index = 0u;
 
 	page_index = cx/this->_PAGE_SIZE_PIXELS;
@@ -194,178 +281,400 @@ bool ST7920::bufferPaintPixel(uint32_t cx, uint32_t cy)
 	return this->bufferPaintPage(page_index, cy);
 }
 
-bool ST7920::bufferPaintPage(uint32_t page_index, uint32_t cy)
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferPaintPage(uint32_t page_index, uint32_t cy)
 {
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_PAINT_PAGE);
+
 	uint32_t buffer_index = 0u;
 	uint32_t v_pageindex = 0u;
 	uint32_t v_cy = 0u;
 	uint16_t page_value = 0u;
+	uint8_t bytes[2];
 
 	if(this->_status < 1) return false;
+	if(this->_frame_count > 1u) return false;
 
 	if(!this->_phys_pageindex_cy_to_virt_bufindex_pageindex_cy(page_index, cy, &buffer_index, &v_pageindex, &v_cy)) return false;
 
 	v_pageindex &= 0xff;
-	v_cy &= 0xff;
+	v_cy = this->_gdram_row(v_cy);
 
 	page_value = this->_page_buffer[buffer_index];
 
+	this->_bus_call_begin();
+
 	this->_set_instruction_mode(true);
+	this->_set_gdram_address(v_cy, v_pageindex);
+
+	bytes[0] = (uint8_t) (page_value >> 8);
+	bytes[1] = (uint8_t) (page_value & 0xff);
+	if(!this->_send_bytes(true, bytes, 2u, this->_CMD_SHORT_DELAY_US)) return this->_bus_call_end();
+
+	this->_dirty_map[buffer_index >> 5] &= ~(1u << (buffer_index & 0x1f));
+	this->_paint_map[buffer_index >> 5] &= ~(1u << (buffer_index & 0x1f));
+
+	return this->_bus_call_end();
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferPaintAll(void)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_PAINT_ALL);
+
+	uint32_t sent = 0u;
+
+	if(this->_status < 1) return false;
+	if(this->_frame_count > 1u) return false;
+
+	this->_paint_active = false;
+	memset(this->_paint_map, 0x00, sizeof(this->_paint_map));
+
+	this->_bus_call_begin();
+
+	sent = this->_paint_pages(this->_page_buffer, NULL);
+
+	/*Write dropped: the pages from the first one not sent on are still to be painted*/
+	this->_dirty_map_set_all(sent < this->_BUFFER_SIZE_PAGES);
+	this->_dirty_map_clear_below(sent);
+
+	return this->_bus_call_end();
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferPaintDirty(void)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_PAINT_DIRTY);
+
+	if(this->_status < 1) return false;
+	if(this->_frame_count > 1u) return false;
+
+	this->_paint_cancel();
+
+	this->_last_paint_byte_count = 0u;
+
+	if(this->bufferIsDirty() < 1) return true;
+
+	this->_bus_call_begin();
+	this->_dirty_map_clear_below(this->_paint_pages(this->_page_buffer, this->_dirty_map));
+
+	return this->_bus_call_end();
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferPaintBegin(bool paint_all)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_PAINT_BEGIN);
+
+	uint32_t n_word = 0u;
+
+	if(this->_status < 1) return false;
+	if(this->_frame_count > 1u) return false;
 
-	this->_send_byte(false, (uint8_t) (0x80 | v_cy), this->_CMD_SHORT_DELAY_US);
-	this->_send_byte(false, (uint8_t) (0x80 | v_pageindex), this->_CMD_SHORT_DELAY_US);
+	if(paint_all) memset(this->_paint_map, 0xff, sizeof(this->_paint_map));
+	else for(n_word = 0u; n_word < this->_DIRTY_MAP_SIZE; n_word++) this->_paint_map[n_word] |= this->_dirty_map[n_word];
 
-	this->_send_byte(true, (uint8_t) (page_value >> 8), this->_CMD_SHORT_DELAY_US);
-	this->_send_byte(true, (uint8_t) (page_value & 0xff), this->_CMD_SHORT_DELAY_US);
+	this->_dirty_map_set_all(false);
+
+	this->_paint_index = 0u;
+	this->_paint_active = true;
 
 	return true;
 }
 
-bool ST7920::bufferPaintAll(void)
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::bufferPaintStep(uint32_t budget_us)
 {
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_PAINT_STEP);
+
+	uint32_t start_us = 0u;
+	uint32_t spent_us = 0u;
 	uint32_t buffer_index = 0u;
+	uint32_t row_end = 0u;
+	uint32_t n_pages = 0u;
+	uint32_t n_fit = 0u;
+	uint32_t n_page = 0u;
 	uint16_t page_value = 0u;
-	uint8_t v_cy = 0u;
-	uint8_t v_pageindex = 0u;
+	uint8_t bytes[_WIDTH_PAGES*_PAGE_SIZE_BYTES];
 
-	if(this->_status < 1) return false;
+	if(this->_status < 1) return -1;
+	if(this->_frame_count > 1u) return -1;
 
-	this->_set_instruction_mode(true);
+	if(!this->_paint_active) return 1;
 
-	for(v_cy = 0u; v_cy < ((uint8_t) this->_HEIGHT_PIXELS); v_cy++)
+	this->_bus_call_begin();
+
+	start_us = micros();
+
+	buffer_index = this->_paint_index;
+	while(buffer_index < this->_BUFFER_SIZE_PAGES)
 	{
-		this->_send_byte(false, (0x80 | v_cy), this->_CMD_SHORT_DELAY_US);
-		this->_send_byte(false, 0x80, this->_CMD_SHORT_DELAY_US);
+		if(!this->_paint_map_get(buffer_index))
+		{
+			buffer_index++;
+			continue;
+		}
+
+		/*Run of latched pages, up to the end of the buffer row.*/
+		row_end = (buffer_index/this->_WIDTH_PAGES + 1u)*this->_WIDTH_PAGES;
+
+		n_pages = 0u;
+		while(((buffer_index + n_pages) < row_end) && this->_paint_map_get(buffer_index + n_pages)) n_pages++;
+
+		/*
+		 * Instruction mode and display address might have been changed since the last step: set again as needed (instruction mode switch only
+		 * budgeted if the state cache says it's needed). Address set (2 transfers) + 2 transfers per page.
+		 * The first page of a step goes whatever the budget, so every step makes progress.
+		 */
+		spent_us = (micros() - start_us) + this->_instruction_mode_switch_us(true);
 
-		for(v_pageindex = 0u; v_pageindex < ((uint8_t) this->_WIDTH_PAGES); v_pageindex++)
+		n_fit = 0u;
+		if(spent_us < budget_us) n_fit = (budget_us - spent_us)/this->_SHORT_TRANSFER_US;
+
+		if(n_fit < 4u)
 		{
-			if(buffer_index >= this->_BUFFER_SIZE_PAGES) return false; /*Not really necessary, but just to be safe...*/
+			if(buffer_index != this->_paint_index) break;
+			n_fit = 4u;
+		}
+
+		n_fit = (n_fit - 2u)/2u;
+		if(n_pages > n_fit) n_pages = n_fit;
+
+		this->_set_instruction_mode(true);
+		this->_set_gdram_address(this->_gdram_row(buffer_index/this->_WIDTH_PAGES), (buffer_index%this->_WIDTH_PAGES));
 
+		for(n_page = 0u; n_page < n_pages; n_page++)
+		{
 			page_value = this->_page_buffer[buffer_index];
 
-			this->_send_byte(true, (uint8_t) (page_value >> 8), this->_CMD_SHORT_DELAY_US);
-			this->_send_byte(true, (uint8_t) (page_value & 0xff), this->_CMD_SHORT_DELAY_US);
+			bytes[2u*n_page] = (uint8_t) (page_value >> 8);
+			bytes[2u*n_page + 1u] = (uint8_t) (page_value & 0xff);
 
+			this->_paint_map[buffer_index >> 5] &= ~(1u << (buffer_index & 0x1f));
 			buffer_index++;
 		}
+
+		if(this->_send_bytes(true, bytes, (2u*n_pages), this->_CMD_SHORT_DELAY_US)) continue;
+
+		/*Write dropped: the run goes back to the dirty map*/
+		for(n_page = (buffer_index - n_pages); n_page < buffer_index; n_page++) this->_dirty_map[n_page >> 5] |= (1u << (n_page & 0x1f));
+		break;
 	}
 
+	this->_paint_index = buffer_index;
+
+	if(!this->_bus_call_end()) return -1;
+
+	if(buffer_index < this->_BUFFER_SIZE_PAGES) return 0;
+
+	this->_paint_active = false;
+	return 1;
+}
+
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::bufferIsDirty(void)
+{
+	uint32_t n_word = 0u;
+
+	if(this->_status < 1) return -1;
+
+	for(n_word = 0u; n_word < this->_DIRTY_MAP_SIZE; n_word++) if(this->_dirty_map[n_word]) return 1;
+
+	return 0;
+}
+
+template<class Geometry>
+uint32_t ST7920Panel<Geometry>::getBusByteCount(void)
+{
+	return this->_bus_byte_count;
+}
+
+template<class Geometry>
+uint32_t ST7920Panel<Geometry>::getBusCommandCount(void)
+{
+	return this->_bus_command_count;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::resetBusByteCount(void)
+{
+	this->_bus_byte_count = 0u;
+	this->_bus_command_count = 0u;
+	return;
+}
+
+template<class Geometry>
+uint32_t ST7920Panel<Geometry>::getLastPaintByteCount(void)
+{
+	return this->_last_paint_byte_count;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::setTracer(ST7920Tracer *tracer)
+{
+	if((tracer != NULL) && !tracer->isValid()) return false;
+
+	this->_tracer = tracer;
 	return true;
 }
 
-bool ST7920::clearGraphics(void)
+#ifdef ST7920_STATS
+template<class Geometry>
+void ST7920Panel<Geometry>::getStats(struct _st7920_stats *p_stats)
+{
+	this->_stats.getSnapshot(p_stats);
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::resetStats(void)
+{
+	this->_stats.reset();
+	return;
+}
+#endif
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::clearGraphics(void)
 {
+	ST7920_STATS_SCOPE(ST7920_STATS_CLEAR_GRAPHICS);
+
 	if(this->_status < 1) return false;
 
 	this->bufferSetAll(false);
-	this->bufferPaintAll();
-	return true;
+
+	/*Frame buffer mode: the display is cleared with the next published frame*/
+	if(this->_frame_count > 1u) return true;
+
+	return this->bufferPaintAll();
 }
 
-bool ST7920::setDisplayMode(int32_t display_mode)
+template<class Geometry>
+bool ST7920Panel<Geometry>::setDisplayMode(int32_t display_mode)
 {
-	if(this->_status < 1) return false;
+	ST7920_STATS_SCOPE(ST7920_STATS_SET_DISPLAY_MODE);
 
-	this->_set_instruction_mode(false);
+	uint8_t display_control = 0u;
+
+	if(this->_status < 1) return false;
 
 	switch(display_mode)
 	{
 		case this->DISPLAYMODE_DISPLAY_OFF:
-			this->_send_byte(false, 0x08, this->_CMD_SHORT_DELAY_US);
-			return true;
+			display_control = 0x08;
+			break;
 
 		case this->DISPLAYMODE_DISPLAY_ON_CURSOR_OFF:
-			this->_send_byte(false, 0x0c, this->_CMD_SHORT_DELAY_US);
-			return true;
+			display_control = 0x0c;
+			break;
 
 		case this->DISPLAYMODE_DISPLAY_ON_CURSOR_ON:
-			this->_send_byte(false, 0x0e, this->_CMD_SHORT_DELAY_US);
-			return true;
+			display_control = 0x0e;
+			break;
 
 		case this->DISPLAYMODE_DISPLAY_ON_CURSOR_BLINK:
-			this->_send_byte(false, 0x0f, this->_CMD_SHORT_DELAY_US);
-			return true;
+			display_control = 0x0f;
+			break;
+
+		default:
+			return false;
 	}
 
-	return false;
+	this->_bus_call_begin();
+
+	if(this->_display_control != ((int32_t) display_control))
+	{
+		this->_set_instruction_mode(false);
+		this->_send_byte(false, display_control, this->_CMD_SHORT_DELAY_US);
+
+		this->_display_control = (int32_t) display_control;
+	}
+
+	/*Cursor shown: it must be where the text cursor is (painting graphics moves it away)*/
+	this->_text_sync_cursor();
+
+	return this->_bus_call_end();
 }
 
-bool ST7920::clearText(void)
+template<class Geometry>
+bool ST7920Panel<Geometry>::clearText(void)
 {
+	ST7920_STATS_SCOPE(ST7920_STATS_CLEAR_TEXT);
+
 	return this->fillScreenChar(' ');
 }
 
-bool ST7920::cursorHome(void)
+template<class Geometry>
+bool ST7920Panel<Geometry>::cursorHome(void)
 {
+	ST7920_STATS_SCOPE(ST7920_STATS_CURSOR_HOME);
+
 	if(this->_status < 1) return false;
 
-	this->_set_instruction_mode(false);
-	this->_send_byte(false, 0x02, this->_CMD_SHORT_DELAY_US);
+	this->_bus_call_begin();
 
-	return true;
+	this->_text_cursor = (int32_t) (this->_AC_ROW_BYTES*this->_text_row(0u));
+	this->_text_sync_cursor();
+
+	return this->_bus_call_end();
 }
 
-bool ST7920::setTextCursorPosition(uint32_t cx, uint32_t cy)
+template<class Geometry>
+bool ST7920Panel<Geometry>::setTextCursorPosition(uint32_t cx, uint32_t cy)
 {
-	uint32_t num32 = 0u;
+	ST7920_STATS_SCOPE(ST7920_STATS_SET_TEXT_CURSOR_POSITION);
+
 	bool add_space = false;
 
 	if(this->_status < 1) return false;
 
 	if(!this->_phys_text_cx_cy_to_virt_wtext_cx_cy_addspace(cx, cy, &cx, &cy, &add_space)) return false;
 
-	this->_set_instruction_mode(false);
-
-	if(cy) this->_send_byte(false, 0x90, this->_CMD_SHORT_DELAY_US);
-	else this->_send_byte(false, 0x80, this->_CMD_SHORT_DELAY_US);
-
-	num32 = 0u;
-	while(num32 < cx)
-	{
-		this->_send_byte(false, 0x14, this->_CMD_SHORT_DELAY_US);
-		num32++;
-	}
+	this->_bus_call_begin();
 
-	if(add_space) this->_send_byte(true, ' ', this->_CMD_SHORT_DELAY_US);
+	this->_text_cursor = (int32_t) (this->_AC_ROW_BYTES*cy + 2u*cx + ((uint32_t) add_space));
+	this->_text_sync_cursor();
 
-	return true;
+	return this->_bus_call_end();
 }
 
-bool ST7920::setWTextCursorPosition(uint32_t cx, uint32_t cy)
+template<class Geometry>
+bool ST7920Panel<Geometry>::setWTextCursorPosition(uint32_t cx, uint32_t cy)
 {
-	uint32_t num32 = 0u;
+	ST7920_STATS_SCOPE(ST7920_STATS_SET_WTEXT_CURSOR_POSITION);
 
 	if(this->_status < 1) return false;
 
 	if(!this->_phys_wtext_cx_cy_to_virt_wtext_cx_cy(cx, cy, &cx, &cy)) return false;
 
-	this->_set_instruction_mode(false);
-
-	if(cy) this->_send_byte(false, 0x90, this->_CMD_SHORT_DELAY_US);
-	else this->_send_byte(false, 0x80, this->_CMD_SHORT_DELAY_US);
+	this->_bus_call_begin();
 
-	num32 = 0u;
-	while(num32 < cx)
-	{
-		this->_send_byte(false, 0x14, this->_CMD_SHORT_DELAY_US);
-		num32++;
-	}
+	this->_text_cursor = (int32_t) (this->_AC_ROW_BYTES*cy + 2u*cx);
+	this->_text_sync_cursor();
 
-	return true;
+	return this->_bus_call_end();
 }
 
-bool ST7920::printChar(char c)
+template<class Geometry>
+bool ST7920Panel<Geometry>::printChar(char c)
 {
+	ST7920_STATS_SCOPE(ST7920_STATS_PRINT_CHAR);
+
+	uint8_t byte = (uint8_t) c;
+
 	if(this->_status < 1) return false;
 
-	this->_set_instruction_mode(false);
-	this->_send_byte(true, (uint8_t) c, this->_CMD_SHORT_DELAY_US);
+	this->_bus_call_begin();
+	this->_text_write(&byte, 1u);
 
-	return true;
+	return this->_bus_call_end();
 }
 
-bool ST7920::printText(const char *text)
+template<class Geometry>
+bool ST7920Panel<Geometry>::printText(const char *text)
 {
+	ST7920_STATS_SCOPE(ST7920_STATS_PRINT_TEXT);
+
 	uint32_t n_len = 0u;
 
 	if(this->_status < 1) return false;
@@ -376,39 +685,43 @@ bool ST7920::printText(const char *text)
 	return this->printText(text, n_len);
 }
 
-bool ST7920::printText(const char *text, uint32_t length)
+template<class Geometry>
+bool ST7920Panel<Geometry>::printText(const char *text, uint32_t length)
 {
-	uint32_t n_char = 0u;
+	ST7920_STATS_SCOPE(ST7920_STATS_PRINT_TEXT);
 
 	if(this->_status < 1) return false;
 	if(text == NULL) return false;
 
-	this->_set_instruction_mode(false);
-
-	n_char = 0u;
-	while(n_char < length)
-	{
-		this->_send_byte(true, (uint8_t) text[n_char], this->_CMD_SHORT_DELAY_US);
-		n_char++;
-	}
+	this->_bus_call_begin();
+	this->_text_write((const uint8_t*) text, length);
 
-	return true;
+	return this->_bus_call_end();
 }
 
-bool ST7920::printWChar(uint16_t wc)
+template<class Geometry>
+bool ST7920Panel<Geometry>::printWChar(uint16_t wc)
 {
+	ST7920_STATS_SCOPE(ST7920_STATS_PRINT_WCHAR);
+
+	uint8_t bytes[2];
+
 	if(this->_status < 1) return false;
 
-	this->_set_instruction_mode(false);
+	bytes[0] = (uint8_t) (wc >> 8);
+	bytes[1] = (uint8_t) (wc & 0xff);
 
-	this->_send_byte(true, (uint8_t) (wc >> 8), this->_CMD_SHORT_DELAY_US);
-	this->_send_byte(true, (uint8_t) (wc & 0xff), this->_CMD_SHORT_DELAY_US);
+	this->_bus_call_begin();
+	this->_text_write(bytes, 2u);
 
-	return true;
+	return this->_bus_call_end();
 }
 
-bool ST7920::printWText(const uint16_t *wtext)
+template<class Geometry>
+bool ST7920Panel<Geometry>::printWText(const uint16_t *wtext)
 {
+	ST7920_STATS_SCOPE(ST7920_STATS_PRINT_WTEXT);
+
 	uint32_t n_len = 0u;
 
 	if(this->_status < 1) return false;
@@ -419,186 +732,996 @@ bool ST7920::printWText(const uint16_t *wtext)
 	return this->printWText(wtext, n_len);
 }
 
-bool ST7920::printWText(const uint16_t *wtext, uint32_t length)
+template<class Geometry>
+bool ST7920Panel<Geometry>::printWText(const uint16_t *wtext, uint32_t length)
 {
+	ST7920_STATS_SCOPE(ST7920_STATS_PRINT_WTEXT);
+
 	uint32_t n_wchar = 0u;
+	uint32_t n_bytes = 0u;
 	uint16_t wchar = 0u;
+	uint8_t bytes[_N_CHARS];
 
 	if(this->_status < 1) return false;
 	if(wtext == NULL) return false;
 
-	this->_set_instruction_mode(false);
+	this->_bus_call_begin();
 
 	n_wchar = 0u;
 	while(n_wchar < length)
 	{
 		wchar = wtext[n_wchar];
 
-		this->_send_byte(true, (uint8_t) (wchar >> 8), this->_CMD_SHORT_DELAY_US);
-		this->_send_byte(true, (uint8_t) (wchar & 0xff), this->_CMD_SHORT_DELAY_US);
+		bytes[n_bytes++] = (uint8_t) (wchar >> 8);
+		bytes[n_bytes++] = (uint8_t) (wchar & 0xff);
+
+		if(n_bytes >= sizeof(bytes))
+		{
+			this->_text_write(bytes, n_bytes);
+			n_bytes = 0u;
+		}
 
 		n_wchar++;
 	}
 
-	return true;
+	this->_text_write(bytes, n_bytes);
+
+	return this->_bus_call_end();
 }
 
-bool ST7920::fillScreenChar(char c)
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::loadCgramGlyph(const uint16_t *glyph)
 {
-	uint32_t n_char = 0u;
-
-	if(this->_status < 1) return false;
+	ST7920_STATS_SCOPE(ST7920_STATS_LOAD_CGRAM_GLYPH);
 
-	this->_set_instruction_mode(false);
+	uint8_t bytes[32];
+	uint32_t slot = 0u;
+	uint32_t n_slot = 0u;
+	uint32_t n_row = 0u;
+	bool found = false;
 
-	this->_send_byte(false, 0x80, this->_CMD_SHORT_DELAY_US);
-	for(n_char = 0u; n_char < this->_N_CHARS; n_char++) this->_send_byte(true, (uint8_t) c, this->_CMD_SHORT_DELAY_US);
+	if(this->_status < 1) return -1;
+	if(glyph == NULL) return -1;
 
-	this->_send_byte(false, 0x90, this->_CMD_SHORT_DELAY_US);
-	for(n_char = 0u; n_char < this->_N_CHARS; n_char++) this->_send_byte(true, (uint8_t) c, this->_CMD_SHORT_DELAY_US);
+	this->_cgram_use_count++;
 
-	return true;
-}
+	for(slot = 0u; slot < this->_N_CGRAM_SLOTS; slot++)
+	{
+		if(this->_cgram_glyph[slot] != glyph) continue;
 
-bool ST7920::fillScreenWChar(uint16_t wc)
-{
-	uint32_t n_wchar = 0u;
+		this->_cgram_last_use[slot] = this->_cgram_use_count;
+		this->_cgram_hit_count++;
+		return (int32_t) (2u*slot);
+	}
 
-	if(this->_status < 1) return false;
+	/*Miss: an empty slot, otherwise the least recently used glyph that isn't on screen*/
+	for(n_slot = 0u; n_slot < this->_N_CGRAM_SLOTS; n_slot++)
+	{
+		if(this->_cgram_glyph[n_slot] == NULL)
+		{
+			slot = n_slot;
+			found = true;
+			break;
+		}
 
-	this->_set_instruction_mode(false);
+		if(this->_cgram_slot_shown(n_slot)) continue;
+		if(found && ((this->_cgram_use_count - this->_cgram_last_use[n_slot]) <= (this->_cgram_use_count - this->_cgram_last_use[slot]))) continue;
 
-	this->_send_byte(false, 0x80, this->_CMD_SHORT_DELAY_US);
-	for(n_wchar = 0u; n_wchar < this->_N_WCHARS; n_wchar++)
-	{
-		this->_send_byte(true, (uint8_t) (wc >> 8), this->_CMD_SHORT_DELAY_US);
-		this->_send_byte(true, (uint8_t) (wc & 0xff), this->_CMD_SHORT_DELAY_US);
+		slot = n_slot;
+		found = true;
 	}
 
-	this->_send_byte(false, 0x90, this->_CMD_SHORT_DELAY_US);
-	for(n_wchar = 0u; n_wchar < this->_N_WCHARS; n_wchar++)
+	if(!found) return -1;
+
+	for(n_row = 0u; n_row < 16u; n_row++)
 	{
-		this->_send_byte(true, (uint8_t) (wc >> 8), this->_CMD_SHORT_DELAY_US);
-		this->_send_byte(true, (uint8_t) (wc & 0xff), this->_CMD_SHORT_DELAY_US);
+		bytes[2u*n_row] = (uint8_t) (glyph[n_row] >> 8);
+		bytes[2u*n_row + 1u] = (uint8_t) (glyph[n_row] & 0xff);
 	}
 
-	return true;
-}
+	this->_bus_call_begin();
 
-bool ST7920::clearDisplay(void)
-{
-	if(this->_status < 1) return false;
+	/*The text cursor stays where the address counter was*/
+	if(this->_text_cursor < 0) this->_text_cursor = this->_ddram_address();
 
-	this->clearGraphics();
+	/*CGRAM address is only taken with SR = 0*/
+	this->_set_scroll_select(false);
 
 	this->_set_instruction_mode(false);
-	this->_send_byte(false, 0x01, this->_CMD_SHORT_DELAY_US);
+	this->_send_byte(false, (uint8_t) (0x40 | (16u*slot)), this->_CMD_SHORT_DELAY_US);
+	this->_send_bytes(true, bytes, sizeof(bytes), this->_CMD_SHORT_DELAY_US);
 
-	return true;
+	this->_ac_mode = this->_AC_UNKNOWN;
+
+	this->_cgram_glyph[slot] = glyph;
+	this->_cgram_last_use[slot] = this->_cgram_use_count;
+	this->_cgram_miss_count++;
+
+	this->_text_sync_cursor();
+
+	if(!this->_bus_call_end()) return -1;
+
+	return (int32_t) (2u*slot);
 }
 
-void ST7920::_set_instruction_mode(bool ext)
+template<class Geometry>
+bool ST7920Panel<Geometry>::printCgramGlyph(const uint16_t *glyph)
 {
-	uint8_t mode = 0x0;
+	ST7920_STATS_SCOPE(ST7920_STATS_PRINT_CGRAM_GLYPH);
 
-	if(ext)
-	{
-		mode = this->_EXT_INSTRUCTION_BYTE;
-		if(this->_graphic_display_enabled) mode |= this->_GRAPHIC_DISPLAY_ENABLE_BIT;
-	}
-	else mode = this->_BASIC_INSTRUCTION_BYTE;
+	int32_t code = 0;
 
-	this->_send_byte(false, mode, this->_CMD_LONG_DELAY_US);
-	return;
+	code = this->loadCgramGlyph(glyph);
+	if(code < 0) return false;
+
+	return this->printWChar((uint16_t) code);
 }
 
-void ST7920::_send_byte(bool reg, uint8_t byte, uint32_t cmddelay_us)
+template<class Geometry>
+void ST7920Panel<Geometry>::invalidateCgramGlyphs(void)
 {
-	digitalWrite(this->pins.e, 0);
-	digitalWrite(this->pins.rs, reg);
-	delayMicroseconds(this->_EN_DELAY_US);
-	this->_write_byte(byte);
-	digitalWrite(this->pins.e, 1);
-	delayMicroseconds(this->_EN_DELAY_US);
-	digitalWrite(this->pins.e, 0);
-	delayMicroseconds(cmddelay_us);
+	uint32_t slot = 0u;
+
+	for(slot = 0u; slot < this->_N_CGRAM_SLOTS; slot++) this->_cgram_glyph[slot] = NULL;
 
 	return;
 }
 
-void ST7920::_write_byte(uint8_t byte)
+template<class Geometry>
+uint32_t ST7920Panel<Geometry>::getCgramGlyphHitCount(void)
 {
-	digitalWrite(this->pins.db7, (byte & 0x80));
-	digitalWrite(this->pins.db6, (byte & 0x40));
-	digitalWrite(this->pins.db5, (byte & 0x20));
-	digitalWrite(this->pins.db4, (byte & 0x10));
-	digitalWrite(this->pins.db3, (byte & 0x08));
-	digitalWrite(this->pins.db2, (byte & 0x04));
-	digitalWrite(this->pins.db1, (byte & 0x02));
-	digitalWrite(this->pins.db0, (byte & 0x01));
-
-	return;
+	return this->_cgram_hit_count;
 }
 
-void ST7920::_set_dataline_mode(bool output)
+template<class Geometry>
+uint32_t ST7920Panel<Geometry>::getCgramGlyphMissCount(void)
 {
-	if(output)
-	{
-		pinMode(this->pins.db0, OUTPUT);
-		pinMode(this->pins.db1, OUTPUT);
-		pinMode(this->pins.db2, OUTPUT);
-		pinMode(this->pins.db3, OUTPUT);
-		pinMode(this->pins.db4, OUTPUT);
-		pinMode(this->pins.db5, OUTPUT);
-		pinMode(this->pins.db6, OUTPUT);
-		pinMode(this->pins.db7, OUTPUT);
-	}
-	else
-	{
-		pinMode(this->pins.db0, INPUT);
-		pinMode(this->pins.db1, INPUT);
-		pinMode(this->pins.db2, INPUT);
-		pinMode(this->pins.db3, INPUT);
-		pinMode(this->pins.db4, INPUT);
-		pinMode(this->pins.db5, INPUT);
-		pinMode(this->pins.db6, INPUT);
-		pinMode(this->pins.db7, INPUT);
-	}
+	return this->_cgram_miss_count;
+}
 
+template<class Geometry>
+void ST7920Panel<Geometry>::resetCgramGlyphCounters(void)
+{
+	this->_cgram_hit_count = 0u;
+	this->_cgram_miss_count = 0u;
 	return;
 }
 
-bool ST7920::_validate_pins(void)
+template<class Geometry>
+bool ST7920Panel<Geometry>::fillScreenChar(char c)
 {
-	uint32_t n_pin = 0u;
-	int8_t *p_pins = (int8_t*) &this->pins;
+	ST7920_STATS_SCOPE(ST7920_STATS_FILL_SCREEN_CHAR);
 
-	/*DB0 - DB7*/
-	for(n_pin = 0u; n_pin < 8u; n_pin++) if(p_pins[n_pin] < 0) return false;
+	uint8_t bytes[_N_CHARS];
 
-	/*RS*/
-	if(p_pins[8] < 0) return false;
+	if(this->_status < 1) return false;
 
-	/*Ignore RW for now... (p_pins[9])*/
+	memset(bytes, (uint8_t) c, sizeof(bytes));
 
-	/*E*/
-	if(p_pins[10] < 0) return false;
+	this->_bus_call_begin();
 
-	return true;
+	this->_text_cursor = (int32_t) (this->_AC_ROW_BYTES*this->_text_row(0u));
+	this->_text_write(bytes, this->_N_CHARS);
+
+	this->_text_cursor = (int32_t) (this->_AC_ROW_BYTES*this->_text_row(1u));
+	this->_text_write(bytes, this->_N_CHARS);
+
+	return this->_bus_call_end();
 }
 
-bool ST7920::_phys_cx_cy_to_virt_bufindex_pageindex_cy_offset(uint32_t cx, uint32_t cy, uint32_t *p_bufferindex, uint32_t *p_pageindex, uint32_t *p_cy, uint32_t *p_offset)
+template<class Geometry>
+bool ST7920Panel<Geometry>::fillScreenWChar(uint16_t wc)
 {
-	uint32_t buffer_index = 0u;
-	uint32_t page_index = 0u;
+	ST7920_STATS_SCOPE(ST7920_STATS_FILL_SCREEN_WCHAR);
 
-	if((cx >= this->WIDTH) || (cy >= this->HEIGHT)) return false;
+	uint32_t n_wchar = 0u;
+	uint8_t bytes[_N_CHARS];
 
-	page_index = cx/this->_PAGE_SIZE_PIXELS;
-	cx %= this->_PAGE_SIZE_PIXELS;
-	cx = this->_PAGE_SIZE_PIXELS - cx - 1u;
+	if(this->_status < 1) return false;
 
-	if(cy >= this->_HEIGHT_PIXELS)
+	for(n_wchar = 0u; n_wchar < this->_N_WCHARS; n_wchar++)
+	{
+		bytes[2u*n_wchar] = (uint8_t) (wc >> 8);
+		bytes[2u*n_wchar + 1u] = (uint8_t) (wc & 0xff);
+	}
+
+	this->_bus_call_begin();
+
+	this->_text_cursor = (int32_t) (this->_AC_ROW_BYTES*this->_text_row(0u));
+	this->_text_write(bytes, this->_N_CHARS);
+
+	this->_text_cursor = (int32_t) (this->_AC_ROW_BYTES*this->_text_row(1u));
+	this->_text_write(bytes, this->_N_CHARS);
+
+	return this->_bus_call_end();
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::clearDisplay(void)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_CLEAR_DISPLAY);
+
+	if(this->_status < 1) return false;
+
+	this->_bus_call_begin();
+
+	this->clearGraphics();
+
+	this->_set_instruction_mode(false);
+	this->_send_byte(false, 0x01, this->_CMD_CLEAR_DELAY_US);
+
+	/*Clear fills DDRAM with spaces and resets the address counter*/
+	this->_ac_mode = this->_AC_DDRAM;
+	this->_ac_row = 0u;
+	this->_ac_col = 0u;
+
+	memset(this->_ddram_shadow, ' ', sizeof(this->_ddram_shadow));
+	memset(this->_ddram_known, 0xff, sizeof(this->_ddram_known));
+	this->_text_cursor = (int32_t) (this->_AC_ROW_BYTES*this->_text_row(0u));
+
+	return this->_bus_call_end();
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::scrollDisplay(int32_t n_rows)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_SCROLL_DISPLAY);
+
+	uint32_t moved[_DIRTY_MAP_SIZE];
+	uint32_t old_position = 0u;
+	int32_t shift_rows = 0;
+	int32_t n_lines = 0;
+
+	if(this->_status < 1) return false;
+	if(this->_frame_count > 1u) return false;
+	if(!n_rows) return true;
+
+	this->_paint_cancel();
+	this->_bus_call_begin();
+
+	/*Scrolled by a screen or more: nothing left to move, the display stays where it is*/
+	if(n_rows >= ((int32_t) this->HEIGHT)) n_rows = (int32_t) this->HEIGHT;
+	else if(n_rows <= -((int32_t) this->HEIGHT)) n_rows = -((int32_t) this->HEIGHT);
+	else shift_rows = n_rows;
+
+	old_position = this->_scroll_position;
+	this->_scroll_position = (old_position + this->_GDRAM_ROWS + ((uint32_t) shift_rows)) % this->_GDRAM_ROWS;
+
+	/*Text lines the DDRAM rows on screen move by (rounded down)*/
+	n_lines = ((int32_t) (old_position + this->_GDRAM_ROWS) + shift_rows)/16 - ((int32_t) (old_position + this->_GDRAM_ROWS))/16;
+
+	/*What the display can't move is sent before the scroll command, while (mostly) out of view*/
+	this->_scroll_buffer(n_rows, shift_rows, moved);
+	this->_paint_pages(this->_page_buffer, moved);
+
+	this->_scroll_text(old_position, n_lines, (shift_rows != n_rows));
+
+	if(shift_rows) this->_send_scroll_position();
+
+	this->_text_sync_cursor();
+
+	/*Write dropped: where the display is scrolled to isn't known, everything is painted again*/
+	if(this->_bus_dropped) this->_dirty_map_set_all(true);
+
+	return this->_bus_call_end();
+}
+
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::getScrollPosition(void)
+{
+	if(this->_status < 1) return -1;
+
+	return (int32_t) this->_scroll_position;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_set_instruction_mode(bool ext)
+{
+	uint8_t mode = this->_instruction_mode_byte(ext);
+
+	if(this->_function_set == ((int32_t) mode)) return;
+
+	this->_send_byte(false, mode, this->_CMD_LONG_DELAY_US);
+
+#ifdef ST7920_STATS
+	this->_stats.countModeSwitch();
+#endif
+
+	this->_function_set = (int32_t) mode;
+	return;
+}
+
+template<class Geometry>
+uint8_t ST7920Panel<Geometry>::_instruction_mode_byte(bool ext)
+{
+	uint8_t mode = 0x0;
+
+	if(ext)
+	{
+		mode = this->_EXT_INSTRUCTION_BYTE;
+		if(this->_graphic_display_enabled) mode |= this->_GRAPHIC_DISPLAY_ENABLE_BIT;
+	}
+	else mode = this->_BASIC_INSTRUCTION_BYTE;
+
+	return mode;
+}
+
+/*Worst case time _set_instruction_mode() takes: 0 if the display is known to be in that instruction set already*/
+
+template<class Geometry>
+uint32_t ST7920Panel<Geometry>::_instruction_mode_switch_us(bool ext)
+{
+	if(this->_function_set == ((int32_t) this->_instruction_mode_byte(ext))) return 0u;
+
+	return this->_LONG_TRANSFER_US;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_set_gdram_address(uint32_t v_cy, uint32_t v_pageindex)
+{
+	uint8_t bytes[2];
+
+	if((this->_ac_mode == this->_AC_GDRAM) && (this->_ac_row == v_cy) && (this->_ac_col == this->_PAGE_SIZE_BYTES*v_pageindex)) return;
+
+	/*Vertical address, then horizontal address. Must be sent in extended instruction mode.*/
+	bytes[0] = (uint8_t) (0x80 | v_cy);
+	bytes[1] = (uint8_t) (0x80 | v_pageindex);
+	this->_send_bytes(false, bytes, 2u, this->_CMD_SHORT_DELAY_US);
+
+	this->_ac_mode = this->_AC_GDRAM;
+	this->_ac_row = v_cy;
+	this->_ac_col = this->_PAGE_SIZE_BYTES*v_pageindex;
+
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_set_ddram_address(uint32_t v_cy, uint32_t v_cx)
+{
+	if((this->_ac_mode == this->_AC_DDRAM) && (this->_ac_row == v_cy) && (this->_ac_col == 2u*v_cx)) return;
+
+	/*Must be sent in basic instruction mode.*/
+	this->_send_byte(false, (uint8_t) (0x80 | (v_cy << 4) | v_cx), this->_CMD_SHORT_DELAY_US);
+
+	this->_ac_mode = this->_AC_DDRAM;
+	this->_ac_row = v_cy;
+	this->_ac_col = 2u*v_cx;
+
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_set_scroll_select(bool scroll)
+{
+	uint8_t byte = this->_SCROLL_SELECT_BYTE;
+
+	if(scroll) byte |= 0x01;
+
+	if(this->_scroll_select == ((int32_t) byte)) return;
+
+	/*Must be sent in extended instruction mode.*/
+	this->_set_instruction_mode(true);
+	this->_send_byte(false, byte, this->_CMD_SHORT_DELAY_US);
+
+	this->_scroll_select = (int32_t) byte;
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_send_scroll_position(void)
+{
+	this->_set_scroll_select(true);
+	this->_set_instruction_mode(true);
+	this->_send_byte(false, (uint8_t) (this->_SCROLL_ADDRESS_BYTE | this->_scroll_position), this->_CMD_SHORT_DELAY_US);
+
+	return;
+}
+
+template<class Geometry>
+uint32_t ST7920Panel<Geometry>::_gdram_row(uint32_t v_cy)
+{
+	return ((v_cy + this->_scroll_position) % this->_GDRAM_ROWS);
+}
+
+template<class Geometry>
+uint32_t ST7920Panel<Geometry>::_text_row(uint32_t v_cy)
+{
+	return ((v_cy + this->_scroll_position/16u) % this->_DDRAM_ROWS);
+}
+
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::_ddram_address(void)
+{
+	if(this->_ac_mode != this->_AC_DDRAM) return -1;
+
+	return (int32_t) (this->_AC_ROW_BYTES*this->_ac_row + this->_ac_col);
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::_ddram_shadow_is(uint32_t address, uint8_t byte)
+{
+	if(!(this->_ddram_known[address >> 5] & (1u << (address & 0x1f)))) return false;
+
+	return (this->_ddram_shadow[address] == byte);
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_ddram_shadow_set(uint32_t address, uint8_t byte)
+{
+	this->_ddram_shadow[address] = byte;
+	this->_ddram_known[address >> 5] |= (1u << (address & 0x1f));
+	return;
+}
+
+template<class Geometry>
+uint8_t ST7920Panel<Geometry>::_ddram_shadow_get(uint32_t address)
+{
+	/*Unknown: sent as a space*/
+	if(!(this->_ddram_known[address >> 5] & (1u << (address & 0x1f)))) return ' ';
+
+	return this->_ddram_shadow[address];
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_text_write(const uint8_t *bytes, uint32_t n_bytes)
+{
+	uint8_t run[_AC_ROW_BYTES];
+	uint32_t n_run = 0u;
+	uint32_t n_byte = 0u;
+	uint32_t address = 0u;
+	uint32_t word_address = 0u;
+	int32_t ac_address = -1;
+	bool hi_covered = false;
+	bool lo_covered = false;
+	bool changed = false;
+
+	if(!n_bytes) return;
+
+	/*No text cursor: the address counter is the cursor, if it's in DDRAM. Otherwise the text goes wherever it points to.*/
+	if(this->_text_cursor < 0) this->_text_cursor = this->_ddram_address();
+
+	if(this->_text_cursor < 0)
+	{
+		this->_set_instruction_mode(false);
+		this->_send_bytes(true, bytes, n_bytes, this->_CMD_SHORT_DELAY_US);
+
+		memset(this->_ddram_known, 0x00, sizeof(this->_ddram_known));
+		return;
+	}
+
+	/*
+	 * DDRAM is written a word (2 characters) at a time. Words already showing the text are skipped, the others are sent in runs,
+	 * each run starting with a DDRAM address (unless the address counter is already there).
+	 * A word only partly covered by the text: at the start, the high byte is sent again from the shadow (unless the address counter
+	 * is right after it); at the end, only the high byte is sent.
+	 */
+
+	address = (uint32_t) this->_text_cursor;
+	ac_address = this->_ddram_address();
+
+	while(n_byte < n_bytes)
+	{
+		word_address = address & ~0x1u;
+
+		hi_covered = !(address & 0x1);
+		lo_covered = !hi_covered || ((n_byte + 1u) < n_bytes);
+
+		changed = false;
+		if(hi_covered && !this->_ddram_shadow_is(word_address, bytes[n_byte])) changed = true;
+		if(lo_covered && !this->_ddram_shadow_is((word_address + 1u), bytes[n_byte + ((uint32_t) hi_covered)])) changed = true;
+
+		if(changed)
+		{
+			if(hi_covered || (ac_address != ((int32_t) (word_address + 1u))))
+			{
+				if(ac_address != ((int32_t) word_address))
+				{
+					this->_text_send_run(run, n_run);
+					n_run = 0u;
+
+					this->_set_instruction_mode(false);
+					this->_set_ddram_address((word_address/this->_AC_ROW_BYTES), ((word_address % this->_AC_ROW_BYTES)/2u));
+				}
+
+				if(hi_covered) this->_ddram_shadow_set(word_address, bytes[n_byte]);
+				else this->_ddram_shadow_set(word_address, this->_ddram_shadow_get(word_address));
+
+				run[n_run++] = this->_ddram_shadow[word_address];
+				ac_address = (int32_t) (word_address + 1u);
+			}
+
+			if(lo_covered)
+			{
+				this->_ddram_shadow_set((word_address + 1u), bytes[n_byte + ((uint32_t) hi_covered)]);
+
+				run[n_run++] = this->_ddram_shadow[word_address + 1u];
+				ac_address = (int32_t) (word_address + 2u);
+			}
+
+			/*End of a DDRAM row: the address counter position isn't tracked past it*/
+			if(!(ac_address % this->_AC_ROW_BYTES))
+			{
+				this->_text_send_run(run, n_run);
+				n_run = 0u;
+
+				ac_address = -1;
+			}
+		}
+
+		if(hi_covered) n_byte++;
+		if(lo_covered) n_byte++;
+
+		address = this->_text_wrap(word_address + 2u);
+		if(!lo_covered) address = word_address + 1u;
+	}
+
+	this->_text_send_run(run, n_run);
+
+	this->_text_cursor = (int32_t) address;
+	this->_text_sync_cursor();
+
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_text_send_run(const uint8_t *bytes, uint32_t n_bytes)
+{
+	if(!n_bytes) return;
+
+	this->_set_instruction_mode(false);
+	this->_send_bytes(true, bytes, n_bytes, this->_CMD_SHORT_DELAY_US);
+
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_text_sync_cursor(void)
+{
+	uint8_t byte = 0u;
+
+	if(this->_text_cursor < 0) return;
+
+	/*The address counter only has to follow the text cursor while the cursor is shown (or might be)*/
+	if((this->_display_control >= 0) && !(this->_display_control & 0x02)) return;
+
+	if(this->_ddram_address() == this->_text_cursor) return;
+
+	this->_set_instruction_mode(false);
+	this->_set_ddram_address((((uint32_t) this->_text_cursor)/this->_AC_ROW_BYTES), ((((uint32_t) this->_text_cursor) % this->_AC_ROW_BYTES)/2u));
+
+	/*Odd column: the first character of the word is sent again*/
+	if(this->_text_cursor & 0x1)
+	{
+		byte = this->_ddram_shadow_get((uint32_t) (this->_text_cursor - 1));
+		this->_ddram_shadow_set((uint32_t) (this->_text_cursor - 1), byte);
+		this->_send_byte(true, byte, this->_CMD_SHORT_DELAY_US);
+	}
+
+	return;
+}
+
+/*Address right after the end of a DDRAM row: start of the next text line (the last line wraps to the first). Otherwise unchanged.*/
+template<class Geometry>
+uint32_t ST7920Panel<Geometry>::_text_wrap(uint32_t address)
+{
+	uint32_t line = 0u;
+
+	if(address % this->_AC_ROW_BYTES) return address;
+
+	/*Text line of the row that ended. Row out of view: just the next row.*/
+	line = (address/this->_AC_ROW_BYTES + this->_DDRAM_ROWS - 1u - this->_text_row(0u)) % this->_DDRAM_ROWS;
+	if(line >= this->_N_LINES) return (address % this->_DDRAM_SIZE_BYTES);
+
+	return (this->_AC_ROW_BYTES*this->_text_row((line + 1u) % this->_N_LINES));
+}
+
+/*
+ * Moves the buffer up by n_rows screen rows (down if negative), blank rows coming in. Pages the display moves by itself
+ * (scrolled by shift_rows, same GDRAM column) keep their modified bit. The others are set in "moved" (to be painted now).
+ */
+template<class Geometry>
+void ST7920Panel<Geometry>::_scroll_buffer(int32_t n_rows, int32_t shift_rows, uint32_t *moved)
+{
+	int32_t cy = 0;
+	int32_t src_cy = 0;
+	int32_t step = 1;
+	uint32_t n_row = 0u;
+	uint32_t n_page = 0u;
+	uint32_t buffer_index = 0u;
+	uint32_t src_index = 0u;
+	uint32_t v_cy = 0u;
+	bool in_view = false;
+	bool in_place = false;
+	bool dirty = false;
+	uint16_t page_value = 0u;
+
+	memset(moved, 0x00, (this->_DIRTY_MAP_SIZE*sizeof(uint32_t)));
+
+	/*Rows are moved in the order that reads each source row before it's overwritten*/
+	if(n_rows < 0)
+	{
+		cy = (int32_t) (this->HEIGHT - 1u);
+		step = -1;
+	}
+
+	for(n_row = 0u; n_row < this->HEIGHT; n_row++)
+	{
+		buffer_index = this->_pixel_buffer_index(0u, (uint32_t) cy);
+		v_cy = buffer_index/this->_WIDTH_PAGES;
+
+		src_cy = cy + n_rows;
+		in_view = ((src_cy >= 0) && (src_cy < ((int32_t) this->HEIGHT)));
+		in_place = false;
+
+		if(in_view)
+		{
+			src_index = this->_pixel_buffer_index(0u, (uint32_t) src_cy);
+
+			/*The source page goes to the GDRAM row this page is painted to, once the display is scrolled*/
+			if(((src_index % this->_WIDTH_PAGES) == (buffer_index % this->_WIDTH_PAGES)) && ((src_index/this->_WIDTH_PAGES) == ((v_cy + this->_GDRAM_ROWS + ((uint32_t) shift_rows)) % this->_GDRAM_ROWS))) in_place = true;
+		}
+
+		for(n_page = 0u; n_page < this->WIDTH_PAGES; n_page++)
+		{
+			page_value = 0u;
+			dirty = false;
+
+			if(in_view)
+			{
+				page_value = this->_page_buffer[src_index + n_page];
+				dirty = this->_dirty_map_get(src_index + n_page);
+			}
+
+			this->_page_buffer[buffer_index + n_page] = page_value;
+
+			if(!in_place) moved[(buffer_index + n_page) >> 5] |= (1u << ((buffer_index + n_page) & 0x1f));
+
+			if(in_place && dirty) this->_dirty_map[(buffer_index + n_page) >> 5] |= (1u << ((buffer_index + n_page) & 0x1f));
+			else this->_dirty_map[(buffer_index + n_page) >> 5] &= ~(1u << ((buffer_index + n_page) & 0x1f));
+		}
+
+		cy += step;
+	}
+
+	return;
+}
+
+/*
+ * Text lines follow the scroll: each text line on screen (and the line partly on screen below, if any) gets the line that was n_lines
+ * below it, unless its DDRAM row already holds it. blank: all lines are blank. The text cursor stays at the same place on screen.
+ */
+template<class Geometry>
+void ST7920Panel<Geometry>::_scroll_text(uint32_t old_position, int32_t n_lines, bool blank)
+{
+	uint8_t shadow[_DDRAM_SIZE_BYTES];
+	uint8_t bytes[_AC_ROW_BYTES];
+	uint32_t old_row = old_position/16u;
+	uint32_t n_bands = 2u;
+	uint32_t n_halves = 1u;
+	uint32_t n_old_lines = 2u;
+	uint32_t band = 0u;
+	uint32_t half = 0u;
+	uint32_t src_half = 0u;
+	uint32_t line = 0u;
+	uint32_t address = 0u;
+	uint32_t src_address = 0u;
+	int32_t src_line = 0;
+	int32_t cursor = this->_text_cursor;
+
+	/*Lines on screen, in full or in part: bands of 16 rows (and the lower half of a folded panel)*/
+	if(this->_scroll_position % 16u) n_bands = 3u;
+	if(old_position % 16u) n_old_lines++;
+	if(this->_FOLDED)
+	{
+		n_halves = 2u;
+		n_old_lines += this->_N_LINES;
+	}
+
+	for(address = 0u; address < this->_DDRAM_SIZE_BYTES; address++) shadow[address] = this->_ddram_shadow_get(address);
+
+	for(band = 0u; band < n_bands; band++)
+	{
+		for(half = 0u; half < n_halves; half++)
+		{
+			line = band + this->_N_LINES*half;
+			address = this->_AC_ROW_BYTES*this->_text_row(band) + this->N_CHARS*half;
+
+			src_line = ((int32_t) line) + n_lines;
+
+			if(blank || (src_line < 0) || (src_line >= ((int32_t) n_old_lines))) memset(bytes, ' ', this->N_CHARS);
+			else
+			{
+				/*Folded: line 2 is on both halves (in part on the upper one), it's read from the lower one*/
+				src_half = 0u;
+				if(this->_FOLDED && (((uint32_t) src_line) >= this->_N_LINES)) src_half = 1u;
+
+				src_address = this->_AC_ROW_BYTES*((old_row + ((uint32_t) src_line) - this->_N_LINES*src_half) % this->_DDRAM_ROWS) + this->N_CHARS*src_half;
+				if(src_address == address) continue;
+
+				memcpy(bytes, &shadow[src_address], this->N_CHARS);
+			}
+
+			this->_text_cursor = (int32_t) address;
+			this->_text_write(bytes, this->N_CHARS);
+		}
+	}
+
+	if(cursor >= 0)
+	{
+		line = (((uint32_t) cursor)/this->_AC_ROW_BYTES + this->_DDRAM_ROWS - old_row) % this->_DDRAM_ROWS;
+		if(line < this->_N_LINES) cursor = (int32_t) (this->_AC_ROW_BYTES*this->_text_row(line) + ((uint32_t) cursor) % this->_AC_ROW_BYTES);
+	}
+
+	this->_text_cursor = cursor;
+	return;
+}
+
+/*Slot character (0x00 , 2*slot) somewhere in DDRAM (visible or not)*/
+template<class Geometry>
+bool ST7920Panel<Geometry>::_cgram_slot_shown(uint32_t slot)
+{
+	uint32_t address = 0u;
+
+	for(address = 0u; address < this->_DDRAM_SIZE_BYTES; address += 2u)
+	{
+		if(this->_ddram_shadow_is(address, 0x00) && this->_ddram_shadow_is((address + 1u), (uint8_t) (2u*slot))) return true;
+	}
+
+	return false;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_buffer_write_page(uint32_t buffer_index, uint16_t page_value)
+{
+	if(this->_page_buffer[buffer_index] == page_value) return;
+
+	this->_page_buffer[buffer_index] = page_value;
+	this->_dirty_map[buffer_index >> 5] |= (1u << (buffer_index & 0x1f));
+
+	return;
+}
+
+/*
+ * Paints the pages set in dirty (all pages if NULL).
+ * returns the buffer index of the first page not sent (write dropped), _BUFFER_SIZE_PAGES if all were.
+ */
+
+template<class Geometry>
+uint32_t ST7920Panel<Geometry>::_paint_pages(const uint16_t *pages, const uint32_t *dirty)
+{
+	uint32_t buffer_index = 0u;
+	uint32_t n_bytes = 0u;
+	uint16_t page_value = 0u;
+	uint8_t v_cy = 0u;
+	uint8_t v_pageindex = 0u;
+	uint8_t bytes[_WIDTH_PAGES*_PAGE_SIZE_BYTES];
+
+	this->_last_paint_byte_count = this->_bus_byte_count;
+
+	this->_set_instruction_mode(true);
+
+	for(v_cy = 0u; v_cy < ((uint8_t) this->_HEIGHT_PIXELS); v_cy++)
+	{
+		v_pageindex = 0u;
+		while(v_pageindex < ((uint8_t) this->_WIDTH_PAGES))
+		{
+			buffer_index = this->_WIDTH_PAGES*v_cy + v_pageindex;
+
+			if(!this->_map_get(dirty, buffer_index))
+			{
+				v_pageindex++;
+				continue;
+			}
+
+			/*Start of a run of modified pages. The display address counter auto increments within the run.*/
+			this->_set_gdram_address(this->_gdram_row(v_cy), v_pageindex);
+
+			n_bytes = 0u;
+			while((v_pageindex < ((uint8_t) this->_WIDTH_PAGES)) && this->_map_get(dirty, buffer_index))
+			{
+				page_value = pages[buffer_index];
+
+				bytes[n_bytes++] = (uint8_t) (page_value >> 8);
+				bytes[n_bytes++] = (uint8_t) (page_value & 0xff);
+
+				v_pageindex++;
+				buffer_index++;
+			}
+
+			if(this->_send_bytes(true, bytes, n_bytes, this->_CMD_SHORT_DELAY_US)) continue;
+
+			this->_last_paint_byte_count = this->_bus_byte_count - this->_last_paint_byte_count;
+			return (buffer_index - n_bytes/2u);
+		}
+	}
+
+	this->_last_paint_byte_count = this->_bus_byte_count - this->_last_paint_byte_count;
+	return this->_BUFFER_SIZE_PAGES;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_dirty_map_set_all(bool dirty)
+{
+	if(dirty) memset(this->_dirty_map, 0xff, (this->_DIRTY_MAP_SIZE*sizeof(uint32_t)));
+	else memset(this->_dirty_map, 0x00, (this->_DIRTY_MAP_SIZE*sizeof(uint32_t)));
+
+	return;
+}
+
+/*Pages below buffer index end were painted*/
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_dirty_map_clear_below(uint32_t end)
+{
+	uint32_t n_word = 0u;
+
+	for(n_word = 0u; n_word < (end >> 5); n_word++) this->_dirty_map[n_word] = 0u;
+
+	if(end & 0x1f) this->_dirty_map[n_word] &= ~((1u << (end & 0x1f)) - 1u);
+
+	return;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::_dirty_map_get(uint32_t buffer_index)
+{
+	if(this->_dirty_map[buffer_index >> 5] & (1u << (buffer_index & 0x1f))) return true;
+
+	return false;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::_paint_map_get(uint32_t buffer_index)
+{
+	if(this->_paint_map[buffer_index >> 5] & (1u << (buffer_index & 0x1f))) return true;
+
+	return false;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::_map_get(const uint32_t *map, uint32_t buffer_index)
+{
+	if(map == NULL) return true;
+	if(map[buffer_index >> 5] & (1u << (buffer_index & 0x1f))) return true;
+
+	return false;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_paint_cancel(void)
+{
+	uint32_t n_word = 0u;
+
+	/*Pages latched by bufferPaintBegin() and not painted yet go back to the dirty map.*/
+	for(n_word = 0u; n_word < this->_DIRTY_MAP_SIZE; n_word++)
+	{
+		this->_dirty_map[n_word] |= this->_paint_map[n_word];
+		this->_paint_map[n_word] = 0u;
+	}
+
+	this->_paint_active = false;
+	return;
+}
+
+/*Display state the driver keeps track of. The scroll position is not: it's the driver's, sent again by the caller.*/
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_forget_state(void)
+{
+	this->_function_set = -1;
+	this->_display_control = -1;
+	this->_scroll_select = -1;
+	this->_ac_mode = this->_AC_UNKNOWN;
+
+	memset(this->_ddram_known, 0x00, sizeof(this->_ddram_known));
+
+	this->invalidateCgramGlyphs();
+
+	return;
+}
+
+/*
+ * Around each call that sends. _bus_call_end() returns false if a write was dropped during the call: once the outermost call is done,
+ * the display state is forgotten, and the scroll position goes again with the next call.
+ */
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_bus_call_begin(void)
+{
+	this->_bus_call_depth++;
+
+	if((this->_bus_call_depth > 1u) || !this->_bus_resync) return;
+
+	this->_bus_resync = false;
+	this->_send_scroll_position();
+
+	return;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::_bus_call_end(void)
+{
+	this->_bus_call_depth--;
+
+	if(!this->_bus_dropped) return true;
+	if(this->_bus_call_depth) return false;
+
+	this->_bus_dropped = false;
+	this->_bus_resync = true;
+	this->_forget_state();
+
+	return false;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::_send_byte(bool reg, uint8_t byte, uint32_t cmddelay_us)
+{
+	return this->_send_bytes(reg, &byte, 1u, cmddelay_us);
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::_send_bytes(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+{
+#ifdef ST7920_STATS
+	uint32_t start_cycles = 0u;
+	uint32_t start_delay_us = 0u;
+#endif
+	uint32_t trace_cycles = 0u;
+	bool sent = false;
+
+	if(!n_bytes) return true;
+
+	/*A write was dropped: what follows in the call relies on it*/
+	if(this->_bus_dropped) return false;
+
+#ifdef ST7920_STATS
+	start_cycles = st7920_stats_cycles();
+	start_delay_us = this->_bus->getDelayUs();
+#endif
+
+	if(this->_tracer != NULL) trace_cycles = st7920_stats_cycles();
+
+	if(reg) sent = this->_bus->writeData(bytes, n_bytes, cmddelay_us);
+	else sent = this->_bus->writeCommands(bytes, n_bytes, cmddelay_us);
+
+	if(!sent)
+	{
+		this->_bus_dropped = true;
+		return false;
+	}
+
+	if(this->_tracer != NULL) this->_tracer->record(reg, bytes, n_bytes, cmddelay_us, trace_cycles, st7920_stats_cycles());
+
+#ifdef ST7920_STATS
+	this->_stats.countTransfer(reg, n_bytes, (this->_bus->getDelayUs() - start_delay_us), (st7920_stats_cycles() - start_cycles));
+#endif
+
+	this->_bus_byte_count += n_bytes;
+	if(!reg) this->_bus_command_count += n_bytes;
+
+	/*Data writes move the address counter. Past the end of a row, its position isn't tracked.*/
+	if(reg && (this->_ac_mode != this->_AC_UNKNOWN))
+	{
+		this->_ac_col += n_bytes;
+		if(this->_ac_col >= this->_AC_ROW_BYTES) this->_ac_mode = this->_AC_UNKNOWN;
+	}
+
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::_phys_cx_cy_to_virt_bufindex_pageindex_cy_offset(uint32_t cx, uint32_t cy, uint32_t *p_bufferindex, uint32_t *p_pageindex, uint32_t *p_cy, uint32_t *p_offset)
+{
+	uint32_t buffer_index = 0u;
+	uint32_t page_index = 0u;
+
+	if((cx >= this->WIDTH) || (cy >= this->HEIGHT)) return false;
+
+	page_index = cx/this->_PAGE_SIZE_PIXELS;
+	cx %= this->_PAGE_SIZE_PIXELS;
+	cx = this->_PAGE_SIZE_PIXELS - cx - 1u;
+
+	if(cy >= this->_HEIGHT_PIXELS)
 	{
 		cy -= this->_HEIGHT_PIXELS;
 		page_index += this->WIDTH_PAGES;
@@ -614,7 +1737,8 @@ bool ST7920::_phys_cx_cy_to_virt_bufindex_pageindex_cy_offset(uint32_t cx, uint3
 	return true;
 }
 
-bool ST7920::_phys_pageindex_cy_to_virt_bufindex_pageindex_cy(uint32_t page_index, uint32_t cy, uint32_t *p_bufferindex, uint32_t *p_pageindex, uint32_t *p_cy)
+template<class Geometry>
+bool ST7920Panel<Geometry>::_phys_pageindex_cy_to_virt_bufindex_pageindex_cy(uint32_t page_index, uint32_t cy, uint32_t *p_bufferindex, uint32_t *p_pageindex, uint32_t *p_cy)
 {
 	uint32_t buffer_index = 0u;
 
@@ -635,7 +1759,8 @@ bool ST7920::_phys_pageindex_cy_to_virt_bufindex_pageindex_cy(uint32_t page_inde
 	return true;
 }
 
-bool ST7920::_phys_text_cx_cy_to_virt_wtext_cx_cy_addspace(uint32_t cx, uint32_t cy, uint32_t *p_cx, uint32_t *p_cy, bool *p_addspace)
+template<class Geometry>
+bool ST7920Panel<Geometry>::_phys_text_cx_cy_to_virt_wtext_cx_cy_addspace(uint32_t cx, uint32_t cy, uint32_t *p_cx, uint32_t *p_cy, bool *p_addspace)
 {
 	bool add_space = false;
 
@@ -651,6 +1776,8 @@ bool ST7920::_phys_text_cx_cy_to_virt_wtext_cx_cy_addspace(uint32_t cx, uint32_t
 		cx += this->N_WCHARS;
 	}
 
+	cy = this->_text_row(cy);
+
 	if(p_cx != NULL) *p_cx = cx;
 	if(p_cy != NULL) *p_cy = cy;
 	if(p_addspace != NULL) *p_addspace = add_space;
@@ -658,7 +1785,8 @@ bool ST7920::_phys_text_cx_cy_to_virt_wtext_cx_cy_addspace(uint32_t cx, uint32_t
 	return true;
 }
 
-bool ST7920::_phys_wtext_cx_cy_to_virt_wtext_cx_cy(uint32_t cx, uint32_t cy, uint32_t *p_cx, uint32_t *p_cy)
+template<class Geometry>
+bool ST7920Panel<Geometry>::_phys_wtext_cx_cy_to_virt_wtext_cx_cy(uint32_t cx, uint32_t cy, uint32_t *p_cx, uint32_t *p_cy)
 {
 	if((cx >= this->N_WCHARS) || (cy >= this->N_LINES)) return false;
 
@@ -668,9 +1796,64 @@ bool ST7920::_phys_wtext_cx_cy_to_virt_wtext_cx_cy(uint32_t cx, uint32_t cy, uin
 		cx += this->N_WCHARS;
 	}
 
+	cy = this->_text_row(cy);
+
 	if(p_cx != NULL) *p_cx = cx;
 	if(p_cy != NULL) *p_cy = cy;
 
 	return true;
 }
 
+template<class Geometry>
+ST7920PinPanel<Geometry>::ST7920PinPanel(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t e)
+{
+	this->resetPinout(db0, db1, db2, db3, db4, db5, db6, db7, rs, e);
+}
+
+template<class Geometry>
+ST7920PinPanel<Geometry>::ST7920PinPanel(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t rw, uint8_t e)
+{
+	this->resetPinout(db0, db1, db2, db3, db4, db5, db6, db7, rs, rw, e);
+}
+
+template<class Geometry>
+ST7920PinPanel<Geometry>::ST7920PinPanel(uint8_t cs, SPIClass &spi)
+{
+	this->resetSerialPinout(cs, spi);
+}
+
+template<class Geometry>
+ST7920PinPanel<Geometry>::ST7920PinPanel(ST7920Bus &bus) : ST7920Panel<Geometry>(bus)
+{
+}
+
+template<class Geometry>
+void ST7920PinPanel<Geometry>::resetPinout(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t e)
+{
+	this->resetPinout(db0, db1, db2, db3, db4, db5, db6, db7, rs, this->PIN_NONE, e);
+	return;
+}
+
+template<class Geometry>
+void ST7920PinPanel<Geometry>::resetPinout(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t rw, uint8_t e)
+{
+	this->_parallel_bus.resetPinout(db0, db1, db2, db3, db4, db5, db6, db7, rs, rw, e);
+	this->resetBus(this->_parallel_bus);
+	return;
+}
+
+template<class Geometry>
+void ST7920PinPanel<Geometry>::resetSerialPinout(uint8_t cs, SPIClass &spi)
+{
+	this->_serial_bus.resetPinout(cs, spi);
+	this->resetBus(this->_serial_bus);
+	return;
+}
+
+template class ST7920Panel<ST7920Geometry128x64>;
+template class ST7920Panel<ST7920Geometry256x32>;
+template class ST7920Panel<ST7920Geometry192x32>;
+
+template class ST7920PinPanel<ST7920Geometry128x64>;
+template class ST7920PinPanel<ST7920Geometry256x32>;
+template class ST7920PinPanel<ST7920Geometry192x32>;
@@ -1,5 +1,5 @@
 /*
- * ST7920 Driver for Teensy boards (Arduino IDE) (Standard 128x64 ST7920 Displays Only!)
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
  * Version 1.1
  *
  * Author: Rafael Sabe
@@ -13,25 +13,135 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <Arduino.h>
+#include <SPI.h>
 
-struct _st7920_pinout {
-	uint8_t db0;
-	uint8_t db1;
-	uint8_t db2;
-	uint8_t db3;
-	uint8_t db4;
-	uint8_t db5;
-	uint8_t db6;
-	uint8_t db7;
-	uint8_t rs;
-	uint8_t rw; /*RESERVED*/
-	uint8_t e;
+#include "st7920_bus.hpp"
+#include "st7920_queue.hpp"
+#include "st7920_shared.hpp"
+#include "st7920_stats.hpp"
+#include "st7920_trace.hpp"
+#include "st7920_font.hpp"
+#include "st7920_anim.hpp"
+
+/*
+ * ST7920_REFRESH_SLOTS: number of pending refresh regions kept by refreshRequest() (16 bytes each). A request that finds every slot taken
+ * is merged into the region it grows the least.
+ */
+
+#ifndef ST7920_REFRESH_SLOTS
+#define ST7920_REFRESH_SLOTS 8u
+#endif
+
+/*
+ * A glyph as 32 bit rows, shifted right by "shift" pixels: written to two adjacent pages with plain word operations.
+ * Glyph cache entries (see setGlyphCache()) are 76 bytes each.
+ */
+
+struct _st7920_glyph_cache_entry {
+	const struct _st7920_font *font; /*NULL: entry not in use*/
+	uint8_t glyph;
+	uint8_t shift;
+	uint8_t width;
+	bool recent; /*Most recently used of its set*/
+	uint32_t rows[16];
+};
+
+/*
+ * Panel geometry traits (template parameter of ST7920Panel).
+ *
+ * WIDTH x HEIGHT: visible pixels. WIDTH must be a multiple of 16.
+ * FOLDED: the controller drives 32 GDRAM rows of up to 256 pixels. On a folded panel (128x64) the lower half of the screen is
+ * the right half of those rows (and text lines 2 - 3 the right half of DDRAM lines 0 - 1). Otherwise rows map straight to the screen.
+ *
+ * Text is 8x16 pixel characters: WIDTH/8 characters per line, HEIGHT/16 lines.
+ */
+
+struct ST7920Geometry128x64 {
+	static const uint32_t WIDTH = 128u;
+	static const uint32_t HEIGHT = 64u;
+	static const bool FOLDED = true;
+};
+
+struct ST7920Geometry256x32 {
+	static const uint32_t WIDTH = 256u;
+	static const uint32_t HEIGHT = 32u;
+	static const bool FOLDED = false;
+};
+
+struct ST7920Geometry192x32 {
+	static const uint32_t WIDTH = 192u;
+	static const uint32_t HEIGHT = 32u;
+	static const bool FOLDED = false;
+};
+
+/*
+ * A frame of the graphics buffer (GDRAM row layout), with the pages modified since the previous frame and the frame sequence number.
+ * Used for frame buffering (see setFrameBuffers()). Declare frames as ST7920::Frame.
+ */
+
+template<uint32_t N_PAGES>
+struct _st7920_frame {
+	uint16_t pages[N_PAGES];
+	uint32_t dirty[N_PAGES/32u];
+	uint32_t seq;
+};
+
+/*
+ * A pending refresh region (see refreshRequest()): 16 pixel page columns col0 - col1 of screen rows row0 - row1 (both ends included).
+ * Rows above row0 have been sent. Deadline: micros() time.
+ */
+
+struct _st7920_refresh_region {
+	uint32_t deadline_us;
+	uint8_t col0;
+	uint8_t col1;
+	uint8_t row0;
+	uint8_t row1;
+	uint8_t priority;
+	bool used;
+	bool missed; /*Deadline passed, already counted*/
 };
 
-class ST7920 {
+/*
+ * Refresh scheduler counters (see getRefreshStats()).
+ */
+
+struct _st7920_refresh_stats {
+	uint32_t requests; /*refreshRequest() calls accepted*/
+	uint32_t coalesced; /*Requests merged with a pending region*/
+	uint32_t completed; /*Regions fully sent*/
+	uint32_t missed; /*Regions not fully sent by their deadline*/
+	uint32_t max_late_us; /*Longest past its deadline a region was completed*/
+	uint32_t pages; /*Pages sent by refreshTick()*/
+	uint32_t ticks; /*refreshTick() calls*/
+	uint32_t max_tick_us; /*Longest refreshTick() call*/
+};
+
+/*
+ * ST7920Panel
+ * Driver for a panel with the given geometry, on a bus backend (see resetBus()). The methods are built for the geometries above (see the end of
+ * the source files). It holds no bus of its own: ST7920PinPanel adds the parallel and serial buses set up from pin numbers at runtime,
+ * ST7920Fixed a parallel bus with the pins fixed at compile time.
+ * ST7920 is the standard 128x64 panel (runtime pins).
+ */
+
+template<class Geometry>
+class ST7920Panel {
 	public:
-		ST7920(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t e);
-		~ST7920(void);
+		/*
+		 * Frame: a frame for setFrameBuffers() (WIDTH*HEIGHT/16 pages).
+		 */
+
+		typedef struct _st7920_frame<Geometry::WIDTH*Geometry::HEIGHT/16u> Frame;
+
+		/*
+		 * GlyphCacheEntry: an entry of the glyph cache given to setGlyphCache().
+		 */
+
+		typedef struct _st7920_glyph_cache_entry GlyphCacheEntry;
+
+		ST7920Panel(ST7920Bus &bus);
+		~ST7920Panel(void);
 
 		/* begin()
 		 * Initializes the st7920 object. Must be called before calling any other methods.
@@ -42,11 +152,40 @@ class ST7920 {
 		bool begin(void);
 
 		/*
-		 * resetPinout()
-		 * Sets the new pin layout for the display. Requires reinitialization ("begin()").
+		 * resetBus()
+		 * Sets a custom bus backend for the display. Requires reinitialization ("begin()").
+		 * The bus object must stay valid for as long as it's in use by the display.
+		 *
+		 * For asynchronous operation, wrap the display bus in an ST7920QueuedBus (see st7920_queue.hpp): every method then queues
+		 * its transfers and returns, and the queue is sent from a timer interrupt. Check its getFree() before each call: a full queue drops writes.
+		 * A call that had a write dropped sends nothing more, returns false (-1) and leaves the pages it didn't send modified. The display state
+		 * is forgotten (see invalidateStateCache(), the text cursor is kept): paint / print again once there's room.
+		 * Several displays sharing DB0 - DB7 and RS (one E pin each) each take an ST7920SharedBusDisplay (see st7920_shared.hpp).
 		 */
 
-		void resetPinout(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t e);
+		void resetBus(ST7920Bus &bus);
+
+		/*
+		 * beginTransaction() & endTransaction()
+		 *
+		 * Group several calls into a single bus transaction (e.g. one SPI transaction with chip select held, on the serial interface).
+		 * Transactions may be nested. The bus is released by the outermost endTransaction().
+		 *
+		 * returns true if successful, false otherwise.
+		 */
+
+		bool beginTransaction(void);
+		bool endTransaction(void);
+
+		/*
+		 * invalidateStateCache()
+		 *
+		 * The driver keeps track of the display state (instruction set, display mode, address counter, text and CGRAM glyphs) and skips commands that
+		 * wouldn't change it. Call this if the display state might have been changed by anything else (e.g. display reset).
+		 * The scroll position (see scrollDisplay()) is sent again.
+		 */
+
+		void invalidateStateCache(void);
 
 		/*
 		 * getStatus()
@@ -72,6 +211,17 @@ class ST7920 {
 
 		int32_t graphicDisplayIsEnabled(void);
 
+		/*
+		 * busyFlagIsEnabled()
+		 *
+		 * Busy flag polling is enabled when the RW pin is connected (parallel interface only). It's disabled (falling back to fixed delays) if the busy flag
+		 * doesn't clear within the timeout.
+		 *
+		 * returns 1 if the busy flag is being polled, 0 if fixed delays are being used, -1 if error.
+		 */
+
+		int32_t busyFlagIsEnabled(void);
+
 		/*
 		 * bufferSetPixel()
 		 *
@@ -152,6 +302,145 @@ class ST7920 {
 
 		bool bufferToggleAll(void);
 
+		/*
+		 * bufferSetPixels() & bufferSetPackedPixels()
+		 *
+		 * Batch pixel plotting. Draws n_points pixels using draw_mode (DRAWMODE_CLEAR, DRAWMODE_SET or DRAWMODE_TOGGLE).
+		 * bufferSetPixels() takes the coordinates in two arrays (xs[n] , ys[n]). bufferSetPackedPixels() takes one array of packed
+		 * coordinates (see packPixel()). Points outside the display are skipped.
+		 *
+		 * returns true if successful, false otherwise.
+		 */
+
+		bool bufferSetPixels(const uint16_t *xs, const uint16_t *ys, uint32_t n_points, int32_t draw_mode);
+		bool bufferSetPackedPixels(const uint16_t *points, uint32_t n_points, int32_t draw_mode);
+
+		/*
+		 * packPixel()
+		 *
+		 * returns the packed coordinates of pixel (cx , cy), for bufferSetPackedPixels().
+		 */
+
+		static uint16_t packPixel(uint32_t cx, uint32_t cy) { return (uint16_t) ((cy << 8) | (cx & 0xff)); }
+
+		/*
+		 * bufferSetPixelUnchecked() & bufferTogglePixelUnchecked()
+		 *
+		 * Same as bufferSetPixel() & bufferTogglePixel(), inline and without any checks.
+		 * Only for callers that guarantee begin() succeeded and cx < WIDTH, cy < HEIGHT. Anything else corrupts memory.
+		 */
+
+		void bufferSetPixelUnchecked(uint32_t cx, uint32_t cy, bool lit)
+		{
+			uint32_t buffer_index = this->_pixel_buffer_index(cx, cy);
+			uint16_t page_value = this->_page_buffer[buffer_index];
+
+			if(lit) page_value |= this->_pixel_mask(cx);
+			else page_value &= ~this->_pixel_mask(cx);
+
+			if(page_value == this->_page_buffer[buffer_index]) return;
+
+			this->_page_buffer[buffer_index] = page_value;
+			this->_dirty_map[buffer_index >> 5] |= (1u << (buffer_index & 0x1f));
+			return;
+		}
+
+		void bufferTogglePixelUnchecked(uint32_t cx, uint32_t cy)
+		{
+			uint32_t buffer_index = this->_pixel_buffer_index(cx, cy);
+
+			this->_page_buffer[buffer_index] ^= this->_pixel_mask(cx);
+			this->_dirty_map[buffer_index >> 5] |= (1u << (buffer_index & 0x1f));
+			return;
+		}
+
+		/*
+		 * Drawing primitives
+		 *
+		 * Draw on the buffer using draw_mode (DRAWMODE_CLEAR, DRAWMODE_SET or DRAWMODE_TOGGLE). Coordinates may be negative or beyond the display,
+		 * shapes are clipped. Horizontal runs of pixels are written a whole page at a time.
+		 * Every pixel of a shape is written once, so DRAWMODE_TOGGLE drawn twice restores the buffer.
+		 *
+		 * bufferDrawHLine(): w pixels to the right of (cx , cy). bufferDrawVLine(): h pixels down from (cx , cy).
+		 * bufferDrawLine(): line from (cx0 , cy0) to (cx1 , cy1), both ends included. Only the steps on the display are walked, whatever the length.
+		 * bufferDrawRect() & bufferFillRect(): w x h rectangle with top left corner at (cx , cy).
+		 * bufferDrawCircle() & bufferFillCircle(): circle centered at (cx , cy), radius r.
+		 * bufferDrawEllipse() & bufferFillEllipse(): ellipse centered at (cx , cy), radii rx (horizontal) and ry (vertical).
+		 * bufferDrawArc(): part of the circle outline from start_deg to end_deg (degrees, counter clockwise, 0 = right). A difference of 360 or more draws the whole circle.
+		 *
+		 * Radii are limited to MAX_RADIUS.
+		 *
+		 * returns true if successful, false otherwise.
+		 */
+
+		bool bufferDrawHLine(int32_t cx, int32_t cy, int32_t w, int32_t draw_mode);
+		bool bufferDrawVLine(int32_t cx, int32_t cy, int32_t h, int32_t draw_mode);
+		bool bufferDrawLine(int32_t cx0, int32_t cy0, int32_t cx1, int32_t cy1, int32_t draw_mode);
+		bool bufferDrawRect(int32_t cx, int32_t cy, int32_t w, int32_t h, int32_t draw_mode);
+		bool bufferFillRect(int32_t cx, int32_t cy, int32_t w, int32_t h, int32_t draw_mode);
+		bool bufferDrawCircle(int32_t cx, int32_t cy, uint32_t r, int32_t draw_mode);
+		bool bufferFillCircle(int32_t cx, int32_t cy, uint32_t r, int32_t draw_mode);
+		bool bufferDrawEllipse(int32_t cx, int32_t cy, uint32_t rx, uint32_t ry, int32_t draw_mode);
+		bool bufferFillEllipse(int32_t cx, int32_t cy, uint32_t rx, uint32_t ry, int32_t draw_mode);
+		bool bufferDrawArc(int32_t cx, int32_t cy, uint32_t r, int32_t start_deg, int32_t end_deg, int32_t draw_mode);
+
+		/*
+		 * bufferBlit()
+		 *
+		 * Draws a w x h bitmap with its top left corner at (cx , cy), at any x alignment, combining it with the buffer using raster_op:
+		 * RASTEROP_COPY (buffer = bitmap), RASTEROP_OR, RASTEROP_AND, RASTEROP_XOR (buffer = buffer op bitmap), RASTEROP_NOT (buffer = ~bitmap).
+		 * Bitmap rows are (w + 7)/8 bytes, leftmost pixel in the MSB of the first byte. The bitmap is clipped to the display.
+		 *
+		 * returns true if successful, false otherwise.
+		 */
+
+		bool bufferBlit(int32_t cx, int32_t cy, uint32_t w, uint32_t h, const uint8_t *bitmap, int32_t raster_op);
+
+		/*
+		 * bufferDrawChar() & bufferDrawText()
+		 *
+		 * Draws text on the buffer using a bitmap font (see st7920_font.hpp), with the top left corner of the first character at (cx , cy),
+		 * using draw_mode (DRAWMODE_CLEAR, DRAWMODE_SET or DRAWMODE_TOGGLE). Only the glyph pixels are drawn. Text is clipped to the display.
+		 * Characters missing from the font are drawn as '?'.
+		 *
+		 * With a glyph cache (see setGlyphCache()), glyphs are kept shifted to their pixel offset within the page, so text drawn again at
+		 * the same positions (labels, counters) is a few word operations per glyph row. Without one, each glyph is shifted as it's drawn.
+		 *
+		 * returns true if successful, false otherwise.
+		 */
+
+		bool bufferDrawChar(int32_t cx, int32_t cy, char c, const struct _st7920_font *font, int32_t draw_mode);
+		bool bufferDrawText(int32_t cx, int32_t cy, const char *text, const struct _st7920_font *font, int32_t draw_mode);
+
+		/*
+		 * measureText()
+		 *
+		 * returns the width in pixels of text drawn with font (no trailing spacing), -1 if error.
+		 */
+
+		int32_t measureText(const char *text, const struct _st7920_font *font);
+
+		/*
+		 * invalidateGlyphCache()
+		 *
+		 * Drops the cached glyphs. Must be called if a font in RAM is modified.
+		 */
+
+		void invalidateGlyphCache(void);
+
+		/*
+		 * setGlyphCache()
+		 *
+		 * Gives bufferDrawText() a glyph cache: n_entries entries (2 way set associative, must be even), provided by the caller.
+		 * n_entries = 0: no glyph cache (entries may be NULL). This is the default: the cache costs 76 bytes per entry, 32 entries are
+		 * enough for a few labels and counters.
+		 * The cache starts empty.
+		 *
+		 * returns true if successful, false otherwise.
+		 */
+
+		bool setGlyphCache(GlyphCacheEntry *entries, uint32_t n_entries);
+
 		/*
 		 * bufferPaintPixel() & bufferPaintPage()
 		 *
@@ -174,6 +463,204 @@ class ST7920 {
 
 		bool bufferPaintAll(void);
 
+		/*
+		 * bufferPaintDirty()
+		 *
+		 * Paints to the display only the pages that have been modified in the buffer since they were last painted.
+		 * The display address is set once for each run of adjacent modified pages within a buffer row.
+		 *
+		 * returns true if successful, false otherwise.
+		 */
+
+		bool bufferPaintDirty(void);
+
+		/*
+		 * bufferIsDirty()
+		 *
+		 * returns 1 if the buffer holds pages not yet painted to the display, 0 if it doesn't, -1 if error.
+		 */
+
+		int32_t bufferIsDirty(void);
+
+		/*
+		 * bufferPaintBegin() & bufferPaintStep()
+		 *
+		 * Incremental (non blocking) paint.
+		 * bufferPaintBegin() latches the pages to be painted: all pages if paint_all is true, only the modified pages otherwise.
+		 * bufferPaintStep() paints as many of the latched pages as fit within budget_us microseconds, then returns. It's meant to be called
+		 * once per loop() iteration until the paint is complete. Each step paints at least one page: a budget shorter than that (one page, plus
+		 * an instruction set switch if anything else was sent in between) is overrun.
+		 * Pages modified after being painted stay marked as modified, so they go with the next paint.
+		 *
+		 * bufferPaintBegin() returns true if successful, false otherwise.
+		 * bufferPaintStep() returns 1 if the paint is complete, 0 if there are pages left to paint, -1 if error.
+		 */
+
+		bool bufferPaintBegin(bool paint_all);
+		int32_t bufferPaintStep(uint32_t budget_us);
+
+		/*
+		 * refreshRequest() & refreshTick()
+		 *
+		 * Refresh scheduler: paints regions of the buffer at a steady rate, by priority, instead of full paints from here and there.
+		 * refreshRequest() asks for the w x h rectangle at (cx , cy) to be painted within deadline_us microseconds. Higher priority goes first.
+		 * A request overlapping a pending region is merged with it (bounding box, highest priority, earliest deadline).
+		 * refreshTick() is meant to be called at a fixed rate (e.g. every 20ms). It paints the pending regions, highest priority first (then
+		 * earliest deadline), as far as they fit within budget_us microseconds. A region cut short goes on from there on the next tick.
+		 * Each tick paints at least one page (if a pending region has any): a budget shorter than that (one page, plus an instruction set
+		 * switch if anything else was sent in between) is overrun.
+		 * Only the modified pages of a region are sent. Modified pages outside any region wait for a request (or bufferPaintDirty()).
+		 * A region not fully painted by its deadline is counted as missed (see getRefreshStats()), at the first tick past it.
+		 * Not available with frame buffering on (see setFrameBuffers()).
+		 *
+		 * refreshRequest() returns true if successful, false otherwise (rectangle off the screen).
+		 * refreshTick() returns the number of regions still pending, -1 if error.
+		 */
+
+		bool refreshRequest(int32_t cx, int32_t cy, int32_t w, int32_t h, uint8_t priority, uint32_t deadline_us);
+		int32_t refreshTick(uint32_t budget_us);
+
+		/*
+		 * refreshCancel()
+		 *
+		 * Drops every pending region. Their pages stay modified.
+		 */
+
+		void refreshCancel(void);
+
+		/*
+		 * getRefreshPendingCount()
+		 *
+		 * returns the number of regions waiting to be painted by refreshTick().
+		 */
+
+		uint32_t getRefreshPendingCount(void);
+
+		/*
+		 * getRefreshStats() & resetRefreshStats()
+		 *
+		 * Refresh scheduler counters: requests, coalesced requests, completed and missed regions, pages sent, tick durations.
+		 */
+
+		void getRefreshStats(struct _st7920_refresh_stats *p_stats);
+		void resetRefreshStats(void);
+
+		/*
+		 * setFrameBuffers()
+		 *
+		 * Frame buffering: drawing goes to a draw buffer, bufferPublish() hands it over as a complete frame and bufferPaintFrame() paints
+		 * the latest published frame. A refresh interrupt (or a second core / thread) can call bufferPaintFrame() while the application
+		 * keeps drawing: the display always gets whole frames, never a frame being drawn.
+		 *
+		 * frames: n_frames frames (in addition to the driver buffer), provided by the caller.
+		 * n_frames = 1: double buffering. bufferPublish() fails while the previous frame is being painted.
+		 * n_frames = 2: triple buffering. bufferPublish() never fails, frames published faster than they're painted are skipped.
+		 * n_frames = 0: frame buffering off (frames may be NULL). The draw buffer becomes the driver buffer, fully repainted by the next bufferPaintDirty().
+		 *
+		 * The draw buffer keeps its content across bufferPublish(), so frames can be drawn incrementally as usual.
+		 * While frame buffering is on, the display is painted by bufferPaintFrame() only: the other buffer paint methods return an error
+		 * and clearGraphics() only clears the draw buffer. Must not be called while bufferPaintFrame() may be running.
+		 *
+		 * returns true if successful, false otherwise.
+		 */
+
+		bool setFrameBuffers(Frame *frames, uint32_t n_frames);
+
+		/*
+		 * bufferPublish()
+		 *
+		 * Publishes the draw buffer as the next frame to be painted. Wait free. The draw buffer is replaced by a copy of the published frame.
+		 *
+		 * returns true if successful, false if error or (double buffering) the previous frame is still being painted: keep drawing and publish again later.
+		 */
+
+		bool bufferPublish(void);
+
+		/*
+		 * bufferPaintFrame()
+		 *
+		 * Paints the latest published frame, if it hasn't been painted yet. Only the pages modified since the previous frame are painted,
+		 * unless frames were skipped (then the whole frame is painted). Wait free. Safe to call from an interrupt or another thread than the one
+		 * drawing, provided nothing else uses the display bus meanwhile.
+		 *
+		 * returns 1 if a frame was painted, 0 if there was no new frame, -1 if error.
+		 */
+
+		int32_t bufferPaintFrame(void);
+
+		/*
+		 * animationBegin()
+		 *
+		 * Starts playing an animation (see st7920_anim.hpp) made for this panel. The data is read in place (e.g. from flash), one frame
+		 * per bufferAnimationFrame() call: it must stay valid (and unchanged) while playing. loop: start over after the last frame.
+		 *
+		 * returns true if successful, false otherwise (not a valid animation, or made for another panel).
+		 */
+
+		bool animationBegin(const uint8_t *anim, uint32_t size, bool loop);
+
+		/*
+		 * bufferAnimationFrame()
+		 *
+		 * Decodes the next frame of the animation into the buffer. Only the pages the frame changes are modified, so the next bufferPaintDirty()
+		 * (or bufferPublish()) sends just those. Delta frames apply to the buffer as the previous frame left it: anything drawn over the animation
+		 * stays until the next keyframe. A damaged frame isn't applied at all, and stops the animation.
+		 *
+		 * returns 1 if a frame was decoded, 0 if the animation is over, -1 if error (or no animation playing).
+		 */
+
+		int32_t bufferAnimationFrame(void);
+
+		/*
+		 * getAnimationFrameIndex() & getAnimationFramePeriod()
+		 *
+		 * returns the index of the frame last decoded / the frame period of the animation (ms), -1 if error (or no animation playing).
+		 */
+
+		int32_t getAnimationFrameIndex(void);
+		int32_t getAnimationFramePeriod(void);
+
+		/*
+		 * getBusByteCount(), getBusCommandCount() & resetBusByteCount()
+		 *
+		 * Gets the number of bytes (commands + data) / the number of commands sent to the display since the last reset.
+		 * resetBusByteCount() resets both counts.
+		 */
+
+		uint32_t getBusByteCount(void);
+		uint32_t getBusCommandCount(void);
+		void resetBusByteCount(void);
+
+		/*
+		 * getLastPaintByteCount()
+		 *
+		 * Returns the number of bytes (commands + data) sent to the display by the last bufferPaintAll() / bufferPaintDirty() call.
+		 */
+
+		uint32_t getLastPaintByteCount(void);
+
+		/*
+		 * setTracer()
+		 *
+		 * Records every byte sent to the display into tracer (see st7920_trace.hpp). NULL stops recording.
+		 *
+		 * returns true if successful, false otherwise (tracer storage not valid).
+		 */
+
+		bool setTracer(ST7920Tracer *tracer);
+
+#ifdef ST7920_STATS
+		/*
+		 * getStats() & resetStats()
+		 *
+		 * Performance counters, only with ST7920_STATS defined (see st7920_stats.hpp).
+		 * getStats() copies the counters of every counted method to p_stats. resetStats() clears them.
+		 */
+
+		void getStats(struct _st7920_stats *p_stats);
+		void resetStats(void);
+#endif
+
 		/*
 		 * clearGraphics()
 		 *
@@ -218,6 +705,7 @@ class ST7920 {
 		 * setTextCursorPosition() & setWTextCursorPosition()
 		 *
 		 * Sets the text cursor position on display
+		 * Nothing is sent until the next character is printed, unless the cursor is shown (see setDisplayMode()).
 		 *
 		 * returns true if successful, false otherwise.
 		 */
@@ -240,6 +728,7 @@ class ST7920 {
 		 *
 		 * Prints a text on display at the current cursor position.
 		 * printText(const char *text) requires a null terminator character '\0' at the end.
+		 * Only the characters that differ from what the display already shows are sent (2 characters at a time).
 		 *
 		 * returns true if successful, false otherwise.
 		 */
@@ -269,6 +758,52 @@ class ST7920 {
 		bool printWText(const uint16_t *wtext);
 		bool printWText(const uint16_t *wtext, uint32_t length);
 
+		/*
+		 * loadCgramGlyph()
+		 *
+		 * Makes a custom 16x16 glyph (16 rows, leftmost pixel in the MSB) printable as text. Any number of glyphs can be used: they share the
+		 * 4 CGRAM slots of the display, the least recently used glyph making room for a new one. A glyph is uploaded (34 bytes) only if it isn't
+		 * in CGRAM already. Glyphs are told apart by their address, so a glyph must stay in memory (and unchanged) while in use.
+		 * A glyph still showing somewhere on the text screen is never replaced (it would change on screen).
+		 * Uploading moves the address counter: if the text cursor was never set (setTextCursorPosition(), cursorHome(), clearDisplay()...),
+		 * set it before printing.
+		 *
+		 * returns the 16bit character code of the glyph (0x0000, 0x0002, 0x0004 or 0x0006) for printWChar()/printWText(),
+		 * -1 if error or if all 4 slots hold glyphs that are on screen.
+		 */
+
+		int32_t loadCgramGlyph(const uint16_t *glyph);
+
+		/*
+		 * printCgramGlyph()
+		 *
+		 * Prints a custom 16x16 glyph (see loadCgramGlyph()) at the current cursor position (Must be a valid wide char cursor position!).
+		 * Once the glyph is in CGRAM, it costs the same as printWChar(): 2 data bytes.
+		 *
+		 * returns true if successful, false otherwise.
+		 */
+
+		bool printCgramGlyph(const uint16_t *glyph);
+
+		/*
+		 * invalidateCgramGlyphs()
+		 *
+		 * Forgets which glyphs are in CGRAM (they're uploaded again when used). Must be called if a glyph in use is modified.
+		 */
+
+		void invalidateCgramGlyphs(void);
+
+		/*
+		 * getCgramGlyphHitCount(), getCgramGlyphMissCount() & resetCgramGlyphCounters()
+		 *
+		 * Gets the number of loadCgramGlyph()/printCgramGlyph() calls that found the glyph in CGRAM / that had to upload it, since the last reset.
+		 * resetCgramGlyphCounters() resets both counts.
+		 */
+
+		uint32_t getCgramGlyphHitCount(void);
+		uint32_t getCgramGlyphMissCount(void);
+		void resetCgramGlyphCounters(void);
+
 		/*
 		 * fillScreenChar() & fillScreenWChar()
 		 *
@@ -290,6 +825,30 @@ class ST7920 {
 
 		bool clearDisplay(void);
 
+		/*
+		 * scrollDisplay()
+		 *
+		 * Scrolls the whole screen (graphics and text) up by n_rows pixel rows (down if n_rows is negative), using the display vertical scroll.
+		 * The rows scrolled into view are blank. Pixel and text coordinates stay screen coordinates: the buffer and the text are scrolled along.
+		 * The display moves what it shows with a single command. Only what it can't move is sent, right away: the rows scrolled into view
+		 * and, on folded panels (128x64), the rows going from one half of the screen to the other. Pages modified before the scroll stay
+		 * modified (painted by the next buffer paint).
+		 * Text lines are only in place while the scroll position is a multiple of 16 rows (see getScrollPosition()).
+		 * begin() expects the display not to be scrolled (power on state). Not available while frame buffering is on (see setFrameBuffers()).
+		 *
+		 * returns true if successful, false otherwise.
+		 */
+
+		bool scrollDisplay(int32_t n_rows);
+
+		/*
+		 * getScrollPosition()
+		 *
+		 * returns the display vertical scroll position (0 - 63: the display RAM row shown on the first screen row), -1 if error.
+		 */
+
+		int32_t getScrollPosition(void);
+
 		enum Status {
 			_STATUS_ERROR = -1,
 			_STATUS_UNINITIALIZED = 0,
@@ -303,42 +862,260 @@ class ST7920 {
 			DISPLAYMODE_DISPLAY_ON_CURSOR_BLINK = 3
 		};
 
+		enum DrawMode {
+			DRAWMODE_CLEAR = 0,
+			DRAWMODE_SET = 1,
+			DRAWMODE_TOGGLE = 2
+		};
+
+		enum RasterOp {
+			RASTEROP_COPY = 0,
+			RASTEROP_OR = 1,
+			RASTEROP_AND = 2,
+			RASTEROP_XOR = 3,
+			RASTEROP_NOT = 4
+		};
+
+	protected:
+		/*No bus: set one (resetBus()) before begin()*/
+		ST7920Panel(void) {}
+
 	private:
+		/*
+		 * Buffer (GDRAM) geometry: _HEIGHT_PIXELS rows of _WIDTH_PIXELS. DDRAM: _N_LINES lines of _N_CHARS.
+		 * Folded panel: twice as wide and half as tall as the screen.
+		 */
+
+		static const bool _FOLDED = Geometry::FOLDED;
+
 		static const uint32_t _PAGE_SIZE_PIXELS = 16u;
 		static const uint32_t _PAGE_SIZE_BYTES = 2u;
-		static const uint32_t _HEIGHT_PIXELS = 32u;
-		static const uint32_t _WIDTH_PIXELS = 256u;
+		static const uint32_t _HEIGHT_PIXELS = _FOLDED ? (Geometry::HEIGHT/2u) : Geometry::HEIGHT;
+		static const uint32_t _WIDTH_PIXELS = _FOLDED ? (2u*Geometry::WIDTH) : Geometry::WIDTH;
 		static const uint32_t _WIDTH_PAGES = _WIDTH_PIXELS/_PAGE_SIZE_PIXELS;
 		static const uint32_t _BUFFER_SIZE_PAGES = _WIDTH_PAGES*_HEIGHT_PIXELS;
 		static const uint32_t _BUFFER_SIZE_BYTES = _BUFFER_SIZE_PAGES*_PAGE_SIZE_BYTES;
 
-		static const uint32_t _N_WCHARS = 16u;
-		static const uint32_t _N_LINES = 2u;
+		static const uint32_t _N_WCHARS = _WIDTH_PIXELS/16u;
+		static const uint32_t _N_LINES = _HEIGHT_PIXELS/16u;
 		static const uint32_t _N_CHARS = 2u*_N_WCHARS;
 
+		static_assert((Geometry::WIDTH % _PAGE_SIZE_PIXELS) == 0u, "ST7920 panel width must be a multiple of 16");
+		static_assert((_WIDTH_PIXELS > 0u) && (_WIDTH_PIXELS <= 256u), "ST7920 GDRAM rows are 256 pixels at most");
+		static_assert(_HEIGHT_PIXELS == 32u, "ST7920 panels are 32 GDRAM rows (64 pixels tall when folded)");
+		static_assert((_WIDTH_PAGES*_PAGE_SIZE_BYTES) <= ST7920QueuedBus::MAX_WRITE_BYTES, "ST7920 GDRAM row writes must fit ST7920QueuedBus::MAX_WRITE_BYTES");
+
 		static const uint32_t _CMD_LONG_DELAY_US = 1024u;
 		static const uint32_t _CMD_SHORT_DELAY_US = 128u;
-		static const uint32_t _EN_DELAY_US = 1u;
+		static const uint32_t _CMD_CLEAR_DELAY_US = 1664u; /*Display clear takes 1.6ms*/
+
+		/*Worst case time of a single transfer (command delay + enable strobe + pin writes). Used to plan bufferPaintStep().*/
+		static const uint32_t _SHORT_TRANSFER_US = _CMD_SHORT_DELAY_US + 8u;
+		static const uint32_t _LONG_TRANSFER_US = _CMD_LONG_DELAY_US + 8u;
 
 		static const uint8_t _BASIC_INSTRUCTION_BYTE = 0x30;
 		static const uint8_t _EXT_INSTRUCTION_BYTE = 0x34;
 		static const uint8_t _GRAPHIC_DISPLAY_ENABLE_BIT = 0x02;
+		static const uint8_t _SCROLL_SELECT_BYTE = 0x02; /*Extended: | 0x01 (SR) for scroll address, CGRAM address otherwise*/
+		static const uint8_t _SCROLL_ADDRESS_BYTE = 0x40; /*Extended, SR = 1: | scroll position*/
+
+		/*GDRAM: 64 rows, 32 of them on the screen from the scroll position on. DDRAM: 4 rows of 16 words, 2 on the screen.*/
+		static const uint32_t _GDRAM_ROWS = 64u;
+		static const uint32_t _DDRAM_ROWS = 4u;
 
 		int32_t _status = this->_STATUS_UNINITIALIZED;
 
-		struct _st7920_pinout pins;
-		uint16_t _page_buffer[_BUFFER_SIZE_PAGES] = {0u};
+		ST7920Bus *_bus = NULL;
+
+		/*Driver buffer. Draw buffer unless frame buffering is on.*/
+		Frame _frame = {};
+
+		uint16_t *_page_buffer = this->_frame.pages;
+
+		/*One bit per buffer page. Set when the page is modified, cleared when the page is painted (or published).*/
+		static const uint32_t _DIRTY_MAP_SIZE = _BUFFER_SIZE_PAGES/32u;
+		uint32_t *_dirty_map = this->_frame.dirty;
+
+		static_assert((sizeof(_frame.pages)/sizeof(uint16_t)) == _BUFFER_SIZE_PAGES, "struct _st7920_frame pages size mismatch");
+		static_assert((sizeof(_frame.dirty)/sizeof(uint32_t)) == _DIRTY_MAP_SIZE, "struct _st7920_frame dirty size mismatch");
+
+		/*
+		 * Frame buffering. Frame index 0 is the driver buffer.
+		 * _draw_frame is owned by bufferPublish(), _scan_frame by bufferPaintFrame(). They exchange frames through _ready_frame only.
+		 */
+
+		static const uint8_t _FRAME_FRESH = 0x80; /*_ready_frame holds a frame not painted yet*/
+		static const uint8_t _FRAME_NONE = 0x7f; /*No frame (double buffering: the frame is being painted)*/
+
+		Frame *_frames[3] = {&this->_frame, NULL, NULL};
+		uint32_t _frame_count = 1u;
+		uint8_t _draw_frame = 0u;
+		uint8_t _scan_frame = this->_FRAME_NONE;
+		volatile uint8_t _ready_frame = this->_FRAME_NONE;
+		uint32_t _publish_seq = 0u;
+		uint32_t _scan_seq = 0u;
+
+		/*Incremental paint: pages latched by bufferPaintBegin() and not painted yet.*/
+		uint32_t _paint_map[_DIRTY_MAP_SIZE] = {0u};
+		uint32_t _paint_index = 0u;
+		bool _paint_active = false;
+
+		/*Refresh scheduler (see st7920_refresh.cpp)*/
+		struct _st7920_refresh_region _refresh_regions[ST7920_REFRESH_SLOTS] = {};
+		struct _st7920_refresh_stats _refresh_stats = {};
+
+		uint32_t _bus_byte_count = 0u;
+		uint32_t _bus_command_count = 0u;
+		uint32_t _last_paint_byte_count = 0u;
+
+		/*
+		 * Dropped bus writes. Once a write is dropped, nothing more is sent until the outermost call returns (_bus_call_depth), then
+		 * the display state is forgotten and the scroll position is sent again at the start of the next call (_bus_resync).
+		 */
+		uint32_t _bus_call_depth = 0u;
+		bool _bus_dropped = false;
+		bool _bus_resync = false;
+
+#ifdef ST7920_STATS
+		ST7920Stats _stats;
+#endif
+
+		ST7920Tracer *_tracer = NULL;
 
 		bool _graphic_display_enabled = false;
 
+		/*Display state cache. -1: unknown.*/
+		int32_t _function_set = -1;
+		int32_t _display_control = -1;
+		int32_t _scroll_select = -1;
+
+		/*Vertical scroll position. Buffer row v is painted to GDRAM row (v + _scroll_position) % _GDRAM_ROWS.*/
+		uint32_t _scroll_position = 0u;
+
+		/*
+		 * Address counter cache. The address counter is shared by DDRAM (text) and GDRAM (graphics).
+		 * row: DDRAM line / GDRAM vertical address. col: byte position within the row.
+		 */
+
+		enum AddressCounterMode {
+			_AC_UNKNOWN = 0,
+			_AC_DDRAM = 1,
+			_AC_GDRAM = 2
+		};
+
+		static const uint32_t _AC_ROW_BYTES = 32u; /*16 words per DDRAM/GDRAM row, whatever the panel width*/
+
+		int32_t _ac_mode = this->_AC_UNKNOWN;
+		uint32_t _ac_row = 0u;
+		uint32_t _ac_col = 0u;
+
+		/*
+		 * DDRAM (text) shadow: what the display holds, 4 rows of 32 bytes, with one known bit per byte.
+		 * Text cursor: DDRAM byte address where the next character goes. -1: unknown (the address counter is used).
+		 * Text line 0 is DDRAM row _scroll_position/16, line 1 the next row (folded panel: lines 2 - 3 are the right half of those rows).
+		 */
+
+		static const uint32_t _DDRAM_SIZE_BYTES = _DDRAM_ROWS*_AC_ROW_BYTES;
+
+		uint8_t _ddram_shadow[_DDRAM_SIZE_BYTES] = {0u};
+		uint32_t _ddram_known[_DDRAM_ROWS] = {0u, 0u, 0u, 0u};
+		int32_t _text_cursor = -1;
+
+		/*
+		 * CGRAM glyph slots: glyph held by each slot (NULL: none / unknown) and when it was last used (LRU).
+		 */
+
+		static const uint32_t _N_CGRAM_SLOTS = 4u;
+
+		const uint16_t *_cgram_glyph[_N_CGRAM_SLOTS] = {NULL, NULL, NULL, NULL};
+		uint32_t _cgram_last_use[_N_CGRAM_SLOTS] = {0u, 0u, 0u, 0u};
+		uint32_t _cgram_use_count = 0u;
+		uint32_t _cgram_hit_count = 0u;
+		uint32_t _cgram_miss_count = 0u;
+
+		uint32_t _transaction_depth = 0u;
+
+		/*
+		 * Animation being played (see st7920_anim.hpp). NULL: none. Offset: next frame. _anim_frame: frames decoded since the first one.
+		 */
+
+		const uint8_t *_anim_data = NULL;
+		uint32_t _anim_size = 0u;
+		uint32_t _anim_offset = 0u;
+		uint32_t _anim_n_frames = 0u;
+		uint32_t _anim_frame = 0u;
+		uint32_t _anim_period_ms = 0u;
+		bool _anim_loop = false;
+
+		struct _st7920_glyph_cache_entry *_glyph_cache = NULL;
+		uint32_t _glyph_cache_size = 0u;
+
 		void _set_instruction_mode(bool ext);
+		uint8_t _instruction_mode_byte(bool ext);
+		uint32_t _instruction_mode_switch_us(bool ext);
+		void _set_gdram_address(uint32_t v_cy, uint32_t v_pageindex);
+		void _set_ddram_address(uint32_t v_cy, uint32_t v_cx);
+		void _set_scroll_select(bool scroll);
+		void _send_scroll_position(void);
+		uint32_t _gdram_row(uint32_t v_cy);
+		uint32_t _text_row(uint32_t v_cy);
+
+		int32_t _ddram_address(void);
+		bool _ddram_shadow_is(uint32_t address, uint8_t byte);
+		void _ddram_shadow_set(uint32_t address, uint8_t byte);
+		uint8_t _ddram_shadow_get(uint32_t address);
+		void _text_write(const uint8_t *bytes, uint32_t n_bytes);
+		void _text_send_run(const uint8_t *bytes, uint32_t n_bytes);
+		void _text_sync_cursor(void);
+		uint32_t _text_wrap(uint32_t address);
+		void _scroll_buffer(int32_t n_rows, int32_t shift_rows, uint32_t *moved);
+		void _scroll_text(uint32_t old_position, int32_t n_lines, bool blank);
+		bool _cgram_slot_shown(uint32_t slot);
+
+		void _buffer_write_page(uint32_t buffer_index, uint16_t page_value);
+		void _buffer_modify_page(uint32_t buffer_index, uint16_t mask, int32_t draw_mode);
+		void _buffer_plot(int32_t cx, int32_t cy, int32_t draw_mode);
+		void _buffer_hspan(int32_t cx0, int32_t cx1, int32_t cy, int32_t draw_mode);
+		void _buffer_vspan(int32_t cx, int32_t cy0, int32_t cy1, int32_t draw_mode);
+		void _buffer_ellipse(int32_t cx, int32_t cy, uint32_t rx, uint32_t ry, bool fill, int32_t draw_mode);
+		void _buffer_arc(int32_t cx, int32_t cy, uint32_t r, int32_t start_deg, int32_t end_deg, int32_t draw_mode);
+		bool _draw_mode_is_valid(int32_t draw_mode);
+		int32_t _font_glyph_index(const struct _st7920_font *font, char c);
+		uint32_t _font_glyph_width(const struct _st7920_font *font, uint32_t glyph);
+		const struct _st7920_glyph_cache_entry *_glyph_cache_get(const struct _st7920_font *font, uint32_t glyph, uint32_t shift, struct _st7920_glyph_cache_entry *p_scratch);
+		void _glyph_shift(const struct _st7920_font *font, uint32_t glyph, uint32_t shift, struct _st7920_glyph_cache_entry *entry);
+		void _buffer_draw_text(int32_t cx, int32_t cy, const char *text, uint32_t length, const struct _st7920_font *font, int32_t draw_mode);
+		void _buffer_modify_chunk(uint32_t buffer_index, uint32_t n_pages, uint32_t source, uint32_t mask, int32_t raster_op);
+		uint32_t _paint_pages(const uint16_t *pages, const uint32_t *dirty);
+		bool _anim_decode(const uint8_t *payload, uint32_t n_bytes, bool delta, bool apply);
+		void _dirty_map_set_all(bool dirty);
+		void _dirty_map_clear_below(uint32_t end);
+		bool _dirty_map_get(uint32_t buffer_index);
+		bool _paint_map_get(uint32_t buffer_index);
+		static bool _map_get(const uint32_t *map, uint32_t buffer_index);
+		void _paint_cancel(void);
+		bool _refresh_send(struct _st7920_refresh_region *p_region, uint32_t start_us, uint32_t budget_us, bool *p_first_run);
+		void _refresh_merge(struct _st7920_refresh_region *p_region, const struct _st7920_refresh_region *p_other);
+
+		void _forget_state(void);
+		void _bus_call_begin(void);
+		bool _bus_call_end(void);
+
+		bool _send_byte(bool reg, uint8_t byte, uint32_t cmddelay_us);
+		bool _send_bytes(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us);
 
-		void _send_byte(bool reg, uint8_t byte, uint32_t cmddelay_us);
-		void _write_byte(uint8_t byte);
+		/*
+		 * Buffer index and bit mask of pixel (cx , cy), no checks. Folded panel: rows 32 - 63 are the right half of buffer rows 0 - 31.
+		 */
+
+		static uint32_t _pixel_buffer_index(uint32_t cx, uint32_t cy)
+		{
+			if(_FOLDED) return (_WIDTH_PAGES*(cy % _HEIGHT_PIXELS) + (cy/_HEIGHT_PIXELS)*(_WIDTH_PAGES/2u) + (cx >> 4));
 
-		void _set_dataline_mode(bool output);
+			return (_WIDTH_PAGES*cy + (cx >> 4));
+		}
 
-		bool _validate_pins(void);
+		static uint16_t _pixel_mask(uint32_t cx) { return (uint16_t) (0x8000 >> (cx & 0xf)); }
 
 		bool _phys_cx_cy_to_virt_bufindex_pageindex_cy_offset(uint32_t cx, uint32_t cy, uint32_t *p_bufferindex, uint32_t *p_pageindex, uint32_t *p_cy, uint32_t *p_offset);
 		bool _phys_pageindex_cy_to_virt_bufindex_pageindex_cy(uint32_t page_index, uint32_t cy, uint32_t *p_bufferindex, uint32_t *p_pageindex, uint32_t *p_cy);
@@ -347,28 +1124,103 @@ class ST7920 {
 		bool _phys_wtext_cx_cy_to_virt_wtext_cx_cy(uint32_t cx, uint32_t cy, uint32_t *p_cx, uint32_t *p_cy);
 
 	public:
+		/*
+		 * PIN_NONE: value for optional pins that are not connected.
+		 */
+
+		static const uint8_t PIN_NONE = ST7920Bus::PIN_NONE;
+
 		/*
 		 * Display Size Constants:
-		 * Display is 128x64 pixels.
 		 * Pixels are organized in pages.
 		 * A Page is 16 horizontal adjancent pixels.
 		 *
-		 * WIDTH = 128 (pixels wide)
-		 * HEIGHT = 64 (pixels tall)
-		 * WIDTH_PAGES = 8 (16 pixel pages wide)
+		 * WIDTH (pixels wide): 128 / 256 / 192
+		 * HEIGHT (pixels tall): 64 / 32 / 32
+		 * WIDTH_PAGES (16 pixel pages wide): 8 / 16 / 12
 		 *
-		 * N_CHARS = 16 (8bit ASCII characters per line)
-		 * N_LINES = 4 (number of text lines on display)
-		 * N_WCHARS = 8 (16bit GB wide characters per line)
+		 * N_CHARS (8bit ASCII characters per line): 16 / 32 / 24
+		 * N_LINES (number of text lines on display): 4 / 2 / 2
+		 * N_WCHARS (16bit GB wide characters per line): 8 / 16 / 12
 		 */
 
-		static const uint32_t WIDTH = _WIDTH_PIXELS/2u;
-		static const uint32_t HEIGHT = _HEIGHT_PIXELS*2u;
-		static const uint32_t WIDTH_PAGES = _WIDTH_PAGES/2u;
+		static const uint32_t WIDTH = Geometry::WIDTH;
+		static const uint32_t HEIGHT = Geometry::HEIGHT;
+		static const uint32_t WIDTH_PAGES = WIDTH/_PAGE_SIZE_PIXELS;
+
+		static const uint32_t N_CHARS = WIDTH/8u;
+		static const uint32_t N_LINES = HEIGHT/16u;
+		static const uint32_t N_WCHARS = N_CHARS/2u;
+
+		/*
+		 * MAX_RADIUS: largest radius accepted by the circle/ellipse/arc primitives.
+		 */
 
-		static const uint32_t N_CHARS = _N_CHARS/2u;
-		static const uint32_t N_LINES = _N_LINES*2u;
-		static const uint32_t N_WCHARS = _N_WCHARS/2u;
+		static const uint32_t MAX_RADIUS = 8191u;
+};
+
+/*
+ * ST7920PinPanel
+ * Panel driven through pins set at runtime: parallel (ST7920ParallelBus) or serial (ST7920SerialBus) interface, or any bus backend.
+ */
+
+template<class Geometry>
+class ST7920PinPanel : public ST7920Panel<Geometry> {
+	public:
+		ST7920PinPanel(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t e);
+		ST7920PinPanel(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t rw, uint8_t e);
+		ST7920PinPanel(uint8_t cs, SPIClass &spi);
+		ST7920PinPanel(ST7920Bus &bus);
+
+		/*
+		 * resetPinout()
+		 * Sets the new pin layout for the display. Requires reinitialization ("begin()").
+		 *
+		 * RW is optional. If connected, the driver reads the display busy flag instead of waiting a fixed delay after each transfer.
+		 * Reading the busy flag makes the display drive the data lines: make sure the board pins tolerate the display logic level.
+		 */
+
+		void resetPinout(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t e);
+		void resetPinout(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t rw, uint8_t e);
+
+		/*
+		 * resetSerialPinout()
+		 * Sets the display to serial interface mode (PSB pin tied low). Requires reinitialization ("begin()").
+		 *
+		 * cs is the pin connected to the display CS (RS) pin. Display SID and SCLK go to the MOSI and SCK pins of the given SPI port.
+		 */
+
+		void resetSerialPinout(uint8_t cs, SPIClass &spi);
+
+	private:
+		ST7920ParallelBus _parallel_bus;
+		ST7920SerialBus _serial_bus;
+};
+
+/*
+ * ST7920: standard 128x64 panel. ST7920_256x32 & ST7920_192x32: single line (unfolded) panels.
+ */
+
+typedef ST7920PinPanel<ST7920Geometry128x64> ST7920;
+typedef ST7920PinPanel<ST7920Geometry256x32> ST7920_256x32;
+typedef ST7920PinPanel<ST7920Geometry192x32> ST7920_192x32;
+
+/*
+ * ST7920Fixed
+ * Parallel interface display with the pins fixed at compile time (see ST7920FixedBus). The pins are checked at compile time.
+ * Holds no pin table: the only bus is the ST7920FixedBus. RW is optional (ST7920Bus::PIN_NONE if not connected). Geometry defaults to the standard 128x64 panel.
+ *
+ * e.g. ST7920Fixed<2, 3, 4, 5, 6, 7, 8, 9, 10, 11> st7920; (DB0 - DB7, RS, E)
+ */
+
+template<uint8_t DB0, uint8_t DB1, uint8_t DB2, uint8_t DB3, uint8_t DB4, uint8_t DB5, uint8_t DB6, uint8_t DB7, uint8_t RS, uint8_t E, uint8_t RW = ST7920Bus::PIN_NONE, class Geometry = ST7920Geometry128x64>
+class ST7920Fixed : public ST7920Panel<Geometry> {
+	public:
+		/*The bus is only used from begin() on, once constructed*/
+		ST7920Fixed(void) : ST7920Panel<Geometry>(this->_fixed_bus) {}
+
+	private:
+		ST7920FixedBus<DB0, DB1, DB2, DB3, DB4, DB5, DB6, DB7, RS, E, RW> _fixed_bus;
 };
 
 #endif /*ST7920_HPP*/
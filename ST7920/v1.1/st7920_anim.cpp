@@ -0,0 +1,191 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Animation playback (format: see st7920_anim.hpp).
+ *
+ * Frames are decoded straight into the buffer, one run at a time: zero runs of a delta frame are skipped, the other pages go through
+ * the same write as any drawing, so only the pages that actually change are marked modified (and painted).
+ * Each frame is checked before it's applied: a damaged frame never leaves the buffer half decoded.
+ */
+
+#include "st7920.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t st7920_anim_u16(const uint8_t *bytes)
+{
+	return (((uint32_t) bytes[0]) | (((uint32_t) bytes[1]) << 8));
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::animationBegin(const uint8_t *anim, uint32_t size, bool loop)
+{
+	this->_anim_data = NULL;
+
+	if(this->_status < 1) return false;
+	if(anim == NULL) return false;
+	if(size < (ST7920_ANIM_HEADER_SIZE + ST7920_ANIM_FRAME_HEADER_SIZE)) return false;
+
+	if((anim[0] != 'S') || (anim[1] != '7') || (anim[2] != 'A') || (anim[3] != 'N')) return false;
+	if(anim[4] != ST7920_ANIM_VERSION) return false;
+
+	if(st7920_anim_u16(&anim[6]) != this->WIDTH) return false;
+	if(st7920_anim_u16(&anim[8]) != this->HEIGHT) return false;
+	if(!st7920_anim_u16(&anim[10])) return false;
+
+	/*Decoding starts from a keyframe*/
+	if(anim[ST7920_ANIM_HEADER_SIZE] != ST7920_ANIM_KEYFRAME) return false;
+
+	this->_anim_data = anim;
+	this->_anim_size = size;
+	this->_anim_offset = ST7920_ANIM_HEADER_SIZE;
+	this->_anim_n_frames = st7920_anim_u16(&anim[10]);
+	this->_anim_frame = 0u;
+	this->_anim_period_ms = st7920_anim_u16(&anim[12]);
+	this->_anim_loop = loop;
+
+	return true;
+}
+
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::bufferAnimationFrame(void)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_ANIMATION_FRAME);
+
+	const uint8_t *anim = this->_anim_data;
+	const uint8_t *frame = NULL;
+	uint32_t n_bytes = 0u;
+	bool delta = false;
+
+	if(this->_status < 1) return -1;
+	if(anim == NULL) return -1;
+
+	if(this->_anim_frame >= this->_anim_n_frames)
+	{
+		if(!this->_anim_loop) return 0;
+
+		this->_anim_offset = ST7920_ANIM_HEADER_SIZE;
+		this->_anim_frame = 0u;
+	}
+
+	/*Damaged frame: the animation stops there*/
+	this->_anim_data = NULL;
+
+	if((this->_anim_offset + ST7920_ANIM_FRAME_HEADER_SIZE) > this->_anim_size) return -1;
+
+	frame = &anim[this->_anim_offset];
+	n_bytes = st7920_anim_u16(&frame[1]);
+
+	if((this->_anim_offset + ST7920_ANIM_FRAME_HEADER_SIZE + n_bytes) > this->_anim_size) return -1;
+
+	if(frame[0] == ST7920_ANIM_DELTA) delta = true;
+	else if(frame[0] != ST7920_ANIM_KEYFRAME) return -1;
+
+	if(delta && !this->_anim_frame) return -1;
+
+	if(!this->_anim_decode(&frame[ST7920_ANIM_FRAME_HEADER_SIZE], n_bytes, delta, false)) return -1;
+
+	this->_anim_decode(&frame[ST7920_ANIM_FRAME_HEADER_SIZE], n_bytes, delta, true);
+
+	this->_anim_data = anim;
+	this->_anim_offset += ST7920_ANIM_FRAME_HEADER_SIZE + n_bytes;
+	this->_anim_frame++;
+
+	return 1;
+}
+
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::getAnimationFrameIndex(void)
+{
+	if(this->_status < 1) return -1;
+	if((this->_anim_data == NULL) || !this->_anim_frame) return -1;
+
+	return (int32_t) (this->_anim_frame - 1u);
+}
+
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::getAnimationFramePeriod(void)
+{
+	if(this->_status < 1) return -1;
+	if(this->_anim_data == NULL) return -1;
+
+	return (int32_t) this->_anim_period_ms;
+}
+
+/*
+ * Decodes a frame payload. apply = false: only checks that the runs fit the buffer and the payload.
+ * Keyframe: pages = values (pages not in the payload cleared). Delta: pages ^= values (zero runs skipped).
+ */
+template<class Geometry>
+bool ST7920Panel<Geometry>::_anim_decode(const uint8_t *payload, uint32_t n_bytes, bool delta, bool apply)
+{
+	const uint8_t *end = payload + n_bytes;
+	uint32_t buffer_index = 0u;
+	uint32_t n_pages = 0u;
+	uint32_t n_page = 0u;
+	uint16_t page_value = 0u;
+	uint8_t control = 0u;
+
+	while(payload < end)
+	{
+		control = *payload++;
+
+		if(control & ST7920_ANIM_LITERAL_RUN)
+		{
+			n_pages = (uint32_t) (control & 0x7f) + 1u;
+			if((buffer_index + n_pages) > this->_BUFFER_SIZE_PAGES) return false;
+			if(((uint32_t) (end - payload)) < 2u*n_pages) return false;
+
+			for(n_page = 0u; n_page < n_pages; n_page++)
+			{
+				page_value = (uint16_t) st7920_anim_u16(payload);
+				payload += 2;
+
+				if(!apply) continue;
+
+				if(delta) page_value ^= this->_page_buffer[buffer_index + n_page];
+				this->_buffer_write_page((buffer_index + n_page), page_value);
+			}
+		}
+		else if(control & ST7920_ANIM_REPEAT_RUN)
+		{
+			n_pages = (uint32_t) (control & 0x3f) + 1u;
+			if((buffer_index + n_pages) > this->_BUFFER_SIZE_PAGES) return false;
+			if(((uint32_t) (end - payload)) < 2u) return false;
+
+			page_value = (uint16_t) st7920_anim_u16(payload);
+			payload += 2;
+
+			for(n_page = 0u; apply && (n_page < n_pages); n_page++)
+			{
+				if(delta) this->_buffer_write_page((buffer_index + n_page), (this->_page_buffer[buffer_index + n_page] ^ page_value));
+				else this->_buffer_write_page((buffer_index + n_page), page_value);
+			}
+		}
+		else
+		{
+			n_pages = (uint32_t) control + 1u;
+			if((buffer_index + n_pages) > this->_BUFFER_SIZE_PAGES) return false;
+
+			for(n_page = 0u; apply && !delta && (n_page < n_pages); n_page++) this->_buffer_write_page((buffer_index + n_page), 0u);
+		}
+
+		buffer_index += n_pages;
+	}
+
+	/*Rest of the frame: zero pages*/
+	for(; apply && !delta && (buffer_index < this->_BUFFER_SIZE_PAGES); buffer_index++) this->_buffer_write_page(buffer_index, 0u);
+
+	return true;
+}
+
+template class ST7920Panel<ST7920Geometry128x64>;
+template class ST7920Panel<ST7920Geometry256x32>;
+template class ST7920Panel<ST7920Geometry192x32>;
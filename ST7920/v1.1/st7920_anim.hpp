@@ -0,0 +1,51 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Animation format (ST7920::animationBegin() & bufferAnimationFrame()).
+ *
+ * Frames are in the buffer page layout of the panel (GDRAM rows: 32 rows of WIDTH_PAGES pages, folded panels twice as wide),
+ * pages in buffer order. Keyframes hold the pages, delta frames the pages XOR the previous frame. Either is run length encoded,
+ * one 16 bit page at a time. Multi byte values are little endian. Made by the host tool host/st7920_anim_encode.
+ *
+ * Header (ST7920_ANIM_HEADER_SIZE bytes):
+ * 'S' '7' 'A' 'N', version (ST7920_ANIM_VERSION), flags (0), width, height (uint16: panel the frames are for),
+ * number of frames, frame period in ms (uint16).
+ *
+ * Frame: type (ST7920_ANIM_KEYFRAME or ST7920_ANIM_DELTA), payload size in bytes (uint16), payload.
+ * The first frame is a keyframe.
+ *
+ * Payload: runs of pages, each starting with a control byte c:
+ * 0x00 - 0x3f: (c + 1) zero pages. Keyframe: pages cleared. Delta: pages unchanged (no data follows).
+ * 0x40 - 0x7f: (c - 0x3f) times the page value that follows.
+ * 0x80 - 0xff: (c - 0x7f) page values follow.
+ * Pages past the end of the payload are zero pages.
+ */
+
+#ifndef ST7920_ANIM_HPP
+#define ST7920_ANIM_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ST7920_ANIM_VERSION 1u
+#define ST7920_ANIM_HEADER_SIZE 14u
+#define ST7920_ANIM_FRAME_HEADER_SIZE 3u
+
+#define ST7920_ANIM_KEYFRAME 0u
+#define ST7920_ANIM_DELTA 1u
+
+#define ST7920_ANIM_ZERO_RUN 0x00
+#define ST7920_ANIM_REPEAT_RUN 0x40
+#define ST7920_ANIM_LITERAL_RUN 0x80
+
+#define ST7920_ANIM_MAX_ZERO_RUN 64u
+#define ST7920_ANIM_MAX_REPEAT_RUN 64u
+#define ST7920_ANIM_MAX_LITERAL_RUN 128u
+
+#endif /*ST7920_ANIM_HPP*/
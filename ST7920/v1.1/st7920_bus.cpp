@@ -0,0 +1,438 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "st7920_bus.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * ST7920ParallelBus
+ */
+
+ST7920ParallelBus::ST7920ParallelBus(void)
+{
+	memset(&this->pins, 0xff, sizeof(struct _st7920_pinout));
+}
+
+ST7920ParallelBus::ST7920ParallelBus(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t rw, uint8_t e)
+{
+	this->resetPinout(db0, db1, db2, db3, db4, db5, db6, db7, rs, rw, e);
+}
+
+void ST7920ParallelBus::resetPinout(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t rw, uint8_t e)
+{
+	memset(&this->pins, 0xff, sizeof(struct _st7920_pinout));
+
+	this->_fast_bus = false;
+	this->_busy_flag_enabled = false;
+
+	this->pins.db0 = db0;
+	this->pins.db1 = db1;
+	this->pins.db2 = db2;
+	this->pins.db3 = db3;
+	this->pins.db4 = db4;
+	this->pins.db5 = db5;
+	this->pins.db6 = db6;
+	this->pins.db7 = db7;
+	this->pins.rs = rs;
+	this->pins.rw = rw;
+	this->pins.e = e;
+
+	return;
+}
+
+bool ST7920ParallelBus::begin(void)
+{
+	if(!this->_validate_pins()) return false;
+
+	pinMode(this->pins.e, OUTPUT);
+	digitalWrite(this->pins.e, 0);
+
+	pinMode(this->pins.rs, OUTPUT);
+
+	this->_busy_flag_enabled = (this->pins.rw != this->PIN_NONE);
+	if(this->_busy_flag_enabled)
+	{
+		pinMode(this->pins.rw, OUTPUT);
+		digitalWrite(this->pins.rw, 0);
+	}
+
+	this->_set_dataline_mode(true);
+
+	this->_fast_bus = this->_setup_fast_bus();
+
+	return true;
+}
+
+bool ST7920ParallelBus::writeCommands(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+{
+	this->_write_bytes(false, bytes, n_bytes, cmddelay_us);
+	return true;
+}
+
+bool ST7920ParallelBus::writeData(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+{
+	this->_write_bytes(true, bytes, n_bytes, cmddelay_us);
+	return true;
+}
+
+bool ST7920ParallelBus::busyFlagIsEnabled(void)
+{
+	return this->_busy_flag_enabled;
+}
+
+void ST7920ParallelBus::_write_bytes(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+{
+	uint32_t n_byte = 0u;
+	uint32_t delay_us = 0u;
+
+	if(!n_bytes) return;
+
+	/*RS is set up once for the whole sequence. Busy flag polling changes it, so it's restored after each poll.*/
+	this->_write_pin_e(false);
+	this->_write_pin_rs(reg);
+	this->_delay(this->_EN_DELAY_US);
+
+	for(n_byte = 0u; n_byte < n_bytes; n_byte++)
+	{
+		/*
+		 * With busy flag polling, the wait happens before the transfer (until the previous instruction is done),
+		 * instead of a worst case fixed delay after it.
+		 */
+
+		delay_us = cmddelay_us;
+
+		if(this->_busy_flag_enabled)
+		{
+			if(this->_wait_busy_flag()) delay_us = 0u;
+			else
+			{
+				this->_busy_flag_enabled = false;
+				delay_us = this->_CMD_LONG_DELAY_US;
+			}
+
+			this->_write_pin_rs(reg);
+			this->_delay(this->_EN_DELAY_US);
+		}
+
+		this->_write_byte(bytes[n_byte]);
+		this->_write_pin_e(true);
+		this->_delay(this->_EN_DELAY_US);
+		this->_write_pin_e(false);
+		if(delay_us) this->_delay(delay_us);
+	}
+
+	return;
+}
+
+void ST7920ParallelBus::_write_byte(uint8_t byte)
+{
+#ifdef ST7920_FAST_GPIO
+	uint32_t set_mask[8];
+	uint32_t clear_mask[8];
+	uint32_t n_port = 0u;
+
+	if(this->_fast_bus)
+	{
+		st7920_portmap_encode(&this->_portmap, byte, set_mask, clear_mask);
+
+		for(n_port = 0u; n_port < this->_portmap.n_ports; n_port++)
+		{
+			*(this->_port_set_reg[n_port]) = set_mask[n_port];
+			*(this->_port_clear_reg[n_port]) = clear_mask[n_port];
+		}
+
+		return;
+	}
+#endif
+
+	digitalWrite(this->pins.db7, (byte & 0x80));
+	digitalWrite(this->pins.db6, (byte & 0x40));
+	digitalWrite(this->pins.db5, (byte & 0x20));
+	digitalWrite(this->pins.db4, (byte & 0x10));
+	digitalWrite(this->pins.db3, (byte & 0x08));
+	digitalWrite(this->pins.db2, (byte & 0x04));
+	digitalWrite(this->pins.db1, (byte & 0x02));
+	digitalWrite(this->pins.db0, (byte & 0x01));
+
+	return;
+}
+
+void ST7920ParallelBus::_write_pin_rs(bool level)
+{
+#ifdef ST7920_FAST_GPIO
+	if(this->_fast_bus)
+	{
+		if(level) *(this->_rs_set_reg) = this->_rs_mask;
+		else *(this->_rs_clear_reg) = this->_rs_mask;
+
+		return;
+	}
+#endif
+
+	digitalWrite(this->pins.rs, level);
+	return;
+}
+
+void ST7920ParallelBus::_write_pin_e(bool level)
+{
+#ifdef ST7920_FAST_GPIO
+	if(this->_fast_bus)
+	{
+		if(level) *(this->_e_set_reg) = this->_e_mask;
+		else *(this->_e_clear_reg) = this->_e_mask;
+
+		return;
+	}
+#endif
+
+	digitalWrite(this->pins.e, level);
+	return;
+}
+
+bool ST7920ParallelBus::_wait_busy_flag(void)
+{
+	uint32_t start_us = 0u;
+	bool busy = true;
+
+	this->_write_pin_e(false);
+	this->_write_pin_rs(false);
+	this->_set_dataline_mode(false);
+	digitalWrite(this->pins.rw, 1);
+
+	start_us = micros();
+
+	while(busy)
+	{
+		this->_write_pin_e(true);
+		this->_delay(this->_EN_DELAY_US);
+		busy = (digitalRead(this->pins.db7) != 0);
+		this->_write_pin_e(false);
+
+		if(busy && ((micros() - start_us) >= this->_BUSY_TIMEOUT_US)) break;
+	}
+
+	digitalWrite(this->pins.rw, 0);
+	this->_set_dataline_mode(true);
+
+	return !busy;
+}
+
+bool ST7920ParallelBus::_setup_fast_bus(void)
+{
+#ifdef ST7920_FAST_GPIO
+	uintptr_t line_port[8];
+	uint32_t line_mask[8];
+	uint32_t n_line = 0u;
+	uint8_t *p_pins = (uint8_t*) &this->pins;
+
+	for(n_line = 0u; n_line < 8u; n_line++)
+	{
+		line_port[n_line] = (uintptr_t) portOutputRegister(p_pins[n_line]);
+		line_mask[n_line] = digitalPinToBitMask(p_pins[n_line]);
+	}
+
+	if(!st7920_portmap_build(line_port, line_mask, &this->_portmap)) return false;
+
+	/*Set/clear registers of each port are taken from the first data line found on that port*/
+	for(n_line = 7u; n_line < 8u; n_line--)
+	{
+		this->_port_set_reg[this->_portmap.line_port[n_line]] = portSetRegister(p_pins[n_line]);
+		this->_port_clear_reg[this->_portmap.line_port[n_line]] = portClearRegister(p_pins[n_line]);
+	}
+
+	this->_rs_set_reg = portSetRegister(this->pins.rs);
+	this->_rs_clear_reg = portClearRegister(this->pins.rs);
+	this->_rs_mask = digitalPinToBitMask(this->pins.rs);
+
+	this->_e_set_reg = portSetRegister(this->pins.e);
+	this->_e_clear_reg = portClearRegister(this->pins.e);
+	this->_e_mask = digitalPinToBitMask(this->pins.e);
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+void ST7920ParallelBus::_set_dataline_mode(bool output)
+{
+	if(output)
+	{
+		pinMode(this->pins.db0, OUTPUT);
+		pinMode(this->pins.db1, OUTPUT);
+		pinMode(this->pins.db2, OUTPUT);
+		pinMode(this->pins.db3, OUTPUT);
+		pinMode(this->pins.db4, OUTPUT);
+		pinMode(this->pins.db5, OUTPUT);
+		pinMode(this->pins.db6, OUTPUT);
+		pinMode(this->pins.db7, OUTPUT);
+	}
+	else
+	{
+		pinMode(this->pins.db0, INPUT);
+		pinMode(this->pins.db1, INPUT);
+		pinMode(this->pins.db2, INPUT);
+		pinMode(this->pins.db3, INPUT);
+		pinMode(this->pins.db4, INPUT);
+		pinMode(this->pins.db5, INPUT);
+		pinMode(this->pins.db6, INPUT);
+		pinMode(this->pins.db7, INPUT);
+	}
+
+	return;
+}
+
+bool ST7920ParallelBus::_validate_pins(void)
+{
+	uint32_t n_pin = 0u;
+	int8_t *p_pins = (int8_t*) &this->pins;
+
+	/*DB0 - DB7*/
+	for(n_pin = 0u; n_pin < 8u; n_pin++) if(p_pins[n_pin] < 0) return false;
+
+	/*RS*/
+	if(p_pins[8] < 0) return false;
+
+	/*RW is optional (p_pins[9])*/
+
+	/*E*/
+	if(p_pins[10] < 0) return false;
+
+#ifdef CORE_NUM_DIGITAL
+	/*The core pin table (portOutputRegister(), digitalPinToBitMask(), ...) isn't bounds checked: digital pins of this board only*/
+	for(n_pin = 0u; n_pin < 11u; n_pin++)
+	{
+		if((n_pin == 9u) && (this->pins.rw == this->PIN_NONE)) continue;
+		if(((uint8_t) p_pins[n_pin]) >= CORE_NUM_DIGITAL) return false;
+	}
+#endif
+
+	return true;
+}
+
+/*
+ * ST7920SerialBus
+ */
+
+ST7920SerialBus::ST7920SerialBus(void)
+{
+}
+
+ST7920SerialBus::ST7920SerialBus(uint8_t cs, SPIClass &spi)
+{
+	this->resetPinout(cs, spi);
+}
+
+void ST7920SerialBus::resetPinout(uint8_t cs, SPIClass &spi)
+{
+	this->_cs = cs;
+	this->_spi = &spi;
+
+	return;
+}
+
+bool ST7920SerialBus::begin(void)
+{
+	if(this->_spi == NULL) return false;
+	if(((int8_t) this->_cs) < 0) return false;
+
+	/*CS is active high*/
+	pinMode(this->_cs, OUTPUT);
+	digitalWrite(this->_cs, 0);
+
+	this->_spi->begin();
+
+	return true;
+}
+
+bool ST7920SerialBus::writeCommands(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+{
+	this->_write_bytes(false, bytes, n_bytes, cmddelay_us);
+	return true;
+}
+
+bool ST7920SerialBus::writeData(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+{
+	this->_write_bytes(true, bytes, n_bytes, cmddelay_us);
+	return true;
+}
+
+void ST7920SerialBus::beginTransaction(void)
+{
+	if(this->_in_transaction) return;
+
+	this->_select();
+	this->_in_transaction = true;
+
+	return;
+}
+
+void ST7920SerialBus::endTransaction(void)
+{
+	if(!this->_in_transaction) return;
+
+	this->_in_transaction = false;
+	this->_deselect();
+
+	return;
+}
+
+void ST7920SerialBus::_write_bytes(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+{
+	uint32_t n_byte = 0u;
+	uint8_t frame[2];
+
+	if(!n_bytes) return;
+
+	/*
+	 * The whole sequence goes in a single SPI transaction (CS held high).
+	 * The sync byte (with RW = 0 and the RS bit) is sent once; every byte after it is sent as two frames: high nibble, low nibble.
+	 */
+
+	if(!this->_in_transaction) this->_select();
+
+	if(this->_sync_rs != ((int32_t) reg))
+	{
+		if(reg) this->_spi->transfer((uint8_t) (this->_SYNC_BYTE | this->_RS_BIT));
+		else this->_spi->transfer(this->_SYNC_BYTE);
+
+		this->_sync_rs = (int32_t) reg;
+	}
+
+	for(n_byte = 0u; n_byte < n_bytes; n_byte++)
+	{
+		frame[0] = bytes[n_byte] & 0xf0;
+		frame[1] = (uint8_t) (bytes[n_byte] << 4);
+
+		this->_spi->transfer(frame, NULL, 2u);
+		this->_delay(cmddelay_us);
+	}
+
+	if(!this->_in_transaction) this->_deselect();
+
+	return;
+}
+
+void ST7920SerialBus::_select(void)
+{
+	this->_spi->beginTransaction(SPISettings(this->_SPI_CLOCK_HZ, MSBFIRST, SPI_MODE3));
+	digitalWrite(this->_cs, 1);
+
+	this->_sync_rs = -1;
+	return;
+}
+
+void ST7920SerialBus::_deselect(void)
+{
+	digitalWrite(this->_cs, 0);
+	this->_spi->endTransaction();
+
+	return;
+}
@@ -0,0 +1,435 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Bus interface between the ST7920 driver and the display.
+ * The driver hands whole sequences of command or data bytes to the bus, so each backend is free to do the per sequence setup
+ * (RS level, chip select, SPI transaction, DMA...) only once.
+ */
+
+#ifndef ST7920_BUS_HPP
+#define ST7920_BUS_HPP
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <Arduino.h>
+#include <SPI.h>
+
+#include "st7920_portmap.hpp"
+#include "st7920_stats.hpp"
+
+/*
+ * Direct GPIO port writes are used on Teensy 4.x boards. Other boards use digitalWrite().
+ * Define ST7920_NO_FAST_GPIO to always use digitalWrite().
+ */
+
+#if defined(__IMXRT1062__) && !defined(ST7920_NO_FAST_GPIO)
+#define ST7920_FAST_GPIO
+#endif
+
+struct _st7920_pinout {
+	uint8_t db0;
+	uint8_t db1;
+	uint8_t db2;
+	uint8_t db3;
+	uint8_t db4;
+	uint8_t db5;
+	uint8_t db6;
+	uint8_t db7;
+	uint8_t rs;
+	uint8_t rw; /*Optional (ST7920Bus::PIN_NONE if not connected)*/
+	uint8_t e;
+};
+
+class ST7920Bus {
+	public:
+		virtual ~ST7920Bus(void) {}
+
+		/*
+		 * begin()
+		 * Sets up the bus pins/peripherals. Called by ST7920::begin().
+		 *
+		 * returns true if successful, false otherwise.
+		 */
+
+		virtual bool begin(void) = 0;
+
+		/*
+		 * writeCommands() & writeData()
+		 *
+		 * Sends n_bytes instruction bytes (RS = 0) or data bytes (RS = 1) to the display.
+		 * cmddelay_us is the time the display needs to execute each byte. Backends able to tell when the display is ready may wait less.
+		 *
+		 * returns true if the bytes were sent (or queued to be), false if the write was dropped (none of its bytes go to the display).
+		 */
+
+		virtual bool writeCommands(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us) = 0;
+		virtual bool writeData(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us) = 0;
+
+		/*
+		 * busyFlagIsEnabled()
+		 *
+		 * returns true if the backend waits on the display busy flag instead of fixed delays.
+		 */
+
+		virtual bool busyFlagIsEnabled(void) { return false; }
+
+		/*
+		 * beginTransaction() & endTransaction()
+		 *
+		 * Writes between these calls may be grouped by the backend (e.g. into a single SPI transaction). Not nested.
+		 */
+
+		virtual void beginTransaction(void) {}
+		virtual void endTransaction(void) {}
+
+		/*
+		 * PIN_NONE: value for optional pins that are not connected.
+		 */
+
+		static const uint8_t PIN_NONE = 0xff;
+
+#ifdef ST7920_STATS
+		/*
+		 * getDelayUs()
+		 * returns the total time (microseconds, wrapping) the backend spent in delayMicroseconds(). For the performance counters.
+		 */
+
+		uint32_t getDelayUs(void) { return this->_delay_us; }
+#endif
+
+	protected:
+		static const uint32_t _CMD_LONG_DELAY_US = 1024u;
+		static const uint32_t _EN_DELAY_US = 1u;
+
+		/*delayMicroseconds(), counted for the performance counters*/
+		void _delay(uint32_t us)
+		{
+#ifdef ST7920_STATS
+			this->_delay_us += us;
+#endif
+			delayMicroseconds(us);
+			return;
+		}
+
+#ifdef ST7920_STATS
+	private:
+		uint32_t _delay_us = 0u;
+#endif
+};
+
+/*
+ * ST7920ParallelBus
+ * 8 bit parallel interface (PSB pin tied high).
+ */
+
+class ST7920ParallelBus : public ST7920Bus {
+	public:
+		ST7920ParallelBus(void);
+		ST7920ParallelBus(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t rw, uint8_t e);
+
+		/*
+		 * resetPinout()
+		 * Sets the new pin layout. Requires reinitialization ("begin()").
+		 *
+		 * RW is optional. If connected, the bus reads the display busy flag instead of waiting a fixed delay after each transfer.
+		 * Reading the busy flag makes the display drive the data lines: make sure the board pins tolerate the display logic level.
+		 * begin() fails if a pin isn't a digital pin of the board (CORE_NUM_DIGITAL, where the core defines it).
+		 */
+
+		void resetPinout(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs, uint8_t rw, uint8_t e);
+
+		bool begin(void);
+
+		bool writeCommands(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us);
+		bool writeData(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us);
+
+		bool busyFlagIsEnabled(void);
+
+	private:
+		static const uint32_t _BUSY_TIMEOUT_US = 2u*_CMD_LONG_DELAY_US;
+
+		struct _st7920_pinout pins;
+
+		bool _busy_flag_enabled = false;
+
+		/*Direct port access to the bus pins. Set up by begin(), if available.*/
+		struct _st7920_portmap _portmap;
+		bool _fast_bus = false;
+
+#ifdef ST7920_FAST_GPIO
+		volatile uint32_t *_port_set_reg[8];
+		volatile uint32_t *_port_clear_reg[8];
+
+		volatile uint32_t *_rs_set_reg = NULL;
+		volatile uint32_t *_rs_clear_reg = NULL;
+		uint32_t _rs_mask = 0u;
+
+		volatile uint32_t *_e_set_reg = NULL;
+		volatile uint32_t *_e_clear_reg = NULL;
+		uint32_t _e_mask = 0u;
+#endif
+
+		void _write_bytes(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us);
+
+		void _write_byte(uint8_t byte);
+		void _write_pin_rs(bool level);
+		void _write_pin_e(bool level);
+
+		bool _wait_busy_flag(void);
+
+		bool _setup_fast_bus(void);
+
+		void _set_dataline_mode(bool output);
+
+		bool _validate_pins(void);
+};
+
+/*
+ * ST7920SerialBus
+ * Serial interface (PSB pin tied low) through a hardware SPI port.
+ * cs is the pin connected to the display CS (RS) pin. Display SID and SCLK go to the MOSI and SCK pins of the SPI port.
+ */
+
+class ST7920SerialBus : public ST7920Bus {
+	public:
+		ST7920SerialBus(void);
+		ST7920SerialBus(uint8_t cs, SPIClass &spi);
+
+		/*
+		 * resetPinout()
+		 * Sets the new chip select pin and SPI port. Requires reinitialization ("begin()").
+		 */
+
+		void resetPinout(uint8_t cs, SPIClass &spi);
+
+		bool begin(void);
+
+		bool writeCommands(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us);
+		bool writeData(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us);
+
+		/*
+		 * beginTransaction() & endTransaction()
+		 *
+		 * Hold the SPI port and chip select across writes. A sync byte is only sent when RS changes.
+		 */
+
+		void beginTransaction(void);
+		void endTransaction(void);
+
+	private:
+		static const uint32_t _SPI_CLOCK_HZ = 1000000u;
+		static const uint8_t _SYNC_BYTE = 0xf8;
+		static const uint8_t _RS_BIT = 0x02;
+
+		uint8_t _cs = PIN_NONE;
+		SPIClass *_spi = NULL;
+
+		bool _in_transaction = false;
+		int32_t _sync_rs = -1; /*RS value of the last sync byte sent in the current transaction. -1: none.*/
+
+		void _write_bytes(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us);
+		void _select(void);
+		void _deselect(void);
+};
+
+/*
+ * st7920_pins_distinct()
+ * returns true if no two of the given pins are the same pin (constant expression).
+ */
+
+static constexpr bool st7920_pin_unique(uint8_t)
+{
+	return true;
+}
+
+template<class... Pins>
+static constexpr bool st7920_pin_unique(uint8_t pin, uint8_t first, Pins... rest)
+{
+	return (pin != first) && st7920_pin_unique(pin, rest...);
+}
+
+static constexpr bool st7920_pins_distinct(uint8_t)
+{
+	return true;
+}
+
+template<class... Pins>
+static constexpr bool st7920_pins_distinct(uint8_t pin, Pins... rest)
+{
+	return st7920_pin_unique(pin, rest...) && st7920_pins_distinct(rest...);
+}
+
+/*
+ * ST7920FixedBus
+ * 8 bit parallel interface (PSB pin tied high) with the pins fixed at compile time.
+ *
+ * Same transfers as ST7920ParallelBus, but every pin access is a digitalWriteFast()/digitalReadFast() on a constant pin, which the
+ * Teensy core turns into a single port register access with a constant mask. No pin table is kept.
+ * The pins are checked at compile time. RW is optional (ST7920Bus::PIN_NONE if not connected): if connected, the bus reads the
+ * display busy flag (see ST7920ParallelBus::resetPinout()).
+ */
+
+template<uint8_t DB0, uint8_t DB1, uint8_t DB2, uint8_t DB3, uint8_t DB4, uint8_t DB5, uint8_t DB6, uint8_t DB7, uint8_t RS, uint8_t E, uint8_t RW = ST7920Bus::PIN_NONE>
+class ST7920FixedBus : public ST7920Bus {
+	public:
+		bool begin(void)
+		{
+			pinMode(E, OUTPUT);
+			digitalWriteFast(E, 0);
+
+			pinMode(RS, OUTPUT);
+
+			this->_busy_flag_enabled = (RW != PIN_NONE);
+			if(this->_busy_flag_enabled)
+			{
+				pinMode(RW, OUTPUT);
+				digitalWriteFast(RW, 0);
+			}
+
+			this->_set_dataline_mode(true);
+
+			return true;
+		}
+
+		bool writeCommands(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+		{
+			this->_write_bytes(false, bytes, n_bytes, cmddelay_us);
+			return true;
+		}
+
+		bool writeData(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+		{
+			this->_write_bytes(true, bytes, n_bytes, cmddelay_us);
+			return true;
+		}
+
+		bool busyFlagIsEnabled(void)
+		{
+			return this->_busy_flag_enabled;
+		}
+
+	private:
+		static_assert((DB0 != PIN_NONE) && (DB1 != PIN_NONE) && (DB2 != PIN_NONE) && (DB3 != PIN_NONE) && (DB4 != PIN_NONE) && (DB5 != PIN_NONE) && (DB6 != PIN_NONE) && (DB7 != PIN_NONE), "ST7920FixedBus: DB0 - DB7 must be connected");
+		static_assert((RS != PIN_NONE) && (E != PIN_NONE), "ST7920FixedBus: RS and E must be connected");
+		static_assert(st7920_pins_distinct(DB0, DB1, DB2, DB3, DB4, DB5, DB6, DB7, RS, E), "ST7920FixedBus: pins must be distinct");
+		static_assert((RW == PIN_NONE) || st7920_pin_unique(RW, DB0, DB1, DB2, DB3, DB4, DB5, DB6, DB7, RS, E), "ST7920FixedBus: RW must be distinct from the other pins");
+
+#ifdef CORE_NUM_DIGITAL
+		static_assert((DB0 < CORE_NUM_DIGITAL) && (DB1 < CORE_NUM_DIGITAL) && (DB2 < CORE_NUM_DIGITAL) && (DB3 < CORE_NUM_DIGITAL) && (DB4 < CORE_NUM_DIGITAL) && (DB5 < CORE_NUM_DIGITAL) && (DB6 < CORE_NUM_DIGITAL) && (DB7 < CORE_NUM_DIGITAL), "ST7920FixedBus: DB0 - DB7 must be digital pins of this board");
+		static_assert((RS < CORE_NUM_DIGITAL) && (E < CORE_NUM_DIGITAL) && ((RW == PIN_NONE) || (RW < CORE_NUM_DIGITAL)), "ST7920FixedBus: RS, RW and E must be digital pins of this board");
+#endif
+
+		static const uint32_t _BUSY_TIMEOUT_US = 2u*_CMD_LONG_DELAY_US;
+
+		bool _busy_flag_enabled = false;
+
+		/*Same sequence as ST7920ParallelBus::_write_bytes()*/
+		void _write_bytes(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+		{
+			uint32_t n_byte = 0u;
+			uint32_t delay_us = 0u;
+
+			if(!n_bytes) return;
+
+			digitalWriteFast(E, 0);
+			digitalWriteFast(RS, reg);
+			this->_delay(this->_EN_DELAY_US);
+
+			for(n_byte = 0u; n_byte < n_bytes; n_byte++)
+			{
+				delay_us = cmddelay_us;
+
+				if(this->_busy_flag_enabled)
+				{
+					if(this->_wait_busy_flag()) delay_us = 0u;
+					else
+					{
+						this->_busy_flag_enabled = false;
+						delay_us = this->_CMD_LONG_DELAY_US;
+					}
+
+					digitalWriteFast(RS, reg);
+					this->_delay(this->_EN_DELAY_US);
+				}
+
+				this->_write_byte(bytes[n_byte]);
+				digitalWriteFast(E, 1);
+				this->_delay(this->_EN_DELAY_US);
+				digitalWriteFast(E, 0);
+				if(delay_us) this->_delay(delay_us);
+			}
+
+			return;
+		}
+
+		void _write_byte(uint8_t byte)
+		{
+			digitalWriteFast(DB7, (byte & 0x80));
+			digitalWriteFast(DB6, (byte & 0x40));
+			digitalWriteFast(DB5, (byte & 0x20));
+			digitalWriteFast(DB4, (byte & 0x10));
+			digitalWriteFast(DB3, (byte & 0x08));
+			digitalWriteFast(DB2, (byte & 0x04));
+			digitalWriteFast(DB1, (byte & 0x02));
+			digitalWriteFast(DB0, (byte & 0x01));
+
+			return;
+		}
+
+		bool _wait_busy_flag(void)
+		{
+			uint32_t start_us = 0u;
+			bool busy = true;
+
+			if(RW == PIN_NONE) return false;
+
+			digitalWriteFast(E, 0);
+			digitalWriteFast(RS, 0);
+			this->_set_dataline_mode(false);
+			digitalWriteFast(RW, 1);
+
+			start_us = micros();
+
+			while(busy)
+			{
+				digitalWriteFast(E, 1);
+				this->_delay(this->_EN_DELAY_US);
+				busy = (digitalReadFast(DB7) != 0);
+				digitalWriteFast(E, 0);
+
+				if(busy && ((micros() - start_us) >= this->_BUSY_TIMEOUT_US)) break;
+			}
+
+			digitalWriteFast(RW, 0);
+			this->_set_dataline_mode(true);
+
+			return !busy;
+		}
+
+		void _set_dataline_mode(bool output)
+		{
+			uint8_t mode = INPUT;
+
+			if(output) mode = OUTPUT;
+
+			pinMode(DB0, mode);
+			pinMode(DB1, mode);
+			pinMode(DB2, mode);
+			pinMode(DB3, mode);
+			pinMode(DB4, mode);
+			pinMode(DB5, mode);
+			pinMode(DB6, mode);
+			pinMode(DB7, mode);
+
+			return;
+		}
+};
+
+#endif /*ST7920_BUS_HPP*/
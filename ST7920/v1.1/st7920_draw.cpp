@@ -0,0 +1,1128 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Drawing primitives (lines, rectangles, circles, ellipses, arcs), batch pixel plotting, bitmap blit and bitmap font text.
+ */
+
+#include "st7920.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*sin(0 - 90 degrees), Q14*/
+static const uint16_t st7920_sin_table_q14[91] = {
+	0, 286, 572, 857, 1143, 1428, 1713, 1997, 2280, 2563,
+	2845, 3126, 3406, 3686, 3964, 4240, 4516, 4790, 5063, 5334,
+	5604, 5872, 6138, 6402, 6664, 6924, 7182, 7438, 7692, 7943,
+	8192, 8438, 8682, 8923, 9162, 9397, 9630, 9860, 10087, 10311,
+	10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+	12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+	14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+	15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+	16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+	16384
+};
+
+/*Degrees (any value) to sine, Q14*/
+static int32_t st7920_sin_q14(int32_t deg)
+{
+	deg %= 360;
+	if(deg < 0) deg += 360;
+
+	if(deg <= 90) return (int32_t) st7920_sin_table_q14[deg];
+	if(deg <= 180) return (int32_t) st7920_sin_table_q14[180 - deg];
+	if(deg <= 270) return -((int32_t) st7920_sin_table_q14[deg - 180]);
+
+	return -((int32_t) st7920_sin_table_q14[360 - deg]);
+}
+
+/*
+ * Half width of the ellipse at row dy from the center, -1 if the row is outside the ellipse.
+ * A pixel (x , y) is inside if x^2/(rx + 1/2)^2 + y^2/(ry + 1/2)^2 <= 1, i.e. 4*x^2*b + 4*y^2*a <= a*b with a = (2*rx + 1)^2, b = (2*ry + 1)^2.
+ * Adjacent rows have close half widths, so the search starts at the half width of the previous row (w_prev).
+ */
+
+static int32_t st7920_ellipse_half_width(uint64_t a, uint64_t b, uint32_t ry, int32_t dy, int32_t w_prev)
+{
+	uint64_t limit = 0u;
+	uint64_t x = 0u;
+
+	if(dy < 0) dy = -dy;
+	if(((uint32_t) dy) > ry) return -1;
+
+	limit = a*(b - 4u*((uint64_t) dy)*((uint64_t) dy));
+
+	if(w_prev > 0) x = (uint64_t) w_prev;
+
+	while((4u*(x + 1u)*(x + 1u)*b) <= limit) x++;
+	while(x && ((4u*x*x*b) > limit)) x--;
+
+	return (int32_t) x;
+}
+
+/*
+ * 32 bitmap bits of row "row" (row_bytes long) starting at bit_offset (may be negative). Bits outside the row read as 0.
+ */
+
+static uint32_t st7920_blit_fetch32(const uint8_t *row, int32_t row_bytes, int32_t bit_offset)
+{
+	uint64_t bits = 0u;
+	int32_t byte_index = 0;
+	int32_t n_byte = 0;
+
+	/*Floor division, bit_offset may be negative*/
+	byte_index = bit_offset >> 3;
+	bit_offset &= 0x7;
+
+	for(n_byte = 0; n_byte < 5; n_byte++)
+	{
+		bits <<= 8;
+		if(((byte_index + n_byte) >= 0) && ((byte_index + n_byte) < row_bytes)) bits |= row[byte_index + n_byte];
+	}
+
+	return (uint32_t) (bits >> (8 - bit_offset));
+}
+
+/*
+ * Last coordinate of a span of n (> 0) pixels from c. Clamped to "limit" (past the display edge, so the span is clipped the same) to fit
+ * in 32 bits.
+ */
+
+static int32_t st7920_span_last(int32_t c, int32_t n, int32_t limit)
+{
+	int64_t last = ((int64_t) c) + ((int64_t) n) - 1;
+
+	if(last > limit) last = limit;
+
+	return (int32_t) last;
+}
+
+/*
+ * floor(a*b/d), remainder in p_rem, without overflowing 64 bits: a, b and d below 2^33.
+ */
+
+static uint64_t st7920_mul_div(uint64_t a, uint64_t b, uint64_t d, uint64_t *p_rem)
+{
+	uint64_t high = a*(b >> 16);
+	uint64_t low = 0u;
+	uint64_t q = 0u;
+
+	q = high/d;
+	low = ((high%d) << 16) + a*(b & 0xffff);
+
+	*p_rem = low%d;
+	return (q << 16) + low/d;
+}
+
+/*
+ * Bresenham line state after "step" steps along the major axis ("major" steps in all, "minor" along the other axis, minor <= major).
+ * The line passes the minor axis offset at round(step*minor/major) (halves up). returns that offset, and the error term (see
+ * bufferDrawLine()) in p_err, as for an x major line (negated for a y major one).
+ */
+
+static uint64_t st7920_line_state(uint64_t major, uint64_t minor, uint64_t step, int64_t *p_err)
+{
+	uint64_t rem = 0u;
+	uint64_t offset = 0u;
+	uint64_t carry = 0u;
+
+	offset = st7920_mul_div(minor, step, major, &rem);
+
+	if((2u*rem) >= major) carry = 1u;
+
+	*p_err = ((int64_t) (major*carry)) - ((int64_t) rem) + ((int64_t) major) - ((int64_t) minor);
+	return offset + carry;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferDrawHLine(int32_t cx, int32_t cy, int32_t w, int32_t draw_mode)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_DRAW_HLINE);
+
+	if(this->_status < 1) return false;
+	if(!this->_draw_mode_is_valid(draw_mode)) return false;
+
+	if(w > 0) this->_buffer_hspan(cx, st7920_span_last(cx, w, (int32_t) this->WIDTH), cy, draw_mode);
+
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferDrawVLine(int32_t cx, int32_t cy, int32_t h, int32_t draw_mode)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_DRAW_VLINE);
+
+	if(this->_status < 1) return false;
+	if(!this->_draw_mode_is_valid(draw_mode)) return false;
+
+	if(h > 0) this->_buffer_vspan(cx, cy, st7920_span_last(cy, h, (int32_t) this->HEIGHT), draw_mode);
+
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferDrawLine(int32_t cx0, int32_t cy0, int32_t cx1, int32_t cy1, int32_t draw_mode)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_DRAW_LINE);
+
+	int64_t dx = 0;
+	int64_t dy = 0;
+	int64_t err = 0;
+	int64_t e2 = 0;
+	int64_t major = 0;
+	int64_t first = 0;
+	int64_t last = 0;
+	int64_t start = 0;
+	int64_t limit = 0;
+	int64_t offset0 = 0;
+	int64_t offset1 = 0;
+	int32_t step = 0;
+	int32_t sx = 0;
+	int32_t sy = 0;
+	int32_t run_cx = 0;
+	int32_t prev_cx = 0;
+	bool x_major = false;
+
+	if(this->_status < 1) return false;
+	if(!this->_draw_mode_is_valid(draw_mode)) return false;
+
+	if(cy0 == cy1)
+	{
+		this->_buffer_hspan(cx0, cx1, cy0, draw_mode);
+		return true;
+	}
+
+	if(cx0 == cx1)
+	{
+		this->_buffer_vspan(cx0, cy0, cy1, draw_mode);
+		return true;
+	}
+
+	/*64 bit: the ends may be anywhere in the int32_t range*/
+	dx = ((int64_t) cx1) - ((int64_t) cx0);
+	dy = ((int64_t) cy1) - ((int64_t) cy0);
+	if(dx < 0) dx = -dx;
+	if(dy < 0) dy = -dy;
+
+	if(cx0 < cx1) sx = 1;
+	else sx = -1;
+
+	if(cy0 < cy1) sy = 1;
+	else sy = -1;
+
+	/*Clip: steps along the major axis (one per column, or per row) that are on the display*/
+	x_major = (dx >= dy);
+
+	if(x_major)
+	{
+		major = dx;
+		start = cx0;
+		step = sx;
+		limit = (int64_t) this->WIDTH;
+	}
+	else
+	{
+		major = dy;
+		start = cy0;
+		step = sy;
+		limit = (int64_t) this->HEIGHT;
+	}
+
+	first = 0;
+	last = major;
+
+	if(step > 0)
+	{
+		if(-start > first) first = -start;
+		if((limit - 1 - start) < last) last = limit - 1 - start;
+	}
+	else
+	{
+		if((start - limit + 1) > first) first = start - limit + 1;
+		if(start < last) last = start;
+	}
+
+	if(first > last) return true;
+
+	/*Bresenham state at the first and last visible steps, same pixels as from the ends*/
+	if(x_major)
+	{
+		offset0 = (int64_t) st7920_line_state((uint64_t) dx, (uint64_t) dy, (uint64_t) first, &err);
+		offset1 = (int64_t) st7920_line_state((uint64_t) dx, (uint64_t) dy, (uint64_t) last, &e2);
+
+		cx1 = (int32_t) (cx0 + sx*last);
+		cy1 = (int32_t) (cy0 + sy*offset1);
+		cx0 = (int32_t) (cx0 + sx*first);
+		cy0 = (int32_t) (cy0 + sy*offset0);
+	}
+	else
+	{
+		offset0 = (int64_t) st7920_line_state((uint64_t) dy, (uint64_t) dx, (uint64_t) first, &err);
+		offset1 = (int64_t) st7920_line_state((uint64_t) dy, (uint64_t) dx, (uint64_t) last, &e2);
+		err = -err;
+
+		cx1 = (int32_t) (cx0 + sx*offset1);
+		cy1 = (int32_t) (cy0 + sy*last);
+		cx0 = (int32_t) (cx0 + sx*offset0);
+		cy0 = (int32_t) (cy0 + sy*first);
+	}
+
+	/*Bresenham over the visible steps. Pixels on the same row are written as one span.*/
+	dy = -dy;
+	run_cx = cx0;
+
+	while(true)
+	{
+		if((cx0 == cx1) && (cy0 == cy1))
+		{
+			this->_buffer_hspan(run_cx, cx0, cy0, draw_mode);
+			break;
+		}
+
+		prev_cx = cx0;
+		e2 = 2*err;
+
+		if(e2 >= dy)
+		{
+			err += dy;
+			cx0 += sx;
+		}
+
+		if(e2 <= dx)
+		{
+			err += dx;
+
+			this->_buffer_hspan(run_cx, prev_cx, cy0, draw_mode);
+			cy0 += sy;
+			run_cx = cx0;
+		}
+	}
+
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferDrawRect(int32_t cx, int32_t cy, int32_t w, int32_t h, int32_t draw_mode)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_DRAW_RECT);
+
+	int32_t cx1 = 0;
+	int32_t cy1 = 0;
+
+	if(this->_status < 1) return false;
+	if(!this->_draw_mode_is_valid(draw_mode)) return false;
+
+	if((w < 1) || (h < 1)) return true;
+	if((cx >= ((int32_t) this->WIDTH)) || (cy >= ((int32_t) this->HEIGHT))) return true;
+
+	cx1 = st7920_span_last(cx, w, (int32_t) this->WIDTH);
+	cy1 = st7920_span_last(cy, h, (int32_t) this->HEIGHT);
+
+	this->_buffer_hspan(cx, cx1, cy, draw_mode);
+	if(h < 2) return true;
+
+	this->_buffer_hspan(cx, cx1, cy1, draw_mode);
+	if(h < 3) return true;
+
+	this->_buffer_vspan(cx, (cy + 1), (cy1 - 1), draw_mode);
+	if(w > 1) this->_buffer_vspan(cx1, (cy + 1), (cy1 - 1), draw_mode);
+
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferFillRect(int32_t cx, int32_t cy, int32_t w, int32_t h, int32_t draw_mode)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_FILL_RECT);
+
+	int32_t cx1 = 0;
+	int32_t cy0 = 0;
+	int32_t cy1 = 0;
+
+	if(this->_status < 1) return false;
+	if(!this->_draw_mode_is_valid(draw_mode)) return false;
+
+	if((w < 1) || (h < 1)) return true;
+
+	cy0 = cy;
+	cy1 = st7920_span_last(cy, h, (int32_t) this->HEIGHT);
+
+	if(cy0 < 0) cy0 = 0;
+	if(cy1 >= ((int32_t) this->HEIGHT)) cy1 = ((int32_t) this->HEIGHT) - 1;
+
+	cx1 = st7920_span_last(cx, w, (int32_t) this->WIDTH);
+
+	for(cy = cy0; cy <= cy1; cy++) this->_buffer_hspan(cx, cx1, cy, draw_mode);
+
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferDrawCircle(int32_t cx, int32_t cy, uint32_t r, int32_t draw_mode)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_DRAW_CIRCLE);
+
+	return this->bufferDrawEllipse(cx, cy, r, r, draw_mode);
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferFillCircle(int32_t cx, int32_t cy, uint32_t r, int32_t draw_mode)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_FILL_CIRCLE);
+
+	return this->bufferFillEllipse(cx, cy, r, r, draw_mode);
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferDrawEllipse(int32_t cx, int32_t cy, uint32_t rx, uint32_t ry, int32_t draw_mode)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_DRAW_ELLIPSE);
+
+	if(this->_status < 1) return false;
+	if(!this->_draw_mode_is_valid(draw_mode)) return false;
+	if((rx > this->MAX_RADIUS) || (ry > this->MAX_RADIUS)) return false;
+
+	this->_buffer_ellipse(cx, cy, rx, ry, false, draw_mode);
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferFillEllipse(int32_t cx, int32_t cy, uint32_t rx, uint32_t ry, int32_t draw_mode)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_FILL_ELLIPSE);
+
+	if(this->_status < 1) return false;
+	if(!this->_draw_mode_is_valid(draw_mode)) return false;
+	if((rx > this->MAX_RADIUS) || (ry > this->MAX_RADIUS)) return false;
+
+	this->_buffer_ellipse(cx, cy, rx, ry, true, draw_mode);
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferDrawArc(int32_t cx, int32_t cy, uint32_t r, int32_t start_deg, int32_t end_deg, int32_t draw_mode)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_DRAW_ARC);
+
+	if(this->_status < 1) return false;
+	if(!this->_draw_mode_is_valid(draw_mode)) return false;
+	if(r > this->MAX_RADIUS) return false;
+
+	if(((int64_t) end_deg - (int64_t) start_deg >= 360) || ((int64_t) start_deg - (int64_t) end_deg >= 360))
+	{
+		this->_buffer_ellipse(cx, cy, r, r, false, draw_mode);
+		return true;
+	}
+
+	this->_buffer_arc(cx, cy, r, start_deg, end_deg, draw_mode);
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferSetPixels(const uint16_t *xs, const uint16_t *ys, uint32_t n_points, int32_t draw_mode)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_SET_PIXELS);
+
+	uint32_t n_point = 0u;
+	uint32_t cx = 0u;
+	uint32_t cy = 0u;
+
+	if(this->_status < 1) return false;
+	if((xs == NULL) || (ys == NULL)) return false;
+	if(!this->_draw_mode_is_valid(draw_mode)) return false;
+
+	/*One loop per mode, so the loops carry no mode test*/
+	switch(draw_mode)
+	{
+		case this->DRAWMODE_CLEAR:
+			for(n_point = 0u; n_point < n_points; n_point++)
+			{
+				cx = xs[n_point];
+				cy = ys[n_point];
+				if((cx < this->WIDTH) && (cy < this->HEIGHT)) this->bufferSetPixelUnchecked(cx, cy, false);
+			}
+			break;
+
+		case this->DRAWMODE_SET:
+			for(n_point = 0u; n_point < n_points; n_point++)
+			{
+				cx = xs[n_point];
+				cy = ys[n_point];
+				if((cx < this->WIDTH) && (cy < this->HEIGHT)) this->bufferSetPixelUnchecked(cx, cy, true);
+			}
+			break;
+
+		case this->DRAWMODE_TOGGLE:
+			for(n_point = 0u; n_point < n_points; n_point++)
+			{
+				cx = xs[n_point];
+				cy = ys[n_point];
+				if((cx < this->WIDTH) && (cy < this->HEIGHT)) this->bufferTogglePixelUnchecked(cx, cy);
+			}
+			break;
+	}
+
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferSetPackedPixels(const uint16_t *points, uint32_t n_points, int32_t draw_mode)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_SET_PACKED_PIXELS);
+
+	uint32_t n_point = 0u;
+	uint32_t cx = 0u;
+	uint32_t cy = 0u;
+
+	if(this->_status < 1) return false;
+	if(points == NULL) return false;
+	if(!this->_draw_mode_is_valid(draw_mode)) return false;
+
+	switch(draw_mode)
+	{
+		case this->DRAWMODE_CLEAR:
+			for(n_point = 0u; n_point < n_points; n_point++)
+			{
+				cx = points[n_point] & 0xff;
+				cy = points[n_point] >> 8;
+				if((cx < this->WIDTH) && (cy < this->HEIGHT)) this->bufferSetPixelUnchecked(cx, cy, false);
+			}
+			break;
+
+		case this->DRAWMODE_SET:
+			for(n_point = 0u; n_point < n_points; n_point++)
+			{
+				cx = points[n_point] & 0xff;
+				cy = points[n_point] >> 8;
+				if((cx < this->WIDTH) && (cy < this->HEIGHT)) this->bufferSetPixelUnchecked(cx, cy, true);
+			}
+			break;
+
+		case this->DRAWMODE_TOGGLE:
+			for(n_point = 0u; n_point < n_points; n_point++)
+			{
+				cx = points[n_point] & 0xff;
+				cy = points[n_point] >> 8;
+				if((cx < this->WIDTH) && (cy < this->HEIGHT)) this->bufferTogglePixelUnchecked(cx, cy);
+			}
+			break;
+	}
+
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferBlit(int32_t cx, int32_t cy, uint32_t w, uint32_t h, const uint8_t *bitmap, int32_t raster_op)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_BLIT);
+
+	const uint8_t *row = NULL;
+	int32_t row_bytes = 0;
+	int32_t cx0 = 0;
+	int32_t cx1 = 0;
+	int32_t cy0 = 0;
+	int32_t cy1 = 0;
+	int32_t chunk_cx = 0;
+	uint32_t row_index = 0u;
+	uint32_t page_index = 0u;
+	uint32_t last_page = 0u;
+	uint32_t n_pages = 0u;
+	uint32_t mask = 0u;
+
+	if(this->_status < 1) return false;
+	if(bitmap == NULL) return false;
+	if((raster_op < this->RASTEROP_COPY) || (raster_op > this->RASTEROP_NOT)) return false;
+
+	if(!w || !h) return true;
+	if((w > 0x7fffffff) || (h > 0x7fffffff)) return false;
+
+	/*Clip*/
+	cx0 = cx;
+	cx1 = st7920_span_last(cx, (int32_t) w, (int32_t) this->WIDTH);
+	cy0 = cy;
+	cy1 = st7920_span_last(cy, (int32_t) h, (int32_t) this->HEIGHT);
+
+	if(cx0 < 0) cx0 = 0;
+	if(cy0 < 0) cy0 = 0;
+	if(cx1 >= ((int32_t) this->WIDTH)) cx1 = ((int32_t) this->WIDTH) - 1;
+	if(cy1 >= ((int32_t) this->HEIGHT)) cy1 = ((int32_t) this->HEIGHT) - 1;
+
+	if((cx0 > cx1) || (cy0 > cy1)) return true;
+
+	row_bytes = (int32_t) ((w + 7u) >> 3);
+	last_page = ((uint32_t) cx1) >> 4;
+
+	for(; cy0 <= cy1; cy0++)
+	{
+		row = bitmap + ((uint32_t) (cy0 - cy))*((uint32_t) row_bytes);
+
+		/*Half screen remap, once per row*/
+		row_index = this->_pixel_buffer_index(0u, (uint32_t) cy0);
+
+		/*32 bit chunks: two pages at a time*/
+		for(page_index = ((uint32_t) cx0) >> 4; page_index <= last_page; page_index += 2u)
+		{
+			chunk_cx = (int32_t) (page_index << 4);
+
+			mask = 0xffffffff;
+			if(cx0 > chunk_cx) mask >>= (cx0 - chunk_cx);
+			if(cx1 < (chunk_cx + 31)) mask &= ~(0xffffffff >> (cx1 - chunk_cx + 1));
+
+			n_pages = 2u;
+			if(page_index == last_page) n_pages = 1u;
+
+			this->_buffer_modify_chunk((row_index + page_index), n_pages, st7920_blit_fetch32(row, row_bytes, (chunk_cx - cx)), mask, raster_op);
+		}
+	}
+
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferDrawChar(int32_t cx, int32_t cy, char c, const struct _st7920_font *font, int32_t draw_mode)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_DRAW_CHAR);
+
+	if(this->_status < 1) return false;
+	if(font == NULL) return false;
+	if(!this->_draw_mode_is_valid(draw_mode)) return false;
+
+	this->_buffer_draw_text(cx, cy, &c, 1u, font, draw_mode);
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferDrawText(int32_t cx, int32_t cy, const char *text, const struct _st7920_font *font, int32_t draw_mode)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_DRAW_TEXT);
+
+	uint32_t length = 0u;
+
+	if(this->_status < 1) return false;
+	if((text == NULL) || (font == NULL)) return false;
+	if(!this->_draw_mode_is_valid(draw_mode)) return false;
+
+	while(text[length] != '\0') length++;
+
+	this->_buffer_draw_text(cx, cy, text, length, font, draw_mode);
+	return true;
+}
+
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::measureText(const char *text, const struct _st7920_font *font)
+{
+	int32_t glyph = 0;
+	int32_t width = 0;
+
+	if(this->_status < 1) return -1;
+	if((text == NULL) || (font == NULL)) return -1;
+
+	while(*text != '\0')
+	{
+		glyph = this->_font_glyph_index(font, *text);
+		if(glyph >= 0) width += (int32_t) (this->_font_glyph_width(font, (uint32_t) glyph) + font->spacing);
+
+		text++;
+	}
+
+	/*No spacing after the last character*/
+	if(width > 0) width -= (int32_t) font->spacing;
+
+	return width;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::invalidateGlyphCache(void)
+{
+	uint32_t n_entry = 0u;
+
+	for(n_entry = 0u; n_entry < this->_glyph_cache_size; n_entry++) this->_glyph_cache[n_entry].font = NULL;
+
+	return;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::setGlyphCache(GlyphCacheEntry *entries, uint32_t n_entries)
+{
+	if(n_entries & 0x1) return false;
+	if(n_entries && (entries == NULL)) return false;
+
+	this->_glyph_cache = entries;
+	this->_glyph_cache_size = n_entries;
+	if(!n_entries) this->_glyph_cache = NULL;
+
+	this->invalidateGlyphCache();
+	return true;
+}
+
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::_font_glyph_index(const struct _st7920_font *font, char c)
+{
+	uint8_t code = (uint8_t) c;
+
+	if((code < font->first_char) || (code > font->last_char)) code = '?';
+	if((code < font->first_char) || (code > font->last_char)) return -1;
+
+	return (int32_t) (code - font->first_char);
+}
+
+template<class Geometry>
+uint32_t ST7920Panel<Geometry>::_font_glyph_width(const struct _st7920_font *font, uint32_t glyph)
+{
+	if(font->width) return font->width;
+
+	return font->widths[glyph];
+}
+
+/*
+ * returns the glyph shifted by "shift" pixels: from the glyph cache (a miss replaces the least recently used entry of the set),
+ * or in p_scratch if there's no glyph cache.
+ */
+
+template<class Geometry>
+const struct _st7920_glyph_cache_entry *ST7920Panel<Geometry>::_glyph_cache_get(const struct _st7920_font *font, uint32_t glyph, uint32_t shift, struct _st7920_glyph_cache_entry *p_scratch)
+{
+	struct _st7920_glyph_cache_entry *set = NULL;
+	uint32_t n_way = 0u;
+
+	if(!this->_glyph_cache_size)
+	{
+		this->_glyph_shift(font, glyph, shift, p_scratch);
+		return p_scratch;
+	}
+
+	/*2 way set associative*/
+	set = &this->_glyph_cache[2u*((31u*glyph + 7u*shift + (uint32_t) (((uintptr_t) font) >> 2))%(this->_glyph_cache_size/2u))];
+
+	for(n_way = 0u; n_way < 2u; n_way++)
+	{
+		if((set[n_way].font == font) && (set[n_way].glyph == glyph) && (set[n_way].shift == shift))
+		{
+			set[n_way].recent = true;
+			set[n_way ^ 1u].recent = false;
+			return &set[n_way];
+		}
+	}
+
+	n_way = 0u;
+	if(set[0].recent) n_way = 1u;
+
+	set[n_way].recent = true;
+	set[n_way ^ 1u].recent = false;
+
+	this->_glyph_shift(font, glyph, shift, &set[n_way]);
+	return &set[n_way];
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_glyph_shift(const struct _st7920_font *font, uint32_t glyph, uint32_t shift, struct _st7920_glyph_cache_entry *entry)
+{
+	const uint8_t *column = NULL;
+	uint32_t column_bytes = 0u;
+	uint32_t n_column = 0u;
+	uint32_t n_row = 0u;
+	uint32_t bit = 0u;
+
+	entry->font = font;
+	entry->glyph = (uint8_t) glyph;
+	entry->shift = (uint8_t) shift;
+	entry->width = (uint8_t) this->_font_glyph_width(font, glyph);
+	memset(entry->rows, 0, sizeof(entry->rows));
+
+	column_bytes = (font->height + 7u) >> 3;
+
+	if(font->width) column = font->data + glyph*font->width*column_bytes;
+	else column = font->data + font->offsets[glyph];
+
+	for(n_column = 0u; (n_column < entry->width) && (n_column < 16u); n_column++)
+	{
+		bit = 0x80000000 >> (shift + n_column);
+
+		for(n_row = 0u; (n_row < font->height) && (n_row < 16u); n_row++)
+		{
+			if(column[n_row >> 3] & (1u << (n_row & 0x7))) entry->rows[n_row] |= bit;
+		}
+
+		column += column_bytes;
+	}
+
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_buffer_draw_text(int32_t cx, int32_t cy, const char *text, uint32_t length, const struct _st7920_font *font, int32_t draw_mode)
+{
+	/*Text line: one row of pages per glyph row, plus a page on each side for glyphs crossing the display edges*/
+	uint16_t block[16][WIDTH_PAGES + 2u];
+	struct _st7920_glyph_cache_entry scratch;
+	const struct _st7920_glyph_cache_entry *entry = NULL;
+	uint32_t rows = 0u;
+	uint32_t n_row = 0u;
+	uint32_t n_char = 0u;
+	uint32_t width = 0u;
+	uint32_t shift = 0u;
+	uint32_t row_index = 0u;
+	uint32_t n_page = 0u;
+	int32_t glyph = 0;
+	int32_t page_index = 0;
+	int32_t row_cy = 0;
+
+	rows = font->height;
+	if(rows > 16u) rows = 16u;
+
+	if((cy >= ((int32_t) this->HEIGHT)) || ((cy + ((int32_t) rows)) <= 0)) return;
+
+	memset(block, 0, sizeof(block));
+
+	/*Merge the visible glyphs into the text line*/
+	for(n_char = 0u; n_char < length; n_char++)
+	{
+		if(cx >= ((int32_t) this->WIDTH)) break;
+
+		glyph = this->_font_glyph_index(font, text[n_char]);
+		if(glyph < 0) continue;
+
+		width = this->_font_glyph_width(font, (uint32_t) glyph);
+
+		if((cx + ((int32_t) width)) > 0)
+		{
+			/*Page and pixel offset within the page (also for negative cx)*/
+			shift = ((uint32_t) cx) & 0xf;
+			page_index = (cx - ((int32_t) shift))/16 + 1;
+
+			entry = this->_glyph_cache_get(font, (uint32_t) glyph, shift, &scratch);
+
+			for(n_row = 0u; n_row < rows; n_row++)
+			{
+				block[n_row][page_index] |= (uint16_t) (entry->rows[n_row] >> 16);
+				block[n_row][page_index + 1] |= (uint16_t) (entry->rows[n_row] & 0xffff);
+			}
+		}
+
+		cx += (int32_t) (width + font->spacing);
+	}
+
+	/*Write the text line, each page once*/
+	for(n_row = 0u; n_row < rows; n_row++)
+	{
+		row_cy = cy + ((int32_t) n_row);
+
+		if(row_cy < 0) continue;
+		if(row_cy >= ((int32_t) this->HEIGHT)) break;
+
+		row_index = this->_pixel_buffer_index(0u, (uint32_t) row_cy);
+
+		for(n_page = 0u; n_page < this->WIDTH_PAGES; n_page++) if(block[n_row][n_page + 1u]) this->_buffer_modify_page((row_index + n_page), block[n_row][n_page + 1u], draw_mode);
+	}
+
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_buffer_modify_chunk(uint32_t buffer_index, uint32_t n_pages, uint32_t source, uint32_t mask, int32_t raster_op)
+{
+	uint32_t value = 0u;
+
+	value = ((uint32_t) this->_page_buffer[buffer_index]) << 16;
+	if(n_pages > 1u) value |= this->_page_buffer[buffer_index + 1u];
+
+	switch(raster_op)
+	{
+		case this->RASTEROP_COPY:
+			value = (value & ~mask) | (source & mask);
+			break;
+
+		case this->RASTEROP_OR:
+			value |= (source & mask);
+			break;
+
+		case this->RASTEROP_AND:
+			value &= (source | ~mask);
+			break;
+
+		case this->RASTEROP_XOR:
+			value ^= (source & mask);
+			break;
+
+		case this->RASTEROP_NOT:
+			value = (value & ~mask) | (~source & mask);
+			break;
+	}
+
+	this->_buffer_write_page(buffer_index, (uint16_t) (value >> 16));
+	if(n_pages > 1u) this->_buffer_write_page((buffer_index + 1u), (uint16_t) (value & 0xffff));
+
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_buffer_modify_page(uint32_t buffer_index, uint16_t mask, int32_t draw_mode)
+{
+	switch(draw_mode)
+	{
+		case this->DRAWMODE_CLEAR:
+			this->_buffer_write_page(buffer_index, (this->_page_buffer[buffer_index] & ~mask));
+			break;
+
+		case this->DRAWMODE_SET:
+			this->_buffer_write_page(buffer_index, (this->_page_buffer[buffer_index] | mask));
+			break;
+
+		case this->DRAWMODE_TOGGLE:
+			this->_buffer_write_page(buffer_index, (this->_page_buffer[buffer_index] ^ mask));
+			break;
+	}
+
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_buffer_plot(int32_t cx, int32_t cy, int32_t draw_mode)
+{
+	uint32_t buffer_index = 0u;
+	uint32_t pixel_offset = 0u;
+
+	if((cx < 0) || (cy < 0)) return;
+
+	if(!this->_phys_cx_cy_to_virt_bufindex_pageindex_cy_offset((uint32_t) cx, (uint32_t) cy, &buffer_index, NULL, NULL, &pixel_offset)) return;
+
+	this->_buffer_modify_page(buffer_index, (uint16_t) (1u << pixel_offset), draw_mode);
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_buffer_hspan(int32_t cx0, int32_t cx1, int32_t cy, int32_t draw_mode)
+{
+	uint32_t buffer_index = 0u;
+	uint32_t last_index = 0u;
+	uint32_t row_index = 0u;
+	uint16_t first_mask = 0u;
+	uint16_t last_mask = 0u;
+	int32_t temp = 0;
+
+	if(cx0 > cx1)
+	{
+		temp = cx0;
+		cx0 = cx1;
+		cx1 = temp;
+	}
+
+	if((cy < 0) || (cy >= ((int32_t) this->HEIGHT))) return;
+	if((cx1 < 0) || (cx0 >= ((int32_t) this->WIDTH))) return;
+
+	if(cx0 < 0) cx0 = 0;
+	if(cx1 >= ((int32_t) this->WIDTH)) cx1 = ((int32_t) this->WIDTH) - 1;
+
+	/*Half screen remap, once per span*/
+	if(cy >= ((int32_t) this->_HEIGHT_PIXELS)) row_index = this->_WIDTH_PAGES*(cy - this->_HEIGHT_PIXELS) + this->WIDTH_PAGES;
+	else row_index = this->_WIDTH_PAGES*cy;
+
+	buffer_index = row_index + ((uint32_t) cx0)/this->_PAGE_SIZE_PIXELS;
+	last_index = row_index + ((uint32_t) cx1)/this->_PAGE_SIZE_PIXELS;
+
+	first_mask = (uint16_t) (0xffff >> (((uint32_t) cx0)%this->_PAGE_SIZE_PIXELS));
+	last_mask = (uint16_t) (0xffff << (this->_PAGE_SIZE_PIXELS - 1u - ((uint32_t) cx1)%this->_PAGE_SIZE_PIXELS));
+
+	if(buffer_index == last_index)
+	{
+		this->_buffer_modify_page(buffer_index, (first_mask & last_mask), draw_mode);
+		return;
+	}
+
+	this->_buffer_modify_page(buffer_index++, first_mask, draw_mode);
+
+	while(buffer_index < last_index) this->_buffer_modify_page(buffer_index++, 0xffff, draw_mode);
+
+	this->_buffer_modify_page(last_index, last_mask, draw_mode);
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_buffer_vspan(int32_t cx, int32_t cy0, int32_t cy1, int32_t draw_mode)
+{
+	uint32_t page_index = 0u;
+	uint16_t mask = 0u;
+	int32_t temp = 0;
+
+	if(cy0 > cy1)
+	{
+		temp = cy0;
+		cy0 = cy1;
+		cy1 = temp;
+	}
+
+	if((cx < 0) || (cx >= ((int32_t) this->WIDTH))) return;
+	if((cy1 < 0) || (cy0 >= ((int32_t) this->HEIGHT))) return;
+
+	if(cy0 < 0) cy0 = 0;
+	if(cy1 >= ((int32_t) this->HEIGHT)) cy1 = ((int32_t) this->HEIGHT) - 1;
+
+	page_index = ((uint32_t) cx)/this->_PAGE_SIZE_PIXELS;
+	mask = (uint16_t) (0x8000 >> (((uint32_t) cx)%this->_PAGE_SIZE_PIXELS));
+
+	/*Upper half, then lower half*/
+	for(; (cy0 <= cy1) && (cy0 < ((int32_t) this->_HEIGHT_PIXELS)); cy0++) this->_buffer_modify_page((this->_WIDTH_PAGES*cy0 + page_index), mask, draw_mode);
+
+	page_index += this->WIDTH_PAGES;
+
+	for(; cy0 <= cy1; cy0++) this->_buffer_modify_page((this->_WIDTH_PAGES*(cy0 - this->_HEIGHT_PIXELS) + page_index), mask, draw_mode);
+
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_buffer_ellipse(int32_t cx, int32_t cy, uint32_t rx, uint32_t ry, bool fill, int32_t draw_mode)
+{
+	int32_t dy = 0;
+	int32_t dy_end = 0;
+	int32_t w_prev = 0;
+	int32_t w = 0;
+	int32_t w_next = 0;
+	int32_t w_inner = 0;
+	uint64_t a = 0u;
+	uint64_t b = 0u;
+
+	a = 2u*((uint64_t) rx) + 1u;
+	a *= a;
+	b = 2u*((uint64_t) ry) + 1u;
+	b *= b;
+
+	/*Off the display (the center may be anywhere in the int32_t range): nothing to draw*/
+	if(((((int64_t) cx) + rx) < 0) || ((((int64_t) cx) - rx) >= ((int64_t) this->WIDTH))) return;
+	if(((((int64_t) cy) + ry) < 0) || ((((int64_t) cy) - ry) >= ((int64_t) this->HEIGHT))) return;
+
+	/*Visible rows only*/
+	dy = -((int32_t) ry);
+	dy_end = (int32_t) ry;
+
+	if(cy + dy < 0) dy = -cy;
+	if(cy + dy_end >= ((int32_t) this->HEIGHT)) dy_end = ((int32_t) this->HEIGHT) - 1 - cy;
+
+	w_prev = st7920_ellipse_half_width(a, b, ry, (dy - 1), 0);
+	w = st7920_ellipse_half_width(a, b, ry, dy, w_prev);
+
+	for(; dy <= dy_end; dy++)
+	{
+		w_next = st7920_ellipse_half_width(a, b, ry, (dy + 1), w);
+
+		if(fill) this->_buffer_hspan((cx - w), (cx + w), (cy + dy), draw_mode);
+		else
+		{
+			/*Outline: pixels with a neighbor outside the ellipse. |x| > w_inner on this row.*/
+			w_inner = w - 1;
+			if(w_prev < w_inner) w_inner = w_prev;
+			if(w_next < w_inner) w_inner = w_next;
+
+			if(w_inner < 0) this->_buffer_hspan((cx - w), (cx + w), (cy + dy), draw_mode);
+			else
+			{
+				this->_buffer_hspan((cx - w), (cx - w_inner - 1), (cy + dy), draw_mode);
+				this->_buffer_hspan((cx + w_inner + 1), (cx + w), (cy + dy), draw_mode);
+			}
+		}
+
+		w_prev = w;
+		w = w_next;
+	}
+
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_buffer_arc(int32_t cx, int32_t cy, uint32_t r, int32_t start_deg, int32_t end_deg, int32_t draw_mode)
+{
+	int64_t a_x = 0;
+	int64_t a_y = 0;
+	int64_t b_x = 0;
+	int64_t b_y = 0;
+	int64_t p_x = 0;
+	int64_t p_y = 0;
+	int32_t sweep = 0;
+	int32_t dy = 0;
+	int32_t dy_end = 0;
+	int32_t dx = 0;
+	int32_t w_prev = 0;
+	int32_t w = 0;
+	int32_t w_next = 0;
+	int32_t w_inner = 0;
+	uint64_t a = 0u;
+	bool inside = false;
+
+	sweep = (int32_t) ((((int64_t) end_deg) - ((int64_t) start_deg))%360);
+	if(sweep < 0) sweep += 360;
+	if(!sweep) return;
+
+	if(((((int64_t) cx) + r) < 0) || ((((int64_t) cx) - r) >= ((int64_t) this->WIDTH))) return;
+	if(((((int64_t) cy) + r) < 0) || ((((int64_t) cy) - r) >= ((int64_t) this->HEIGHT))) return;
+
+	/*Start and end directions (y up), Q14*/
+	start_deg %= 360;
+	end_deg %= 360;
+
+	a_x = st7920_sin_q14(start_deg + 90);
+	a_y = st7920_sin_q14(start_deg);
+	b_x = st7920_sin_q14(end_deg + 90);
+	b_y = st7920_sin_q14(end_deg);
+
+	dy = -((int32_t) r);
+	dy_end = (int32_t) r;
+
+	if(cy + dy < 0) dy = -cy;
+	if(cy + dy_end >= ((int32_t) this->HEIGHT)) dy_end = ((int32_t) this->HEIGHT) - 1 - cy;
+
+	a = 2u*((uint64_t) r) + 1u;
+	a *= a;
+
+	w_prev = st7920_ellipse_half_width(a, a, r, (dy - 1), 0);
+	w = st7920_ellipse_half_width(a, a, r, dy, w_prev);
+
+	for(; dy <= dy_end; dy++)
+	{
+		w_next = st7920_ellipse_half_width(a, a, r, (dy + 1), w);
+
+		w_inner = w - 1;
+		if(w_prev < w_inner) w_inner = w_prev;
+		if(w_next < w_inner) w_inner = w_next;
+
+		for(dx = -w; dx <= w; dx++)
+		{
+			if((dx >= -w_inner) && (dx <= w_inner))
+			{
+				dx = w_inner;
+				continue;
+			}
+
+			p_x = dx;
+			p_y = -dy;
+
+			/*Counter clockwise from a to b: cross(a , p) >= 0 and cross(p , b) >= 0 (sweep up to 180), or not within b to a (sweep over 180)*/
+			if(sweep <= 180) inside = (((a_x*p_y - a_y*p_x) >= 0) && ((p_x*b_y - p_y*b_x) >= 0));
+			else inside = !(((b_x*p_y - b_y*p_x) > 0) && ((p_x*a_y - p_y*a_x) > 0));
+
+			if(inside) this->_buffer_plot((cx + dx), (cy + dy), draw_mode);
+		}
+
+		w_prev = w;
+		w = w_next;
+	}
+
+	return;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::_draw_mode_is_valid(int32_t draw_mode)
+{
+	if((draw_mode == this->DRAWMODE_CLEAR) || (draw_mode == this->DRAWMODE_SET) || (draw_mode == this->DRAWMODE_TOGGLE)) return true;
+
+	return false;
+}
+
+template class ST7920Panel<ST7920Geometry128x64>;
+template class ST7920Panel<ST7920Geometry256x32>;
+template class ST7920Panel<ST7920Geometry192x32>;
@@ -0,0 +1,46 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Bitmap fonts for the graphics text renderer (ST7920::bufferDrawText()).
+ *
+ * Glyphs are stored column by column, left to right. Each column is (height + 7)/8 bytes, bit 0 of the first byte is the top pixel.
+ * Fixed width fonts: every glyph is "width" columns wide, glyph n starts at byte n*width*(column bytes).
+ * Proportional fonts: width = 0, glyph n is widths[n] columns wide and starts at byte offsets[n].
+ *
+ * Glyphs are at most 16 pixels wide and 16 pixels tall.
+ */
+
+#ifndef ST7920_FONT_HPP
+#define ST7920_FONT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct _st7920_font {
+	uint8_t height;
+	uint8_t first_char;
+	uint8_t last_char;
+	uint8_t width; /*0 for proportional fonts*/
+	uint8_t spacing; /*Blank columns between glyphs*/
+	const uint8_t *widths; /*Proportional fonts only, NULL otherwise*/
+	const uint16_t *offsets; /*Proportional fonts only, NULL otherwise*/
+	const uint8_t *data;
+};
+
+/*
+ * Built-in fonts (ASCII 0x20 - 0x7e)
+ *
+ * st7920_font_5x7: 5x7 fixed width, 1 column spacing (6 pixels per character, 21 characters per line).
+ * st7920_font_5x7p: proportional version of st7920_font_5x7.
+ */
+
+extern const struct _st7920_font st7920_font_5x7;
+extern const struct _st7920_font st7920_font_5x7p;
+
+#endif /*ST7920_FONT_HPP*/
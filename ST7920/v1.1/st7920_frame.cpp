@@ -0,0 +1,211 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Frame buffering (double/triple buffering).
+ *
+ * Frames are handed over through a single byte (_ready_frame): frame index + fresh flag.
+ * bufferPublish() puts the draw frame there (fresh) and takes the one it held. bufferPaintFrame() takes the fresh frame
+ * and puts back the frame it painted before (triple buffering), or nothing until it's done painting (double buffering).
+ * Each side only ever touches its own frame, so neither side waits for the other.
+ */
+
+#include "st7920.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_ARCH_6M__)
+
+/*Cortex-M0+ (Teensy LC) has no exclusive load/store: the exchange runs with interrupts masked.*/
+
+static uint8_t st7920_frame_exchange(volatile uint8_t *p, uint8_t value)
+{
+	uint32_t primask = 0u;
+	uint8_t old_value = 0u;
+
+	__asm__ volatile("mrs %0, primask" : "=r" (primask));
+	__asm__ volatile("cpsid i" ::: "memory");
+
+	old_value = *p;
+	*p = value;
+
+	__asm__ volatile("msr primask, %0" :: "r" (primask) : "memory");
+	return old_value;
+}
+
+static bool st7920_frame_compare_exchange(volatile uint8_t *p, uint8_t expected, uint8_t value)
+{
+	uint32_t primask = 0u;
+	bool retval = false;
+
+	__asm__ volatile("mrs %0, primask" : "=r" (primask));
+	__asm__ volatile("cpsid i" ::: "memory");
+
+	if(*p == expected)
+	{
+		*p = value;
+		retval = true;
+	}
+
+	__asm__ volatile("msr primask, %0" :: "r" (primask) : "memory");
+	return retval;
+}
+
+#else
+
+static uint8_t st7920_frame_exchange(volatile uint8_t *p, uint8_t value)
+{
+	return __atomic_exchange_n(p, value, __ATOMIC_ACQ_REL);
+}
+
+static bool st7920_frame_compare_exchange(volatile uint8_t *p, uint8_t expected, uint8_t value)
+{
+	return __atomic_compare_exchange_n(p, &expected, value, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+#endif
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::setFrameBuffers(Frame *frames, uint32_t n_frames)
+{
+	uint32_t n_frame = 0u;
+
+	if(this->_status < 1) return false;
+	if(n_frames > 2u) return false;
+	if((n_frames > 0u) && (frames == NULL)) return false;
+
+	this->_paint_cancel();
+
+	/*Back to (or start from) the driver buffer, with the current drawing. Its modified pages are still to be painted.*/
+	if(this->_page_buffer != this->_frame.pages) memcpy(this->_frame.pages, this->_page_buffer, sizeof(this->_frame.pages));
+
+	this->_page_buffer = this->_frame.pages;
+	this->_dirty_map = this->_frame.dirty;
+	this->_draw_frame = 0u;
+
+	/*Coming from frame buffering: the display might show any of the frames*/
+	if(this->_frame_count > 1u) this->_dirty_map_set_all(true);
+
+	this->_frames[1] = NULL;
+	this->_frames[2] = NULL;
+
+	for(n_frame = 0u; n_frame < n_frames; n_frame++)
+	{
+		this->_frames[n_frame + 1u] = &frames[n_frame];
+		memset(frames[n_frame].dirty, 0x00, sizeof(frames[n_frame].dirty));
+		frames[n_frame].seq = 0u;
+	}
+
+	this->_frame_count = n_frames + 1u;
+
+	this->_publish_seq = 0u;
+	this->_scan_seq = 0u;
+	this->_frame.seq = 0u;
+
+	this->_scan_frame = this->_FRAME_NONE;
+	this->_ready_frame = this->_FRAME_NONE;
+
+	if(this->_frame_count == 2u) this->_ready_frame = 1u;
+
+	if(this->_frame_count == 3u)
+	{
+		this->_ready_frame = 1u;
+		this->_scan_frame = 2u;
+	}
+
+	return true;
+}
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::bufferPublish(void)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_PUBLISH);
+
+	Frame *p_frame = NULL;
+	Frame *p_next = NULL;
+	uint8_t ready = 0u;
+
+	if(this->_status < 1) return false;
+	if(this->_frame_count < 2u) return false;
+
+	p_frame = this->_frames[this->_draw_frame];
+	p_frame->seq = this->_publish_seq + 1u;
+
+	if(this->_frame_count == 3u) ready = st7920_frame_exchange(&this->_ready_frame, (this->_draw_frame | this->_FRAME_FRESH));
+	else
+	{
+		/*Double buffering: the only other frame must not be in use by bufferPaintFrame()*/
+		ready = __atomic_load_n(&this->_ready_frame, __ATOMIC_ACQUIRE);
+		if(ready == this->_FRAME_NONE) return false;
+
+		if(!st7920_frame_compare_exchange(&this->_ready_frame, ready, (this->_draw_frame | this->_FRAME_FRESH))) return false;
+	}
+
+	this->_publish_seq++;
+
+	/*The frame taken back is older than the one just published: continue drawing from the published one*/
+	this->_draw_frame = ready & ~this->_FRAME_FRESH;
+	p_next = this->_frames[this->_draw_frame];
+
+	memcpy(p_next->pages, p_frame->pages, sizeof(p_next->pages));
+	memset(p_next->dirty, 0x00, sizeof(p_next->dirty));
+
+	this->_page_buffer = p_next->pages;
+	this->_dirty_map = p_next->dirty;
+
+	return true;
+}
+
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::bufferPaintFrame(void)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_BUFFER_PAINT_FRAME);
+
+	Frame *p_frame = NULL;
+	uint32_t sent = 0u;
+	uint8_t ready = 0u;
+
+	if(this->_status < 1) return -1;
+	if(this->_frame_count < 2u) return -1;
+
+	ready = __atomic_load_n(&this->_ready_frame, __ATOMIC_ACQUIRE);
+	if((ready == this->_FRAME_NONE) || !(ready & this->_FRAME_FRESH)) return 0;
+
+	this->_bus_call_begin();
+
+	/*Only this side clears the fresh flag: the frame taken is fresh (possibly a newer one than seen above)*/
+	if(this->_frame_count == 3u) ready = st7920_frame_exchange(&this->_ready_frame, this->_scan_frame);
+	else ready = st7920_frame_exchange(&this->_ready_frame, this->_FRAME_NONE);
+
+	this->_scan_frame = ready & ~this->_FRAME_FRESH;
+	p_frame = this->_frames[this->_scan_frame];
+
+	if(p_frame->seq == (this->_scan_seq + 1u)) sent = this->_paint_pages(p_frame->pages, p_frame->dirty);
+	else sent = this->_paint_pages(p_frame->pages, NULL);
+
+	this->_scan_seq = p_frame->seq;
+
+	/*Write dropped: the display doesn't show this frame, the next one is painted in full*/
+	if(sent < this->_BUFFER_SIZE_PAGES) this->_scan_seq--;
+
+	/*Double buffering: the frame goes back for the next bufferPublish()*/
+	if(this->_frame_count == 2u)
+	{
+		__atomic_store_n(&this->_ready_frame, this->_scan_frame, __ATOMIC_RELEASE);
+		this->_scan_frame = this->_FRAME_NONE;
+	}
+
+	if(!this->_bus_call_end()) return -1;
+
+	return 1;
+}
+
+template class ST7920Panel<ST7920Geometry128x64>;
+template class ST7920Panel<ST7920Geometry256x32>;
+template class ST7920Panel<ST7920Geometry192x32>;
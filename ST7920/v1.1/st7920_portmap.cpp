@@ -0,0 +1,78 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "st7920_portmap.hpp"
+
+#include <string.h>
+
+bool st7920_portmap_build(const uintptr_t *line_port, const uint32_t *line_mask, struct _st7920_portmap *p_map)
+{
+	uint32_t n_line = 0u;
+	uint32_t n_port = 0u;
+	int32_t shift = 0;
+
+	if((line_port == NULL) || (line_mask == NULL) || (p_map == NULL)) return false;
+
+	memset(p_map, 0, sizeof(struct _st7920_portmap));
+	p_map->shift = -1;
+
+	for(n_line = 0u; n_line < 8u; n_line++)
+	{
+		/*Exactly one bit per data line*/
+		if(!line_mask[n_line]) return false;
+		if(line_mask[n_line] & (line_mask[n_line] - 1u)) return false;
+
+		for(n_port = 0u; n_port < p_map->n_ports; n_port++) if(p_map->port[n_port] == line_port[n_line]) break;
+
+		if(n_port == p_map->n_ports)
+		{
+			p_map->port[n_port] = line_port[n_line];
+			p_map->n_ports++;
+		}
+
+		/*Two data lines on the same port bit*/
+		if(p_map->port_mask[n_port] & line_mask[n_line]) return false;
+
+		p_map->port_mask[n_port] |= line_mask[n_line];
+		p_map->line_port[n_line] = (uint8_t) n_port;
+		p_map->line_mask[n_line] = line_mask[n_line];
+	}
+
+	if(p_map->n_ports != 1u) return true;
+
+	shift = 0;
+	while(!(line_mask[0] & (1u << shift))) shift++;
+
+	if(shift > 24) return true;
+
+	for(n_line = 0u; n_line < 8u; n_line++) if(line_mask[n_line] != (1u << (shift + n_line))) return true;
+
+	p_map->shift = shift;
+	return true;
+}
+
+void st7920_portmap_encode(const struct _st7920_portmap *p_map, uint8_t byte, uint32_t *p_set, uint32_t *p_clear)
+{
+	uint32_t n_line = 0u;
+	uint32_t n_port = 0u;
+
+	if(p_map->shift >= 0)
+	{
+		p_set[0] = ((uint32_t) byte) << p_map->shift;
+		p_clear[0] = ((uint32_t) ((uint8_t) ~byte)) << p_map->shift;
+		return;
+	}
+
+	for(n_port = 0u; n_port < p_map->n_ports; n_port++) p_set[n_port] = 0u;
+
+	for(n_line = 0u; n_line < 8u; n_line++) if(byte & (1u << n_line)) p_set[p_map->line_port[n_line]] |= p_map->line_mask[n_line];
+
+	for(n_port = 0u; n_port < p_map->n_ports; n_port++) p_clear[n_port] = p_map->port_mask[n_port] & ~p_set[n_port];
+
+	return;
+}
@@ -0,0 +1,53 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Data line to GPIO port mapping.
+ * Groups the 8 data lines (DB0 - DB7) by the GPIO port they belong to, so a byte can be written with one set and one clear write per port
+ * instead of one pin write per data line.
+ *
+ * These functions don't touch any hardware. They only work on port identifiers and bit masks, so they can be used with a fake port table.
+ */
+
+#ifndef ST7920_PORTMAP_HPP
+#define ST7920_PORTMAP_HPP
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+struct _st7920_portmap {
+	uint32_t n_ports;
+	uintptr_t port[8]; /*Port identifier (usually the address of the port output register)*/
+	uint32_t port_mask[8]; /*All data line bits within each port*/
+	uint8_t line_port[8]; /*Port slot of each data line (DB0 - DB7)*/
+	uint32_t line_mask[8]; /*Bit of each data line (DB0 - DB7) within its port*/
+	int32_t shift; /*If DB0 - DB7 are 8 consecutive ascending bits of a single port: bit position of DB0. -1 otherwise*/
+};
+
+/*
+ * st7920_portmap_build()
+ *
+ * Builds the port map from the port identifier and bit mask of each data line (DB0 - DB7).
+ * Each line mask must have exactly one bit set, and no two data lines may share the same port bit.
+ *
+ * returns true if successful, false otherwise.
+ */
+
+extern bool st7920_portmap_build(const uintptr_t *line_port, const uint32_t *line_mask, struct _st7920_portmap *p_map);
+
+/*
+ * st7920_portmap_encode()
+ *
+ * Computes for each port (in port slot order) the bits to be set and the bits to be cleared to put "byte" on the data lines.
+ * p_set and p_clear must have room for p_map->n_ports values.
+ */
+
+extern void st7920_portmap_encode(const struct _st7920_portmap *p_map, uint8_t byte, uint32_t *p_set, uint32_t *p_clear);
+
+#endif /*ST7920_PORTMAP_HPP*/
@@ -0,0 +1,215 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "st7920_queue.hpp"
+
+/*
+ * ST7920CommandQueue
+ */
+
+ST7920CommandQueue::ST7920CommandQueue(void)
+{
+	static_assert((SIZE != 0u) && ((SIZE & (SIZE - 1u)) == 0u), "ST7920_QUEUE_SIZE must be a power of 2");
+}
+
+bool ST7920CommandQueue::push(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t delay_us)
+{
+	uint32_t head = 0u;
+	uint32_t tail = 0u;
+	uint32_t n_byte = 0u;
+	struct _st7920_transfer *p_transfer = NULL;
+
+	if(bytes == NULL) return false;
+
+	head = this->_head;
+	tail = __atomic_load_n(&this->_tail, __ATOMIC_ACQUIRE);
+
+	if((this->SIZE - (head - tail)) < n_bytes) return false;
+
+	for(n_byte = 0u; n_byte < n_bytes; n_byte++)
+	{
+		p_transfer = &this->_ring[(head + n_byte) & this->_INDEX_MASK];
+
+		p_transfer->reg = (uint8_t) reg;
+		p_transfer->byte = bytes[n_byte];
+		p_transfer->delay_us = (uint16_t) delay_us;
+	}
+
+	/*Publish the transfers only after they're written*/
+	__atomic_store_n(&this->_head, (head + n_bytes), __ATOMIC_RELEASE);
+
+	return true;
+}
+
+bool ST7920CommandQueue::pop(struct _st7920_transfer *p_transfer)
+{
+	uint32_t head = 0u;
+	uint32_t tail = 0u;
+
+	if(p_transfer == NULL) return false;
+
+	tail = this->_tail;
+	head = __atomic_load_n(&this->_head, __ATOMIC_ACQUIRE);
+
+	if(head == tail) return false;
+
+	*p_transfer = this->_ring[tail & this->_INDEX_MASK];
+
+	/*Release the slot only after it's read*/
+	__atomic_store_n(&this->_tail, (tail + 1u), __ATOMIC_RELEASE);
+
+	return true;
+}
+
+uint32_t ST7920CommandQueue::getFree(void)
+{
+	return this->SIZE - this->getUsed();
+}
+
+uint32_t ST7920CommandQueue::getUsed(void)
+{
+	return __atomic_load_n(&this->_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&this->_tail, __ATOMIC_ACQUIRE);
+}
+
+bool ST7920CommandQueue::isEmpty(void)
+{
+	return (this->getUsed() == 0u);
+}
+
+/*
+ * ST7920QueuedBus
+ */
+
+ST7920QueuedBus::ST7920QueuedBus(ST7920Bus &bus, uint32_t tick_us)
+{
+	this->_bus = &bus;
+	this->_tick_us = tick_us;
+}
+
+bool ST7920QueuedBus::begin(void)
+{
+	if(this->_bus == NULL) return false;
+	if(!this->_tick_us) return false;
+
+	return this->_bus->begin();
+}
+
+bool ST7920QueuedBus::writeCommands(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+{
+	return this->_write_bytes(false, bytes, n_bytes, cmddelay_us);
+}
+
+bool ST7920QueuedBus::writeData(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+{
+	return this->_write_bytes(true, bytes, n_bytes, cmddelay_us);
+}
+
+void ST7920QueuedBus::setWaitWhenFull(bool wait)
+{
+	this->_wait_when_full = wait;
+	return;
+}
+
+void ST7920QueuedBus::service(void)
+{
+	struct _st7920_transfer transfer;
+
+	uint32_t hold_us = this->_hold_us;
+
+	if(hold_us > this->_tick_us)
+	{
+		__atomic_store_n(&this->_hold_us, (hold_us - this->_tick_us), __ATOMIC_RELEASE);
+		return;
+	}
+
+	__atomic_store_n(&this->_hold_us, 0u, __ATOMIC_RELEASE);
+
+	if(!this->_queue.pop(&transfer)) return;
+
+	/*The display delay is covered by the following ticks*/
+	if(transfer.reg) this->_bus->writeData(&transfer.byte, 1u, 0u);
+	else this->_bus->writeCommands(&transfer.byte, 1u, 0u);
+
+	__atomic_store_n(&this->_hold_us, (uint32_t) transfer.delay_us, __ATOMIC_RELEASE);
+
+	return;
+}
+
+void ST7920QueuedBus::flush(void)
+{
+	while(!this->idle());
+	return;
+}
+
+bool ST7920QueuedBus::idle(void)
+{
+	if(!this->_queue.isEmpty()) return false;
+	if(__atomic_load_n(&this->_hold_us, __ATOMIC_ACQUIRE)) return false;
+
+	return true;
+}
+
+uint32_t ST7920QueuedBus::getFree(void)
+{
+	return this->_queue.getFree();
+}
+
+uint32_t ST7920QueuedBus::getFullCount(void)
+{
+	return this->_full_count;
+}
+
+uint32_t ST7920QueuedBus::getDropCount(void)
+{
+	return this->_drop_count;
+}
+
+void ST7920QueuedBus::resetFullCount(void)
+{
+	this->_full_count = 0u;
+	this->_drop_count = 0u;
+	return;
+}
+
+bool ST7920QueuedBus::_write_bytes(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+{
+	uint32_t n_chunk = 0u;
+	bool full = false;
+
+	if(!n_bytes) return true;
+
+	/*Backpressure: all or nothing, never wait*/
+	if(!this->_wait_when_full)
+	{
+		if(this->_queue.push(reg, bytes, n_bytes, cmddelay_us)) return true;
+
+		this->_full_count++;
+		this->_drop_count++;
+		return false;
+	}
+
+	/*Long sequences are queued in chunks, so they don't need the whole queue to be free at once. A chunk always fits in an empty queue.*/
+	while(n_bytes)
+	{
+		n_chunk = n_bytes;
+		if(n_chunk > this->MAX_WRITE_BYTES) n_chunk = this->MAX_WRITE_BYTES;
+
+		if(!this->_queue.push(reg, bytes, n_chunk, cmddelay_us))
+		{
+			if(!full) this->_full_count++;
+			full = true;
+			continue;
+		}
+
+		full = false;
+		bytes += n_chunk;
+		n_bytes -= n_chunk;
+	}
+
+	return true;
+}
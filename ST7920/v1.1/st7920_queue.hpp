@@ -0,0 +1,189 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Asynchronous bus operation.
+ * ST7920CommandQueue is a fixed size single producer / single consumer ring of bus transfers. It's lock free: the producer
+ * (application) only writes the head index, the consumer (interrupt) only writes the tail index.
+ * ST7920QueuedBus is a bus backend that encodes transfers into the queue and returns. Its service() method is meant to be called
+ * from a periodic timer interrupt (e.g. IntervalTimer). It sends one transfer per call on the wrapped bus, so the display
+ * command delays are paid by the timer schedule instead of the application.
+ * A full queue is reported, not waited on (see writeCommands()): check getFree() before each display call to keep it from filling up.
+ */
+
+#ifndef ST7920_QUEUE_HPP
+#define ST7920_QUEUE_HPP
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "st7920_bus.hpp"
+
+/*
+ * Number of transfers the queue can hold. Must be a power of 2, at least ST7920QueuedBus::MAX_WRITE_BYTES (32).
+ * Each transfer takes 4 bytes of RAM.
+ */
+
+#ifndef ST7920_QUEUE_SIZE
+#define ST7920_QUEUE_SIZE 256u
+#endif
+
+struct _st7920_transfer {
+	uint8_t reg; /*0: command, 1: data*/
+	uint8_t byte;
+	uint16_t delay_us;
+};
+
+class ST7920CommandQueue {
+	public:
+		ST7920CommandQueue(void);
+
+		/*
+		 * push()
+		 * Producer side. Encodes n_bytes transfers into the queue. Either all of them are queued, or none.
+		 *
+		 * returns true if successful, false if there's not enough room in the queue.
+		 */
+
+		bool push(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t delay_us);
+
+		/*
+		 * pop()
+		 * Consumer side. Takes the oldest transfer out of the queue.
+		 *
+		 * returns true if successful, false if the queue is empty.
+		 */
+
+		bool pop(struct _st7920_transfer *p_transfer);
+
+		/*
+		 * getFree() & getUsed()
+		 * Returns the number of free/used transfer slots.
+		 */
+
+		uint32_t getFree(void);
+		uint32_t getUsed(void);
+
+		/*
+		 * isEmpty()
+		 * returns true if there are no transfers in the queue, false otherwise.
+		 */
+
+		bool isEmpty(void);
+
+		static const uint32_t SIZE = ST7920_QUEUE_SIZE;
+
+	private:
+		static const uint32_t _INDEX_MASK = SIZE - 1u;
+
+		struct _st7920_transfer _ring[SIZE];
+
+		/*Free running indexes. head: written by the producer only, tail: written by the consumer only.*/
+		volatile uint32_t _head = 0u;
+		volatile uint32_t _tail = 0u;
+};
+
+class ST7920QueuedBus : public ST7920Bus {
+	public:
+		/*
+		 * bus: the bus the queued transfers are sent on.
+		 * tick_us: period (in microseconds) at which service() is called.
+		 */
+
+		ST7920QueuedBus(ST7920Bus &bus, uint32_t tick_us);
+
+		bool begin(void);
+
+		/*
+		 * writeCommands() & writeData()
+		 *
+		 * Queue the transfers and return, without waiting. A write that doesn't fit in the queue is dropped whole (none of its transfers
+		 * are queued), counted (getDropCount()) and reported: the display call that made it returns false, and the display forgets what
+		 * it knew of the display state. Its pages stay dirty: paint / print again once there's room. The driver makes writes of up to
+		 * MAX_WRITE_BYTES: with that many free slots per write a display call makes (getFree()), nothing is dropped. See setWaitWhenFull()
+		 * to wait instead.
+		 *
+		 * returns true if the write was queued, false if it was dropped.
+		 */
+
+		bool writeCommands(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us);
+		bool writeData(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us);
+
+		/*
+		 * setWaitWhenFull()
+		 * wait = true: a write that doesn't fit waits for service() to make room (in chunks of up to MAX_WRITE_BYTES) instead of being dropped.
+		 * Only while the timer interrupt keeps running: a write made with it blocked (or from a higher priority interrupt) would wait forever.
+		 * Off by default.
+		 */
+
+		void setWaitWhenFull(bool wait);
+
+		/*
+		 * service()
+		 * Sends one queued transfer, if the display is done with the previous one. Call from the timer interrupt, every tick_us.
+		 */
+
+		void service(void);
+
+		/*
+		 * flush()
+		 * Waits until every queued transfer is sent and executed. Must not be called with the timer interrupt blocked.
+		 */
+
+		void flush(void);
+
+		/*
+		 * idle()
+		 * returns true if every queued transfer has been sent and executed, false otherwise.
+		 */
+
+		bool idle(void);
+
+		/*
+		 * getFree()
+		 * returns the number of free transfer slots in the queue.
+		 */
+
+		uint32_t getFree(void);
+
+		/*
+		 * getFullCount(), getDropCount() & resetFullCount()
+		 * Gets the number of writes that found the queue full (dropped, or waited with setWaitWhenFull()) / that were dropped.
+		 * resetFullCount() resets both counts.
+		 */
+
+		uint32_t getFullCount(void);
+		uint32_t getDropCount(void);
+		void resetFullCount(void);
+
+		/*
+		 * MAX_WRITE_BYTES: largest write the driver makes (a 256 pixel GDRAM row, or a CGRAM glyph).
+		 */
+
+		static const uint32_t MAX_WRITE_BYTES = 32u;
+
+	private:
+		static_assert(ST7920CommandQueue::SIZE >= MAX_WRITE_BYTES, "ST7920_QUEUE_SIZE must hold the largest write (ST7920QueuedBus::MAX_WRITE_BYTES)");
+
+		ST7920Bus *_bus = NULL;
+		uint32_t _tick_us = 0u;
+
+		ST7920CommandQueue _queue;
+
+		/*Consumer side: time left until the display is done with the last transfer sent.*/
+		volatile uint32_t _hold_us = 0u;
+
+		volatile uint32_t _full_count = 0u;
+		volatile uint32_t _drop_count = 0u;
+		bool _wait_when_full = false;
+
+		bool _write_bytes(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us);
+};
+
+#endif /*ST7920_QUEUE_HPP*/
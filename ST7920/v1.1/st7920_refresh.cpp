@@ -0,0 +1,359 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Refresh scheduler.
+ *
+ * Pending regions are kept in a small table (ST7920_REFRESH_SLOTS), in 16 pixel page columns by screen rows. Each tick picks the
+ * pending region with the highest priority (earliest deadline among equals) and sends its modified pages row by row, planning each run
+ * of pages against what's left of the budget the same way bufferPaintStep() does (worst case transfer time). A region is done once its
+ * last row is sent; the tick then goes on with the next region, until the budget runs out. As with bufferPaintStep(), the first page
+ * of a tick goes whatever the budget, so every tick makes progress.
+ */
+
+#include "st7920.hpp"
+
+#include <string.h>
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::refreshRequest(int32_t cx, int32_t cy, int32_t w, int32_t h, uint8_t priority, uint32_t deadline_us)
+{
+	struct _st7920_refresh_region region;
+	struct _st7920_refresh_region candidate;
+	struct _st7920_refresh_region *p_slot = NULL;
+	uint32_t n_slot = 0u;
+	uint32_t area = 0u;
+	uint32_t growth = 0u;
+	uint32_t least_growth = 0u;
+	int32_t cx1 = 0;
+	int32_t cy1 = 0;
+	bool merged = false;
+	bool coalesced = false;
+
+	if(this->_status < 1) return false;
+	if(this->_frame_count > 1u) return false;
+	if((w <= 0) || (h <= 0)) return false;
+
+	/*Clip to the screen (the far edges in 64 bit, cx + w may be past the int32_t range)*/
+	cx1 = (int32_t) this->WIDTH - 1;
+	cy1 = (int32_t) this->HEIGHT - 1;
+
+	if((((int64_t) cx) + w - 1) < cx1) cx1 = cx + w - 1;
+	if((((int64_t) cy) + h - 1) < cy1) cy1 = cy + h - 1;
+
+	if(cx < 0) cx = 0;
+	if(cy < 0) cy = 0;
+
+	if((cx > cx1) || (cy > cy1)) return false;
+
+	region.deadline_us = micros() + deadline_us;
+	region.col0 = (uint8_t) (cx >> 4);
+	region.col1 = (uint8_t) (cx1 >> 4);
+	region.row0 = (uint8_t) cy;
+	region.row1 = (uint8_t) cy1;
+	region.priority = priority;
+	region.used = true;
+	region.missed = false;
+
+	this->_refresh_stats.requests++;
+
+	/*Merge with every overlapping region. The region grows, so check them all again after each merge.*/
+	do {
+		merged = false;
+
+		for(n_slot = 0u; n_slot < ST7920_REFRESH_SLOTS; n_slot++)
+		{
+			p_slot = &this->_refresh_regions[n_slot];
+
+			if(!p_slot->used) continue;
+			if((p_slot->col0 > region.col1) || (region.col0 > p_slot->col1)) continue;
+			if((p_slot->row0 > region.row1) || (region.row0 > p_slot->row1)) continue;
+
+			this->_refresh_merge(&region, p_slot);
+			p_slot->used = false;
+
+			merged = true;
+			coalesced = true;
+		}
+	} while(merged);
+
+	if(coalesced) this->_refresh_stats.coalesced++;
+
+	for(n_slot = 0u; n_slot < ST7920_REFRESH_SLOTS; n_slot++)
+	{
+		if(this->_refresh_regions[n_slot].used) continue;
+
+		this->_refresh_regions[n_slot] = region;
+		return true;
+	}
+
+	/*Every slot taken: merge with the region that grows the least*/
+	p_slot = NULL;
+
+	for(n_slot = 0u; n_slot < ST7920_REFRESH_SLOTS; n_slot++)
+	{
+		candidate = this->_refresh_regions[n_slot];
+
+		area = (candidate.col1 - candidate.col0 + 1u)*(candidate.row1 - candidate.row0 + 1u);
+		this->_refresh_merge(&candidate, &region);
+		growth = (candidate.col1 - candidate.col0 + 1u)*(candidate.row1 - candidate.row0 + 1u) - area;
+
+		if((p_slot != NULL) && (growth >= least_growth)) continue;
+
+		p_slot = &this->_refresh_regions[n_slot];
+		least_growth = growth;
+	}
+
+	this->_refresh_merge(p_slot, &region);
+
+	if(!coalesced) this->_refresh_stats.coalesced++;
+
+	return true;
+}
+
+template<class Geometry>
+int32_t ST7920Panel<Geometry>::refreshTick(uint32_t budget_us)
+{
+	ST7920_STATS_SCOPE(ST7920_STATS_REFRESH_TICK);
+
+	struct _st7920_refresh_region *p_region = NULL;
+	struct _st7920_refresh_region *p_best = NULL;
+	uint32_t start_us = 0u;
+	uint32_t now_us = 0u;
+	uint32_t late_us = 0u;
+	uint32_t n_slot = 0u;
+	int32_t n_pending = 0;
+	bool first_run = true;
+
+	if(this->_status < 1) return -1;
+	if(this->_frame_count > 1u) return -1;
+
+	this->_bus_call_begin();
+
+	start_us = micros();
+
+	while(true)
+	{
+		p_best = NULL;
+
+		for(n_slot = 0u; n_slot < ST7920_REFRESH_SLOTS; n_slot++)
+		{
+			p_region = &this->_refresh_regions[n_slot];
+
+			if(!p_region->used) continue;
+
+			if(p_best != NULL)
+			{
+				if(p_region->priority < p_best->priority) continue;
+				if((p_region->priority == p_best->priority) && (((int32_t) (p_region->deadline_us - p_best->deadline_us)) >= 0)) continue;
+			}
+
+			p_best = p_region;
+		}
+
+		if(p_best == NULL) break;
+
+		/*Out of budget: the region goes on next tick*/
+		if(!this->_refresh_send(p_best, start_us, budget_us, &first_run)) break;
+
+		now_us = micros();
+		late_us = now_us - p_best->deadline_us;
+
+		if(((int32_t) late_us) > 0)
+		{
+			if(!p_best->missed) this->_refresh_stats.missed++;
+			if(late_us > this->_refresh_stats.max_late_us) this->_refresh_stats.max_late_us = late_us;
+		}
+
+		p_best->used = false;
+		this->_refresh_stats.completed++;
+	}
+
+	/*Deadlines passed with the region still pending*/
+	now_us = micros();
+
+	for(n_slot = 0u; n_slot < ST7920_REFRESH_SLOTS; n_slot++)
+	{
+		p_region = &this->_refresh_regions[n_slot];
+
+		if(!p_region->used) continue;
+
+		n_pending++;
+
+		if(p_region->missed) continue;
+		if(((int32_t) (now_us - p_region->deadline_us)) <= 0) continue;
+
+		p_region->missed = true;
+		this->_refresh_stats.missed++;
+	}
+
+	this->_refresh_stats.ticks++;
+	if((now_us - start_us) > this->_refresh_stats.max_tick_us) this->_refresh_stats.max_tick_us = now_us - start_us;
+
+	if(!this->_bus_call_end()) return -1;
+
+	return n_pending;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::refreshCancel(void)
+{
+	uint32_t n_slot = 0u;
+
+	for(n_slot = 0u; n_slot < ST7920_REFRESH_SLOTS; n_slot++) this->_refresh_regions[n_slot].used = false;
+
+	return;
+}
+
+template<class Geometry>
+uint32_t ST7920Panel<Geometry>::getRefreshPendingCount(void)
+{
+	uint32_t n_slot = 0u;
+	uint32_t n_pending = 0u;
+
+	for(n_slot = 0u; n_slot < ST7920_REFRESH_SLOTS; n_slot++) if(this->_refresh_regions[n_slot].used) n_pending++;
+
+	return n_pending;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::getRefreshStats(struct _st7920_refresh_stats *p_stats)
+{
+	if(p_stats == NULL) return;
+
+	*p_stats = this->_refresh_stats;
+	return;
+}
+
+template<class Geometry>
+void ST7920Panel<Geometry>::resetRefreshStats(void)
+{
+	memset(&this->_refresh_stats, 0, sizeof(struct _st7920_refresh_stats));
+	return;
+}
+
+/*
+ * Sends the modified pages of the region, from its first row not sent yet, as far as they fit in the budget (started at start_us).
+ * The instruction set switch is only budgeted if the state cache says the display isn't in the extended set already.
+ * *p_first_run: nothing sent yet this tick. The first run then goes whatever the budget (one page, if the budget is short of it).
+ * returns true if the region is done, false if the budget ran out (or a write was dropped).
+ */
+
+template<class Geometry>
+bool ST7920Panel<Geometry>::_refresh_send(struct _st7920_refresh_region *p_region, uint32_t start_us, uint32_t budget_us, bool *p_first_run)
+{
+	uint32_t cy = 0u;
+	uint32_t col = 0u;
+	uint32_t row_index = 0u;
+	uint32_t buffer_index = 0u;
+	uint32_t spent_us = 0u;
+	uint32_t n_pages = 0u;
+	uint32_t n_fit = 0u;
+	uint32_t n_page = 0u;
+	uint16_t page_value = 0u;
+	uint8_t bytes[_WIDTH_PAGES*_PAGE_SIZE_BYTES];
+
+	for(cy = p_region->row0; cy <= p_region->row1; cy++)
+	{
+		row_index = this->_pixel_buffer_index(((uint32_t) p_region->col0) << 4, cy);
+
+		col = p_region->col0;
+		while(col <= p_region->col1)
+		{
+			buffer_index = row_index + (col - p_region->col0);
+
+			if(!this->_dirty_map_get(buffer_index))
+			{
+				col++;
+				continue;
+			}
+
+			/*Run of modified pages within the region*/
+			n_pages = 0u;
+			while(((col + n_pages) <= p_region->col1) && this->_dirty_map_get(buffer_index + n_pages)) n_pages++;
+
+			/*Instruction set switch (if needed) + address set (2 transfers) + 2 transfers per page*/
+			spent_us = (micros() - start_us) + this->_instruction_mode_switch_us(true);
+
+			n_fit = 0u;
+			if(spent_us < budget_us) n_fit = (budget_us - spent_us)/this->_SHORT_TRANSFER_US;
+
+			if(n_fit < 4u)
+			{
+				if(!*p_first_run) return false;
+				n_fit = 4u;
+			}
+
+			*p_first_run = false;
+
+			n_fit = (n_fit - 2u)/2u;
+			if(n_pages > n_fit) n_pages = n_fit;
+
+			this->_set_instruction_mode(true);
+			this->_set_gdram_address(this->_gdram_row(buffer_index/this->_WIDTH_PAGES), (buffer_index%this->_WIDTH_PAGES));
+
+			for(n_page = 0u; n_page < n_pages; n_page++)
+			{
+				page_value = this->_page_buffer[buffer_index + n_page];
+
+				bytes[2u*n_page] = (uint8_t) (page_value >> 8);
+				bytes[2u*n_page + 1u] = (uint8_t) (page_value & 0xff);
+
+				this->_dirty_map[(buffer_index + n_page) >> 5] &= ~(1u << ((buffer_index + n_page) & 0x1f));
+				this->_paint_map[(buffer_index + n_page) >> 5] &= ~(1u << ((buffer_index + n_page) & 0x1f));
+			}
+
+			if(!this->_send_bytes(true, bytes, (2u*n_pages), this->_CMD_SHORT_DELAY_US))
+			{
+				/*Write dropped: the run is still to be painted, the region goes on next tick*/
+				for(n_page = 0u; n_page < n_pages; n_page++) this->_dirty_map[(buffer_index + n_page) >> 5] |= (1u << ((buffer_index + n_page) & 0x1f));
+				return false;
+			}
+
+			this->_refresh_stats.pages += n_pages;
+
+			col += n_pages;
+		}
+
+		/*Row sent*/
+		p_region->row0 = (uint8_t) (cy + 1u);
+	}
+
+	return true;
+}
+
+/*
+ * Bounding box, highest priority, earliest deadline.
+ * A deadline already missed (and counted) gives way to the other one: the late pages go with the newer request, which can miss in turn.
+ */
+
+template<class Geometry>
+void ST7920Panel<Geometry>::_refresh_merge(struct _st7920_refresh_region *p_region, const struct _st7920_refresh_region *p_other)
+{
+	if(p_other->col0 < p_region->col0) p_region->col0 = p_other->col0;
+	if(p_other->col1 > p_region->col1) p_region->col1 = p_other->col1;
+	if(p_other->row0 < p_region->row0) p_region->row0 = p_other->row0;
+	if(p_other->row1 > p_region->row1) p_region->row1 = p_other->row1;
+	if(p_other->priority > p_region->priority) p_region->priority = p_other->priority;
+
+	if(p_other->missed != p_region->missed)
+	{
+		if(p_region->missed) p_region->deadline_us = p_other->deadline_us;
+
+		p_region->missed = false;
+		return;
+	}
+
+	if(((int32_t) (p_other->deadline_us - p_region->deadline_us)) < 0) p_region->deadline_us = p_other->deadline_us;
+
+	return;
+}
+
+template class ST7920Panel<ST7920Geometry128x64>;
+template class ST7920Panel<ST7920Geometry256x32>;
+template class ST7920Panel<ST7920Geometry192x32>;
@@ -0,0 +1,240 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "st7920_shared.hpp"
+
+/*
+ * ST7920SharedBusDisplay
+ */
+
+ST7920SharedBusDisplay::ST7920SharedBusDisplay(ST7920SharedBus &shared, uint8_t e)
+{
+	this->_shared = &shared;
+	this->_e = e;
+}
+
+bool ST7920SharedBusDisplay::begin(void)
+{
+	const uint8_t *pins = NULL;
+
+	if(this->_shared == NULL) return false;
+	if(!this->_shared->_add_display(this)) return false;
+
+	/*The shared pins are read here, not in the constructor: the shared bus might be constructed later (another file)*/
+	pins = this->_shared->_pins;
+	this->_bus.resetPinout(pins[0], pins[1], pins[2], pins[3], pins[4], pins[5], pins[6], pins[7], pins[8], this->PIN_NONE, this->_e);
+
+	return this->_bus.begin();
+}
+
+bool ST7920SharedBusDisplay::writeCommands(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+{
+	this->_write_bytes(false, bytes, n_bytes, cmddelay_us);
+	return true;
+}
+
+bool ST7920SharedBusDisplay::writeData(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+{
+	this->_write_bytes(true, bytes, n_bytes, cmddelay_us);
+	return true;
+}
+
+bool ST7920SharedBusDisplay::idle(void)
+{
+	if(!this->_queue.isEmpty()) return false;
+
+	return this->_ready(micros());
+}
+
+uint32_t ST7920SharedBusDisplay::getFree(void)
+{
+	return this->_queue.getFree();
+}
+
+void ST7920SharedBusDisplay::_write_bytes(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us)
+{
+	uint32_t n_chunk = 0u;
+	uint32_t wait_us = 0u;
+
+	/*Long sequences are queued in chunks, so they don't need the whole queue to be free at once.*/
+	while(n_bytes)
+	{
+		n_chunk = n_bytes;
+		if(n_chunk > this->_MAX_CHUNK) n_chunk = this->_MAX_CHUNK;
+
+		if(!this->_queue.push(reg, bytes, n_chunk, cmddelay_us))
+		{
+			wait_us = this->_shared->_step();
+			if(wait_us) this->_delay(wait_us);
+			continue;
+		}
+
+		bytes += n_chunk;
+		n_bytes -= n_chunk;
+	}
+
+	return;
+}
+
+/*
+ * micros() only counts whole microseconds: the hold is over once strictly more than _hold_us have gone by.
+ */
+
+bool ST7920SharedBusDisplay::_ready(uint32_t now_us)
+{
+	if(!this->_hold_us) return true;
+	if((now_us - this->_sent_us) <= this->_hold_us) return false;
+
+	this->_hold_us = 0u;
+	return true;
+}
+
+/*
+ * ST7920SharedBus
+ */
+
+ST7920SharedBus::ST7920SharedBus(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs)
+{
+	this->_pins[0] = db0;
+	this->_pins[1] = db1;
+	this->_pins[2] = db2;
+	this->_pins[3] = db3;
+	this->_pins[4] = db4;
+	this->_pins[5] = db5;
+	this->_pins[6] = db6;
+	this->_pins[7] = db7;
+	this->_pins[8] = rs;
+}
+
+uint32_t ST7920SharedBus::service(void)
+{
+	ST7920SharedBusDisplay *display = NULL;
+	struct _st7920_transfer transfer;
+	uint32_t n_sent = 0u;
+
+	for(display = this->_displays; display != NULL; display = display->_next)
+	{
+		if(!display->_ready(micros())) continue;
+		if(!display->_queue.pop(&transfer)) continue;
+
+		/*The display delay is covered by the transfers to the other displays*/
+		if(transfer.reg) display->_bus.writeData(&transfer.byte, 1u, 0u);
+		else display->_bus.writeCommands(&transfer.byte, 1u, 0u);
+
+		display->_sent_us = micros();
+		display->_hold_us = transfer.delay_us;
+		n_sent++;
+	}
+
+	this->_transfer_count += n_sent;
+	return n_sent;
+}
+
+void ST7920SharedBus::flush(void)
+{
+	uint32_t wait_us = 0u;
+
+	while(!this->idle())
+	{
+		wait_us = this->_step();
+		if(wait_us) delayMicroseconds(wait_us);
+	}
+
+	return;
+}
+
+bool ST7920SharedBus::idle(void)
+{
+	ST7920SharedBusDisplay *display = NULL;
+
+	for(display = this->_displays; display != NULL; display = display->_next) if(!display->idle()) return false;
+
+	return true;
+}
+
+uint32_t ST7920SharedBus::getDisplayCount(void)
+{
+	ST7920SharedBusDisplay *display = NULL;
+	uint32_t n_displays = 0u;
+
+	for(display = this->_displays; display != NULL; display = display->_next) n_displays++;
+
+	return n_displays;
+}
+
+uint32_t ST7920SharedBus::getTransferCount(void)
+{
+	return this->_transfer_count;
+}
+
+uint32_t ST7920SharedBus::getWaitUs(void)
+{
+	return this->_wait_us;
+}
+
+void ST7920SharedBus::resetCounters(void)
+{
+	this->_transfer_count = 0u;
+	this->_wait_us = 0u;
+	return;
+}
+
+bool ST7920SharedBus::_add_display(ST7920SharedBusDisplay *display)
+{
+	ST7920SharedBusDisplay *other = NULL;
+	uint32_t n_pin = 0u;
+
+	for(n_pin = 0u; n_pin < 9u; n_pin++) if(display->_e == this->_pins[n_pin]) return false;
+
+	for(other = this->_displays; other != NULL; other = other->_next)
+	{
+		/*begin() called again*/
+		if(other == display) return true;
+
+		if(other->_e == display->_e) return false;
+	}
+
+	display->_sent_us = 0u;
+	display->_hold_us = 0u;
+	display->_next = this->_displays;
+	this->_displays = display;
+
+	return true;
+}
+
+uint32_t ST7920SharedBus::_step(void)
+{
+	ST7920SharedBusDisplay *display = NULL;
+	uint32_t now_us = 0u;
+	uint32_t left_us = 0u;
+	uint32_t wait_us = 0u;
+	uint32_t idle_wait_us = 0u;
+
+	if(this->service()) return 0u;
+
+	now_us = micros();
+
+	/*Displays with transfers left come first. The others only matter to flush() (executing their last transfer).*/
+	for(display = this->_displays; display != NULL; display = display->_next)
+	{
+		if(display->_ready(now_us)) continue;
+
+		left_us = display->_hold_us - (now_us - display->_sent_us) + 1u;
+
+		if(display->_queue.isEmpty())
+		{
+			if(!idle_wait_us || (left_us < idle_wait_us)) idle_wait_us = left_us;
+		}
+		else if(!wait_us || (left_us < wait_us)) wait_us = left_us;
+	}
+
+	if(!wait_us) wait_us = idle_wait_us;
+
+	this->_wait_us += wait_us;
+	return wait_us;
+}
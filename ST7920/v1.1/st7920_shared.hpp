@@ -0,0 +1,177 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Several displays on one parallel bus.
+ * DB0 - DB7 and RS are wired to every display, each display has its own E pin. A transfer only takes a couple of microseconds of
+ * bus time, but the display then needs up to ~128us to execute it: ST7920SharedBus sends the other displays their next transfers
+ * within that time, so refreshing N displays takes about as long as refreshing the slowest one.
+ *
+ * Each display gets an ST7920SharedBusDisplay, the bus backend given to its ST7920 object. Its writes are queued (ST7920CommandQueue),
+ * and the shared bus sends the queues, one transfer at a time, to whichever display is done with its previous transfer.
+ * Busy flag polling isn't available (the displays would drive the shared data lines): fixed delays are used.
+ *
+ * Usage:
+ *   ST7920SharedBus bus(db0, db1, db2, db3, db4, db5, db6, db7, rs);
+ *   ST7920SharedBusDisplay bus_a(bus, e_a), bus_b(bus, e_b);
+ *   ST7920 lcd_a(bus_a), lcd_b(bus_b);
+ *   ...
+ *   lcd_a.bufferPaintDirty(); lcd_b.bufferPaintDirty(); bus.flush();
+ *
+ * Transfers only overlap with transfers already queued for the other displays. A write that finds its queue full sends the bus until
+ * there's room, so a paint larger than the queue (a full 128x64 paint is ~1100 transfers) would mostly run alone: queue large paints
+ * in slices, round robin (bufferPaintBegin() on each display, then bufferPaintStep() on each display in turn until all are complete),
+ * or raise ST7920_QUEUE_SIZE.
+ *
+ * The shared bus is sent by the writes (queue full), service() and flush(): these must all run from the same context (not from an
+ * interrupt).
+ */
+
+#ifndef ST7920_SHARED_HPP
+#define ST7920_SHARED_HPP
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "st7920_bus.hpp"
+#include "st7920_queue.hpp"
+
+class ST7920SharedBus;
+
+class ST7920SharedBusDisplay : public ST7920Bus {
+	public:
+		/*
+		 * shared: the bus the display is wired to.
+		 * e: the display E pin (distinct for each display).
+		 */
+
+		ST7920SharedBusDisplay(ST7920SharedBus &shared, uint8_t e);
+
+		/*
+		 * begin()
+		 * Sets up the pins and adds the display to the shared bus. Called by ST7920::begin().
+		 *
+		 * returns true if successful, false otherwise (pins not valid, E pin already used by another display on the bus).
+		 */
+
+		bool begin(void);
+
+		/*
+		 * writeCommands() & writeData()
+		 *
+		 * Queue the transfers and return. If the queue is full, these send the shared bus until there's room (writes are queued in
+		 * chunks of up to ST7920QueuedBus::MAX_WRITE_BYTES, so a write larger than the queue still goes through).
+		 */
+
+		bool writeCommands(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us);
+		bool writeData(const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us);
+
+		/*
+		 * idle()
+		 * returns true if every transfer queued for this display has been sent and executed, false otherwise.
+		 */
+
+		bool idle(void);
+
+		/*
+		 * getFree()
+		 * returns the number of free transfer slots in the queue.
+		 */
+
+		uint32_t getFree(void);
+
+	private:
+		friend class ST7920SharedBus;
+
+		/*A chunk must fit in the empty queue, or the write would send the bus forever waiting for room*/
+		static const uint32_t _MAX_CHUNK = ST7920QueuedBus::MAX_WRITE_BYTES;
+		static_assert(ST7920CommandQueue::SIZE >= _MAX_CHUNK, "ST7920_QUEUE_SIZE must hold a shared bus write chunk (ST7920QueuedBus::MAX_WRITE_BYTES)");
+
+		ST7920SharedBus *_shared = NULL;
+		uint8_t _e = PIN_NONE;
+
+		/*Strobes one transfer on the shared lines with this display E pin (no delay)*/
+		ST7920ParallelBus _bus;
+
+		ST7920CommandQueue _queue;
+
+		/*Time (micros()) the last transfer was sent, and how long the display needs to execute it. _hold_us = 0: display ready.*/
+		uint32_t _sent_us = 0u;
+		uint32_t _hold_us = 0u;
+
+		ST7920SharedBusDisplay *_next = NULL;
+
+		void _write_bytes(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t cmddelay_us);
+
+		bool _ready(uint32_t now_us);
+};
+
+class ST7920SharedBus {
+	public:
+		ST7920SharedBus(uint8_t db0, uint8_t db1, uint8_t db2, uint8_t db3, uint8_t db4, uint8_t db5, uint8_t db6, uint8_t db7, uint8_t rs);
+
+		/*
+		 * service()
+		 * Sends the next queued transfer of every display that is done with its previous one, and returns. Doesn't wait.
+		 *
+		 * returns the number of transfers sent.
+		 */
+
+		uint32_t service(void);
+
+		/*
+		 * flush()
+		 * Sends every queued transfer, interleaving the displays, and waits until they're executed.
+		 */
+
+		void flush(void);
+
+		/*
+		 * idle()
+		 * returns true if every queued transfer of every display has been sent and executed, false otherwise.
+		 */
+
+		bool idle(void);
+
+		/*
+		 * getDisplayCount()
+		 * returns the number of displays added to the bus (by ST7920SharedBusDisplay::begin()).
+		 */
+
+		uint32_t getDisplayCount(void);
+
+		/*
+		 * getTransferCount() & getWaitUs() & resetCounters()
+		 * Number of transfers sent and time spent waiting with no display ready, since the last resetCounters().
+		 */
+
+		uint32_t getTransferCount(void);
+		uint32_t getWaitUs(void);
+		void resetCounters(void);
+
+	private:
+		friend class ST7920SharedBusDisplay;
+
+		uint8_t _pins[9]; /*DB0 - DB7, RS*/
+
+		ST7920SharedBusDisplay *_displays = NULL;
+
+		uint32_t _transfer_count = 0u;
+		uint32_t _wait_us = 0u;
+
+		bool _add_display(ST7920SharedBusDisplay *display);
+
+		/*
+		 * Sends what's ready. If nothing is, returns how long to wait (microseconds) until the first display that has transfers left is
+		 * ready (the caller waits, so the wait is counted as its delay). 0: something was sent, or nothing is left.
+		 */
+		uint32_t _step(void);
+};
+
+#endif /*ST7920_SHARED_HPP*/
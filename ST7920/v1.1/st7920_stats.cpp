@@ -0,0 +1,185 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "st7920_stats.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char *st7920_stats_method_names[ST7920_STATS_N_METHODS] = {
+	"begin",
+	"enableGraphicDisplay",
+	"bufferSetAll",
+	"bufferToggleAll",
+	"bufferSetPixels",
+	"bufferSetPackedPixels",
+	"bufferDrawHLine",
+	"bufferDrawVLine",
+	"bufferDrawLine",
+	"bufferDrawRect",
+	"bufferFillRect",
+	"bufferDrawCircle",
+	"bufferFillCircle",
+	"bufferDrawEllipse",
+	"bufferFillEllipse",
+	"bufferDrawArc",
+	"bufferBlit",
+	"bufferDrawChar",
+	"bufferDrawText",
+	"bufferPaintPixel",
+	"bufferPaintPage",
+	"bufferPaintAll",
+	"bufferPaintDirty",
+	"bufferPaintBegin",
+	"bufferPaintStep",
+	"bufferPublish",
+	"bufferPaintFrame",
+	"bufferAnimationFrame",
+	"clearGraphics",
+	"setDisplayMode",
+	"clearText",
+	"cursorHome",
+	"setTextCursorPosition",
+	"setWTextCursorPosition",
+	"printChar",
+	"printText",
+	"printWChar",
+	"printWText",
+	"loadCgramGlyph",
+	"printCgramGlyph",
+	"fillScreenChar",
+	"fillScreenWChar",
+	"clearDisplay",
+	"scrollDisplay",
+	"refreshTick",
+	"other"
+};
+
+ST7920Stats::ST7920Stats(void)
+{
+	this->reset();
+}
+
+void ST7920Stats::enter(uint32_t method)
+{
+	this->_depth++;
+	if(this->_depth > 1u) return;
+
+	if(method >= ST7920_STATS_N_METHODS) method = ST7920_STATS_OTHER;
+
+	this->_method = method;
+	this->_start_cycles = st7920_stats_cycles();
+	return;
+}
+
+void ST7920Stats::leave(void)
+{
+	struct _st7920_method_stats *p_method = NULL;
+	uint32_t cycles = 0u;
+
+	if(!this->_depth) return;
+
+	this->_depth--;
+	if(this->_depth) return;
+
+	cycles = st7920_stats_cycles() - this->_start_cycles;
+	p_method = &this->_stats.methods[this->_method];
+
+	p_method->calls++;
+	p_method->total_cycles += cycles;
+	if(cycles > p_method->max_cycles) p_method->max_cycles = cycles;
+	p_method->histogram[this->getHistogramBucket(cycles)]++;
+
+	this->_method = ST7920_STATS_OTHER;
+	return;
+}
+
+void ST7920Stats::countTransfer(bool reg, uint32_t n_bytes, uint32_t delay_us, uint32_t bus_cycles)
+{
+	struct _st7920_method_stats *p_method = &this->_stats.methods[this->_method];
+
+	p_method->bytes += n_bytes;
+	if(!reg) p_method->commands += n_bytes;
+	p_method->delay_us += delay_us;
+
+	this->_bus_cycles[this->_method] += bus_cycles;
+	return;
+}
+
+void ST7920Stats::countModeSwitch(void)
+{
+	this->_stats.methods[this->_method].mode_switches++;
+	return;
+}
+
+void ST7920Stats::getSnapshot(struct _st7920_stats *p_stats)
+{
+	uint32_t n_method = 0u;
+	uint64_t bus_us = 0u;
+
+	if(p_stats == NULL) return;
+
+	memcpy(p_stats, &this->_stats, sizeof(struct _st7920_stats));
+
+	/*Bus time not spent in delays: pin toggling*/
+	for(n_method = 0u; n_method < ST7920_STATS_N_METHODS; n_method++)
+	{
+		bus_us = this->_bus_cycles[n_method]/this->_stats.cycles_per_us;
+
+		p_stats->methods[n_method].pin_us = 0u;
+		if(bus_us > p_stats->methods[n_method].delay_us) p_stats->methods[n_method].pin_us = bus_us - p_stats->methods[n_method].delay_us;
+	}
+
+	return;
+}
+
+void ST7920Stats::reset(void)
+{
+	/*Teensy 3.x: the cycle counter is off after reset*/
+#if defined(ARM_DEMCR) && defined(ARM_DWT_CTRL) && defined(ARM_DEMCR_TRCENA) && defined(ARM_DWT_CTRL_CYCCNTENA)
+	ARM_DEMCR |= ARM_DEMCR_TRCENA;
+	ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+
+	memset(&this->_stats, 0, sizeof(struct _st7920_stats));
+	memset(this->_bus_cycles, 0, sizeof(this->_bus_cycles));
+
+	this->_stats.cycles_per_us = this->getCyclesPerUs();
+
+	/*A call in progress is counted from the reset*/
+	this->_start_cycles = st7920_stats_cycles();
+	return;
+}
+
+uint32_t ST7920Stats::getHistogramBucket(uint32_t cycles)
+{
+	uint32_t bucket = 0u;
+
+	if(cycles) bucket = 32u - (uint32_t) __builtin_clz(cycles);
+	if(bucket >= ST7920_STATS_HISTOGRAM_SIZE) bucket = ST7920_STATS_HISTOGRAM_SIZE - 1u;
+
+	return bucket;
+}
+
+uint32_t ST7920Stats::getCyclesPerUs(void)
+{
+#if defined(ARM_DWT_CYCCNT) && defined(__IMXRT1062__)
+	return F_CPU_ACTUAL/1000000u;
+#elif defined(ARM_DWT_CYCCNT)
+	return F_CPU/1000000u;
+#else
+	return 1u;
+#endif
+}
+
+const char *ST7920Stats::getMethodName(uint32_t method)
+{
+	if(method >= ST7920_STATS_N_METHODS) return "";
+
+	return st7920_stats_method_names[method];
+}
@@ -0,0 +1,213 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Performance counters (ST7920::getStats() & resetStats()).
+ *
+ * Compiled out by default. Define ST7920_STATS for the whole build (compiler flags, e.g. -DST7920_STATS, or uncomment the define below)
+ * to count, for each public method that does any work:
+ * calls, bytes and commands sent, instruction set switches (basic <-> extended), time spent in delayMicroseconds() by the bus backend and
+ * the rest of the bus time (pin toggling, SPI transfers), total and longest call duration, and a histogram of call durations in
+ * log2 buckets of CPU cycles (cycle counter: ARM_DWT_CYCCNT where available, micros() otherwise).
+ *
+ * A public method called by another one is counted as part of the outer call. Bus traffic outside any counted call goes to
+ * ST7920_STATS_OTHER. Not interrupt safe: a counted call made from an interrupt (e.g. bufferPaintFrame()) while another one is running
+ * is counted as part of the interrupted call.
+ *
+ * Dump example:
+ *   struct _st7920_stats stats;
+ *   lcd.getStats(&stats);
+ *   for(n = 0; n < ST7920_STATS_N_METHODS; n++) if(stats.methods[n].calls) Serial.printf("%s %u %u\n", ST7920Stats::getMethodName(n), stats.methods[n].calls, stats.methods[n].bytes);
+ */
+
+#ifndef ST7920_STATS_HPP
+#define ST7920_STATS_HPP
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <Arduino.h>
+
+/*#define ST7920_STATS*/
+
+/*
+ * Number of histogram buckets (log2 of the call duration in cycles). The last bucket takes everything longer.
+ */
+
+#ifndef ST7920_STATS_HISTOGRAM_SIZE
+#define ST7920_STATS_HISTOGRAM_SIZE 32u
+#endif
+
+enum st7920_stats_method {
+	ST7920_STATS_BEGIN = 0,
+	ST7920_STATS_ENABLE_GRAPHIC_DISPLAY,
+	ST7920_STATS_BUFFER_SET_ALL,
+	ST7920_STATS_BUFFER_TOGGLE_ALL,
+	ST7920_STATS_BUFFER_SET_PIXELS,
+	ST7920_STATS_BUFFER_SET_PACKED_PIXELS,
+	ST7920_STATS_BUFFER_DRAW_HLINE,
+	ST7920_STATS_BUFFER_DRAW_VLINE,
+	ST7920_STATS_BUFFER_DRAW_LINE,
+	ST7920_STATS_BUFFER_DRAW_RECT,
+	ST7920_STATS_BUFFER_FILL_RECT,
+	ST7920_STATS_BUFFER_DRAW_CIRCLE,
+	ST7920_STATS_BUFFER_FILL_CIRCLE,
+	ST7920_STATS_BUFFER_DRAW_ELLIPSE,
+	ST7920_STATS_BUFFER_FILL_ELLIPSE,
+	ST7920_STATS_BUFFER_DRAW_ARC,
+	ST7920_STATS_BUFFER_BLIT,
+	ST7920_STATS_BUFFER_DRAW_CHAR,
+	ST7920_STATS_BUFFER_DRAW_TEXT,
+	ST7920_STATS_BUFFER_PAINT_PIXEL,
+	ST7920_STATS_BUFFER_PAINT_PAGE,
+	ST7920_STATS_BUFFER_PAINT_ALL,
+	ST7920_STATS_BUFFER_PAINT_DIRTY,
+	ST7920_STATS_BUFFER_PAINT_BEGIN,
+	ST7920_STATS_BUFFER_PAINT_STEP,
+	ST7920_STATS_BUFFER_PUBLISH,
+	ST7920_STATS_BUFFER_PAINT_FRAME,
+	ST7920_STATS_BUFFER_ANIMATION_FRAME,
+	ST7920_STATS_CLEAR_GRAPHICS,
+	ST7920_STATS_SET_DISPLAY_MODE,
+	ST7920_STATS_CLEAR_TEXT,
+	ST7920_STATS_CURSOR_HOME,
+	ST7920_STATS_SET_TEXT_CURSOR_POSITION,
+	ST7920_STATS_SET_WTEXT_CURSOR_POSITION,
+	ST7920_STATS_PRINT_CHAR,
+	ST7920_STATS_PRINT_TEXT,
+	ST7920_STATS_PRINT_WCHAR,
+	ST7920_STATS_PRINT_WTEXT,
+	ST7920_STATS_LOAD_CGRAM_GLYPH,
+	ST7920_STATS_PRINT_CGRAM_GLYPH,
+	ST7920_STATS_FILL_SCREEN_CHAR,
+	ST7920_STATS_FILL_SCREEN_WCHAR,
+	ST7920_STATS_CLEAR_DISPLAY,
+	ST7920_STATS_SCROLL_DISPLAY,
+	ST7920_STATS_REFRESH_TICK,
+	ST7920_STATS_OTHER,
+	ST7920_STATS_N_METHODS
+};
+
+struct _st7920_method_stats {
+	uint32_t calls;
+	uint32_t bytes; /*Commands + data*/
+	uint32_t commands;
+	uint32_t mode_switches; /*Basic <-> extended instruction set*/
+	uint64_t delay_us; /*Bus time spent in delayMicroseconds()*/
+	uint64_t pin_us; /*Rest of the bus time (pin toggling, SPI transfers, busy flag polling)*/
+	uint64_t total_cycles;
+	uint32_t max_cycles;
+	uint32_t histogram[ST7920_STATS_HISTOGRAM_SIZE]; /*Calls by duration. Bucket n: 2^(n - 1) <= cycles < 2^n (bucket 0: 0 cycles)*/
+};
+
+struct _st7920_stats {
+	uint32_t cycles_per_us;
+	struct _st7920_method_stats methods[ST7920_STATS_N_METHODS];
+};
+
+/*
+ * st7920_stats_cycles()
+ * returns the cycle counter.
+ */
+
+static inline uint32_t st7920_stats_cycles(void)
+{
+#ifdef ARM_DWT_CYCCNT
+	return (uint32_t) ARM_DWT_CYCCNT;
+#else
+	return micros();
+#endif
+}
+
+class ST7920Stats {
+	public:
+		ST7920Stats(void);
+
+		/*
+		 * enter() & leave()
+		 * Start/end of a counted call. Calls made in between (nested) are counted as part of it.
+		 */
+
+		void enter(uint32_t method);
+		void leave(void);
+
+		/*
+		 * countTransfer()
+		 * A bus write of n_bytes (commands if reg is false), that took bus_cycles, delay_us of which in delayMicroseconds().
+		 */
+
+		void countTransfer(bool reg, uint32_t n_bytes, uint32_t delay_us, uint32_t bus_cycles);
+
+		/*
+		 * countModeSwitch()
+		 * An instruction set switch (function set command) was sent.
+		 */
+
+		void countModeSwitch(void);
+
+		/*
+		 * getSnapshot() & reset()
+		 * Copies/clears the counters.
+		 */
+
+		void getSnapshot(struct _st7920_stats *p_stats);
+		void reset(void);
+
+		/*
+		 * getHistogramBucket()
+		 * returns the histogram bucket of a call that took cycles.
+		 */
+
+		static uint32_t getHistogramBucket(uint32_t cycles);
+
+		/*
+		 * getCyclesPerUs()
+		 * returns the cycle counter rate.
+		 */
+
+		static uint32_t getCyclesPerUs(void);
+
+		/*
+		 * getMethodName()
+		 * returns the name of a counted method (e.g. "bufferPaintAll"), "" if method isn't valid.
+		 */
+
+		static const char *getMethodName(uint32_t method);
+
+	private:
+		struct _st7920_stats _stats;
+
+		/*Bus cycles of each method: converted to pin_us by getSnapshot()*/
+		uint64_t _bus_cycles[ST7920_STATS_N_METHODS];
+
+		uint32_t _depth = 0u;
+		uint32_t _method = ST7920_STATS_OTHER;
+		uint32_t _start_cycles = 0u;
+};
+
+/*
+ * ST7920StatsScope
+ * Counts a call from construction to destruction (every return path).
+ */
+
+class ST7920StatsScope {
+	public:
+		ST7920StatsScope(ST7920Stats &stats, uint32_t method) : _stats(stats) { this->_stats.enter(method); }
+		~ST7920StatsScope(void) { this->_stats.leave(); }
+
+	private:
+		ST7920Stats &_stats;
+};
+
+#ifdef ST7920_STATS
+#define ST7920_STATS_SCOPE(method) ST7920StatsScope _stats_scope(this->_stats, (method))
+#else
+#define ST7920_STATS_SCOPE(method)
+#endif
+
+#endif /*ST7920_STATS_HPP*/
@@ -0,0 +1,367 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+#include "st7920_trace.hpp"
+#include "st7920_stats.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+/*E pulse drawn in the VCD export (ns), shortened when the next transfer comes sooner*/
+#define ST7920_TRACE_VCD_E_PULSE_NS 450u
+
+/*Instruction set state tracked by exportText()*/
+struct _st7920_trace_decoder {
+	bool extended;
+	bool scroll_select; /*Extended SR bit: 0x40 - 0x7f sets the scroll position instead of the IRAM address*/
+	bool gdram_y_set; /*Extended 0x80 - 0xff: the first one sets Y, the second X*/
+	int32_t function_set; /*Last function set sent, -1: none*/
+	const char *target; /*Where data goes*/
+	uint32_t n_commands;
+	uint32_t n_data;
+	uint32_t n_redundant;
+};
+
+static void st7920_trace_decode(struct _st7920_trace_decoder *p_decoder, const struct _st7920_trace_entry *p_entry, char *text, size_t size)
+{
+	uint8_t byte = p_entry->byte;
+	bool redundant = false;
+
+	if(p_entry->reg)
+	{
+		p_decoder->n_data++;
+
+		if((byte >= 0x20) && (byte < 0x7f) && !strcmp(p_decoder->target, "DDRAM")) snprintf(text, size, "DATA DDRAM '%c'", (char) byte);
+		else snprintf(text, size, "DATA %s", p_decoder->target);
+
+		return;
+	}
+
+	p_decoder->n_commands++;
+
+	if((byte & 0xe0) == 0x20)
+	{
+		redundant = (p_decoder->function_set == (int32_t) byte);
+		if(redundant) p_decoder->n_redundant++;
+
+		p_decoder->function_set = byte;
+		p_decoder->extended = (byte & 0x04) != 0;
+		p_decoder->gdram_y_set = false;
+
+		snprintf(text, size, "FUNCTION_SET %s %s%s%s", (byte & 0x10) ? "8BIT" : "4BIT", p_decoder->extended ? "EXTENDED" : "BASIC",
+			p_decoder->extended ? ((byte & 0x02) ? " GRAPHICS_ON" : " GRAPHICS_OFF") : "", redundant ? " (redundant)" : "");
+
+		return;
+	}
+
+	if(!p_decoder->extended)
+	{
+		if(byte & 0x80)
+		{
+			p_decoder->target = "DDRAM";
+			snprintf(text, size, "SET_DDRAM_ADDR %02X", (byte & 0x7f));
+		}
+		else if(byte & 0x40)
+		{
+			p_decoder->target = "CGRAM";
+			snprintf(text, size, "SET_CGRAM_ADDR %02X", (byte & 0x3f));
+		}
+		else if(byte & 0x10) snprintf(text, size, "CURSOR_SHIFT %s %s", (byte & 0x08) ? "DISPLAY" : "CURSOR", (byte & 0x04) ? "RIGHT" : "LEFT");
+		else if(byte & 0x08) snprintf(text, size, "DISPLAY_CONTROL D=%u C=%u B=%u", ((byte >> 2) & 1u), ((byte >> 1) & 1u), (byte & 1u));
+		else if(byte & 0x04) snprintf(text, size, "ENTRY_MODE %s%s", (byte & 0x02) ? "INC" : "DEC", (byte & 0x01) ? " SHIFT" : "");
+		else if(byte & 0x02)
+		{
+			p_decoder->target = "DDRAM";
+			snprintf(text, size, "HOME");
+		}
+		else if(byte & 0x01)
+		{
+			p_decoder->target = "DDRAM";
+			snprintf(text, size, "CLEAR");
+		}
+		else snprintf(text, size, "UNKNOWN");
+
+		return;
+	}
+
+	if(byte & 0x80)
+	{
+		p_decoder->target = "GDRAM";
+
+		if(p_decoder->gdram_y_set) snprintf(text, size, "SET_GDRAM_X %u", (byte & 0x0f));
+		else snprintf(text, size, "SET_GDRAM_Y %u", (byte & 0x3f));
+
+		p_decoder->gdram_y_set = !p_decoder->gdram_y_set;
+		return;
+	}
+
+	p_decoder->gdram_y_set = false;
+
+	if(byte & 0x40)
+	{
+		if(p_decoder->scroll_select) snprintf(text, size, "SET_SCROLL_ADDR %u", (byte & 0x3f));
+		else snprintf(text, size, "SET_IRAM_ADDR %02X", (byte & 0x3f));
+	}
+	else if(byte & 0x10) snprintf(text, size, "UNKNOWN");
+	else if(byte & 0x08) snprintf(text, size, "SLEEP %u", ((byte >> 2) & 1u) ? 0u : 1u);
+	else if(byte & 0x04) snprintf(text, size, "REVERSE %u", (byte & 0x03));
+	else if(byte & 0x02)
+	{
+		p_decoder->scroll_select = (byte & 0x01) != 0;
+		snprintf(text, size, "SCROLL_SELECT %s", p_decoder->scroll_select ? "SCROLL" : "IRAM");
+	}
+	else if(byte & 0x01) snprintf(text, size, "STANDBY");
+	else snprintf(text, size, "UNKNOWN");
+
+	return;
+}
+
+/*Writes "#time_ns" if the VCD time moved*/
+static void st7920_trace_vcd_time(st7920_trace_output output, void *context, uint64_t *p_vcd_time_ns, uint64_t time_ns)
+{
+	char text[32];
+
+	if(time_ns == *p_vcd_time_ns) return;
+
+	/*Printed in two parts past 32 bits*/
+	if(time_ns >= 1000000000u) snprintf(text, sizeof(text), "#%lu%09lu\n", (unsigned long) (time_ns/1000000000u), (unsigned long) (time_ns%1000000000u));
+	else snprintf(text, sizeof(text), "#%lu\n", (unsigned long) time_ns);
+
+	output(context, text);
+	*p_vcd_time_ns = time_ns;
+	return;
+}
+
+ST7920Tracer::ST7920Tracer(struct _st7920_trace_entry *entries, uint32_t n_entries)
+{
+	if(entries == NULL) return;
+	if(!n_entries || (n_entries & (n_entries - 1u))) return;
+
+	this->_entries = entries;
+	this->_index_mask = n_entries - 1u;
+
+	/*Teensy 3.x: the cycle counter is off after reset*/
+#if defined(ARM_DEMCR) && defined(ARM_DWT_CTRL) && defined(ARM_DEMCR_TRCENA) && defined(ARM_DWT_CTRL_CYCCNTENA)
+	ARM_DEMCR |= ARM_DEMCR_TRCENA;
+	ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+}
+
+bool ST7920Tracer::isValid(void)
+{
+	return this->_entries != NULL;
+}
+
+void ST7920Tracer::record(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t delay_us, uint32_t start_cycles, uint32_t end_cycles)
+{
+	struct _st7920_trace_entry *p_entry = NULL;
+	uint32_t n_byte = 0u;
+	uint32_t cycles = start_cycles;
+	uint32_t step_cycles = 0u;
+
+	if(this->_entries == NULL) return;
+	if(bytes == NULL) return;
+
+	if(n_bytes > 1u) step_cycles = (end_cycles - start_cycles)/n_bytes;
+	if(delay_us > 0xffff) delay_us = 0xffff;
+
+	for(n_byte = 0u; n_byte < n_bytes; n_byte++)
+	{
+		p_entry = &this->_entries[this->_n_recorded & this->_index_mask];
+
+		p_entry->cycles = cycles;
+		p_entry->delay_us = (uint16_t) delay_us;
+		p_entry->reg = (uint8_t) reg;
+		p_entry->byte = bytes[n_byte];
+
+		this->_n_recorded++;
+		cycles += step_cycles;
+	}
+
+	return;
+}
+
+void ST7920Tracer::clear(void)
+{
+	this->_n_recorded = 0u;
+	return;
+}
+
+uint32_t ST7920Tracer::getCount(void)
+{
+	if(this->_entries == NULL) return 0u;
+	if(this->_n_recorded > this->_index_mask) return this->_index_mask + 1u;
+
+	return this->_n_recorded;
+}
+
+uint32_t ST7920Tracer::getLostCount(void)
+{
+	return this->_n_recorded - this->getCount();
+}
+
+bool ST7920Tracer::getEntry(uint32_t index, struct _st7920_trace_entry *p_entry)
+{
+	if(p_entry == NULL) return false;
+	if(index >= this->getCount()) return false;
+
+	*p_entry = this->_entries[(this->_first() + index) & this->_index_mask];
+	return true;
+}
+
+void ST7920Tracer::exportVcd(st7920_trace_output output, void *context)
+{
+	struct _st7920_trace_entry entry;
+	struct _st7920_trace_entry next_entry;
+	uint32_t n_entries = this->getCount();
+	uint32_t n_entry = 0u;
+	uint32_t n_bit = 0u;
+	uint32_t cycles_per_us = ST7920Stats::getCyclesPerUs();
+	uint64_t cycles = 0u; /*Since the oldest entry*/
+	uint64_t next_cycles = 0u;
+	uint64_t vcd_time_ns = 0u; /*Last time written*/
+	uint64_t min_time_ns = 0u; /*Earliest the next strobe can be drawn*/
+	uint64_t time_ns = 0u;
+	uint64_t next_time_ns = 0u;
+	uint64_t fall_time_ns = 0u;
+	uint64_t hold_end_ns = 0u;
+	bool hold = false;
+	char text[32];
+
+	if(output == NULL) return;
+
+	output(context, "$comment ST7920 bus trace $end\n$timescale 1ns $end\n$scope module st7920 $end\n");
+	output(context, "$var wire 1 ! rs $end\n$var wire 1 \" e $end\n$var wire 8 # db [7:0] $end\n$var wire 1 $ hold $end\n");
+	output(context, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n0!\n0\"\nb0 #\n0$\n$end\n");
+
+	if(!n_entries) return;
+
+	this->getEntry(0u, &next_entry);
+
+	for(n_entry = 0u; n_entry < n_entries; n_entry++)
+	{
+		entry = next_entry;
+		cycles = next_cycles;
+
+		time_ns = (cycles*1000u)/cycles_per_us;
+		if(time_ns < min_time_ns) time_ns = min_time_ns;
+
+		/*Next strobe time, or past this one's delay for the last*/
+		if(this->getEntry((n_entry + 1u), &next_entry))
+		{
+			next_cycles = cycles + (uint32_t) (next_entry.cycles - entry.cycles);
+			next_time_ns = (next_cycles*1000u)/cycles_per_us;
+		}
+		else next_time_ns = time_ns + ST7920_TRACE_VCD_E_PULSE_NS + 1000u*entry.delay_us + 1u;
+
+		if(hold)
+		{
+			if(hold_end_ns > time_ns) hold_end_ns = time_ns;
+
+			st7920_trace_vcd_time(output, context, &vcd_time_ns, hold_end_ns);
+			output(context, "0$\n");
+			hold = false;
+		}
+
+		/*E rises with RS and DB set*/
+		st7920_trace_vcd_time(output, context, &vcd_time_ns, time_ns);
+
+		snprintf(text, sizeof(text), "%u!\nb", (entry.reg ? 1u : 0u));
+		output(context, text);
+
+		for(n_bit = 0u; n_bit < 8u; n_bit++) text[n_bit] = (entry.byte & (0x80 >> n_bit)) ? '1' : '0';
+		text[8] = '\0';
+		output(context, text);
+		output(context, " #\n1\"\n");
+
+		/*E falls, the command delay starts*/
+		fall_time_ns = ST7920_TRACE_VCD_E_PULSE_NS;
+		if(next_time_ns > time_ns)
+		{
+			if((next_time_ns - time_ns)/2u < fall_time_ns) fall_time_ns = (next_time_ns - time_ns)/2u;
+		}
+		if(!fall_time_ns) fall_time_ns = 1u;
+
+		fall_time_ns += time_ns;
+
+		st7920_trace_vcd_time(output, context, &vcd_time_ns, fall_time_ns);
+		output(context, "0\"\n");
+
+		if(entry.delay_us)
+		{
+			output(context, "1$\n");
+			hold = true;
+			hold_end_ns = fall_time_ns + 1000u*entry.delay_us;
+		}
+
+		min_time_ns = fall_time_ns + 1u;
+	}
+
+	if(hold)
+	{
+		st7920_trace_vcd_time(output, context, &vcd_time_ns, hold_end_ns);
+		output(context, "0$\n");
+	}
+
+	return;
+}
+
+void ST7920Tracer::exportText(st7920_trace_output output, void *context, bool timestamps)
+{
+	struct _st7920_trace_decoder decoder = {false, false, false, -1, "DDRAM", 0u, 0u, 0u};
+	struct _st7920_trace_entry entry;
+	uint32_t n_entries = this->getCount();
+	uint32_t n_entry = 0u;
+	uint32_t cycles_per_us = ST7920Stats::getCyclesPerUs();
+	uint32_t prev_cycles = 0u;
+	uint64_t cycles = 0u;
+	uint64_t time_ns = 0u;
+	char mnemonic[64];
+	char text[112];
+
+	if(output == NULL) return;
+
+	snprintf(text, sizeof(text), "# ST7920 bus trace: %lu transfers\n", (unsigned long) n_entries);
+	output(context, text);
+
+	/*The trace doesn't start at a known state: assume the power on one*/
+	if(this->getLostCount())
+	{
+		snprintf(text, sizeof(text), "# %lu earlier transfers lost: basic instruction set assumed up to the first FUNCTION_SET\n", (unsigned long) this->getLostCount());
+		output(context, text);
+	}
+
+	for(n_entry = 0u; n_entry < n_entries; n_entry++)
+	{
+		this->getEntry(n_entry, &entry);
+
+		if(n_entry) cycles += (uint32_t) (entry.cycles - prev_cycles);
+		prev_cycles = entry.cycles;
+
+		st7920_trace_decode(&decoder, &entry, mnemonic, sizeof(mnemonic));
+
+		if(timestamps)
+		{
+			time_ns = (cycles*1000u)/cycles_per_us;
+			snprintf(text, sizeof(text), "%10lu.%03lu %c %02X %s +%uus\n", (unsigned long) (time_ns/1000u), (unsigned long) (time_ns%1000u), (entry.reg ? 'D' : 'C'), entry.byte, mnemonic, entry.delay_us);
+		}
+		else snprintf(text, sizeof(text), "%c %02X %s\n", (entry.reg ? 'D' : 'C'), entry.byte, mnemonic);
+
+		output(context, text);
+	}
+
+	snprintf(text, sizeof(text), "# %lu commands (%lu redundant function sets), %lu data\n", (unsigned long) decoder.n_commands, (unsigned long) decoder.n_redundant, (unsigned long) decoder.n_data);
+	output(context, text);
+
+	return;
+}
+
+uint32_t ST7920Tracer::_first(void)
+{
+	return this->_n_recorded - this->getCount();
+}
@@ -0,0 +1,112 @@
+/*
+ * ST7920 Driver for Teensy boards (Arduino IDE) (128x64, 256x32 & 192x32 ST7920 Displays)
+ * Version 1.1
+ *
+ * Author: Rafael Sabe
+ * Email: rafaelmsabe@gmail.com
+ */
+
+/*
+ * Bus trace recorder (ST7920::setTracer()).
+ *
+ * While a tracer is set, every byte the driver sends is recorded into a ring buffer (oldest entries overwritten): time (cycle counter),
+ * RS, byte value and the command delay asked of the bus. Bytes sent together get times spread evenly over the write.
+ * The time is when the driver hands the byte to the bus: with a queued bus (ST7920QueuedBus, ST7920SharedBus), not when it's strobed.
+ * Recording costs a cycle counter read per write and 8 bytes of RAM per entry. With no tracer set, a pointer check per write.
+ *
+ * Exports (text, line by line, to an output function, e.g. writing to Serial or a file):
+ * exportVcd(): Value Change Dump (GTKWave, PulseView...): rs, e, db[7:0] and hold (the command delay after each strobe), 1ns timescale.
+ * exportText(): one line per transfer, with ST7920 mnemonics (instruction set tracked along the trace). Without timestamps, traces of
+ * two driver versions running the same code can be diffed.
+ *
+ * The cycle counter wraps (about 7s at 600MHz): a longer gap between two transfers shows shorter in the exports.
+ * Not interrupt safe: record from one context, and export/clear while the driver isn't sending (e.g. after setTracer(NULL)).
+ */
+
+#ifndef ST7920_TRACE_HPP
+#define ST7920_TRACE_HPP
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+struct _st7920_trace_entry {
+	uint32_t cycles;
+	uint16_t delay_us;
+	uint8_t reg; /*0: command, 1: data*/
+	uint8_t byte;
+};
+
+/*
+ * Output function for the exports: called with each piece of text (null terminated), in order.
+ */
+
+typedef void (*st7920_trace_output)(void *context, const char *text);
+
+class ST7920Tracer {
+	public:
+		/*
+		 * entries: storage for n_entries trace entries (n_entries must be a power of 2). Must stay valid for as long as the tracer is in use.
+		 */
+
+		ST7920Tracer(struct _st7920_trace_entry *entries, uint32_t n_entries);
+
+		/*
+		 * isValid()
+		 * returns true if the storage given to the constructor can be used, false otherwise.
+		 */
+
+		bool isValid(void);
+
+		/*
+		 * record()
+		 * Records n_bytes transfers, written to the bus between start_cycles and end_cycles. Called by the driver.
+		 */
+
+		void record(bool reg, const uint8_t *bytes, uint32_t n_bytes, uint32_t delay_us, uint32_t start_cycles, uint32_t end_cycles);
+
+		/*
+		 * clear()
+		 * Drops every entry and resets the lost count.
+		 */
+
+		void clear(void);
+
+		/*
+		 * getCount() & getLostCount()
+		 * Number of entries held / entries overwritten since the last clear().
+		 */
+
+		uint32_t getCount(void);
+		uint32_t getLostCount(void);
+
+		/*
+		 * getEntry()
+		 * Copies entry index (0: oldest held).
+		 *
+		 * returns true if successful, false if index is out of range.
+		 */
+
+		bool getEntry(uint32_t index, struct _st7920_trace_entry *p_entry);
+
+		/*
+		 * exportVcd() & exportText()
+		 * Write the entries held, oldest first. Times are relative to the oldest entry.
+		 * timestamps (exportText()): prefix each line with its time (microseconds) and end with the command delay.
+		 */
+
+		void exportVcd(st7920_trace_output output, void *context);
+		void exportText(st7920_trace_output output, void *context, bool timestamps);
+
+	private:
+		struct _st7920_trace_entry *_entries = NULL;
+		uint32_t _index_mask = 0u;
+
+		/*Free running: entries recorded since the last clear()*/
+		uint32_t _n_recorded = 0u;
+
+		/*Index (in _entries) of the oldest entry held*/
+		uint32_t _first(void);
+};
+
+#endif /*ST7920_TRACE_HPP*/